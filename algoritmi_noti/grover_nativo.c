@@ -0,0 +1,36 @@
+#include "../src/quantum_sim.h"
+#include "../src/quantum_algorithms.h"
+#include <math.h>
+#include <complex.h>
+#include <stdio.h>
+
+#define NUM_QUBITS 10
+#define TARGET 0x2A5
+
+// Algoritmo di Grover con gli operatori nativi: ogni iterazione costa
+// un'inversione di segno sull'indice marcato e due passaggi per il diffusore.
+void circuit() {
+    QubitState *state = initializeState(NUM_QUBITS);
+
+    // Sovrapposizione uniforme
+    for (int i = 0; i < NUM_QUBITS; i++) {
+        applyHadamard(state, i);
+    }
+
+    long long marked[1] = { TARGET };
+    int iterations = (int)floor(acos(-1) / 4.0 * sqrt((double)(1 << NUM_QUBITS)));
+    printf("[INFO] %d iterazioni di Grover su %d qubit\n", iterations, NUM_QUBITS);
+
+    for (int k = 0; k < iterations; k++) {
+        applyPhaseOracle(state, marked, 1);
+        applyDiffusion(state, 0, NUM_QUBITS);
+    }
+
+    // In dry-run (QuantumSim trace --dry-run) le ampiezze non vengono allocate
+    if (state->amplitudes) {
+        double p = pow(cabs(state->amplitudes[TARGET]), 2);
+        printf("[INFO] Probabilità dello stato marcato %d: %f\n", TARGET, p);
+    }
+
+    freeState(state);
+}
@@ -1,48 +1,34 @@
 OPENQASM 2.0;
 include "qelib1.inc";
-qreg q[0];
-creg c[0];
-// Istruzione non riconosciuta: #include "quantum_sim.h"
-// Istruzione non riconosciuta: #include <stdio.h>
-// Istruzione non riconosciuta: #include <stdlib.h>
-// Istruzione non riconosciuta: #include <complex.h>
-// Istruzione non riconosciuta: #include <math.h>
-// Istruzione non riconosciuta: 
-// Istruzione non riconosciuta: 
-// Istruzione non riconosciuta: 
-// Istruzione non riconosciuta: void circuit() {
-// Istruzione non riconosciuta:     int numQubits = 2;
-// Istruzione non riconosciuta: 
-// Istruzione non riconosciuta:     // Inizializzazione degli stati: |0>|1>
+qreg q[2];
+creg c[4];
+x q[1];
+h q[0];
+h q[1];
+h q[0];
+measure q[0] -> c[0];
+reset q[0];
+reset q[1];
+x q[1];
+h q[0];
+h q[1];
+x q[1];
+h q[0];
+measure q[0] -> c[1];
+reset q[0];
+reset q[1];
 x q[1];
-// Istruzione non riconosciuta: 
-// Istruzione non riconosciuta:     // Applica Hadamard a entrambi i qubit
 h q[0];
 h q[1];
-// Istruzione non riconosciuta: 
-// Istruzione non riconosciuta:     printf("Stato dopo Hadamard su entrambi i qubit:\n");
-// Istruzione non riconosciuta:     printState(state);
-// Istruzione non riconosciuta: 
-// Istruzione non riconosciuta:     // Implementazione dell'oracolo U_f: qui useremo una funzione bilanciata
-// Istruzione non riconosciuta:     // Supponiamo che f(x) = x (quindi l'oracolo inverte il secondo qubit se il primo è 1)
 cx q[0],q[1];
-// Istruzione non riconosciuta: 
-// Istruzione non riconosciuta:     printf("Stato dopo l'applicazione dell'oracolo U_f (bilanciato):\n");
-// Istruzione non riconosciuta:     printState(state);
-// Istruzione non riconosciuta: 
-// Istruzione non riconosciuta:     // Applica Hadamard al primo qubit
-h q[0];
-// Istruzione non riconosciuta: 
-// Istruzione non riconosciuta:     printf("Stato dopo l'ultima applicazione di Hadamard al primo qubit:\n");
-// Istruzione non riconosciuta:     printState(state);
-// Istruzione non riconosciuta: 
-// Istruzione non riconosciuta:     // Misura il primo qubit per determinare se la funzione è costante o bilanciata
-// Istruzione non riconosciuta:     int* results = measure_all(state);
-// Istruzione non riconosciuta:     printf("Risultato della misura:\n");
-// Istruzione non riconosciuta:     printf("Qubit 0: %d (0 = costante, 1 = bilanciata)\n", results[0]);
-// Istruzione non riconosciuta: 
-// Istruzione non riconosciuta:     // Pulizia della memoria
-// Istruzione non riconosciuta:     free(results);
-// Istruzione non riconosciuta:     freeState(state);
-// Istruzione non riconosciuta: }
-// Istruzione non riconosciuta: 
+h q[0];
+measure q[0] -> c[2];
+reset q[0];
+reset q[1];
+x q[1];
+h q[0];
+h q[1];
+x q[0];
+cx q[0],q[1];
+h q[0];
+measure q[0] -> c[3];
@@ -16,14 +16,155 @@ run_test() {
     fi
 }
 
+# Esegue un comando e verifica che la sua uscita contenga una riga che soddisfa
+# l'espressione regolare indicata
+check_output() {
+    local description=$1
+    local pattern=$2
+    shift 2
+    echo "Eseguendo test: $description..."
+
+    local output
+    if output=$("$@" 2>&1) && grep -qE -- "$pattern" <<< "$output"; then
+        echo "✅ $description"
+    else
+        echo "❌ $description: atteso /$pattern/ nell'uscita di '$*'"
+        echo "$output" | tail -n 20
+        TEST_FAILED=1
+    fi
+}
+
+# Confronta un'uscita con il file .atteso: gli stati stampati da printState a meno della fase
+# globale (tests/confronta_stati.awk), gli istogrammi dei bit classici esattamente
+matches_expected() {
+    local expected=$1
+    local output=$2
+    if grep -q '^Stato' "$expected"; then
+        awk -f tests/confronta_stati.awk "$expected" "$output"
+    else
+        cmp -s "$expected" "$output"
+    fi
+}
+
+# Esegue un comando e confronta la sua uscita con il file .atteso
+check_expected() {
+    local description=$1
+    local expected=$2
+    shift 2
+    echo "Eseguendo test: $description..."
+
+    if "$@" > "$TEST_DIR/uscita" 2>&1 && matches_expected "$expected" "$TEST_DIR/uscita"; then
+        echo "✅ $description"
+    else
+        echo "❌ $description: l'uscita di '$*' non corrisponde a $expected"
+        head -n 20 "$TEST_DIR/uscita"
+        TEST_FAILED=1
+    fi
+}
+
+# Esegue un comando che deve terminare con un errore contenente il messaggio indicato
+check_failure() {
+    local description=$1
+    local message=$2
+    shift 2
+    echo "Eseguendo test: $description..."
+
+    local output
+    if output=$("$@" 2>&1); then
+        echo "❌ $description: '$*' doveva terminare con un errore"
+        TEST_FAILED=1
+    elif grep -qF -- "$message" <<< "$output"; then
+        echo "✅ $description"
+    else
+        echo "❌ $description: atteso '$message'"
+        echo "$output" | tail -n 5
+        TEST_FAILED=1
+    fi
+}
+
+# Compila il simulatore con il circuito indicato nell'eseguibile indicato
+build_circuit() {
+    local circuit_file=$1
+    local executable=$2
+    if ! make -s TARGET="$executable" CIRCUIT_FILE="$circuit_file" "$executable" > /dev/null; then
+        echo "❌ Compilazione di $circuit_file fallita."
+        TEST_FAILED=1
+        return 1
+    fi
+}
+
+# File temporanei dei test, rimossi all'uscita
+TEST_DIR=$(mktemp -d)
+trap 'rm -rf "$TEST_DIR"' EXIT
+
 # Esegui i test per QuantumSim
 run_test "QuantumSim"
 
-# Esegui i test per QasmParser
-run_test "QasmParser"
+# Matrici densità, canali di rumore, metriche e traiettorie (tests/kernel_tests.c)
+run_test "KernelTests"
+
+# Registra il circuito senza simularlo (conversione da C a QASM)
+run_test "QuantumSim trace /dev/null --dry-run"
+
+# Registrazione degli operatori nativi di quantum_algorithms.h: Grover su 10 qubit viene
+# registrato in dry-run e la traccia, rieseguita con "QuantumSim run", deve trovare lo stato
+# marcato 677 con probabilità 0.9995 (ampiezza +-0.9997 a meno della fase globale)
+if build_circuit algoritmi_noti/grover_nativo.c "$TEST_DIR/grover_nativo"; then
+    check_output "Grover nativo registrato in dry-run" "operazioni registrate" \
+        "$TEST_DIR/grover_nativo" trace "$TEST_DIR/grover_dry.qasm" --dry-run
+    check_output "Traccia di Grover rieseguita" "^Stato 677: -?0\.999" \
+        ./QuantumSim run "$TEST_DIR/grover_dry.qasm"
+    "$TEST_DIR/grover_nativo" trace "$TEST_DIR/grover.qasm" > /dev/null
+    check_output "Traccia in dry-run uguale a quella con simulazione" "^uguali$" \
+        sh -c "cmp -s '$TEST_DIR/grover.qasm' '$TEST_DIR/grover_dry.qasm' && echo uguali"
+fi
+
+# Circuiti di riferimento (tests/qasm): ogni file X.qasm ha in X.atteso lo stato finale, calcolato
+# indipendentemente, oppure l'istogramma di 100 esecuzioni (circuiti con risultati certi).
+# Ogni circuito viene eseguito dall'interprete, in streaming e dal formato binario; quelli senza
+# misure anche dal codice C generato da QasmParser (normale e --fused) e dalla traccia di
+# quest'ultimo rieseguita in QASM e in binario.
+for file in tests/qasm/*.qasm; do
+    name=$(basename "$file" .qasm)
+    expected="tests/qasm/$name.atteso"
+    check_expected "$name: run" "$expected" ./QuantumSim run "$file" --shots 100
+    check_expected "$name: run --stream" "$expected" ./QuantumSim run "$file" --shots 100 --stream
+    if ./QasmToBin "$file" "$TEST_DIR/$name.qbin" > /dev/null; then
+        check_expected "$name: run .qbin" "$expected" ./QuantumSim run "$TEST_DIR/$name.qbin" --shots 100
+        check_expected "$name: run --stream .qbin" "$expected" \
+            ./QuantumSim run "$TEST_DIR/$name.qbin" --shots 100 --stream
+    else
+        echo "❌ $name: conversione con QasmToBin fallita."
+        TEST_FAILED=1
+    fi
+
+    grep -q '^Stato' "$expected" || continue
+    for mode in "" "--fused"; do
+        generated="$TEST_DIR/${name}${mode#--}.c"
+        if ./QasmParser $mode "$file" "$generated" > /dev/null &&
+                build_circuit "$generated" "$TEST_DIR/${name}${mode#--}"; then
+            check_expected "$name: QasmParser${mode:+ $mode}" "$expected" "$TEST_DIR/${name}${mode#--}"
+        else
+            echo "❌ $name: generazione del codice con QasmParser $mode fallita."
+            TEST_FAILED=1
+        fi
+    done
+    for format in qasm qbin; do
+        if "$TEST_DIR/$name" trace "$TEST_DIR/${name}_traccia.$format" > /dev/null 2>&1; then
+            check_expected "$name: traccia .$format rieseguita" "$expected" \
+                ./QuantumSim run "$TEST_DIR/${name}_traccia.$format"
+        else
+            echo "❌ $name: registrazione della traccia .$format fallita."
+            TEST_FAILED=1
+        fi
+    done
+done
 
-# Esegui i test per CtoQasm
-run_test "CtoQasm"
+# Errori del parser (tests/errori): la prima riga di ogni file è "// atteso: <riga>: errore: ..."
+for file in tests/errori/*.qasm; do
+    message="$file:$(sed -n '1s|^// atteso: ||p' "$file")"
+    check_failure "errore in $(basename "$file" .qasm)" "$message" ./QuantumSim run "$file"
+done
 
 # Mostra un riepilogo finale
 if [ $TEST_FAILED -eq 0 ]; then
@@ -1,11 +1,186 @@
 #include "quantum_sim.h"
+#include "quantum_memory.h"
+#include "quantum_circuit.h"
+#include "quantum_runner.h"
+#include "quantum_binary.h"
+#include "quantum_trace.h"
+#include "qasm_to_c/qasm_parser.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
 
 void circuit();
 
-int main() {
-    srand(time(NULL)); // Inizializza il generatore di numeri casuali
+static void printUsage(const char *program) {
+    fprintf(stderr, "Utilizzo: %s                                          (esegue circuit())\n", program);
+    fprintf(stderr, "          %s run <file.qasm|file.qbin> [--shots N] [--threads T] [--stream]\n", program);
+    fprintf(stderr, "          %s trace <output.qasm|output.qbin> [--dry-run]\n", program);
+}
+
+static int runQasmStreamMode(const char *filename, long long shots) {
+    QubitState *state;
+    ShotHistogram *histogram = runQasmFileStreamingShots(filename, shots, &state);
+    if (!histogram) {
+        printState(state);
+        freeState(state);
+        return 0;
+    }
+    printShotHistogram(histogram);
+    freeShotHistogram(histogram);
+    return 0;
+}
+
+/* Esegue ogni volta il file binario decodificando le operazioni dalla memoria mappata. */
+static int runBinaryStreamMode(const char *filename, long long shots) {
+    BinaryCircuit *bc = openBinaryCircuit(filename);
+    int numClbits = (int)bc->header->numClbits;
+    if (numClbits > 63) {
+        fprintf(stderr, "Errore: al massimo 63 bit classici (il circuito ne ha %d)\n", numClbits);
+        exit(1);
+    }
+    long long *values = malloc(shots * sizeof(long long));
+    int *clbits = malloc((numClbits > 0 ? numClbits : 1) * sizeof(int));
+    if (!values || !clbits) {
+        perror("Errore allocazione risultati delle esecuzioni");
+        return 1;
+    }
+    QubitState *state = initializeState((int)bc->header->numQubits);
+    for (long long s = 0; s < shots; s++) {
+        initializeStateTo(state, 0);
+        executeBinaryCircuit(bc, state, clbits);
+        if (numClbits == 0) {
+            printState(state);
+            break;
+        }
+        values[s] = classicalRegisterValue(clbits, 0, numClbits);
+    }
+    if (numClbits > 0) {
+        ShotHistogram *histogram = buildShotHistogram(values, shots, numClbits);
+        printShotHistogram(histogram);
+        freeShotHistogram(histogram);
+    }
+    freeState(state);
+    free(clbits);
+    free(values);
+    closeBinaryCircuit(bc);
+    return 0;
+}
+
+/*
+ * Modalità "run": il file QASM viene analizzato ed eseguito direttamente, senza generare
+ * e compilare codice C. Se il circuito ha bit classici viene stampato il conteggio dei
+ * risultati su N esecuzioni, altrimenti lo stato finale.
+ * Con --stream il file viene letto in streaming (vedi runQasmFileStreamingShots), per file
+ * troppo grandi da tenere in memoria come circuito: una sola lettura se le misure sono tutte
+ * finali, altrimenti una per esecuzione.
+ * I file nel formato binario (quantum_binary.h) vengono riconosciuti dall'intestazione; con
+ * --stream vengono eseguiti direttamente dalla memoria mappata senza costruire il circuito.
+ */
+static int runQasmMode(int argc, char *argv[]) {
+    const char *filename = NULL;
+    long long shots = 1;
+    int threads = 0;
+    int stream = 0;
+    for (int k = 2; k < argc; k++) {
+        if (strcmp(argv[k], "--shots") == 0 && k + 1 < argc) {
+            shots = atoll(argv[++k]);
+        } else if (strcmp(argv[k], "--threads") == 0 && k + 1 < argc) {
+            threads = atoi(argv[++k]);
+        } else if (strcmp(argv[k], "--stream") == 0) {
+            stream = 1;
+        } else if (argv[k][0] != '-' && !filename) {
+            filename = argv[k];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (!filename || shots <= 0 || threads < 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+#ifdef _OPENMP
+    if (threads > 0) {
+        omp_set_num_threads(threads);
+    }
+#endif
+
+    QuantumCircuit *c;
+    if (isBinaryCircuitFile(filename)) {
+        if (stream) {
+            return runBinaryStreamMode(filename, shots);
+        }
+        BinaryCircuit *bc = openBinaryCircuit(filename);
+        c = binaryCircuitToCircuit(bc);
+        closeBinaryCircuit(bc);
+    } else if (stream) {
+        return runQasmStreamMode(filename, shots);
+    } else {
+        c = parseQASMFile(filename);
+    }
+    if (c->numClbits == 0) {
+        QubitState *state = initializeState(c->numQubits);
+        runCircuit(c, state, NULL);
+        printState(state);
+        freeState(state);
+    } else {
+        ShotHistogram *histogram = runCircuitShots(c, shots);
+        printShotHistogram(histogram);
+        freeShotHistogram(histogram);
+    }
+    freeCircuit(c);
+    return 0;
+}
+
+/*
+ * Modalità "trace": esegue circuit() registrando ogni gate e misura effettivamente eseguiti
+ * (vedi quantum_trace.h) e li scrive in OpenQASM o nel formato binario. Con --dry-run le
+ * ampiezze non vengono simulate.
+ */
+static int traceMode(int argc, char *argv[]) {
+    const char *filename = NULL;
+    int dryRun = 0;
+    for (int k = 2; k < argc; k++) {
+        if (strcmp(argv[k], "--dry-run") == 0) {
+            dryRun = 1;
+        } else if (argv[k][0] != '-' && !filename) {
+            filename = argv[k];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (!filename) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    startGateTrace(filename, dryRun);
     circuit();
+    long long numOps = stopGateTrace();
+    fprintf(stderr, "%lld operazioni registrate in %s\n", numOps, filename);
     return 0;
 }
+
+int main(int argc, char *argv[]) {
+    int status = 0;
+    srand(time(NULL)); // Inizializza il generatore di numeri casuali
+    if (argc > 1 && strcmp(argv[1], "run") == 0) {
+        status = runQasmMode(argc, argv);
+    } else if (argc > 1 && strcmp(argv[1], "trace") == 0) {
+        status = traceMode(argc, argv);
+    } else if (argc > 1) {
+        printUsage(argv[0]);
+        status = 1;
+    } else {
+        circuit();
+    }
+    // Con QUANTUMSIM_MEMORY_REPORT impostata stampa il picco di memoria usato dal circuito
+    if (getenv("QUANTUMSIM_MEMORY_REPORT")) {
+        printMemoryReport();
+    }
+    return status;
+}
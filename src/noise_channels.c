@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 #include <complex.h>
 #include "quantum_density.h"
 #include "noise_channels.h"
@@ -10,9 +11,9 @@
 // Funzione helper: estende un operatore 2x2 a un sistema di n qubit
 // in modo che agisca come "op" sul qubit target e come identità sugli altri.
 void extendKrausOperator(int n, int target, double complex op[2][2], double complex *K_ext) {
-    int dim = 1 << n;
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
+    long long dim = 1LL << n;
+    for (long long i = 0; i < dim; i++) {
+        for (long long j = 0; j < dim; j++) {
             int valid = 1;
             // Per ogni qubit diverso dal target, i e j devono avere lo stesso bit
             for (int k = 0; k < n; k++) {
@@ -35,99 +36,140 @@ void extendKrausOperator(int n, int target, double complex op[2][2], double comp
     }
 }
 
-// Wrapper per il dephasing su un singolo qubit.
-// p rappresenta la probabilità di errore di dephasing.
-void applyDephasing(DensityMatrix *dm, int targetQubit, double p) {
-    int n = dm->numQubits;
-    int dim = 1 << n;
-    // Operatori di Kraus per il dephasing su un singolo qubit:
-    // K0 = sqrt(1-p)*I,  K1 = sqrt(p)*Z  con Z = diag(1, -1)
-    double complex K0_single[2][2] = { {sqrt(1 - p), 0}, {0, sqrt(1 - p)} };
-    double complex K1_single[2][2] = { {sqrt(p), 0}, {0, -sqrt(p)} };
+// Operatori di Kraus per il dephasing su un singolo qubit:
+// K0 = sqrt(1-p)*I,  K1 = sqrt(p)*Z  con Z = diag(1, -1)
+static void dephasingKraus(double p, double complex kraus[2][2][2]) {
+    double complex K[2][2][2] = {
+        { {sqrt(1 - p), 0}, {0, sqrt(1 - p)} },
+        { {sqrt(p), 0}, {0, -sqrt(p)} }
+    };
+    memcpy(kraus, K, sizeof(K));
+}
 
-    double complex *K0 = calloc(dim * dim, sizeof(double complex));
-    double complex *K1 = calloc(dim * dim, sizeof(double complex));
-    if (!K0 || !K1) {
-        perror("Errore allocazione operatori Kraus in applyDephasing");
-        exit(1);
-    }
-    extendKrausOperator(n, targetQubit, K0_single, K0);
-    extendKrausOperator(n, targetQubit, K1_single, K1);
+// Operatori di Kraus per l'ampiezza damping:
+// K0 = [[1,0],[0,sqrt(1-gamma)]],  K1 = [[0,sqrt(gamma)],[0,0]]
+static void amplitudeDampingKraus(double gamma, double complex kraus[2][2][2]) {
+    double complex K[2][2][2] = {
+        { {1, 0}, {0, sqrt(1 - gamma)} },
+        { {0, sqrt(gamma)}, {0, 0} }
+    };
+    memcpy(kraus, K, sizeof(K));
+}
 
-    double complex *krausOps[2];
-    krausOps[0] = K0;
-    krausOps[1] = K1;
-    applyKrausChannelDensity(dm, 2, krausOps);
+// Operatori di Kraus per il canale depolarizzante:
+// K0 = sqrt(1 - 3p/4)*I, K1 = sqrt(p/4)*X, K2 = sqrt(p/4)*Y, K3 = sqrt(p/4)*Z.
+static void depolarizingKraus(double p, double complex kraus[4][2][2]) {
+    double complex K[4][2][2] = {
+        { {sqrt(1 - 3*p/4), 0}, {0, sqrt(1 - 3*p/4)} },
+        // Pauli X = [[0,1],[1,0]]
+        { {0, sqrt(p/4)}, {sqrt(p/4), 0} },
+        // Pauli Y = [[0,-i],[i,0]]
+        { {0, -I*sqrt(p/4)}, {I*sqrt(p/4), 0} },
+        // Pauli Z = [[1,0],[0,-1]]
+        { {sqrt(p/4), 0}, {0, -sqrt(p/4)} }
+    };
+    memcpy(kraus, K, sizeof(K));
+}
 
-    free(K0);
-    free(K1);
+// Wrapper per il dephasing su un singolo qubit.
+// p rappresenta la probabilità di errore di dephasing.
+// È un canale di Pauli con pz = p: scala solo i blocchi fuori diagonale di (1 - 2p).
+void applyDephasing(DensityMatrix *dm, int targetQubit, double p) {
+    applyPauliChannelDensity(dm, targetQubit, 0.0, 0.0, p);
 }
 
 // Wrapper per l'ampiezza damping su un singolo qubit.
 // gamma rappresenta la probabilità di perdita di eccitazione (legata a T1).
 void applyAmplitudeDamping(DensityMatrix *dm, int targetQubit, double gamma) {
-    int n = dm->numQubits;
-    int dim = 1 << n;
-    // Operatori di Kraus per l'ampiezza damping:
-    // K0 = [[1,0],[0,sqrt(1-gamma)]],  K1 = [[0,sqrt(gamma)],[0,0]]
-    double complex K0_single[2][2] = { {1, 0}, {0, sqrt(1 - gamma)} };
-    double complex K1_single[2][2] = { {0, sqrt(gamma)}, {0, 0} };
-
-    double complex *K0 = calloc(dim * dim, sizeof(double complex));
-    double complex *K1 = calloc(dim * dim, sizeof(double complex));
-    if (!K0 || !K1) {
-        perror("Errore allocazione operatori Kraus in applyAmplitudeDamping");
-        exit(1);
-    }
-    extendKrausOperator(n, targetQubit, K0_single, K0);
-    extendKrausOperator(n, targetQubit, K1_single, K1);
-
-    double complex *krausOps[2];
-    krausOps[0] = K0;
-    krausOps[1] = K1;
-    applyKrausChannelDensity(dm, 2, krausOps);
-
-    free(K0);
-    free(K1);
+    double complex kraus[2][2][2];
+    amplitudeDampingKraus(gamma, kraus);
+    applySingleQubitKrausDensity(dm, targetQubit, 2, kraus);
 }
 
 // Wrapper per il canale depolarizzante su un singolo qubit.
 // p rappresenta la probabilità complessiva di errore.
+// È un canale di Pauli con px = py = pz = p/4.
 void applyDepolarizing(DensityMatrix *dm, int targetQubit, double p) {
-    int n = dm->numQubits;
-    int dim = 1 << n;
-    // Operatori di Kraus per il canale depolarizzante:
-    // K0 = sqrt(1 - 3p/4)*I, K1 = sqrt(p/4)*X, K2 = sqrt(p/4)*Y, K3 = sqrt(p/4)*Z.
-    double complex K0_single[2][2] = { {sqrt(1 - 3*p/4), 0}, {0, sqrt(1 - 3*p/4)} };
-    // Pauli X = [[0,1],[1,0]]
-    double complex K1_single[2][2] = { {0, sqrt(p/4)}, {sqrt(p/4), 0} };
-    // Pauli Y = [[0,-i],[i,0]]
-    double complex K2_single[2][2] = { {0, -I*sqrt(p/4)}, {I*sqrt(p/4), 0} };
-    // Pauli Z = [[1,0],[0,-1]]
-    double complex K3_single[2][2] = { {sqrt(p/4), 0}, {0, -sqrt(p/4)} };
+    applyPauliChannelDensity(dm, targetQubit, p / 4.0, p / 4.0, p / 4.0);
+}
 
-    double complex *K0_ext = calloc(dim * dim, sizeof(double complex));
-    double complex *K1_ext = calloc(dim * dim, sizeof(double complex));
-    double complex *K2_ext = calloc(dim * dim, sizeof(double complex));
-    double complex *K3_ext = calloc(dim * dim, sizeof(double complex));
-    if (!K0_ext || !K1_ext || !K2_ext || !K3_ext) {
-        perror("Errore allocazione operatori Kraus in applyDepolarizing");
-        exit(1);
+// Stessi canali sulla matrice densità vettorizzata (vedi vectorized_density.h)
+void applyDephasingVectorized(VectorizedDensityMatrix *vdm, int targetQubit, double p) {
+    double complex kraus[2][2][2];
+    dephasingKraus(p, kraus);
+    applySingleQubitKrausVectorized(vdm, targetQubit, 2, kraus);
+}
+
+void applyAmplitudeDampingVectorized(VectorizedDensityMatrix *vdm, int targetQubit, double gamma) {
+    double complex kraus[2][2][2];
+    amplitudeDampingKraus(gamma, kraus);
+    applySingleQubitKrausVectorized(vdm, targetQubit, 2, kraus);
+}
+
+void applyDepolarizingVectorized(VectorizedDensityMatrix *vdm, int targetQubit, double p) {
+    double complex kraus[4][2][2];
+    depolarizingKraus(p, kraus);
+    applySingleQubitKrausVectorized(vdm, targetQubit, 4, kraus);
+}
+
+void noiseChannelSuperoperator(NoiseChannelType type, double strength, double complex S[4][4]) {
+    double complex kraus[4][2][2];
+    switch (type) {
+        case NOISE_DEPHASING:
+            dephasingKraus(strength, kraus);
+            singleQubitKrausToSuperoperator(2, kraus, S);
+            break;
+        case NOISE_AMPLITUDE_DAMPING:
+            amplitudeDampingKraus(strength, kraus);
+            singleQubitKrausToSuperoperator(2, kraus, S);
+            break;
+        case NOISE_DEPOLARIZING:
+            depolarizingKraus(strength, kraus);
+            singleQubitKrausToSuperoperator(4, kraus, S);
+            break;
+        case NOISE_THERMAL_RELAXATION:
+            fprintf(stderr, "Errore: il rilassamento termico richiede T1 e T2 "
+                            "(thermalRelaxationSuperoperator)\n");
+            exit(1);
     }
-    extendKrausOperator(n, targetQubit, K0_single, K0_ext);
-    extendKrausOperator(n, targetQubit, K1_single, K1_ext);
-    extendKrausOperator(n, targetQubit, K2_single, K2_ext);
-    extendKrausOperator(n, targetQubit, K3_single, K3_ext);
+}
 
-    double complex *krausOps[4];
-    krausOps[0] = K0_ext;
-    krausOps[1] = K1_ext;
-    krausOps[2] = K2_ext;
-    krausOps[3] = K3_ext;
-    applyKrausChannelDensity(dm, 4, krausOps);
+// Rilassamento termico per un tempo 'duration': ampiezza damping con gamma = 1 - e^{-t/T1}
+// e decadimento dei termini fuori diagonale e^{-t/T2} (T2 limitato a 2 T1, il massimo fisico).
+void thermalRelaxationSuperoperator(double T1, double T2, double duration, double complex S[4][4]) {
+    if (T2 > 2.0 * T1) T2 = 2.0 * T1;
+    double gamma = 1.0 - exp(-duration / T1);
+    double coherence = exp(-duration / T2);
+    memset(S, 0, 16 * sizeof(double complex));
+    S[0][0] = 1.0;                 // rho00' = rho00 + gamma rho11
+    S[0][3] = gamma;
+    S[1][1] = coherence;           // rho01' = e^{-t/T2} rho01
+    S[2][2] = coherence;
+    S[3][3] = 1.0 - gamma;         // rho11' = (1 - gamma) rho11
+}
 
-    free(K0_ext);
-    free(K1_ext);
-    free(K2_ext);
-    free(K3_ext);
+void applyThermalRelaxation(DensityMatrix *dm, int targetQubit, double T1, double T2, double duration) {
+    double complex S[4][4];
+    thermalRelaxationSuperoperator(T1, T2, duration, S);
+    applySingleQubitSuperoperatorDensity(dm, targetQubit, S);
+}
+
+void applyIdleThermalRelaxation(DensityMatrix *dm, long long idleMask,
+                                const double *T1, const double *T2, double duration) {
+    int n = dm->numQubits;
+    int targets[64];
+    double complex (*S)[4][4] = malloc(n * sizeof(*S));
+    if (!S) {
+        perror("Errore allocazione in applyIdleThermalRelaxation");
+        exit(1);
+    }
+    int count = 0;
+    for (int q = 0; q < n; q++) {
+        if ((idleMask >> q) & 1) {
+            thermalRelaxationSuperoperator(T1[q], T2[q], duration, S[count]);
+            targets[count++] = q;
+        }
+    }
+    applySingleQubitSuperoperatorsDensity(dm, count, targets, S);
+    free(S);
 }
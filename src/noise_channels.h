@@ -2,6 +2,15 @@
 #define NOISE_CHANNELS_H
 
 #include "quantum_density.h"
+#include "vectorized_density.h"
+
+// Tipi di canale a 1 qubit disponibili, con il significato del parametro 'strength'
+typedef enum {
+    NOISE_DEPHASING,          // p: probabilità di errore di fase
+    NOISE_AMPLITUDE_DAMPING,  // gamma: probabilità di perdita di eccitazione
+    NOISE_DEPOLARIZING,       // p: probabilità complessiva di errore
+    NOISE_THERMAL_RELAXATION  // durata: rilassamento con i T1, T2 del qubit (solo in noise_model.h)
+} NoiseChannelType;
 
 // Wrapper per il canale di dephasing su un singolo qubit.
 // p rappresenta la probabilità di errore di dephasing.
@@ -15,4 +24,26 @@ void applyAmplitudeDamping(DensityMatrix *dm, int targetQubit, double gamma);
 // p rappresenta la probabilità complessiva di errore.
 void applyDepolarizing(DensityMatrix *dm, int targetQubit, double p);
 
+// Versioni per la matrice densità vettorizzata: ogni canale è un superoperatore locale
+// sulla coppia di qubit (targetQubit, targetQubit + n).
+void applyDephasingVectorized(VectorizedDensityMatrix *vdm, int targetQubit, double p);
+void applyAmplitudeDampingVectorized(VectorizedDensityMatrix *vdm, int targetQubit, double gamma);
+void applyDepolarizingVectorized(VectorizedDensityMatrix *vdm, int targetQubit, double p);
+
+// Superoperatore 4x4 del canale (convenzione di applySingleQubitSuperoperatorDensity);
+// NOISE_THERMAL_RELAXATION richiede T1 e T2: vedi thermalRelaxationSuperoperator
+void noiseChannelSuperoperator(NoiseChannelType type, double strength, double complex S[4][4]);
+
+// Rilassamento termico (T1, T2) per un gate o un'attesa di durata 'duration' (stesse unità di T1, T2):
+// ampiezza damping e dephasing combinati in un unico superoperatore precalcolato.
+void thermalRelaxationSuperoperator(double T1, double T2, double duration, double complex S[4][4]);
+void applyThermalRelaxation(DensityMatrix *dm, int targetQubit, double T1, double T2, double duration);
+
+// Rumore dei qubit inattivi in uno strato del circuito: applica il rilassamento termico a tutti
+// i qubit con bit a 1 in idleMask (T1[q], T2[q] per qubit) con un solo passaggio ogni 5 qubit
+// (blocchi 2^5 x 2^5 in cache, vedi applySingleQubitSuperoperatorsDensity). Gli strati sono
+// calcolati da runNoisyCircuitDensity (noise_model.h).
+void applyIdleThermalRelaxation(DensityMatrix *dm, long long idleMask,
+                                const double *T1, const double *T2, double duration);
+
 #endif // NOISE_CHANNELS_H
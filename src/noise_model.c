@@ -0,0 +1,552 @@
+// noise_model.c
+
+#include "noise_model.h"
+#include "quantum_memory.h"
+#include "quantum_trajectory.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <complex.h>
+
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+
+/* Crea un modello di rumore vuoto (nessun canale). */
+NoiseModel* createNoiseModel(int numQubits) {
+    NoiseModel *model = malloc(sizeof(NoiseModel));
+    if (!model) {
+        perror("Errore allocazione NoiseModel");
+        exit(1);
+    }
+    model->numQubits = numQubits;
+    memset(model->numGateChannels, 0, sizeof(model->numGateChannels));
+    model->numQubitChannels = calloc(numQubits, sizeof(int));
+    model->qubitChannels = malloc(numQubits * sizeof(*model->qubitChannels));
+    model->T1 = calloc(numQubits, sizeof(double));
+    model->T2 = calloc(numQubits, sizeof(double));
+    if (!model->numQubitChannels || !model->qubitChannels || !model->T1 || !model->T2) {
+        perror("Errore allocazione canali per qubit");
+        exit(1);
+    }
+    return model;
+}
+
+void freeNoiseModel(NoiseModel *model) {
+    if (model) {
+        free(model->numQubitChannels);
+        free(model->qubitChannels);
+        free(model->T1);
+        free(model->T2);
+        free(model);
+    }
+}
+
+void noiseModelAddGateChannel(NoiseModel *model, GateType type, NoiseChannelType channel, double strength) {
+    if (model->numGateChannels[type] == NOISE_MAX_CHANNELS) {
+        fprintf(stderr, "Troppi canali per il tipo di gate %d\n", (int)type);
+        exit(1);
+    }
+    NoiseChannelSpec *spec = &model->gateChannels[type][model->numGateChannels[type]++];
+    spec->type = channel;
+    spec->strength = strength;
+}
+
+void noiseModelAddQubitChannel(NoiseModel *model, int qubit, NoiseChannelType channel, double strength) {
+    if (model->numQubitChannels[qubit] == NOISE_MAX_CHANNELS) {
+        fprintf(stderr, "Troppi canali per il qubit %d\n", qubit);
+        exit(1);
+    }
+    NoiseChannelSpec *spec = &model->qubitChannels[qubit][model->numQubitChannels[qubit]++];
+    spec->type = channel;
+    spec->strength = strength;
+}
+
+void noiseModelSetRelaxationTimes(NoiseModel *model, int qubit, double T1, double T2) {
+    if (T1 <= 0.0 || T2 <= 0.0) {
+        fprintf(stderr, "Errore: T1 e T2 devono essere positivi (qubit %d)\n", qubit);
+        exit(1);
+    }
+    model->T1[qubit] = T1;
+    model->T2[qubit] = T2;
+}
+
+/* Superoperatore di un canale sul qubit q (il rilassamento termico usa i T1, T2 del qubit). */
+static void channelSuperoperator(const NoiseModel *model, const NoiseChannelSpec *spec, int q, double complex S[4][4]) {
+    if (spec->type != NOISE_THERMAL_RELAXATION) {
+        noiseChannelSuperoperator(spec->type, spec->strength, S);
+        return;
+    }
+    if (model->T1[q] <= 0.0) {
+        fprintf(stderr, "Errore: rilassamento termico sul qubit %d senza T1 e T2 "
+                        "(noiseModelSetRelaxationTimes)\n", q);
+        exit(1);
+    }
+    thermalRelaxationSuperoperator(model->T1[q], model->T2[q], spec->strength, S);
+}
+
+/* Prodotto C = A B di superoperatori 4x4 (C può coincidere con B). */
+static void compose4(double complex A[4][4], double complex B[4][4], double complex C[4][4]) {
+    double complex tmp[4][4];
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++) {
+            double complex sum = 0.0;
+            for (int k = 0; k < 4; k++) sum += A[r][k] * B[k][c];
+            tmp[r][c] = sum;
+        }
+    memcpy(C, tmp, sizeof(tmp));
+}
+
+/*
+ * Superoperatore complessivo dei canali che seguono un gate di tipo 'type' sul qubit q.
+ * Restituisce 0 se non ci sono canali (S resta l'identità).
+ */
+static int qubitNoiseSuperoperator(const NoiseModel *model, GateType type, int q, double complex S[4][4]) {
+    int count = 0;
+    double complex C[4][4];
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            S[r][c] = (r == c) ? 1.0 : 0.0;
+
+    for (int k = 0; k < model->numGateChannels[type]; k++, count++) {
+        channelSuperoperator(model, &model->gateChannels[type][k], q, C);
+        compose4(C, S, S);
+    }
+    for (int k = 0; k < model->numQubitChannels[q]; k++, count++) {
+        channelSuperoperator(model, &model->qubitChannels[q][k], q, C);
+        compose4(C, S, S);
+    }
+    return count;
+}
+
+/* Gate a 1 qubit: S = N * (G ⊗ conj(G)), con S_G[(a,b)][(c,d)] = G[a][c] conj(G[b][d]). */
+static void runNoisySingleQubitOp(const GateOp *op, const NoiseModel *model, DensityMatrix *dm,
+                                  const double *params) {
+    int q = op->qubits[0];
+    double complex G[2][2], N[4][4], SG[4][4];
+    gateOpSingleQubitMatrix(op, params, G);
+
+    if (!qubitNoiseSuperoperator(model, op->type, q, N)) {
+        applySingleQubitGateDensity(dm, q, G);
+        return;
+    }
+    for (int a = 0; a < 2; a++)
+        for (int b = 0; b < 2; b++)
+            for (int c = 0; c < 2; c++)
+                for (int d = 0; d < 2; d++)
+                    SG[a * 2 + b][c * 2 + d] = G[a][c] * conj(G[b][d]);
+    compose4(N, SG, SG);
+    applySingleQubitSuperoperatorDensity(dm, q, SG);
+}
+
+/*
+ * Gate a 2 qubit: i canali sui due qubit si combinano nel prodotto tensoriale
+ * N[(A,B)][(C,D)] = N0[(a0,b0)][(c0,d0)] N1[(a1,b1)][(c1,d1)], con A = a0 + 2 a1, ...,
+ * e il superoperatore fuso è N * S_G.
+ */
+static void runNoisyTwoQubitOp(const GateOp *op, const NoiseModel *model, DensityMatrix *dm,
+                               const double *params) {
+    int q0 = op->qubits[0], q1 = op->qubits[1];
+    double complex G[4][4], N0[4][4], N1[4][4];
+    gateOpTwoQubitMatrix(op, params, G);
+
+    int noisy = qubitNoiseSuperoperator(model, op->type, q0, N0);
+    noisy += qubitNoiseSuperoperator(model, op->type, q1, N1);
+    if (!noisy) {
+        switch (op->type) {
+            case GATE_CNOT: applyCNOTDensity(dm, q0, q1); break;
+            case GATE_CZ:   applyCZDensity(dm, q0, q1); break;
+            default:        applyTwoQubitGateDensity(dm, q0, q1, G); break;
+        }
+        return;
+    }
+
+    double complex SG[16][16], N[16][16], S[16][16];
+    for (int A = 0; A < 4; A++)
+        for (int B = 0; B < 4; B++)
+            for (int C = 0; C < 4; C++)
+                for (int D = 0; D < 4; D++) {
+                    SG[A * 4 + B][C * 4 + D] = G[A][C] * conj(G[B][D]);
+                    N[A * 4 + B][C * 4 + D] = N0[(A & 1) * 2 + (B & 1)][(C & 1) * 2 + (D & 1)]
+                                            * N1[(A >> 1) * 2 + (B >> 1)][(C >> 1) * 2 + (D >> 1)];
+                }
+    for (int r = 0; r < 16; r++)
+        for (int c = 0; c < 16; c++) {
+            double complex sum = 0.0;
+            for (int k = 0; k < 16; k++) sum += N[r][k] * SG[k][c];
+            S[r][c] = sum;
+        }
+    applyTwoQubitSuperoperatorDensity(dm, q0, q1, S);
+}
+
+/* Gate a 3 qubit: kernel di permutazione/fase, poi i canali qubit per qubit. */
+static void runNoisyThreeQubitOp(const GateOp *op, const NoiseModel *model, DensityMatrix *dm) {
+    const int *q = op->qubits;
+    double complex N[4][4];
+    switch (op->type) {
+        case GATE_TOFFOLI: applyToffoliDensity(dm, q[0], q[1], q[2]); break;
+        case GATE_CSWAP:   applyFredkinDensity(dm, q[0], q[1], q[2]); break;
+        default:           applyCCZDensity(dm, q[0], q[1], q[2]); break;
+    }
+    for (int k = 0; k < 3; k++) {
+        if (qubitNoiseSuperoperator(model, op->type, q[k], N)) {
+            applySingleQubitSuperoperatorDensity(dm, q[k], N);
+        }
+    }
+}
+
+/* Misure e reset campionano il risultato (come measureDensity) e non ricevono rumore. */
+static void runMeasureOrReset(const GateOp *op, DensityMatrix *dm, int *clbits) {
+    int result = measureDensity(dm, op->qubits[0]).result;
+    if (op->type == GATE_MEASURE) {
+        clbits[op->cbit] = result;
+    } else if (result) {
+        double complex X[2][2] = {{0, 1}, {1, 0}};
+        applySingleQubitGateDensity(dm, op->qubits[0], X);
+    }
+}
+
+/*
+ * Strati per il rumore dei qubit inattivi: ogni gate va nel primo strato successivo a quelli
+ * dei gate precedenti sugli stessi qubit; misure, reset, barriere e operazioni condizionate
+ * occupano uno strato a sé dopo tutti i precedenti (i bit classici restano così nell'ordine
+ * del circuito). La durata di uno strato è la massima durata dei suoi gate, cioè l'intensità
+ * dei canali NOISE_THERMAL_RELAXATION associati al loro tipo; i qubit con T1 e T2 impostati e
+ * nessun gate nello strato rilassano per tutta la sua durata.
+ */
+typedef struct {
+    int numLayers;
+    int *order;           // Indici delle operazioni, strato per strato
+    int *layerStart;      // numLayers + 1 elementi: operazioni dello strato in order[start, next)
+    double *duration;
+    long long *idleMask;
+} LayerSchedule;
+
+static int hasRelaxationTimes(const NoiseModel *model) {
+    for (int q = 0; q < model->numQubits; q++) {
+        if (model->T1[q] > 0.0) return 1;
+    }
+    return 0;
+}
+
+static double gateDuration(const NoiseModel *model, GateType type) {
+    double duration = 0.0;
+    for (int k = 0; k < model->numGateChannels[type]; k++) {
+        if (model->gateChannels[type][k].type == NOISE_THERMAL_RELAXATION) {
+            duration += model->gateChannels[type][k].strength;
+        }
+    }
+    return duration;
+}
+
+/* Strati delle prime numOps operazioni, o NULL se nessun qubit ha T1 e T2 (niente rumore inattivo). */
+static LayerSchedule* buildLayerSchedule(const QuantumCircuit *circuit, int numOps, const NoiseModel *model) {
+    if (!hasRelaxationTimes(model)) return NULL;
+    int n = circuit->numQubits;
+    if (n > 63) {
+        fprintf(stderr, "Errore: rumore dei qubit inattivi con più di 63 qubit\n");
+        exit(1);
+    }
+    LayerSchedule *schedule = malloc(sizeof(LayerSchedule));
+    int *nextLayer = calloc(n, sizeof(int));
+    int *layerOf = malloc((numOps > 0 ? numOps : 1) * sizeof(int));
+    if (!schedule || !nextLayer || !layerOf) {
+        perror("Errore allocazione strati del circuito");
+        exit(1);
+    }
+
+    int numLayers = 0;
+    for (int k = 0; k < numOps; k++) {
+        const GateOp *op = &circuit->ops[k];
+        int arity = gateArity(op->type);
+        int layer = 0;
+        if (op->type == GATE_MEASURE || op->type == GATE_RESET || arity == 0 || op->condSize > 0) {
+            layer = numLayers;
+            for (int q = 0; q < n; q++) nextLayer[q] = layer + 1;
+        } else {
+            for (int j = 0; j < arity; j++) {
+                if (nextLayer[op->qubits[j]] > layer) layer = nextLayer[op->qubits[j]];
+            }
+            for (int j = 0; j < arity; j++) nextLayer[op->qubits[j]] = layer + 1;
+        }
+        layerOf[k] = layer;
+        if (layer + 1 > numLayers) numLayers = layer + 1;
+    }
+
+    schedule->numLayers = numLayers;
+    schedule->order = malloc((numOps > 0 ? numOps : 1) * sizeof(int));
+    schedule->layerStart = calloc(numLayers + 1, sizeof(int));
+    schedule->duration = calloc(numLayers > 0 ? numLayers : 1, sizeof(double));
+    schedule->idleMask = malloc((numLayers > 0 ? numLayers : 1) * sizeof(long long));
+    if (!schedule->order || !schedule->layerStart || !schedule->duration || !schedule->idleMask) {
+        perror("Errore allocazione strati del circuito");
+        exit(1);
+    }
+
+    long long relaxing = 0;
+    for (int q = 0; q < n; q++) {
+        if (model->T1[q] > 0.0) relaxing |= 1LL << q;
+    }
+    for (int l = 0; l < numLayers; l++) schedule->idleMask[l] = relaxing;
+
+    // Ordinamento per strato stabile (counting sort): nello strato resta l'ordine del circuito
+    for (int k = 0; k < numOps; k++) schedule->layerStart[layerOf[k] + 1]++;
+    for (int l = 0; l < numLayers; l++) schedule->layerStart[l + 1] += schedule->layerStart[l];
+    int *fill = calloc(numLayers > 0 ? numLayers : 1, sizeof(int));
+    if (!fill) {
+        perror("Errore allocazione strati del circuito");
+        exit(1);
+    }
+    for (int k = 0; k < numOps; k++) {
+        const GateOp *op = &circuit->ops[k];
+        int l = layerOf[k];
+        schedule->order[schedule->layerStart[l] + fill[l]++] = k;
+        double d = gateDuration(model, op->type);
+        if (d > schedule->duration[l]) schedule->duration[l] = d;
+        for (int j = 0; j < gateArity(op->type); j++) {
+            schedule->idleMask[l] &= ~(1LL << op->qubits[j]);
+        }
+    }
+
+    free(fill);
+    free(layerOf);
+    free(nextLayer);
+    return schedule;
+}
+
+static void freeLayerSchedule(LayerSchedule *schedule) {
+    if (schedule) {
+        free(schedule->order);
+        free(schedule->layerStart);
+        free(schedule->duration);
+        free(schedule->idleMask);
+        free(schedule);
+    }
+}
+
+static void runNoisyDensityOp(const GateOp *op, const NoiseModel *model, DensityMatrix *dm,
+                              const double *params, int *clbits) {
+    if (op->condSize > 0 &&
+        classicalRegisterValue(clbits, op->condOffset, op->condSize) != op->condValue) {
+        return;
+    }
+    if (op->type == GATE_MEASURE || op->type == GATE_RESET) {
+        runMeasureOrReset(op, dm, clbits);
+        return;
+    }
+    switch (gateArity(op->type)) {
+        case 0:  break;
+        case 1:  runNoisySingleQubitOp(op, model, dm, params); break;
+        case 2:  runNoisyTwoQubitOp(op, model, dm, params); break;
+        default: runNoisyThreeQubitOp(op, model, dm); break;
+    }
+}
+
+void runNoisyCircuitDensity(QuantumCircuit *circuit, const NoiseModel *model,
+                            DensityMatrix *dm, const double *params) {
+    int *clbits = calloc(circuit->numClbits > 0 ? circuit->numClbits : 1, sizeof(int));
+    if (!clbits) {
+        perror("Errore allocazione bit classici");
+        exit(1);
+    }
+    LayerSchedule *schedule = buildLayerSchedule(circuit, circuit->numOps, model);
+    if (!schedule) {
+        for (int k = 0; k < circuit->numOps; k++) {
+            runNoisyDensityOp(&circuit->ops[k], model, dm, params, clbits);
+        }
+    } else {
+        for (int l = 0; l < schedule->numLayers; l++) {
+            for (int k = schedule->layerStart[l]; k < schedule->layerStart[l + 1]; k++) {
+                runNoisyDensityOp(&circuit->ops[schedule->order[k]], model, dm, params, clbits);
+            }
+            if (schedule->duration[l] > 0.0 && schedule->idleMask[l]) {
+                applyIdleThermalRelaxation(dm, schedule->idleMask[l], model->T1, model->T2, schedule->duration[l]);
+            }
+        }
+    }
+    freeLayerSchedule(schedule);
+    free(clbits);
+}
+
+/* Canale applicato stocasticamente, con gli stessi parametri della versione su \rho. */
+static void applyTrajectoryChannel(QubitState *state, const NoiseModel *model, int q, const NoiseChannelSpec *spec,
+                                   TrajectoryRng *rng) {
+    switch (spec->type) {
+        case NOISE_DEPHASING:         applyDephasingTrajectory(state, q, spec->strength, rng); break;
+        case NOISE_AMPLITUDE_DAMPING: applyAmplitudeDampingTrajectory(state, q, spec->strength, rng); break;
+        case NOISE_DEPOLARIZING:      applyDepolarizingTrajectory(state, q, spec->strength, rng); break;
+        case NOISE_THERMAL_RELAXATION:
+            if (model->T1[q] <= 0.0) {
+                fprintf(stderr, "Errore: rilassamento termico sul qubit %d senza T1 e T2 "
+                                "(noiseModelSetRelaxationTimes)\n", q);
+                exit(1);
+            }
+            applyThermalRelaxationTrajectory(state, q, model->T1[q], model->T2[q], spec->strength, rng);
+            break;
+    }
+}
+
+/* Valore del registro classico quando le misure da 'firstMeasure' in poi osservano lo stato di base i. */
+static long long terminalMeasurementValue(const QuantumCircuit *circuit, int firstMeasure, long long i) {
+    long long value = 0;
+    for (int k = firstMeasure; k < circuit->numOps; k++) {
+        const GateOp *op = &circuit->ops[k];
+        if (op->type != GATE_MEASURE) continue;
+        long long bit = 1LL << op->cbit;
+        value = (i >> op->qubits[0]) & 1 ? (value | bit) : (value & ~bit);
+    }
+    return value;
+}
+
+/* Un'operazione della traiettoria: ogni gate seguito dai canali del modello sui suoi qubit, nello
+   stesso ordine di qubitNoiseSuperoperator (prima quelli del tipo di gate, poi quelli del qubit). */
+static void runNoisyTrajectoryOp(const GateOp *op, const NoiseModel *model, QubitState *state,
+                                 const double *params, int *clbits, TrajectoryRng *rng) {
+    if (op->condSize > 0 &&
+        classicalRegisterValue(clbits, op->condOffset, op->condSize) != op->condValue) {
+        return;
+    }
+    if (op->type == GATE_MEASURE || op->type == GATE_RESET) {
+        int result = measureTrajectory(state, op->qubits[0], rng).result;
+        if (op->type == GATE_MEASURE) {
+            clbits[op->cbit] = result;
+        } else if (result) {
+            applyX(state, op->qubits[0]);
+        }
+        return;
+    }
+    applyGateOp(state, op, params);
+    for (int j = 0; j < gateArity(op->type); j++) {
+        int q = op->qubits[j];
+        for (int c = 0; c < model->numGateChannels[op->type]; c++) {
+            applyTrajectoryChannel(state, model, q, &model->gateChannels[op->type][c], rng);
+        }
+        for (int c = 0; c < model->numQubitChannels[q]; c++) {
+            applyTrajectoryChannel(state, model, q, &model->qubitChannels[q][c], rng);
+        }
+    }
+}
+
+/* Una traiettoria, strato per strato se 'schedule' non è NULL (come runNoisyCircuitDensity).
+   Se le misure da 'terminalStart' in poi sono finali (terminalStart < 0 altrimenti), il
+   risultato viene campionato con un solo passaggio sullo stato invece di una misura per qubit;
+   'schedule' copre allora solo le operazioni precedenti. Restituisce il valore del registro
+   classico. */
+static long long runNoisyTrajectory(QuantumCircuit *circuit, const NoiseModel *model, const LayerSchedule *schedule,
+                                    QubitState *state, const double *params, int *clbits, int terminalStart,
+                                    TrajectoryRng *rng) {
+    for (int c = 0; c < circuit->numClbits; c++) clbits[c] = 0;
+    int end = (terminalStart >= 0) ? terminalStart : circuit->numOps;
+    if (!schedule) {
+        for (int k = 0; k < end; k++) {
+            runNoisyTrajectoryOp(&circuit->ops[k], model, state, params, clbits, rng);
+        }
+    } else {
+        for (int l = 0; l < schedule->numLayers; l++) {
+            for (int k = schedule->layerStart[l]; k < schedule->layerStart[l + 1]; k++) {
+                runNoisyTrajectoryOp(&circuit->ops[schedule->order[k]], model, state, params, clbits, rng);
+            }
+            if (schedule->duration[l] > 0.0 && schedule->idleMask[l]) {
+                applyIdleThermalRelaxationTrajectory(state, schedule->idleMask[l], model->T1, model->T2,
+                                                     schedule->duration[l], rng);
+            }
+        }
+    }
+    if (terminalStart >= 0) {
+        return terminalMeasurementValue(circuit, terminalStart, sampleBasisState(state, rng));
+    }
+    return classicalRegisterValue(clbits, 0, circuit->numClbits);
+}
+
+/* Misure finali: la parte unitaria rumorosa evolve \rho una volta e i risultati vengono
+   campionati dalla diagonale, convertiti nel valore del registro classico. */
+static void sampleNoisyDensityShots(QuantumCircuit *circuit, const NoiseModel *model, int packed,
+                                    long long numShots, const double *params, long long *values) {
+    int n = circuit->numQubits;
+    DensityMatrix *dm = packed ? initializePackedDensityMatrix(n) : initializeDensityMatrix(n);
+    dm->matrix[0] = 1.0;   // |0...0><0...0| (l'elemento (0, 0) è il primo in entrambi i formati)
+
+    QuantumCircuit unitaryPart = *circuit;
+    unitaryPart.numOps = 0;
+    while (unitaryPart.numOps < circuit->numOps && circuit->ops[unitaryPart.numOps].type != GATE_MEASURE) {
+        unitaryPart.numOps++;
+    }
+    runNoisyCircuitDensity(&unitaryPart, model, dm, params);
+
+    long long *counts = sampleShotsDensity(dm, numShots);
+    long long dim = 1LL << n, s = 0;
+    for (long long i = 0; i < dim; i++) {
+        if (counts[i] == 0) continue;
+        long long value = terminalMeasurementValue(circuit, unitaryPart.numOps, i);
+        for (long long c = 0; c < counts[i]; c++) values[s++] = value;
+    }
+    freeShotsDensity(counts, n);
+    freeDensityMatrix(dm);
+}
+
+ShotHistogram* runNoisyCircuitShots(QuantumCircuit *circuit, const NoiseModel *model, long long numShots,
+                                    const double *params, unsigned long long seed) {
+    if (circuit->numClbits > 63) {
+        fprintf(stderr, "Errore: al massimo 63 bit classici (il circuito ne ha %d)\n", circuit->numClbits);
+        exit(1);
+    }
+    // I risultati vengono allocati per primi: la scelta della rappresentazione usa il budget restante
+    size_t valueBytes = checkedBytes(numShots > 0 ? numShots : 1, sizeof(long long), "risultati delle esecuzioni");
+    long long *values = budgetMalloc(valueBytes, "risultati delle esecuzioni");
+
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    SimulationBackend backend = chooseNoisyBackend(circuit->numQubits, threads);
+    if (backend == BACKEND_NONE) {
+        fprintf(stderr, "Errore: nemmeno un vettore di stato di %d qubit entra nel budget di memoria\n",
+                circuit->numQubits);
+        exit(1);
+    }
+
+    int terminal = circuitHasTerminalMeasurements(circuit);
+    if (backend != BACKEND_TRAJECTORIES && terminal) {
+        sampleNoisyDensityShots(circuit, model, backend == BACKEND_PACKED_DENSITY, numShots, params, values);
+    } else {
+        // Ogni esecuzione è una traiettoria con il flusso casuale (seed, indice): il risultato
+        // non dipende dal numero di thread. Se il budget non basta per un vettore di stato
+        // per thread, le traiettorie vengono eseguite da un solo thread.
+        int terminalStart = -1;
+        if (terminal) {
+            terminalStart = 0;
+            while (terminalStart < circuit->numOps && circuit->ops[terminalStart].type != GATE_MEASURE) {
+                terminalStart++;
+            }
+        }
+        LayerSchedule *layers = buildLayerSchedule(circuit, terminalStart >= 0 ? terminalStart : circuit->numOps, model);
+        size_t stateBytes = stateVectorBytes(circuit->numQubits);
+        int useThreads = (stateBytes <= SIZE_MAX / threads && backendMemoryAllows(stateBytes * threads)) ? threads : 1;
+        #pragma omp parallel num_threads(useThreads)
+        {
+            QubitState *state = initializeState(circuit->numQubits);
+            int *clbits = malloc((circuit->numClbits > 0 ? circuit->numClbits : 1) * sizeof(int));
+            if (!clbits) {
+                perror("Errore allocazione bit classici");
+                exit(1);
+            }
+            TrajectoryRng rng;
+
+            #pragma omp for schedule(dynamic)
+            for (long long s = 0; s < numShots; s++) {
+                initializeStateTo(state, 0);
+                seedTrajectoryRng(&rng, seed, (unsigned long long)s);
+                values[s] = runNoisyTrajectory(circuit, model, layers, state, params, clbits, terminalStart, &rng);
+            }
+
+            free(clbits);
+            freeState(state);
+        }
+        freeLayerSchedule(layers);
+    }
+
+    ShotHistogram *histogram = buildShotHistogram(values, numShots, circuit->numClbits);
+    budgetFree(values, valueBytes);
+    return histogram;
+}
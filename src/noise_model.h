@@ -0,0 +1,68 @@
+#ifndef NOISE_MODEL_H
+#define NOISE_MODEL_H
+
+#include <complex.h>
+#include "quantum_circuit.h"
+#include "quantum_density.h"
+#include "noise_channels.h"
+#include "quantum_runner.h"   // Per ShotHistogram
+
+// Numero massimo di canali associabili a un tipo di gate o a un qubit
+#define NOISE_MAX_CHANNELS 4
+
+// Canale a 1 qubit con la sua intensità
+typedef struct {
+    NoiseChannelType type;
+    double strength;
+} NoiseChannelSpec;
+
+// Modello di rumore: dopo ogni gate vengono applicati, su ciascuno dei qubit coinvolti,
+// prima i canali associati al tipo di gate e poi quelli associati al qubit.
+// Rilassamento termico: un canale NOISE_THERMAL_RELAXATION associato a un tipo di gate ne
+// stabilisce la durata e usa i T1, T2 di ciascun qubit. Se almeno un qubit ha T1 e T2, il
+// circuito viene eseguito per strati di gate paralleli e i qubit inattivi in uno strato
+// rilassano per la durata dello strato (il gate più lungo), tutti insieme alla fine di esso.
+typedef struct {
+    int numQubits;
+    int numGateChannels[GATE_NUM_TYPES];
+    NoiseChannelSpec gateChannels[GATE_NUM_TYPES][NOISE_MAX_CHANNELS];
+    int *numQubitChannels;                              // numQubits elementi
+    NoiseChannelSpec (*qubitChannels)[NOISE_MAX_CHANNELS];
+    double *T1, *T2;                                    // numQubits elementi (0 = non impostati)
+} NoiseModel;
+
+NoiseModel* createNoiseModel(int numQubits);
+void freeNoiseModel(NoiseModel *model);
+
+// Aggiunge un canale dopo ogni gate di tipo 'type', su ciascuno dei qubit su cui agisce
+void noiseModelAddGateChannel(NoiseModel *model, GateType type, NoiseChannelType channel, double strength);
+
+// Aggiunge un canale dopo ogni gate che agisce sul qubit indicato
+void noiseModelAddQubitChannel(NoiseModel *model, int qubit, NoiseChannelType channel, double strength);
+
+// Tempi di rilassamento del qubit (stesse unità delle durate dei gate)
+void noiseModelSetRelaxationTimes(NoiseModel *model, int qubit, double T1, double T2);
+
+// Esegue il circuito sulla matrice densità iniettando automaticamente il rumore del modello.
+// Per i gate a 1 e 2 qubit il gate e i canali successivi vengono composti in un unico
+// superoperatore locale (4x4 o 16x16), applicato con un solo passaggio su \rho.
+// I gate a 3 qubit usano il proprio kernel seguito da un superoperatore per qubit.
+// Misure e reset collassano \rho sul risultato campionato (che alimenta le condizioni
+// sui bit classici); le barriere vengono ignorate. Il rumore dei qubit inattivi di uno strato
+// è un solo passaggio su \rho ogni 5 qubit (applyIdleThermalRelaxation).
+void runNoisyCircuitDensity(QuantumCircuit *circuit, const NoiseModel *model,
+                            DensityMatrix *dm, const double *params);
+
+// Esegue numShots volte il circuito rumoroso partendo da |0...0> (circuit->numClbits <= 63) e
+// restituisce l'istogramma dei bit classici. La rappresentazione è scelta da chooseNoisyBackend
+// (quantum_memory.h) in base al budget di memoria, o alla memoria fisica se il budget è
+// illimitato: con misure solo finali (vedi
+// circuitHasTerminalMeasurements) e una matrice densità, completa o compatta, che entra nel
+// budget, \rho viene evoluta una volta e i risultati campionati dalla diagonale; altrimenti
+// ogni esecuzione è una traiettoria (quantum_trajectory.h) con il flusso casuale (seed, indice),
+// con un vettore di stato per thread se il budget lo consente; con misure solo finali ogni
+// traiettoria campiona tutti i bit con un solo passaggio sullo stato finale.
+ShotHistogram* runNoisyCircuitShots(QuantumCircuit *circuit, const NoiseModel *model, long long numShots,
+                                    const double *params, unsigned long long seed);
+
+#endif // NOISE_MODEL_H
@@ -0,0 +1,344 @@
+/*
+ * QuantumSim: A Quantum Circuit Simulator for C Programmers
+ * Copyright (C) 2024 Francesco Sisini
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fused_codegen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+
+// Blocco di gate fusi su 1 o 2 qubit; per 2 qubit l'indice locale è
+// a = bit(qubits[0]) + 2 * bit(qubits[1]) con qubits[0] < qubits[1]
+typedef struct {
+    int numQubits;
+    int qubits[2];
+    double complex M[4][4];
+} FusedBlock;
+
+typedef struct {
+    FILE *kernels;       // Definizioni delle funzioni dei blocchi
+    FILE *body;          // Corpo di circuit(), copiato in fondo al file
+    int numQubits;
+    int numKernels;
+    FusedBlock *blocks;  // Blocco in attesa per ciascun qubit (numQubits = 0: nessuno)
+    int *blockOf;        // Indice in 'blocks' del blocco che contiene il qubit, oppure -1
+} FusionState;
+
+static void multiply4(int d, double complex A[4][4], double complex B[4][4], double complex C[4][4]) {
+    double complex R[4][4];
+    for (int i = 0; i < d; i++)
+        for (int j = 0; j < d; j++) {
+            R[i][j] = 0.0;
+            for (int k = 0; k < d; k++) R[i][j] += A[i][k] * B[k][j];
+        }
+    memcpy(C, R, sizeof(R));
+}
+
+/* Scambia il ruolo dei due bit locali di una matrice 4x4 (indici 1 <-> 2). */
+static void swapLocalBits(double complex G[4][4]) {
+    static const int perm[4] = {0, 2, 1, 3};
+    double complex R[4][4];
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++) R[perm[i]][perm[j]] = G[i][j];
+    memcpy(G, R, sizeof(R));
+}
+
+/* Estende U (2x2) sul bit locale 'bit' di un blocco a 2 qubit. */
+static void embedSingle(double complex U[2][2], int bit, double complex G[4][4]) {
+    for (int a = 0; a < 4; a++)
+        for (int b = 0; b < 4; b++) {
+            int other = bit ? 1 : 2;   // Maschera dell'altro bit locale
+            G[a][b] = ((a & other) == (b & other)) ? U[(a >> bit) & 1][(b >> bit) & 1] : 0.0;
+        }
+}
+
+/* ---------------------------------------------------------------------------
+ * Emissione del codice
+ * ------------------------------------------------------------------------- */
+
+/* Scrive "+ c * x" omettendo i termini nulli e le moltiplicazioni per +-1. */
+static int printTerm(FILE *out, double complex c, const char *x, int first) {
+    double re = creal(c), im = cimag(c);
+    if (re == 0.0 && im == 0.0) return 0;
+    if (im == 0.0 && (re == 1.0 || re == -1.0)) {
+        fprintf(out, "%s%s", re > 0 ? (first ? "" : " + ") : (first ? "-" : " - "), x);
+    } else {
+        fprintf(out, "%s(%.17g + %.17g * I) * %s", first ? "" : " + ", re, im, x);
+    }
+    return 1;
+}
+
+static void printRow(FILE *out, const char *target, const double complex *row, int d, const char **inputs) {
+    fprintf(out, "        %s = ", target);
+    int any = 0;
+    for (int k = 0; k < d; k++) {
+        any |= printTerm(out, row[k], inputs[k], !any);
+    }
+    fprintf(out, "%s;\n", any ? "" : "0.0");
+}
+
+static int isDiagonal(const FusedBlock *b, int d) {
+    for (int i = 0; i < d; i++)
+        for (int j = 0; j < d; j++)
+            if (i != j && b->M[i][j] != 0.0) return 0;
+    return 1;
+}
+
+/*
+ * Scrive la funzione del blocco. Gli indici con i bit dei qubit a zero si ottengono
+ * inserendo bit nulli in un contatore su 2^(n - k) valori; le maschere sono costanti.
+ */
+static void emitKernel(FusionState *fs, const FusedBlock *b, const char *condition) {
+    FILE *out = fs->kernels;
+    int d = 1 << b->numQubits;
+    int lo = b->qubits[0], hi = (b->numQubits == 2) ? b->qubits[1] : -1;
+    long long loMask = 1LL << lo, hiMask = (hi >= 0) ? 1LL << hi : 0;
+    int k = fs->numKernels++;
+
+    if (b->numQubits == 1) {
+        fprintf(out, "/* Blocco fuso sul qubit %d */\n", lo);
+    } else {
+        fprintf(out, "/* Blocco fuso sui qubit %d, %d */\n", lo, hi);
+    }
+    fprintf(out, "static void kernel%d(double complex *restrict amp) {\n", k);
+    long long count = (1LL << fs->numQubits) >> b->numQubits;
+    if (count >= 4096) {
+        // Sui vettori piccoli l'avvio dei thread costa più del ciclo
+        fprintf(out, "    #pragma omp parallel for schedule(static)\n");
+    }
+    fprintf(out, "    for (long long i = 0; i < %lldLL; i++) {\n", count);
+    fprintf(out, "        long long i0 = ((i >> %d) << %d) | (i & %lldLL);\n", lo, lo + 1, loMask - 1);
+    if (hi >= 0) {
+        fprintf(out, "        i0 = ((i0 >> %d) << %d) | (i0 & %lldLL);\n", hi, hi + 1, hiMask - 1);
+    }
+
+    static const char *names[4] = {"x0", "x1", "x2", "x3"};
+    const long long offsets[4] = {0, loMask, hiMask, loMask | hiMask};
+    if (isDiagonal(b, d)) {
+        // Solo fasi: gli elementi pari a 1 non vengono toccati
+        for (int a = 0; a < d; a++) {
+            if (b->M[a][a] == 1.0) continue;
+            fprintf(out, "        amp[i0 | %lldLL] *= %.17g + %.17g * I;\n",
+                    offsets[a], creal(b->M[a][a]), cimag(b->M[a][a]));
+        }
+    } else {
+        for (int a = 0; a < d; a++) {
+            fprintf(out, "        double complex %s = amp[i0 | %lldLL];\n", names[a], offsets[a]);
+        }
+        for (int a = 0; a < d; a++) {
+            char target[64];
+            snprintf(target, sizeof(target), "amp[i0 | %lldLL]", offsets[a]);
+            printRow(out, target, b->M[a], d, names);
+        }
+    }
+    fprintf(out, "    }\n}\n\n");
+    fprintf(fs->body, "    %skernel%d(state->amplitudes);\n", condition, k);
+}
+
+/* Emette il blocco in attesa che contiene il qubit (se c'è). */
+static void flushQubit(FusionState *fs, int q) {
+    int index = fs->blockOf[q];
+    if (index < 0) return;
+    FusedBlock *b = &fs->blocks[index];
+    emitKernel(fs, b, "");
+    for (int k = 0; k < b->numQubits; k++) fs->blockOf[b->qubits[k]] = -1;
+    b->numQubits = 0;
+}
+
+static void flushAll(FusionState *fs) {
+    for (int q = 0; q < fs->numQubits; q++) flushQubit(fs, q);
+}
+
+/* Aggiunge un gate a 1 qubit al blocco del qubit, creandolo se necessario. */
+static void fuseSingle(FusionState *fs, int q, double complex U[2][2]) {
+    int index = fs->blockOf[q];
+    if (index < 0) {
+        FusedBlock *b = &fs->blocks[q];
+        b->numQubits = 1;
+        b->qubits[0] = q;
+        for (int i = 0; i < 2; i++)
+            for (int j = 0; j < 2; j++) b->M[i][j] = U[i][j];
+        fs->blockOf[q] = q;
+        return;
+    }
+    FusedBlock *b = &fs->blocks[index];
+    double complex G[4][4] = {{0}};
+    if (b->numQubits == 1) {
+        for (int i = 0; i < 2; i++)
+            for (int j = 0; j < 2; j++) G[i][j] = U[i][j];
+        multiply4(2, G, b->M, b->M);
+    } else {
+        embedSingle(U, q == b->qubits[1], G);
+        multiply4(4, G, b->M, b->M);
+    }
+}
+
+/* Aggiunge un gate a 2 qubit (indice locale di gateOpTwoQubitMatrix) sulla coppia q0, q1. */
+static void fuseTwo(FusionState *fs, int q0, int q1, double complex G[4][4]) {
+    int lo = q0 < q1 ? q0 : q1, hi = q0 < q1 ? q1 : q0;
+    if (q0 > q1) swapLocalBits(G);
+
+    int i0 = fs->blockOf[lo], i1 = fs->blockOf[hi];
+    if (i0 >= 0 && i0 == i1) {
+        multiply4(4, G, fs->blocks[i0].M, fs->blocks[i0].M);
+        return;
+    }
+
+    // I blocchi a 2 qubit con un solo qubit in comune vengono emessi; quelli a 1 qubit
+    // vengono assorbiti nel nuovo blocco: M = G (U_hi ⊗ U_lo)
+    double complex M[4][4], E[4][4];
+    for (int a = 0; a < 4; a++)
+        for (int b = 0; b < 4; b++) M[a][b] = (a == b) ? 1.0 : 0.0;
+    int qs[2] = {lo, hi};
+    for (int k = 0; k < 2; k++) {
+        int index = fs->blockOf[qs[k]];
+        if (index < 0) continue;
+        FusedBlock *b = &fs->blocks[index];
+        if (b->numQubits == 2) {
+            flushQubit(fs, qs[k]);
+            continue;
+        }
+        double complex U[2][2] = {{b->M[0][0], b->M[0][1]}, {b->M[1][0], b->M[1][1]}};
+        embedSingle(U, k, E);
+        multiply4(4, E, M, M);
+        b->numQubits = 0;
+        fs->blockOf[qs[k]] = -1;
+    }
+    multiply4(4, G, M, M);
+
+    FusedBlock *b = &fs->blocks[lo];
+    b->numQubits = 2;
+    b->qubits[0] = lo;
+    b->qubits[1] = hi;
+    memcpy(b->M, M, sizeof(M));
+    fs->blockOf[lo] = fs->blockOf[hi] = lo;
+}
+
+/* Operazioni tradotte in chiamate del simulatore (interrompono la fusione sui loro qubit). */
+static void emitCall(FusionState *fs, const GateOp *op, const char *condition) {
+    const int *q = op->qubits;
+    FILE *out = fs->body;
+    switch (op->type) {
+        case GATE_TOFFOLI: fprintf(out, "    %sapplyToffoli(state, %d, %d, %d);\n", condition, q[0], q[1], q[2]); break;
+        case GATE_CCZ:     fprintf(out, "    %sapplyCCZ(state, %d, %d, %d);\n", condition, q[0], q[1], q[2]); break;
+        case GATE_CSWAP:   fprintf(out, "    %sapplyFredkin(state, %d, %d, %d);\n", condition, q[0], q[1], q[2]); break;
+        case GATE_MEASURE: fprintf(out, "    %sc[%d] = measure(state, %d).result;\n", condition, op->cbit, q[0]); break;
+        case GATE_RESET:
+            fprintf(out, "    %sif (measure(state, %d).result) applyX(state, %d);\n", condition, q[0], q[0]);
+            break;
+        default:           break;
+    }
+}
+
+void generateFusedCFile(const char *outputFilename, const QuantumCircuit *circuit) {
+    FILE *out = fopen(outputFilename, "w");
+    FusionState fs;
+    fs.kernels = out;
+    fs.body = tmpfile();
+    fs.numQubits = circuit->numQubits;
+    fs.numKernels = 0;
+    fs.blocks = calloc(circuit->numQubits > 0 ? circuit->numQubits : 1, sizeof(FusedBlock));
+    fs.blockOf = malloc((circuit->numQubits > 0 ? circuit->numQubits : 1) * sizeof(int));
+    if (out == NULL || fs.body == NULL) {
+        perror("Errore nella creazione del file C");
+        exit(EXIT_FAILURE);
+    }
+    if (!fs.blocks || !fs.blockOf) {
+        perror("Errore allocazione nel generatore di codice");
+        exit(EXIT_FAILURE);
+    }
+    for (int q = 0; q < circuit->numQubits; q++) fs.blockOf[q] = -1;
+
+    int numCbits = circuit->numClbits;
+    fprintf(out, "#include \"quantum_sim.h\"\n");
+    fprintf(out, "#include \"quantum_circuit.h\"\n");
+    fprintf(out, "#include <stdio.h>\n");
+    fprintf(out, "#include <complex.h>\n\n");
+    fprintf(out, "// Codice generato da QasmParser --fused: %d qubit, %d operazioni nel circuito\n\n",
+            circuit->numQubits, circuit->numOps);
+
+    for (int k = 0; k < circuit->numOps; k++) {
+        const GateOp *op = &circuit->ops[k];
+        const int *q = op->qubits;
+        char condition[96] = "";
+        if (op->condSize > 0) {
+            snprintf(condition, sizeof(condition), "if (classicalRegisterValue(c, %d, %d) == %lldLL) ",
+                     op->condOffset, op->condSize, op->condValue);
+        }
+
+        if (op->type == GATE_BARRIER) {
+            flushAll(&fs);
+            continue;
+        }
+
+        int arity = gateArity(op->type);
+        double complex U[2][2], G[4][4];
+        int unitary1 = (arity == 1) && gateOpSingleQubitMatrix(op, NULL, U);
+        int unitary2 = (arity == 2) && gateOpTwoQubitMatrix(op, NULL, G);
+
+        if (op->condSize == 0 && unitary1) {
+            fuseSingle(&fs, q[0], U);
+        } else if (op->condSize == 0 && unitary2) {
+            fuseTwo(&fs, q[0], q[1], G);
+        } else {
+            for (int j = 0; j < arity; j++) flushQubit(&fs, q[j]);
+            if (unitary1 || unitary2) {
+                // Gate condizionato: blocco proprio, eseguito sotto la condizione
+                FusedBlock b = {0};
+                b.numQubits = arity;
+                if (unitary1) {
+                    b.qubits[0] = q[0];
+                    for (int i = 0; i < 2; i++)
+                        for (int j = 0; j < 2; j++) b.M[i][j] = U[i][j];
+                } else {
+                    if (q[0] > q[1]) swapLocalBits(G);
+                    b.qubits[0] = q[0] < q[1] ? q[0] : q[1];
+                    b.qubits[1] = q[0] < q[1] ? q[1] : q[0];
+                    memcpy(b.M, G, sizeof(G));
+                }
+                emitKernel(&fs, &b, condition);
+            } else {
+                emitCall(&fs, op, condition);
+            }
+        }
+    }
+    flushAll(&fs);
+
+    fprintf(out, "void circuit() {\n");
+    fprintf(out, "    QubitState *state = initializeState(%d);\n", circuit->numQubits);
+    fprintf(out, "    int c[%d] = {0}; // Array dei bit classici\n\n", numCbits > 0 ? numCbits : 1);
+    rewind(fs.body);
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), fs.body)) > 0) {
+        fwrite(buffer, 1, n, out);
+    }
+    fprintf(out, "\n");
+    for (int k = 0; k < numCbits; k++) {
+        fprintf(out, "    printf(\"c[%d]=%%d\\n\", c[%d]);\n", k, k);
+    }
+    fprintf(out, "    printState(state);\n");
+    fprintf(out, "    freeState(state);\n");
+    fprintf(out, "    (void)c;\n");
+    fprintf(out, "}\n");
+
+    fclose(fs.body);
+    fclose(out);
+    free(fs.blocks);
+    free(fs.blockOf);
+}
@@ -0,0 +1,17 @@
+#ifndef FUSED_CODEGEN_H
+#define FUSED_CODEGEN_H
+
+#include "../quantum_circuit.h"  // Per QuantumCircuit
+
+// Generatore di codice C specializzato per circuiti compilati in anticipo.
+//
+// I gate unitari consecutivi vengono fusi in blocchi su 1 o 2 qubit (gate a 1 qubit sullo
+// stesso qubit, gate a 2 qubit sulla stessa coppia e i gate a 1 qubit adiacenti a essi).
+// Ogni blocco diventa una funzione dedicata in cui dimensione dello stato, maschere dei qubit
+// ed elementi della matrice sono costanti: il compilatore può srotolare e vettorizzare il
+// ciclo, e i termini nulli o unitari della matrice non generano moltiplicazioni.
+// Barriere, misure, reset, gate a 3 qubit e operazioni condizionate interrompono la fusione
+// sui qubit coinvolti (le barriere su tutti) e vengono tradotti nelle chiamate del simulatore.
+void generateFusedCFile(const char *outputFilename, const QuantumCircuit *circuit);
+
+#endif // FUSED_CODEGEN_H
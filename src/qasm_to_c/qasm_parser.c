@@ -16,121 +16,1211 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "qasm_parser.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <math.h>
 
-void generateCFile(const char *outputFilename, int numQubits, int numCbits) {
-    FILE *outputFile = fopen(outputFilename, "w");
-    if (outputFile == NULL) {
-        perror("Errore nella creazione del file C");
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+#define QASM_MAX_PARAMS 16   // Parametri di un gate
+#define QASM_MAX_ARGS 16     // Argomenti quantistici di un gate
+
+typedef enum { TOK_EOF, TOK_ID, TOK_NUM, TOK_STR, TOK_SYM } QasmTokenKind;
+
+// Simboli di due caratteri (quelli di un carattere usano il carattere stesso)
+enum { SYM_ARROW = 256, SYM_EQ };
+
+typedef struct {
+    QasmTokenKind kind;
+    int sym;            // Simbolo (TOK_SYM)
+    int length;
+    int line;
+    const char *text;   // Puntatore nel sorgente (senza virgolette per TOK_STR)
+    double value;       // Valore (TOK_NUM)
+} QasmToken;
+
+typedef struct {
+    const char *pos;
+    const char *end;
+    int line;
+    const char *filename;
+} QasmLexer;
+
+typedef struct {
+    char *name;
+    int offset;
+    int size;
+} QasmRegister;
+
+// Gate riconosciuti: quelli nativi vengono tradotti direttamente in GateOp
+typedef enum {
+    QB_USER, QB_OPAQUE,
+    QB_U, QB_U2, QB_U1, QB_ID, QB_U0,
+    QB_X, QB_Y, QB_Z, QB_H, QB_S, QB_SDG, QB_T, QB_TDG,
+    QB_RX, QB_RY, QB_RZ, QB_SX, QB_SXDG,
+    QB_CX, QB_CY, QB_CZ, QB_CH, QB_SWAP, QB_CCX, QB_CSWAP,
+    QB_CRX, QB_CRY, QB_CRZ, QB_CU1, QB_CU3, QB_CU, QB_CSX
+} QasmBuiltin;
+
+typedef struct {
+    char *name;
+    QasmBuiltin builtin;
+    int numParams;
+    int numArgs;
+    QasmToken *paramNames;   // Solo per i gate definiti con "gate"
+    QasmToken *argNames;
+    QasmToken *body;
+    int bodyLength;
+    const char *filename;    // File della definizione (per i messaggi di errore)
+} QasmGate;
+
+struct QasmParser {
+    QasmLexer lex;
+    const char *source;      // Inizio del testo principale
+
+    QasmToken *tokens;       // Istruzione corrente
+    int numTokens;
+    int tokenCapacity;
+
+    QasmRegister *qregs, *cregs;
+    int numQregs, numCregs;
+
+    QasmGate *gates;
+    int numGates;
+    int gateCapacity;
+    int *gateTable;          // Tabella hash nome -> indice + 1 (0 = vuoto)
+    int gateTableSize;
+
+    int qelibIncluded;
+    char **ownedText;        // Sorgenti inclusi e nomi dei file, liberati con il parser
+    int numOwnedText;
+
+    // Condizione dell'istruzione "if" in corso (condSize = 0: nessuna)
+    int condOffset;
+    int condSize;
+    long long condValue;
+};
+
+// Vista su una sequenza di token, con l'ambiente di un gate in espansione
+typedef struct {
+    const QasmGate *gate;
+    const double *params;
+    const int *qubits;
+} QasmEnv;
+
+typedef struct {
+    const QasmToken *tok;
+    int pos;
+    int end;
+    const char *filename;
+    const QasmEnv *env;
+} QasmCursor;
+
+typedef struct {
+    const char *name;
+    QasmBuiltin builtin;
+    int numParams;
+    int numArgs;
+} QasmBuiltinSpec;
+
+// Gate nativi del linguaggio
+static const QasmBuiltinSpec coreGates[] = {
+    {"U", QB_U, 3, 1}, {"CX", QB_CX, 0, 2}
+};
+
+// Gate di qelib1.inc tradotti direttamente
+static const QasmBuiltinSpec qelibGates[] = {
+    {"u3", QB_U, 3, 1}, {"u", QB_U, 3, 1}, {"u2", QB_U2, 2, 1}, {"u1", QB_U1, 1, 1},
+    {"p", QB_U1, 1, 1}, {"id", QB_ID, 0, 1}, {"u0", QB_U0, 1, 1},
+    {"x", QB_X, 0, 1}, {"y", QB_Y, 0, 1}, {"z", QB_Z, 0, 1}, {"h", QB_H, 0, 1},
+    {"s", QB_S, 0, 1}, {"sdg", QB_SDG, 0, 1}, {"t", QB_T, 0, 1}, {"tdg", QB_TDG, 0, 1},
+    {"rx", QB_RX, 1, 1}, {"ry", QB_RY, 1, 1}, {"rz", QB_RZ, 1, 1},
+    {"sx", QB_SX, 0, 1}, {"sxdg", QB_SXDG, 0, 1},
+    {"cx", QB_CX, 0, 2}, {"cy", QB_CY, 0, 2}, {"cz", QB_CZ, 0, 2}, {"ch", QB_CH, 0, 2},
+    {"swap", QB_SWAP, 0, 2}, {"ccx", QB_CCX, 0, 3}, {"cswap", QB_CSWAP, 0, 3},
+    {"crx", QB_CRX, 1, 2}, {"cry", QB_CRY, 1, 2}, {"crz", QB_CRZ, 1, 2},
+    {"cu1", QB_CU1, 1, 2}, {"cp", QB_CU1, 1, 2}, {"cu3", QB_CU3, 3, 2},
+    {"cu", QB_CU, 4, 2}, {"csx", QB_CSX, 0, 2}
+};
+
+// Gate di qelib1.inc senza un equivalente nativo, definiti in QASM
+static const char qelibSource[] =
+    "gate rxx(theta) a, b { h a; h b; cx a, b; rz(theta) b; cx a, b; h a; h b; }\n"
+    "gate rzz(theta) a, b { cx a, b; rz(theta) b; cx a, b; }\n"
+    "gate rccx a, b, c { u2(0, pi) c; u1(pi/4) c; cx b, c; u1(-pi/4) c; cx a, c;\n"
+    "                    u1(pi/4) c; cx b, c; u1(-pi/4) c; u2(0, pi) c; }\n"
+    "gate c3x a, b, c, d { h d; cu1(pi/4) a, d; h d; cx a, b; h d; cu1(-pi/4) b, d; h d;\n"
+    "                      cx a, b; h d; cu1(pi/4) b, d; h d; cx b, c;\n"
+    "                      h d; cu1(-pi/4) c, d; h d; cx a, c; h d; cu1(pi/4) c, d; h d;\n"
+    "                      cx b, c; h d; cu1(-pi/4) c, d; h d; cx a, c;\n"
+    "                      h d; cu1(pi/4) c, d; h d; }\n"
+    "gate c3sqrtx a, b, c, d { h d; cu1(pi/8) a, d; h d; cx a, b; h d; cu1(-pi/8) b, d; h d;\n"
+    "                          cx a, b; h d; cu1(pi/8) b, d; h d; cx b, c;\n"
+    "                          h d; cu1(-pi/8) c, d; h d; cx a, c; h d; cu1(pi/8) c, d; h d;\n"
+    "                          cx b, c; h d; cu1(-pi/8) c, d; h d; cx a, c;\n"
+    "                          h d; cu1(pi/8) c, d; h d; }\n"
+    "gate rc3x a, b, c, d { u2(0, pi) d; u1(pi/4) d; cx c, d; u1(-pi/4) d; u2(0, pi) d;\n"
+    "                       cx a, d; u1(pi/4) d; cx b, d; u1(-pi/4) d; cx a, d; u1(pi/4) d;\n"
+    "                       cx b, d; u1(-pi/4) d; u2(0, pi) d; u1(pi/4) d; cx c, d;\n"
+    "                       u1(-pi/4) d; u2(0, pi) d; }\n"
+    // Il secondo rc3x di c4x è invertito (come in C4XGate di Qiskit): rc3x non è
+    // un'involuzione e due rc3x lascerebbero fasi relative sui controlli
+    "gate c4x a, b, c, d, e { h e; cu1(pi/2) d, e; h e; rc3x a, b, c, d;\n"
+    "                         h e; cu1(-pi/2) d, e; h e;\n"
+    "                         u2(0, pi) d; u1(pi/4) d; cx c, d; u1(-pi/4) d; u2(0, pi) d;\n"
+    "                         u1(pi/4) d; cx b, d; u1(-pi/4) d; cx a, d; u1(pi/4) d;\n"
+    "                         cx b, d; u1(-pi/4) d; cx a, d; u2(0, pi) d; u1(pi/4) d;\n"
+    "                         cx c, d; u1(-pi/4) d; u2(0, pi) d;\n"
+    "                         c3sqrtx a, b, c, e; }\n";
+
+static void parseSource(QasmParser *parser, QuantumCircuit *circuit,
+                        const char *source, size_t length, const char *filename);
+
+/* Stampa "file:riga: errore: ..." e termina. */
+static void qasmError(const char *filename, int line, const char *format, ...) {
+    va_list args;
+    fprintf(stderr, "%s:%d: errore: ", filename, line);
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+    exit(EXIT_FAILURE);
+}
+
+static void* qasmAlloc(size_t bytes) {
+    void *ptr = malloc(bytes);
+    if (!ptr) {
+        perror("Errore allocazione nel parser QASM");
         exit(EXIT_FAILURE);
     }
+    return ptr;
+}
 
-    fprintf(outputFile, "#include \"quantum_sim.h\"\n");
-    fprintf(outputFile, "#include <stdio.h>\n\n");
-    fprintf(outputFile, "void circuit() {\n");
-    fprintf(outputFile, "    int numQubits = %d;\n", numQubits); // Definisce il numero di qubits
-    fprintf(outputFile, "    QubitState *state = initializeState(numQubits);\n");
-    fprintf(outputFile, "    int q[%d]; // Array dei qubits\n", numQubits);
-    fprintf(outputFile, "    int c[%d]; // Array dei bit classici\n\n", numCbits);
+static void* qasmRealloc(void *ptr, size_t bytes) {
+    ptr = realloc(ptr, bytes);
+    if (!ptr) {
+        perror("Errore riallocazione nel parser QASM");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
 
-    fclose(outputFile);
+static char* copyText(const char *text, int length) {
+    char *copy = qasmAlloc(length + 1);
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
 }
 
-void finalizeCFile(const char *outputFilename) {
-    FILE *outputFile = fopen(outputFilename, "a");
-    if (outputFile == NULL) {
-        perror("Errore nella creazione del file C");
-        exit(EXIT_FAILURE);
+/*
+ * Legge l'intero file a blocchi: fseek/ftell non danno una dimensione valida per directory e
+ * file speciali. Restituisce NULL (chiudendo il file) in caso di errore di lettura.
+ */
+static char* readWholeFile(FILE *file, size_t *length) {
+    size_t capacity = 1 << 16, used = 0, n;
+    char *text = qasmAlloc(capacity);
+    while ((n = fread(text + used, 1, capacity - used, file)) > 0) {
+        used += n;
+        if (used == capacity) {
+            capacity *= 2;
+            text = qasmRealloc(text, capacity);
+        }
     }
+    int failed = ferror(file);
+    fclose(file);
+    if (failed) {
+        free(text);
+        return NULL;
+    }
+    *length = used;
+    return text;
+}
 
-    fprintf(outputFile, "    printState(state);\n");
-    fprintf(outputFile, "    freeState(state);\n");
-    fprintf(outputFile, "}\n");
+static char* keepText(QasmParser *parser, char *text) {
+    parser->ownedText = qasmRealloc(parser->ownedText, (parser->numOwnedText + 1) * sizeof(char*));
+    parser->ownedText[parser->numOwnedText++] = text;
+    return text;
+}
 
-    fclose(outputFile);
+static int tokenIs(const QasmToken *t, const char *word) {
+    return t->kind == TOK_ID && (int)strlen(word) == t->length && memcmp(t->text, word, t->length) == 0;
 }
 
-void parseQASM(const char *filename, const char *outputFilename) {
-    FILE *file = fopen(filename, "r");
-    if (file == NULL) {
-        perror("Errore nell'apertura del file QASM");
-        exit(EXIT_FAILURE);
+static int tokensEqual(const QasmToken *a, const QasmToken *b) {
+    return a->length == b->length && memcmp(a->text, b->text, a->length) == 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Analisi lessicale
+ * ------------------------------------------------------------------------- */
+
+/* Numero in notazione decimale o esponenziale. */
+static void lexNumber(QasmLexer *lex, const char *s, QasmToken *t) {
+    const char *start = s, *end = lex->end;
+    double value = 0.0;
+    int isInteger = 1;
+    while (s < end && isdigit((unsigned char)*s)) {
+        value = value * 10.0 + (*s - '0');
+        s++;
+    }
+    if (s < end && *s == '.') {
+        isInteger = 0;
+        s++;
+        while (s < end && isdigit((unsigned char)*s)) s++;
+    }
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char *e = s + 1;
+        if (e < end && (*e == '+' || *e == '-')) e++;
+        if (e < end && isdigit((unsigned char)*e)) {
+            isInteger = 0;
+            s = e;
+            while (s < end && isdigit((unsigned char)*s)) s++;
+        }
+    }
+    t->kind = TOK_NUM;
+    t->length = (int)(s - start);
+    if (!isInteger || t->length > 15) {
+        // Il sorgente non è necessariamente terminato: si converte una copia
+        char buffer[64];
+        if (t->length >= (int)sizeof(buffer)) {
+            qasmError(lex->filename, lex->line, "numero troppo lungo");
+        }
+        memcpy(buffer, start, t->length);
+        buffer[t->length] = '\0';
+        value = strtod(buffer, NULL);
     }
+    t->value = value;
+    lex->pos = s;
+}
 
-    int numQubits = 0, numCbits = 0;
-    char line[256];
+static void lexToken(QasmLexer *lex, QasmToken *t) {
+    const char *s = lex->pos, *end = lex->end;
 
-    // Prima passata: Trova il numero di qubit e bit classici
-    while (fgets(line, sizeof(line), file)) {
-        if (strstr(line, "qreg")) {
-            sscanf(line, "qreg q[%d];", &numQubits);
-        } else if (strstr(line, "creg")) {
-            sscanf(line, "creg c[%d];", &numCbits);
+    for (;;) {
+        while (s < end && (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n')) {
+            if (*s == '\n') lex->line++;
+            s++;
         }
+        if (s + 1 < end && s[0] == '/' && s[1] == '/') {
+            while (s < end && *s != '\n') s++;
+            continue;
+        }
+        break;
     }
 
-    if (numQubits == 0) {
-        fprintf(stderr, "Errore: qreg non trovato o numero di qubits non valido.\n");
-        fclose(file);
-        exit(EXIT_FAILURE);
+    t->line = lex->line;
+    t->text = s;
+    if (s >= end) {
+        t->kind = TOK_EOF;
+        t->length = 0;
+        lex->pos = s;
+        return;
     }
 
-    if (numCbits == 0) {
-        fprintf(stderr, "Errore: creg non trovato o numero di bit classici non valido.\n");
-        fclose(file);
-        exit(EXIT_FAILURE);
+    unsigned char ch = (unsigned char)*s;
+    if (isalpha(ch) || ch == '_') {
+        const char *start = s;
+        while (s < end && (isalnum((unsigned char)*s) || *s == '_')) s++;
+        t->kind = TOK_ID;
+        t->length = (int)(s - start);
+        lex->pos = s;
+    } else if (isdigit(ch) || (ch == '.' && s + 1 < end && isdigit((unsigned char)s[1]))) {
+        lexNumber(lex, s, t);
+    } else if (ch == '"') {
+        const char *start = ++s;
+        while (s < end && *s != '"' && *s != '\n') s++;
+        if (s >= end || *s != '"') {
+            qasmError(lex->filename, t->line, "stringa non terminata");
+        }
+        t->kind = TOK_STR;
+        t->text = start;
+        t->length = (int)(s - start);
+        lex->pos = s + 1;
+    } else {
+        t->kind = TOK_SYM;
+        t->length = 1;
+        t->sym = ch;
+        if (ch == '-' && s + 1 < end && s[1] == '>') {
+            t->sym = SYM_ARROW;
+            t->length = 2;
+        } else if (ch == '=' && s + 1 < end && s[1] == '=') {
+            t->sym = SYM_EQ;
+            t->length = 2;
+        }
+        lex->pos = s + t->length;
+    }
+}
+
+/*
+ * Legge l'istruzione successiva nel buffer dei token: fino al ';' oppure, per le
+ * definizioni "gate", fino alla '}' che chiude il corpo. Restituisce 0 alla fine del testo.
+ */
+static int readStatement(QasmParser *parser) {
+    parser->numTokens = 0;
+    int isGate = 0;
+    for (;;) {
+        if (parser->numTokens == parser->tokenCapacity) {
+            parser->tokenCapacity *= 2;
+            parser->tokens = qasmRealloc(parser->tokens, parser->tokenCapacity * sizeof(QasmToken));
+        }
+        QasmToken *t = &parser->tokens[parser->numTokens];
+        lexToken(&parser->lex, t);
+        if (t->kind == TOK_EOF) {
+            if (parser->numTokens == 0) return 0;
+            // La riga dell'ultimo token letto, non quella della fine del file
+            qasmError(parser->lex.filename, parser->tokens[parser->numTokens - 1].line,
+                      "fine del file inattesa: manca '%s'", isGate ? "}" : ";");
+        }
+        parser->numTokens++;
+        if (parser->numTokens == 1) {
+            isGate = tokenIs(t, "gate");
+        } else if (t->kind == TOK_SYM && t->sym == (isGate ? '}' : ';')) {
+            return 1;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Scorrimento dei token
+ * ------------------------------------------------------------------------- */
+
+static const QasmToken* peek(const QasmCursor *c) {
+    static const QasmToken eof = {TOK_EOF, 0, 0, 0, "", 0.0};
+    return (c->pos < c->end) ? &c->tok[c->pos] : &eof;
+}
+
+static int lastLine(const QasmCursor *c) {
+    if (c->pos < c->end) return c->tok[c->pos].line;
+    return (c->end > 0) ? c->tok[c->end - 1].line : 0;
+}
+
+static int peekSym(const QasmCursor *c, int sym) {
+    const QasmToken *t = peek(c);
+    return t->kind == TOK_SYM && t->sym == sym;
+}
+
+static int acceptSym(QasmCursor *c, int sym) {
+    if (peekSym(c, sym)) {
+        c->pos++;
+        return 1;
+    }
+    return 0;
+}
+
+static void expectSym(QasmCursor *c, int sym) {
+    if (!acceptSym(c, sym)) {
+        const char *name = (sym == SYM_ARROW) ? "->" : (sym == SYM_EQ) ? "==" : NULL;
+        const QasmToken *t = peek(c);
+        if (name) {
+            qasmError(c->filename, lastLine(c), "atteso '%s', trovato '%.*s'", name, t->length, t->text);
+        }
+        qasmError(c->filename, lastLine(c), "atteso '%c', trovato '%.*s'", sym, t->length, t->text);
+    }
+}
+
+static const QasmToken* expectId(QasmCursor *c) {
+    const QasmToken *t = peek(c);
+    if (t->kind != TOK_ID) {
+        qasmError(c->filename, lastLine(c), "atteso un identificatore, trovato '%.*s'", t->length, t->text);
+    }
+    c->pos++;
+    return t;
+}
+
+static long long expectInteger(QasmCursor *c) {
+    const QasmToken *t = peek(c);
+    if (t->kind != TOK_NUM || t->value != floor(t->value) || t->value > 9.0e15) {
+        qasmError(c->filename, lastLine(c), "atteso un intero non negativo, trovato '%.*s'", t->length, t->text);
+    }
+    c->pos++;
+    return (long long)t->value;
+}
+
+/* ---------------------------------------------------------------------------
+ * Tabella dei gate
+ * ------------------------------------------------------------------------- */
+
+static unsigned int hashName(const char *text, int length) {
+    unsigned int h = 2166136261u;
+    for (int k = 0; k < length; k++) {
+        h = (h ^ (unsigned char)text[k]) * 16777619u;
+    }
+    return h;
+}
+
+static const QasmGate* findGate(const QasmParser *parser, const char *text, int length) {
+    unsigned int mask = parser->gateTableSize - 1;
+    for (unsigned int h = hashName(text, length) & mask; parser->gateTable[h]; h = (h + 1) & mask) {
+        const QasmGate *g = &parser->gates[parser->gateTable[h] - 1];
+        if ((int)strlen(g->name) == length && memcmp(g->name, text, length) == 0) {
+            return g;
+        }
+    }
+    return NULL;
+}
+
+static void insertGateIndex(QasmParser *parser, int index) {
+    const char *name = parser->gates[index].name;
+    unsigned int mask = parser->gateTableSize - 1;
+    unsigned int h = hashName(name, (int)strlen(name)) & mask;
+    while (parser->gateTable[h]) h = (h + 1) & mask;
+    parser->gateTable[h] = index + 1;
+}
+
+/* Aggiunge un gate (la tabella hash resta piena al più per metà) e ne restituisce il puntatore. */
+static QasmGate* addGate(QasmParser *parser, const char *name, int length,
+                         QasmBuiltin builtin, int numParams, int numArgs) {
+    if (parser->numGates == parser->gateCapacity) {
+        parser->gateCapacity *= 2;
+        parser->gates = qasmRealloc(parser->gates, parser->gateCapacity * sizeof(QasmGate));
+    }
+    if (2 * (parser->numGates + 1) > parser->gateTableSize) {
+        free(parser->gateTable);
+        parser->gateTableSize *= 2;
+        parser->gateTable = calloc(parser->gateTableSize, sizeof(int));
+        if (!parser->gateTable) {
+            perror("Errore allocazione nel parser QASM");
+            exit(EXIT_FAILURE);
+        }
+        for (int k = 0; k < parser->numGates; k++) insertGateIndex(parser, k);
+    }
+    QasmGate *g = &parser->gates[parser->numGates];
+    memset(g, 0, sizeof(QasmGate));
+    g->name = copyText(name, length);
+    g->builtin = builtin;
+    g->numParams = numParams;
+    g->numArgs = numArgs;
+    insertGateIndex(parser, parser->numGates++);
+    return g;
+}
+
+static void addBuiltins(QasmParser *parser, const QasmBuiltinSpec *specs, int count) {
+    for (int k = 0; k < count; k++) {
+        if (!findGate(parser, specs[k].name, (int)strlen(specs[k].name))) {
+            addGate(parser, specs[k].name, (int)strlen(specs[k].name),
+                    specs[k].builtin, specs[k].numParams, specs[k].numArgs);
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Espressioni sui parametri
+ * ------------------------------------------------------------------------- */
+
+static double parseExpression(QasmCursor *c);
+static double parseUnary(QasmCursor *c);
+
+static double parsePrimary(QasmCursor *c) {
+    const QasmToken *t = peek(c);
+    int line = lastLine(c);
+    if (t->kind == TOK_NUM) {
+        c->pos++;
+        return t->value;
+    }
+    if (acceptSym(c, '(')) {
+        double v = parseExpression(c);
+        expectSym(c, ')');
+        return v;
+    }
+    if (t->kind != TOK_ID) {
+        qasmError(c->filename, line, "espressione non valida: '%.*s'", t->length, t->text);
+    }
+    c->pos++;
+    if (tokenIs(t, "pi")) return M_PI;
+
+    static const char *functions[] = {"sin", "cos", "tan", "exp", "ln", "sqrt"};
+    for (int f = 0; f < 6; f++) {
+        if (tokenIs(t, functions[f])) {
+            expectSym(c, '(');
+            double x = parseExpression(c);
+            expectSym(c, ')');
+            switch (f) {
+                case 0:  return sin(x);
+                case 1:  return cos(x);
+                case 2:  return tan(x);
+                case 3:  return exp(x);
+                case 4:  return log(x);
+                default: return sqrt(x);
+            }
+        }
+    }
+
+    if (c->env) {
+        const QasmGate *g = c->env->gate;
+        for (int k = 0; k < g->numParams; k++) {
+            if (tokensEqual(t, &g->paramNames[k])) {
+                return c->env->params[k];
+            }
+        }
+    }
+    qasmError(c->filename, line, "parametro '%.*s' non definito", t->length, t->text);
+    return 0.0;
+}
+
+/* '^' ha la precedenza più alta ed è associativo a destra; il meno unario lo precede. */
+static double parseUnary(QasmCursor *c) {
+    if (acceptSym(c, '-')) return -parseUnary(c);
+    if (acceptSym(c, '+')) return parseUnary(c);
+    double v = parsePrimary(c);
+    if (acceptSym(c, '^')) {
+        v = pow(v, parseUnary(c));
     }
+    return v;
+}
 
-    // Crea il file C con il numero di qubits e bit classici trovato
-    generateCFile(outputFilename, numQubits, numCbits);
+static double parseTerm(QasmCursor *c) {
+    double v = parseUnary(c);
+    for (;;) {
+        if (acceptSym(c, '*')) {
+            v *= parseUnary(c);
+        } else if (acceptSym(c, '/')) {
+            v /= parseUnary(c);
+        } else {
+            return v;
+        }
+    }
+}
 
-    // Seconda passata: Analizza le istruzioni e le aggiunge al file C
-    rewind(file); // Riavvolge il file per la seconda passata
-    FILE *outputFile = fopen(outputFilename, "a"); // Apre in modalità append
+static double parseExpression(QasmCursor *c) {
+    double v = parseTerm(c);
+    for (;;) {
+        if (acceptSym(c, '+')) {
+            v += parseTerm(c);
+        } else if (acceptSym(c, '-')) {
+            v -= parseTerm(c);
+        } else {
+            return v;
+        }
+    }
+}
 
-    while (fgets(line, sizeof(line), file)) {
-        if (strstr(line, "qreg") || strstr(line, "creg")) {
-            // Ignora la definizione del registro quantistico e classico
+/* Lista opzionale "(e1, e2, ...)" di parametri reali; restituisce il loro numero. */
+static int parseParamList(QasmCursor *c, double *params) {
+    int count = 0;
+    if (!acceptSym(c, '(')) return 0;
+    if (acceptSym(c, ')')) return 0;
+    do {
+        if (count == QASM_MAX_PARAMS) {
+            qasmError(c->filename, lastLine(c), "troppi parametri (massimo %d)", QASM_MAX_PARAMS);
+        }
+        params[count++] = parseExpression(c);
+    } while (acceptSym(c, ','));
+    expectSym(c, ')');
+    return count;
+}
+
+/* ---------------------------------------------------------------------------
+ * Generazione delle operazioni
+ * ------------------------------------------------------------------------- */
+
+static void emitOp(QasmParser *parser, QuantumCircuit *circuit, GateOp *op) {
+    op->condOffset = parser->condOffset;
+    op->condSize = parser->condSize;
+    op->condValue = parser->condValue;
+    circuitAddOp(circuit, op);
+}
+
+static void emitBarrier(QasmParser *parser, QuantumCircuit *circuit) {
+    GateOp op = makeGateOp(GATE_BARRIER);
+    emitOp(parser, circuit, &op);
+}
+
+/* Traduce un gate nativo (di OpenQASM o di qelib1.inc) nell'operazione equivalente. */
+static void emitBuiltin(QasmParser *parser, QuantumCircuit *circuit, const QasmGate *g,
+                        const double *p, const int *q) {
+    GateOp op;
+    switch (g->builtin) {
+        case QB_ID:
+        case QB_U0:   return;
+        case QB_U:    op = makeGateOp(GATE_U); op.angle = p[0]; op.phi = p[1]; op.lambda = p[2]; break;
+        case QB_U2:   op = makeGateOp(GATE_U); op.angle = M_PI / 2.0; op.phi = p[0]; op.lambda = p[1]; break;
+        case QB_U1:   op = makeGateOp(GATE_PHASE); op.angle = p[0]; break;
+        case QB_X:    op = makeGateOp(GATE_X); break;
+        case QB_Y:    op = makeGateOp(GATE_Y); break;
+        case QB_Z:    op = makeGateOp(GATE_Z); break;
+        case QB_H:    op = makeGateOp(GATE_H); break;
+        case QB_S:    op = makeGateOp(GATE_S); break;
+        case QB_SDG:  op = makeGateOp(GATE_PHASE); op.angle = -M_PI / 2.0; break;
+        case QB_T:    op = makeGateOp(GATE_T); break;
+        case QB_TDG:  op = makeGateOp(GATE_TDG); break;
+        case QB_RX:   op = makeGateOp(GATE_RX); op.angle = p[0]; break;
+        case QB_RY:   op = makeGateOp(GATE_RY); op.angle = p[0]; break;
+        case QB_RZ:   op = makeGateOp(GATE_RZ); op.angle = p[0]; break;
+        // sx = e^{i pi/4} RX(pi/2): la fase globale viene trascurata
+        case QB_SX:   op = makeGateOp(GATE_U); op.angle = M_PI / 2.0; op.phi = -M_PI / 2.0; op.lambda = M_PI / 2.0; break;
+        case QB_SXDG: op = makeGateOp(GATE_U); op.angle = M_PI / 2.0; op.phi = M_PI / 2.0; op.lambda = -M_PI / 2.0; break;
+        case QB_CX:   op = makeGateOp(GATE_CNOT); break;
+        case QB_CZ:   op = makeGateOp(GATE_CZ); break;
+        case QB_SWAP: op = makeGateOp(GATE_SWAP); break;
+        case QB_CCX:  op = makeGateOp(GATE_TOFFOLI); break;
+        case QB_CSWAP: op = makeGateOp(GATE_CSWAP); break;
+        case QB_CU1:  op = makeGateOp(GATE_CPHASE); op.angle = p[0]; break;
+        // I controllati generici diventano CU(theta, phi, lambda, gamma)
+        case QB_CY:   op = makeGateOp(GATE_CU); op.angle = M_PI; op.phi = M_PI / 2.0; op.lambda = M_PI / 2.0; break;
+        case QB_CH:   op = makeGateOp(GATE_CU); op.angle = M_PI / 2.0; op.lambda = M_PI; break;
+        case QB_CRX:  op = makeGateOp(GATE_CU); op.angle = p[0]; op.phi = -M_PI / 2.0; op.lambda = M_PI / 2.0; break;
+        case QB_CRY:  op = makeGateOp(GATE_CU); op.angle = p[0]; break;
+        case QB_CRZ:  op = makeGateOp(GATE_CU); op.lambda = p[0]; op.gamma = -p[0] / 2.0; break;
+        case QB_CU3:  op = makeGateOp(GATE_CU); op.angle = p[0]; op.phi = p[1]; op.lambda = p[2]; break;
+        case QB_CU:   op = makeGateOp(GATE_CU); op.angle = p[0]; op.phi = p[1]; op.lambda = p[2]; op.gamma = p[3]; break;
+        case QB_CSX:  op = makeGateOp(GATE_CU); op.angle = M_PI / 2.0; op.phi = -M_PI / 2.0;
+                      op.lambda = M_PI / 2.0; op.gamma = M_PI / 4.0; break;
+        default:      return;
+    }
+    for (int k = 0; k < g->numArgs; k++) {
+        op.qubits[k] = q[k];
+    }
+    emitOp(parser, circuit, &op);
+}
+
+static void checkDistinct(const QasmCursor *c, int line, const int *qubits, int count) {
+    for (int a = 0; a < count; a++)
+        for (int b = a + 1; b < count; b++)
+            if (qubits[a] == qubits[b]) {
+                qasmError(c->filename, line, "lo stesso qubit compare più volte negli argomenti");
+            }
+}
+
+static void walkGateBody(QasmParser *parser, QuantumCircuit *circuit, const QasmGate *gate,
+                         const double *params, const int *qubits, int checkOnly);
+
+static void applyGateCall(QasmParser *parser, QuantumCircuit *circuit, const QasmGate *g,
+                          const double *params, const int *qubits, const QasmCursor *c, int line) {
+    switch (g->builtin) {
+        case QB_USER:
+            walkGateBody(parser, circuit, g, params, qubits, 0);
+            break;
+        case QB_OPAQUE:
+            qasmError(c->filename, line, "il gate opaco '%s' non può essere simulato", g->name);
+            break;
+        default:
+            emitBuiltin(parser, circuit, g, params, qubits);
+            break;
+    }
+}
+
+/* Intestazione comune delle chiamate: nome del gate e parametri, controllandone il numero. */
+static const QasmGate* parseCallHead(QasmParser *parser, QasmCursor *c, double *params) {
+    int line = lastLine(c);
+    const QasmToken *name = expectId(c);
+    const QasmGate *g = findGate(parser, name->text, name->length);
+    if (!g) {
+        qasmError(c->filename, line, "gate '%.*s' non definito", name->length, name->text);
+    }
+    int count = parseParamList(c, params);
+    if (count != g->numParams) {
+        qasmError(c->filename, line, "il gate '%s' richiede %d parametri (%d forniti)",
+                  g->name, g->numParams, count);
+    }
+    return g;
+}
+
+/*
+ * Percorre il corpo di un gate definito dall'utente. Con checkOnly i parametri e i qubit
+ * sono fittizi e le chiamate vengono solo verificate (nomi, numero di argomenti e parametri),
+ * così gli errori del corpo vengono segnalati alla definizione.
+ */
+static void walkGateBody(QasmParser *parser, QuantumCircuit *circuit, const QasmGate *gate,
+                         const double *params, const int *qubits, int checkOnly) {
+    QasmEnv env = {gate, params, qubits};
+    QasmCursor c = {gate->body, 0, gate->bodyLength, gate->filename, &env};
+
+    while (c.pos < c.end) {
+        int line = lastLine(&c);
+        if (tokenIs(peek(&c), "barrier")) {
+            c.pos++;
+            do {
+                expectId(&c);
+            } while (acceptSym(&c, ','));
+            expectSym(&c, ';');
+            if (!checkOnly) emitBarrier(parser, circuit);
             continue;
-        } else if (strstr(line, "h ")) {
-            int qubit;
-            sscanf(line, "h q[%d];", &qubit);
-            fprintf(outputFile, "    applyHadamard(state, %d);\n", qubit);
-        } else if (strstr(line, "cx ")) {
-            int control, target;
-            sscanf(line, "cx q%d,q%d;", &control, &target);
-            fprintf(outputFile, "    applyCNOT(state, %d, %d);\n", control, target);
-        } else if (strstr(line, "x ")) {
-            int qubit;
-            sscanf(line, "x q[%d];", &qubit);
-            fprintf(outputFile, "    applyX(state, %d);\n", qubit);
-        } else if (strstr(line, "measure ")) {
-            int qubit, cbit;
-            sscanf(line, "measure q[%d] -> c[%d];", &qubit, &cbit);
-            fprintf(outputFile, "    int result = measure(state, %d);\n", qubit);
-            fprintf(outputFile, "    c[%d] = result;\n", cbit);
-	    fprintf(outputFile, "    printf(\"c[%d]=%%d\\n\",result);\n", cbit);
+        }
+
+        double callParams[QASM_MAX_PARAMS];
+        int callQubits[QASM_MAX_ARGS];
+        const QasmGate *g = parseCallHead(parser, &c, callParams);
+        // Il gate è già registrato durante la verifica del proprio corpo: una chiamata a se
+        // stesso (l'unica ricorsione possibile, i gate vanno definiti prima dell'uso) non
+        // terminerebbe
+        if (g == gate) {
+            qasmError(c.filename, line, "il gate '%s' non può chiamare se stesso", gate->name);
+        }
+        int count = 0;
+        do {
+            const QasmToken *arg = expectId(&c);
+            int k = 0;
+            while (k < gate->numArgs && !tokensEqual(arg, &gate->argNames[k])) k++;
+            if (k == gate->numArgs) {
+                qasmError(c.filename, line, "argomento '%.*s' non definito in '%s'",
+                          arg->length, arg->text, gate->name);
+            }
+            if (count == QASM_MAX_ARGS) {
+                qasmError(c.filename, line, "troppi argomenti (massimo %d)", QASM_MAX_ARGS);
+            }
+            callQubits[count++] = checkOnly ? k : qubits[k];
+        } while (acceptSym(&c, ','));
+        expectSym(&c, ';');
+
+        if (count != g->numArgs) {
+            qasmError(c.filename, line, "il gate '%s' richiede %d qubit (%d forniti)", g->name, g->numArgs, count);
+        }
+        if (checkOnly) {
+            checkDistinct(&c, line, callQubits, count);
         } else {
-            fprintf(outputFile, "    // Istruzione non riconosciuta: %s", line);
+            applyGateCall(parser, circuit, g, callParams, callQubits, &c, line);
         }
     }
+}
 
-    fclose(file);
-    fclose(outputFile);
+/* ---------------------------------------------------------------------------
+ * Istruzioni
+ * ------------------------------------------------------------------------- */
+
+static const QasmRegister* findRegister(const QasmRegister *regs, int count, const QasmToken *name) {
+    for (int k = 0; k < count; k++) {
+        if ((int)strlen(regs[k].name) == name->length && memcmp(regs[k].name, name->text, name->length) == 0) {
+            return &regs[k];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Argomento "r" oppure "r[i]": restituisce l'indice del primo bit e la dimensione
+ * (0 per un singolo elemento, altrimenti la dimensione del registro).
+ */
+static void parseArgument(QasmCursor *c, const QasmRegister *regs, int numRegs, const char *kind,
+                          int *offset, int *size) {
+    int line = lastLine(c);
+    const QasmToken *name = expectId(c);
+    const QasmRegister *r = findRegister(regs, numRegs, name);
+    if (!r) {
+        qasmError(c->filename, line, "registro %s '%.*s' non dichiarato", kind, name->length, name->text);
+    }
+    if (acceptSym(c, '[')) {
+        long long index = expectInteger(c);
+        expectSym(c, ']');
+        if (index >= r->size) {
+            qasmError(c->filename, line, "indice %lld fuori dal registro '%s' di dimensione %d",
+                      index, r->name, r->size);
+        }
+        *offset = r->offset + (int)index;
+        *size = 0;
+    } else {
+        *offset = r->offset;
+        *size = r->size;
+    }
+}
+
+/* Dimensione comune dei registri interi tra gli argomenti (1 se sono tutti singoli elementi). */
+static int broadcastSize(const QasmCursor *c, int line, const int *sizes, int count) {
+    int n = 0;
+    for (int k = 0; k < count; k++) {
+        if (sizes[k] == 0) continue;
+        if (n != 0 && sizes[k] != n) {
+            qasmError(c->filename, line, "registri di dimensioni diverse negli argomenti");
+        }
+        n = sizes[k];
+    }
+    return n ? n : 1;
+}
+
+static void declareRegister(QasmParser *parser, QuantumCircuit *circuit, QasmCursor *c, int quantum) {
+    int line = lastLine(c);
+    const QasmToken *name = expectId(c);
+    expectSym(c, '[');
+    long long size = expectInteger(c);
+    expectSym(c, ']');
+    expectSym(c, ';');
+    if (findRegister(parser->qregs, parser->numQregs, name) ||
+        findRegister(parser->cregs, parser->numCregs, name)) {
+        qasmError(c->filename, line, "registro '%.*s' già dichiarato", name->length, name->text);
+    }
+    if (size <= 0 || size > 1000000) {
+        qasmError(c->filename, line, "dimensione del registro non valida: %lld", size);
+    }
 
-    // Finalizza il file C
-    finalizeCFile(outputFilename);
+    QasmRegister **regs = quantum ? &parser->qregs : &parser->cregs;
+    int *count = quantum ? &parser->numQregs : &parser->numCregs;
+    int *total = quantum ? &circuit->numQubits : &circuit->numClbits;
+    *regs = qasmRealloc(*regs, (*count + 1) * sizeof(QasmRegister));
+    QasmRegister *r = &(*regs)[(*count)++];
+    r->name = copyText(name->text, name->length);
+    r->offset = *total;
+    r->size = (int)size;
+    *total += (int)size;
 }
 
-int main(int argc, char *argv[]) {
-    if (argc < 3) {
-        fprintf(stderr, "Utilizzo: %s <file.qasm> <output.c>\n", argv[0]);
-        return EXIT_FAILURE;
+/* Lista "(a, b, ...)" o "a, b, ..." di identificatori distinti per le definizioni. */
+static int parseNameList(QasmCursor *c, QasmToken *names, int max, int closing) {
+    int count = 0;
+    if (closing && acceptSym(c, closing)) return 0;
+    do {
+        int line = lastLine(c);
+        const QasmToken *t = expectId(c);
+        if (count == max) {
+            qasmError(c->filename, line, "troppi nomi nella definizione (massimo %d)", max);
+        }
+        for (int k = 0; k < count; k++) {
+            if (tokensEqual(t, &names[k])) {
+                qasmError(c->filename, line, "nome '%.*s' ripetuto", t->length, t->text);
+            }
+        }
+        names[count++] = *t;
+    } while (acceptSym(c, ','));
+    if (closing) expectSym(c, closing);
+    return count;
+}
+
+static void defineGate(QasmParser *parser, QasmCursor *c, int opaque) {
+    int line = lastLine(c);
+    const QasmToken *name = expectId(c);
+    if (findGate(parser, name->text, name->length)) {
+        qasmError(c->filename, line, "gate '%.*s' già definito", name->length, name->text);
+    }
+
+    QasmToken paramNames[QASM_MAX_PARAMS], argNames[QASM_MAX_ARGS];
+    int numParams = acceptSym(c, '(') ? parseNameList(c, paramNames, QASM_MAX_PARAMS, ')') : 0;
+    int numArgs = parseNameList(c, argNames, QASM_MAX_ARGS, 0);
+
+    int bodyStart = 0, bodyLength = 0;
+    if (opaque) {
+        expectSym(c, ';');
+    } else {
+        expectSym(c, '{');
+        bodyStart = c->pos;
+        bodyLength = c->end - 1 - c->pos;   // readStatement termina le definizioni con '}'
+        c->pos = c->end;
+    }
+
+    QasmGate *g = addGate(parser, name->text, name->length, opaque ? QB_OPAQUE : QB_USER, numParams, numArgs);
+    g->filename = c->filename;
+    g->paramNames = qasmAlloc((numParams + 1) * sizeof(QasmToken));
+    g->argNames = qasmAlloc((numArgs + 1) * sizeof(QasmToken));
+    g->body = qasmAlloc((bodyLength + 1) * sizeof(QasmToken));
+    memcpy(g->paramNames, paramNames, numParams * sizeof(QasmToken));
+    memcpy(g->argNames, argNames, numArgs * sizeof(QasmToken));
+    memcpy(g->body, c->tok + bodyStart, bodyLength * sizeof(QasmToken));
+    g->bodyLength = bodyLength;
+
+    if (!opaque) {
+        double dummy[QASM_MAX_PARAMS] = {0};
+        walkGateBody(parser, NULL, g, dummy, NULL, 1);
+    }
+}
+
+static void includeFile(QasmParser *parser, QuantumCircuit *circuit, QasmCursor *c) {
+    int line = lastLine(c);
+    const QasmToken *t = peek(c);
+    if (t->kind != TOK_STR) {
+        qasmError(c->filename, line, "atteso il nome del file da includere");
+    }
+    c->pos++;
+    expectSym(c, ';');
+
+    if (t->length == 10 && memcmp(t->text, "qelib1.inc", 10) == 0) {
+        if (!parser->qelibIncluded) {
+            parser->qelibIncluded = 1;
+            addBuiltins(parser, qelibGates, sizeof(qelibGates) / sizeof(qelibGates[0]));
+            parseSource(parser, circuit, qelibSource, sizeof(qelibSource) - 1, "qelib1.inc");
+        }
+        return;
     }
 
-    parseQASM(argv[1], argv[2]);
+    // Percorso relativo alla directory del file che contiene l'include
+    const char *slash = strrchr(c->filename, '/');
+    int dirLength = (t->text[0] != '/' && slash) ? (int)(slash - c->filename) + 1 : 0;
+    char *path = keepText(parser, qasmAlloc(dirLength + t->length + 1));
+    memcpy(path, c->filename, dirLength);
+    memcpy(path + dirLength, t->text, t->length);
+    path[dirLength + t->length] = '\0';
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        qasmError(c->filename, line, "impossibile aprire il file incluso '%s'", path);
+    }
+    size_t length;
+    char *source = readWholeFile(file, &length);
+    if (!source) {
+        qasmError(c->filename, line, "errore nella lettura di '%s'", path);
+    }
+    parseSource(parser, circuit, keepText(parser, source), length, path);
+}
+
+static void parseMeasure(QasmParser *parser, QuantumCircuit *circuit, QasmCursor *c) {
+    int line = lastLine(c);
+    int qOffset, qSize, cOffset, cSize;
+    parseArgument(c, parser->qregs, parser->numQregs, "quantistico", &qOffset, &qSize);
+    expectSym(c, SYM_ARROW);
+    parseArgument(c, parser->cregs, parser->numCregs, "classico", &cOffset, &cSize);
+    expectSym(c, ';');
+    if (qSize != cSize) {
+        qasmError(c->filename, line, "measure tra argomenti di dimensioni diverse");
+    }
+    int n = qSize ? qSize : 1;
+    for (int k = 0; k < n; k++) {
+        GateOp op = makeGateOp(GATE_MEASURE);
+        op.qubits[0] = qOffset + (qSize ? k : 0);
+        op.cbit = cOffset + (cSize ? k : 0);
+        emitOp(parser, circuit, &op);
+    }
+}
+
+static void parseReset(QasmParser *parser, QuantumCircuit *circuit, QasmCursor *c) {
+    int offset, size;
+    parseArgument(c, parser->qregs, parser->numQregs, "quantistico", &offset, &size);
+    expectSym(c, ';');
+    int n = size ? size : 1;
+    for (int k = 0; k < n; k++) {
+        GateOp op = makeGateOp(GATE_RESET);
+        op.qubits[0] = offset + k;
+        emitOp(parser, circuit, &op);
+    }
+}
+
+static void parseBarrier(QasmParser *parser, QuantumCircuit *circuit, QasmCursor *c) {
+    int offset, size;
+    do {
+        parseArgument(c, parser->qregs, parser->numQregs, "quantistico", &offset, &size);
+    } while (acceptSym(c, ','));
+    expectSym(c, ';');
+    emitBarrier(parser, circuit);
+}
+
+/* Chiamata di un gate con estensione ai registri interi: "cx a, b;" con |a| = |b| = n. */
+static void parseGateCall(QasmParser *parser, QuantumCircuit *circuit, QasmCursor *c) {
+    int line = lastLine(c);
+    double params[QASM_MAX_PARAMS];
+    int offsets[QASM_MAX_ARGS], sizes[QASM_MAX_ARGS], qubits[QASM_MAX_ARGS];
+    const QasmGate *g = parseCallHead(parser, c, params);
+
+    int count = 0;
+    do {
+        if (count == QASM_MAX_ARGS) {
+            qasmError(c->filename, line, "troppi argomenti (massimo %d)", QASM_MAX_ARGS);
+        }
+        parseArgument(c, parser->qregs, parser->numQregs, "quantistico", &offsets[count], &sizes[count]);
+        count++;
+    } while (acceptSym(c, ','));
+    expectSym(c, ';');
+    if (count != g->numArgs) {
+        qasmError(c->filename, line, "il gate '%s' richiede %d qubit (%d forniti)", g->name, g->numArgs, count);
+    }
+
+    int n = broadcastSize(c, line, sizes, count);
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < count; k++) {
+            qubits[k] = offsets[k] + (sizes[k] ? i : 0);
+        }
+        checkDistinct(c, line, qubits, count);
+        applyGateCall(parser, circuit, g, params, qubits, c, line);
+    }
+}
+
+/* Istruzione quantistica (eventualmente preceduta da "if (...)"). */
+static void parseQuantumOp(QasmParser *parser, QuantumCircuit *circuit, QasmCursor *c) {
+    const QasmToken *t = peek(c);
+    if (tokenIs(t, "measure")) {
+        c->pos++;
+        parseMeasure(parser, circuit, c);
+    } else if (tokenIs(t, "reset")) {
+        c->pos++;
+        parseReset(parser, circuit, c);
+    } else if (tokenIs(t, "barrier")) {
+        c->pos++;
+        parseBarrier(parser, circuit, c);
+    } else {
+        parseGateCall(parser, circuit, c);
+    }
+}
+
+static void parseIf(QasmParser *parser, QuantumCircuit *circuit, QasmCursor *c) {
+    int line = lastLine(c);
+    expectSym(c, '(');
+    const QasmToken *name = expectId(c);
+    const QasmRegister *r = findRegister(parser->cregs, parser->numCregs, name);
+    if (!r) {
+        qasmError(c->filename, line, "registro classico '%.*s' non dichiarato", name->length, name->text);
+    }
+    // Il valore del registro viene confrontato come long long (classicalRegisterValue)
+    if (r->size > 63) {
+        qasmError(c->filename, line, "condizione sul registro '%s' di %d bit: al massimo 63",
+                  r->name, r->size);
+    }
+    expectSym(c, SYM_EQ);
+    long long value = expectInteger(c);
+    expectSym(c, ')');
+    if (tokenIs(peek(c), "if")) {
+        qasmError(c->filename, line, "istruzioni if annidate non ammesse");
+    }
+
+    parser->condOffset = r->offset;
+    parser->condSize = r->size;
+    parser->condValue = value;
+    parseQuantumOp(parser, circuit, c);
+    parser->condOffset = parser->condSize = 0;
+    parser->condValue = 0;
+}
+
+static void parseStatement(QasmParser *parser, QuantumCircuit *circuit) {
+    QasmCursor c = {parser->tokens, 0, parser->numTokens, parser->lex.filename, NULL};
+    const QasmToken *t = peek(&c);
+    if (t->kind != TOK_ID) {
+        qasmError(c.filename, t->line, "istruzione non valida: '%.*s'", t->length, t->text);
+    }
+
+    // Le chiamate ai gate sono le istruzioni più frequenti: le parole chiave vengono
+    // confrontate solo se il primo carattere può corrispondere
+    switch (t->text[0]) {
+        case 'O':
+            if (tokenIs(t, "OPENQASM")) {
+                c.pos++;
+                const QasmToken *version = peek(&c);
+                if (version->kind != TOK_NUM || version->value < 2.0 || version->value >= 3.0) {
+                    qasmError(c.filename, t->line, "è supportato solo OpenQASM 2.x");
+                }
+                c.pos++;
+                expectSym(&c, ';');
+                return;
+            }
+            break;
+        case 'i':
+            if (tokenIs(t, "include")) {
+                c.pos++;
+                includeFile(parser, circuit, &c);
+                return;
+            }
+            if (tokenIs(t, "if")) {
+                c.pos++;
+                parseIf(parser, circuit, &c);
+                return;
+            }
+            break;
+        case 'q':
+        case 'c':
+            if (tokenIs(t, "qreg") || tokenIs(t, "creg")) {
+                c.pos++;
+                declareRegister(parser, circuit, &c, t->text[0] == 'q');
+                return;
+            }
+            break;
+        case 'g':
+        case 'o':
+            if (tokenIs(t, "gate") || tokenIs(t, "opaque")) {
+                c.pos++;
+                defineGate(parser, &c, t->text[0] == 'o');
+                return;
+            }
+            break;
+    }
+    parseQuantumOp(parser, circuit, &c);
+    if (c.pos != c.end) {
+        qasmError(c.filename, lastLine(&c), "testo inatteso dopo l'istruzione");
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Interfaccia pubblica
+ * ------------------------------------------------------------------------- */
+
+/* Analizza un intero sorgente incluso, ripristinando poi la posizione nel file corrente. */
+static void parseSource(QasmParser *parser, QuantumCircuit *circuit,
+                        const char *source, size_t length, const char *filename) {
+    QasmLexer saved = parser->lex;
+    parser->lex.pos = source;
+    parser->lex.end = source + length;
+    parser->lex.line = 1;
+    parser->lex.filename = filename;
+    while (qasmParseStatement(parser, circuit)) {
+    }
+    parser->lex = saved;
+}
+
+QasmParser* createQasmParser(const char *source, size_t length, const char *filename) {
+    QasmParser *parser = qasmAlloc(sizeof(QasmParser));
+    memset(parser, 0, sizeof(QasmParser));
+    parser->source = source;
+    parser->lex.pos = source;
+    parser->lex.end = source + length;
+    parser->lex.line = 1;
+    parser->lex.filename = keepText(parser, copyText(filename, (int)strlen(filename)));
+
+    parser->tokenCapacity = 64;
+    parser->tokens = qasmAlloc(parser->tokenCapacity * sizeof(QasmToken));
+    parser->gateCapacity = 64;
+    parser->gates = qasmAlloc(parser->gateCapacity * sizeof(QasmGate));
+    parser->gateTableSize = 128;
+    parser->gateTable = calloc(parser->gateTableSize, sizeof(int));
+    if (!parser->gateTable) {
+        perror("Errore allocazione nel parser QASM");
+        exit(EXIT_FAILURE);
+    }
+    addBuiltins(parser, coreGates, sizeof(coreGates) / sizeof(coreGates[0]));
+    return parser;
+}
+
+void freeQasmParser(QasmParser *parser) {
+    if (!parser) return;
+    for (int k = 0; k < parser->numGates; k++) {
+        free(parser->gates[k].name);
+        free(parser->gates[k].paramNames);
+        free(parser->gates[k].argNames);
+        free(parser->gates[k].body);
+    }
+    for (int k = 0; k < parser->numQregs; k++) free(parser->qregs[k].name);
+    for (int k = 0; k < parser->numCregs; k++) free(parser->cregs[k].name);
+    for (int k = 0; k < parser->numOwnedText; k++) free(parser->ownedText[k]);
+    free(parser->ownedText);
+    free(parser->qregs);
+    free(parser->cregs);
+    free(parser->gates);
+    free(parser->gateTable);
+    free(parser->tokens);
+    free(parser);
+}
+
+int qasmParseStatement(QasmParser *parser, QuantumCircuit *circuit) {
+    if (!readStatement(parser)) {
+        return 0;
+    }
+    parseStatement(parser, circuit);
+    return 1;
+}
+
+size_t qasmParserPosition(const QasmParser *parser) {
+    return (size_t)(parser->lex.pos - parser->source);
+}
+
+QuantumCircuit* parseQASMString(const char *source, size_t length, const char *filename) {
+    QuantumCircuit *circuit = createCircuit(0);
+    QasmParser *parser = createQasmParser(source, length, filename);
+    while (qasmParseStatement(parser, circuit)) {
+    }
+    freeQasmParser(parser);
+    return circuit;
+}
+
+QuantumCircuit* parseQASMFile(const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        perror("Errore nell'apertura del file QASM");
+        exit(EXIT_FAILURE);
+    }
+    size_t length;
+    char *source = readWholeFile(file, &length);
+    if (!source) {
+        perror("Errore nella lettura del file QASM");
+        exit(EXIT_FAILURE);
+    }
 
-    return EXIT_SUCCESS;
+    QuantumCircuit *circuit = parseQASMString(source, length, filename);
+    free(source);
+    return circuit;
 }
@@ -0,0 +1,37 @@
+#ifndef QASM_PARSER_H
+#define QASM_PARSER_H
+
+#include <stddef.h>
+#include "../quantum_circuit.h"  // Per QuantumCircuit e GateOp
+
+// Parser di OpenQASM 2.0 che costruisce direttamente un QuantumCircuit.
+//
+// Supporta: intestazione OPENQASM, include (qelib1.inc è interno, gli altri file vengono
+// letti relativamente al file che li include), qreg/creg, definizioni "gate" e "opaque",
+// espressioni sui parametri (+ - * / ^, pi, sin, cos, tan, exp, ln, sqrt), measure, reset,
+// barrier, "if (creg == n)" e l'estensione implicita ai registri (h q; cx a, b; ...).
+// I registri vengono disposti in ordine di dichiarazione: q[0] del primo qreg è il qubit 0.
+// I gate definiti dall'utente vengono espansi nei gate nativi al momento della chiamata;
+// ogni barrier diventa un'unica GATE_BARRIER su tutti i qubit.
+// In caso di errore viene stampato "file:riga: errore: ..." e il programma termina.
+
+typedef struct QasmParser QasmParser;
+
+// Crea un parser sul testo 'source' (length caratteri, non serve il terminatore),
+// che deve restare valido fino a freeQasmParser. 'filename' compare nei messaggi di errore.
+QasmParser* createQasmParser(const char *source, size_t length, const char *filename);
+void freeQasmParser(QasmParser *parser);
+
+// Analizza la prossima istruzione aggiungendo le operazioni al circuito (creato con
+// createCircuit(0): qreg e creg ne aumentano numQubits e numClbits).
+// Restituisce 1 se è stata letta un'istruzione, 0 alla fine del testo.
+int qasmParseStatement(QasmParser *parser, QuantumCircuit *circuit);
+
+// Numero di caratteri del testo già analizzati
+size_t qasmParserPosition(const QasmParser *parser);
+
+// Analizza un intero programma e restituisce il circuito corrispondente
+QuantumCircuit* parseQASMString(const char *source, size_t length, const char *filename);
+QuantumCircuit* parseQASMFile(const char *filename);
+
+#endif // QASM_PARSER_H
@@ -0,0 +1,163 @@
+/*
+ * QuantumSim: A Quantum Circuit Simulator for C Programmers
+ * Copyright (C) 2024 Francesco Sisini
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// mmap, madvise e i thread POSIX non fanno parte di C99
+#define _DEFAULT_SOURCE
+
+#include "qasm_stream.h"
+#include "qasm_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Le pagine del file già analizzate vengono rilasciate a gruppi di questa dimensione
+#define QASM_STREAM_RELEASE_BYTES ((size_t)8 << 20)
+
+typedef struct {
+    const char *data;
+    size_t size;
+    const char *filename;
+
+    QuantumCircuit *chunks[QASM_STREAM_CHUNKS];
+    int full[QASM_STREAM_CHUNKS];   // 1: blocco pronto per il chiamante
+    int last;                       // Indice dell'ultimo blocco, -1 finché il file non è finito
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} QasmStream;
+
+/*
+ * Thread del parser: riempie i blocchi liberi in ordine circolare. I registri dichiarati
+ * vengono sommati tra un blocco e l'altro impostando i totali prima di ogni riempimento.
+ */
+static void* parseChunks(void *arg) {
+    QasmStream *s = arg;
+    QasmParser *parser = createQasmParser(s->data, s->size, s->filename);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    size_t released = 0;
+    int numQubits = 0, numClbits = 0;
+    int more = 1;
+
+    for (int k = 0; more; k = (k + 1) % QASM_STREAM_CHUNKS) {
+        pthread_mutex_lock(&s->lock);
+        while (s->full[k]) {
+            pthread_cond_wait(&s->changed, &s->lock);
+        }
+        pthread_mutex_unlock(&s->lock);
+
+        QuantumCircuit *chunk = s->chunks[k];
+        chunk->numOps = 0;
+        chunk->numQubits = numQubits;
+        chunk->numClbits = numClbits;
+        while (chunk->numOps < QASM_STREAM_CHUNK_OPS && (more = qasmParseStatement(parser, chunk))) {
+        }
+        numQubits = chunk->numQubits;
+        numClbits = chunk->numClbits;
+
+        // Le pagine rilasciate tornano a essere lette dal file se servono ancora
+        // (per esempio per il corpo di un gate definito all'inizio)
+        size_t position = qasmParserPosition(parser) & ~((size_t)pageSize - 1);
+        if (position - released >= QASM_STREAM_RELEASE_BYTES) {
+            madvise((void*)(s->data + released), position - released, MADV_DONTNEED);
+            released = position;
+        }
+
+        pthread_mutex_lock(&s->lock);
+        s->full[k] = 1;
+        if (!more) {
+            s->last = k;
+        }
+        pthread_cond_broadcast(&s->changed);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    freeQasmParser(parser);
+    return NULL;
+}
+
+void streamQASMFile(const char *filename, QasmChunkHandler handler, void *context) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Errore nell'apertura del file QASM");
+        exit(EXIT_FAILURE);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        perror("Errore nella lettura del file QASM");
+        exit(EXIT_FAILURE);
+    }
+
+    QasmStream s;
+    s.filename = filename;
+    s.size = (size_t)info.st_size;
+    s.data = "";
+    if (s.size > 0) {
+        void *map = mmap(NULL, s.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            perror("Errore nella mappatura del file QASM");
+            exit(EXIT_FAILURE);
+        }
+        madvise(map, s.size, MADV_SEQUENTIAL);
+        s.data = map;
+    }
+    close(fd);
+
+    for (int k = 0; k < QASM_STREAM_CHUNKS; k++) {
+        s.chunks[k] = createCircuit(0);
+        s.full[k] = 0;
+    }
+    s.last = -1;
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.changed, NULL);
+
+    pthread_t parserThread;
+    if (pthread_create(&parserThread, NULL, parseChunks, &s) != 0) {
+        fprintf(stderr, "Errore: impossibile avviare il thread del parser QASM\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int k = 0;; k = (k + 1) % QASM_STREAM_CHUNKS) {
+        pthread_mutex_lock(&s.lock);
+        while (!s.full[k]) {
+            pthread_cond_wait(&s.changed, &s.lock);
+        }
+        int isLast = (s.last == k);
+        pthread_mutex_unlock(&s.lock);
+
+        handler(s.chunks[k], context);
+
+        pthread_mutex_lock(&s.lock);
+        s.full[k] = 0;
+        pthread_cond_broadcast(&s.changed);
+        pthread_mutex_unlock(&s.lock);
+        if (isLast) break;
+    }
+
+    pthread_join(parserThread, NULL);
+    pthread_cond_destroy(&s.changed);
+    pthread_mutex_destroy(&s.lock);
+    for (int k = 0; k < QASM_STREAM_CHUNKS; k++) {
+        freeCircuit(s.chunks[k]);
+    }
+    if (s.size > 0) {
+        munmap((void*)s.data, s.size);
+    }
+}
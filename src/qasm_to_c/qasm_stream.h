@@ -0,0 +1,24 @@
+#ifndef QASM_STREAM_H
+#define QASM_STREAM_H
+
+#include "../quantum_circuit.h"  // Per QuantumCircuit
+
+// Lettura in streaming di file QASM molto grandi, con memoria limitata.
+//
+// Il file viene mappato in memoria e analizzato in un solo passaggio da un thread dedicato,
+// che riempie blocchi di circa QASM_STREAM_CHUNK_OPS operazioni; un numero fisso di blocchi
+// (QASM_STREAM_CHUNKS) circola tra il parser e il chiamante, che esegue un blocco mentre il
+// successivo viene analizzato. Le pagine del file già lette vengono rilasciate man mano:
+// la memoria occupata non dipende dalla lunghezza del file.
+
+#define QASM_STREAM_CHUNK_OPS 4096
+#define QASM_STREAM_CHUNKS 4
+
+// Riceve i blocchi in ordine, nel thread chiamante. chunk->numQubits e chunk->numClbits sono
+// il totale dei registri dichiarati fino alla fine del blocco; il blocco viene riutilizzato
+// dopo il ritorno della funzione.
+typedef void (*QasmChunkHandler)(const QuantumCircuit *chunk, void *context);
+
+void streamQASMFile(const char *filename, QasmChunkHandler handler, void *context);
+
+#endif // QASM_STREAM_H
@@ -0,0 +1,52 @@
+/*
+ * QuantumSim: A Quantum Circuit Simulator for C Programmers
+ * Copyright (C) 2024 Francesco Sisini
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "qasm_stream.h"
+#include "../quantum_binary.h"
+
+typedef struct {
+    BinaryWriter *writer;
+    int numQubits;
+    int numClbits;
+} Conversion;
+
+static void writeChunk(const QuantumCircuit *chunk, void *context) {
+    Conversion *conv = context;
+    binaryWriterAddOps(conv->writer, chunk->ops, chunk->numOps);
+    conv->numQubits = chunk->numQubits;
+    conv->numClbits = chunk->numClbits;
+}
+
+/*
+ * Converte un file QASM nel formato binario di quantum_binary.h. Il file viene letto in
+ * streaming, quindi anche circuiti molto grandi vengono convertiti con memoria limitata.
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Utilizzo: %s <file.qasm> <output.qbin>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Conversion conv = {createBinaryWriter(argv[2]), 0, 0};
+    streamQASMFile(argv[1], writeChunk, &conv);
+    closeBinaryWriter(conv.writer, conv.numQubits, conv.numClbits);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+/*
+ * QuantumSim: A Quantum Circuit Simulator for C Programmers
+ * Copyright (C) 2024 Francesco Sisini
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <complex.h>
+#include <string.h>
+#include "qasm_parser.h"
+#include "fused_codegen.h"
+#include "../quantum_circuit.h"
+
+static void printComplex(FILE *out, double complex z) {
+    fprintf(out, "%.17g + %.17g * I", creal(z), cimag(z));
+}
+
+/* Scrive la chiamata corrispondente a un'operazione (senza la condizione). */
+static void generateOp(FILE *out, const GateOp *op) {
+    const int *q = op->qubits;
+    switch (op->type) {
+        case GATE_H:       fprintf(out, "applyHadamard(state, %d);\n", q[0]); break;
+        case GATE_X:       fprintf(out, "applyX(state, %d);\n", q[0]); break;
+        case GATE_Y:       fprintf(out, "applyY(state, %d);\n", q[0]); break;
+        case GATE_Z:       fprintf(out, "applyZ(state, %d);\n", q[0]); break;
+        case GATE_S:       fprintf(out, "applyS(state, %d);\n", q[0]); break;
+        case GATE_T:       fprintf(out, "applyT(state, %d);\n", q[0]); break;
+        case GATE_TDG:     fprintf(out, "applyTdag(state, %d);\n", q[0]); break;
+        case GATE_RX:      fprintf(out, "applyRX(state, %d, %.17g);\n", q[0], op->angle); break;
+        case GATE_RY:      fprintf(out, "applyRY(state, %d, %.17g);\n", q[0], op->angle); break;
+        case GATE_RZ:      fprintf(out, "applyRZ(state, %d, %.17g);\n", q[0], op->angle); break;
+        case GATE_PHASE:   fprintf(out, "applyPhase(state, %d, %.17g);\n", q[0], op->angle); break;
+        case GATE_CNOT:    fprintf(out, "applyCNOT(state, %d, %d);\n", q[0], q[1]); break;
+        case GATE_CZ:      fprintf(out, "applyCZ(state, %d, %d);\n", q[0], q[1]); break;
+        case GATE_CPHASE:  fprintf(out, "applyCPhaseShift(state, %d, %d, cexp(I * %.17g));\n", q[0], q[1], op->angle); break;
+        case GATE_SWAP:    fprintf(out, "applySwap(state, %d, %d);\n", q[0], q[1]); break;
+        case GATE_TOFFOLI: fprintf(out, "applyToffoli(state, %d, %d, %d);\n", q[0], q[1], q[2]); break;
+        case GATE_CCZ:     fprintf(out, "applyCCZ(state, %d, %d, %d);\n", q[0], q[1], q[2]); break;
+        case GATE_CSWAP:   fprintf(out, "applyFredkin(state, %d, %d, %d);\n", q[0], q[1], q[2]); break;
+        case GATE_MEASURE: fprintf(out, "c[%d] = measure(state, %d).result;\n", op->cbit, q[0]); break;
+        case GATE_RESET:   fprintf(out, "if (measure(state, %d).result) applyX(state, %d);\n", q[0], q[0]); break;
+        case GATE_BARRIER: fprintf(out, "; // barrier\n"); break;
+        case GATE_U: {
+            // La matrice viene calcolata qui: il codice generato contiene solo costanti
+            double complex G[2][2];
+            gateOpSingleQubitMatrix(op, NULL, G);
+            fprintf(out, "{\n        double complex G[2][2] = {\n");
+            for (int r = 0; r < 2; r++) {
+                fprintf(out, "            {");
+                printComplex(out, G[r][0]);
+                fprintf(out, ", ");
+                printComplex(out, G[r][1]);
+                fprintf(out, "}%s\n", r == 0 ? "," : "");
+            }
+            fprintf(out, "        };\n        applySingleQubitGate(state, %d, G);\n    }\n", q[0]);
+            break;
+        }
+        case GATE_CU: {
+            double complex G[4][4];
+            gateOpTwoQubitMatrix(op, NULL, G);
+            fprintf(out, "{\n        double complex G[4][4] = {\n");
+            for (int r = 0; r < 4; r++) {
+                fprintf(out, "            {");
+                for (int k = 0; k < 4; k++) {
+                    printComplex(out, G[r][k]);
+                    fprintf(out, k < 3 ? ", " : "");
+                }
+                fprintf(out, "}%s\n", r < 3 ? "," : "");
+            }
+            fprintf(out, "        };\n        applyTwoQubitGate(state, %d, %d, G);\n    }\n", q[0], q[1]);
+            break;
+        }
+        default:
+            fprintf(out, "; // operazione non supportata\n");
+            break;
+    }
+}
+
+/* Genera la funzione circuit() che esegue le operazioni del circuito. */
+void generateCFile(const char *outputFilename, const QuantumCircuit *circuit) {
+    FILE *out = fopen(outputFilename, "w");
+    if (out == NULL) {
+        perror("Errore nella creazione del file C");
+        exit(EXIT_FAILURE);
+    }
+
+    int numCbits = circuit->numClbits;
+    fprintf(out, "#include \"quantum_sim.h\"\n");
+    fprintf(out, "#include \"quantum_circuit.h\"\n");
+    fprintf(out, "#include <stdio.h>\n");
+    fprintf(out, "#include <complex.h>\n");
+    fprintf(out, "#include <math.h>\n\n");
+    fprintf(out, "void circuit() {\n");
+    fprintf(out, "    int numQubits = %d;\n", circuit->numQubits);
+    fprintf(out, "    QubitState *state = initializeState(numQubits);\n");
+    fprintf(out, "    int c[%d] = {0}; // Array dei bit classici\n\n", numCbits > 0 ? numCbits : 1);
+
+    for (int k = 0; k < circuit->numOps; k++) {
+        const GateOp *op = &circuit->ops[k];
+        fprintf(out, "    ");
+        if (op->condSize > 0) {
+            fprintf(out, "if (classicalRegisterValue(c, %d, %d) == %lldLL) ",
+                    op->condOffset, op->condSize, op->condValue);
+        }
+        generateOp(out, op);
+    }
+
+    fprintf(out, "\n");
+    for (int k = 0; k < numCbits; k++) {
+        fprintf(out, "    printf(\"c[%d]=%%d\\n\", c[%d]);\n", k, k);
+    }
+    fprintf(out, "    printState(state);\n");
+    fprintf(out, "    freeState(state);\n");
+    fprintf(out, "}\n");
+
+    fclose(out);
+}
+
+int main(int argc, char *argv[]) {
+    // Con --fused viene generato codice specializzato con i gate fusi (vedi fused_codegen.h)
+    int fused = (argc > 1 && strcmp(argv[1], "--fused") == 0);
+    if (argc - fused < 3) {
+        fprintf(stderr, "Utilizzo: %s [--fused] <file.qasm> <output.c>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    QuantumCircuit *circuit = parseQASMFile(argv[1 + fused]);
+    if (fused) {
+        generateFusedCFile(argv[2 + fused], circuit);
+    } else {
+        generateCFile(argv[2 + fused], circuit);
+    }
+    freeCircuit(circuit);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,523 @@
+// quantum_algorithms.c
+
+#include "quantum_algorithms.h"
+#include "quantum_sim.h"
+#include "quantum_memory.h"
+#include "quantum_trace.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <complex.h>
+#include <math.h>
+
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+/*
+ * Funzione di supporto: FFT radix-2 in place su un vettore di lunghezza N = 2^m.
+ * 'twiddles' contiene e^{sign 2 pi i k / N} per k = 0 ... N/2 - 1.
+ */
+static void fftInPlace(double complex *buf, int m, const double complex *twiddles) {
+    long long N = 1LL << m;
+
+    // Permutazione a bit invertiti
+    for (long long i = 1, j = 0; i < N; i++) {
+        long long bit = N >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            double complex tmp = buf[i];
+            buf[i] = buf[j];
+            buf[j] = tmp;
+        }
+    }
+
+    // Farfalle di Cooley-Tukey (decimazione nel tempo)
+    for (long long len = 2; len <= N; len <<= 1) {
+        long long half = len >> 1;
+        long long stride = N / len;
+        for (long long start = 0; start < N; start += len) {
+            for (long long k = 0; k < half; k++) {
+                double complex w = twiddles[k * stride];
+                double complex u = buf[start + k];
+                double complex v = w * buf[start + k + half];
+                buf[start + k] = u + v;
+                buf[start + k + half] = u - v;
+            }
+        }
+    }
+}
+
+/* Indice ottenuto invertendo l'ordine degli m bit meno significativi di i. */
+static long long reverseBits(long long i, int m) {
+    long long r = 0;
+    for (int b = 0; b < m; b++) {
+        r = (r << 1) | ((i >> b) & 1);
+    }
+    return r;
+}
+
+/*
+ * FFT in place su una sola fibra di N = 2^m ampiezze base[x * stride], con i thread divisi
+ * all'interno di ogni passo: la permutazione a bit invertiti (che applica anche la
+ * normalizzazione) e ciascuno stadio di farfalle sono cicli di iterazioni indipendenti.
+ * Non serve memoria aggiuntiva: è il caso di un registro che copre (quasi) tutto lo stato.
+ */
+static void fftStrided(double complex *base, long long stride, int m,
+                       const double complex *twiddles, double norm) {
+    long long N = 1LL << m;
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < N; i++) {
+        long long j = reverseBits(i, m);
+        if (i < j) {
+            double complex tmp = base[i * stride];
+            base[i * stride] = norm * base[j * stride];
+            base[j * stride] = norm * tmp;
+        } else if (i == j) {
+            base[i * stride] *= norm;
+        }
+    }
+
+    for (long long len = 2; len <= N; len <<= 1) {
+        long long half = len >> 1;
+        long long twiddleStride = N / len;
+
+        #pragma omp parallel for schedule(static)
+        for (long long b = 0; b < N / 2; b++) {
+            // b = (gruppo) * half + k; il gruppo inizia in (gruppo) * len = 2 (b - k)
+            long long k = b & (half - 1);
+            long long i = 2 * (b - k) + k;
+            double complex w = twiddles[k * twiddleStride];
+            double complex u = base[i * stride];
+            double complex v = w * base[(i + half) * stride];
+            base[i * stride] = u + v;
+            base[(i + half) * stride] = u - v;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Registrazione (quantum_trace.h): gli operatori nativi non hanno un'operazione
+ * corrispondente e vengono scritti come la sequenza di gate equivalente.
+ * ------------------------------------------------------------------------- */
+
+static void traceGate(const QubitState *state, GateType type, int qubit0, int qubit1, double angle) {
+    GateOp op = traceGateOp(type, qubit0, qubit1, -1, angle);
+    traceRecordOp(state, &op);
+}
+
+/*
+ * Fase e^{i theta} sullo stato base con tutti i 'count' qubit a 1. Con k = count - 1 controlli
+ * e bersaglio t = qubits[k] si usa AND(x) = 2^{1-k} sum_S (-1)^{|S|+1} parità_S(x) sui
+ * sottoinsiemi non vuoti S dei controlli: percorsi in codice di Gray, la parità di S viene
+ * accumulata con CNOT sul controllo di indice massimo di S, seguito da una CPHASE verso t
+ * (2^k - 1 CPHASE e altrettanti CNOT circa, come c3x di qelib1.inc). I controlli tornano
+ * al valore iniziale alla fine della sequenza.
+ */
+static void traceMultiControlledPhase(const QubitState *state, const int *qubits, int count, double theta) {
+    if (count == 1) {
+        traceGate(state, theta == M_PI ? GATE_Z : GATE_PHASE, qubits[0], -1, theta);
+        return;
+    }
+    if (count == 2) {
+        traceGate(state, theta == M_PI ? GATE_CZ : GATE_CPHASE, qubits[0], qubits[1], theta);
+        return;
+    }
+    if (count == 3 && theta == M_PI) {
+        GateOp op = traceGateOp(GATE_CCZ, qubits[0], qubits[1], qubits[2], 0.0);
+        traceRecordOp(state, &op);
+        return;
+    }
+
+    int k = count - 1;
+    int target = qubits[k];
+    double lambda = theta / (double)(1LL << (k - 1));
+    long long previous = 0;
+    for (long long i = 1; i < (1LL << k); i++) {
+        long long gray = i ^ (i >> 1);
+        int leader = 63 - __builtin_clzll(gray);
+        if (previous) {
+            int changed = __builtin_ctzll(gray ^ previous);
+            if (changed != leader) {
+                traceGate(state, GATE_CNOT, qubits[changed], qubits[leader], 0.0);
+            } else {
+                // Nuovo controllo di indice massimo: raccoglie la parità degli altri elementi di S
+                for (long long rest = gray & ~(1LL << leader); rest; rest &= rest - 1) {
+                    traceGate(state, GATE_CNOT, qubits[__builtin_ctzll(rest)], qubits[leader], 0.0);
+                }
+            }
+        }
+        double angle = (__builtin_popcountll(gray) & 1) ? lambda : -lambda;
+        traceGate(state, GATE_CPHASE, qubits[leader], target, angle);
+        previous = gray;
+    }
+}
+
+/* Dimensione dei vettori di qubit usati per tracciare le porte multi-controllate. */
+#define MAX_TRACE_QUBITS 64
+
+/* X sui qubit di 'qubits' il cui bit in 'pattern' è 0: |pattern> diventa |1...1>. */
+static void traceFlipZeros(const QubitState *state, const int *qubits, int count, unsigned long long pattern) {
+    for (int k = 0; k < count; k++) {
+        if (!((pattern >> k) & 1)) traceGate(state, GATE_X, qubits[k], -1, 0.0);
+    }
+}
+
+/* |x> -> -|x> sull'intero stato: X sui bit a 0, Z multi-controllata, X di nuovo. */
+static void traceMarkedIndex(const QubitState *state, long long index) {
+    int qubits[MAX_TRACE_QUBITS] = {0};
+    if (state->numQubits > MAX_TRACE_QUBITS) {
+        fprintf(stderr, "Errore: traccia di un oracolo su %d qubit (massimo %d)\n",
+                state->numQubits, MAX_TRACE_QUBITS);
+        exit(1);
+    }
+    for (int q = 0; q < state->numQubits; q++) qubits[q] = q;
+    traceFlipZeros(state, qubits, state->numQubits, (unsigned long long)index);
+    traceMultiControlledPhase(state, qubits, state->numQubits, M_PI);
+    traceFlipZeros(state, qubits, state->numQubits, (unsigned long long)index);
+}
+
+/* Circuito della QFT (il qubit di indice maggiore per primo), swap finali inclusi;
+   l'inversa percorre la stessa sequenza al contrario con le fasi coniugate. */
+static void traceQFT(const QubitState *state, int firstQubit, int m, int inverse) {
+    if (!inverse) {
+        for (int j = m - 1; j >= 0; j--) {
+            traceGate(state, GATE_H, firstQubit + j, -1, 0.0);
+            for (int k = j - 1; k >= 0; k--) {
+                traceGate(state, GATE_CPHASE, firstQubit + k, firstQubit + j, M_PI / (double)(1LL << (j - k)));
+            }
+        }
+    }
+    for (int j = 0; j < m / 2; j++) {
+        traceGate(state, GATE_SWAP, firstQubit + j, firstQubit + m - 1 - j, 0.0);
+    }
+    if (inverse) {
+        for (int j = 0; j < m; j++) {
+            for (int k = 0; k < j; k++) {
+                traceGate(state, GATE_CPHASE, firstQubit + k, firstQubit + j, -M_PI / (double)(1LL << (j - k)));
+            }
+            traceGate(state, GATE_H, firstQubit + j, -1, 0.0);
+        }
+    }
+}
+
+/*
+ * La QFT sul registro [firstQubit, firstQubit + numQubits) è una DFT lungo il corrispondente
+ * "asse" dell'array delle ampiezze. Ogni combinazione dei bit esterni al registro individua
+ * una fibra di 2^numQubits ampiezze con passo 2^firstQubit.
+ * - Con almeno una fibra per thread le fibre vengono distribuite tra i thread: ciascuna viene
+ *   trasformata con una FFT O(m 2^m), in place se è contigua (firstQubit = 0), altrimenti
+ *   raccolta in un buffer del thread che resta in cache.
+ * - Con meno fibre che thread (per esempio la QFT di tutto il registro) le fibre vengono
+ *   trasformate una alla volta dividendo tra i thread le farfalle di ogni stadio.
+ * I buffer (uno per thread attivo, solo se servono) passano dal budget di memoria.
+ */
+void applyQFT(QubitState *state, int firstQubit, int numQubits, int inverse) {
+    int n = state->numQubits;
+    int m = numQubits;
+    if (m <= 0) return;
+    if (firstQubit < 0 || firstQubit + m > n) {
+        fprintf(stderr, "Errore: applyQFT sui qubit %d ... %d di uno stato di %d qubit\n",
+                firstQubit, firstQubit + m - 1, n);
+        exit(1);
+    }
+    if (gateTraceActive) {
+        if (gateTraceDepth == 0) traceQFT(state, firstQubit, m, inverse);
+        if (gateTraceDryRun) return;
+    }
+
+    long long N = 1LL << m;
+    long long lowCount = 1LL << firstQubit;
+    long long numFibers = 1LL << (n - m);
+    double sign = inverse ? -1.0 : 1.0;
+    double norm = 1.0 / sqrt((double)N);
+
+    size_t twiddleBytes = (size_t)(N / 2 + 1) * sizeof(double complex);
+    double complex *twiddles = budgetMalloc(twiddleBytes, "fattori di rotazione della QFT");
+    for (long long k = 0; k < N / 2 + 1; k++) {
+        twiddles[k] = cexp(sign * 2.0 * M_PI * I * (double)k / (double)N);
+    }
+
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+
+    if (numFibers < threads) {
+        for (long long f = 0; f < numFibers; f++) {
+            long long low = f & (lowCount - 1);
+            long long high = f >> firstQubit;
+            fftStrided(state->amplitudes + (high << (firstQubit + m)) + low, lowCount, m, twiddles, norm);
+        }
+        budgetFree(twiddles, twiddleBytes);
+        return;
+    }
+
+    size_t scratchBytes = 0;
+    double complex *scratch = NULL;
+    if (lowCount > 1) {
+        scratchBytes = checkedBytes((size_t)threads * (size_t)N, sizeof(double complex), "buffer della QFT");
+        scratch = budgetMalloc(scratchBytes, "buffer della QFT");
+    }
+
+    #pragma omp parallel num_threads(threads)
+    {
+        int tid = 0;
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+#endif
+        double complex *buf = scratch ? scratch + (size_t)tid * N : NULL;
+
+        #pragma omp for schedule(static)
+        for (long long f = 0; f < numFibers; f++) {
+            // f = (bit alti) * lowCount + (bit bassi)
+            long long low = f & (lowCount - 1);
+            long long high = f >> firstQubit;
+            double complex *base = state->amplitudes + (high << (firstQubit + m)) + low;
+
+            if (!buf) {
+                fftInPlace(base, m, twiddles);
+                for (long long k = 0; k < N; k++) {
+                    base[k] *= norm;
+                }
+                continue;
+            }
+            for (long long x = 0; x < N; x++) {
+                buf[x] = base[x * lowCount];
+            }
+            fftInPlace(buf, m, twiddles);
+            for (long long k = 0; k < N; k++) {
+                base[k * lowCount] = norm * buf[k];
+            }
+        }
+    }
+
+    budgetFree(scratch, scratchBytes);
+    budgetFree(twiddles, twiddleBytes);
+}
+
+/* Oracolo sparso: inverte il segno solo degli indici marcati. */
+void applyPhaseOracle(QubitState *state, const long long *markedIndices, int numMarked) {
+    if (gateTraceActive) {
+        if (gateTraceDepth == 0) {
+            for (int k = 0; k < numMarked; k++) traceMarkedIndex(state, markedIndices[k]);
+        }
+        if (gateTraceDryRun) return;
+    }
+    for (int k = 0; k < numMarked; k++) {
+        state->amplitudes[markedIndices[k]] = -state->amplitudes[markedIndices[k]];
+    }
+}
+
+/* Oracolo tramite predicato, valutato una volta per stato base. */
+void applyPhaseOraclePredicate(QubitState *state, BasisPredicate predicate, void *context) {
+    long long dim = 1LL << state->numQubits;
+
+    // Registrazione: il predicato viene valutato su tutti gli indici (anche in dry-run)
+    if (gateTraceActive) {
+        if (gateTraceDepth == 0) {
+            for (long long i = 0; i < dim; i++) {
+                if (predicate(i, context)) traceMarkedIndex(state, i);
+            }
+        }
+        if (gateTraceDryRun) return;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        if (predicate(i, context)) {
+            state->amplitudes[i] = -state->amplitudes[i];
+        }
+    }
+}
+
+/*
+ * Inversione rispetto alla media. Se il registro copre tutti i qubit basta una sola
+ * riduzione globale; altrimenti si calcola una media per ogni fibra (combinazione dei
+ * bit esterni al registro), con la stessa indicizzazione usata da applyQFT.
+ */
+void applyDiffusion(QubitState *state, int firstQubit, int numQubits) {
+    int n = state->numQubits;
+    long long dim = 1LL << n;
+    if (numQubits <= 0) return;
+    if (firstQubit < 0 || firstQubit + numQubits > n) {
+        fprintf(stderr, "Errore: applyDiffusion sui qubit %d ... %d di uno stato di %d qubit\n",
+                firstQubit, firstQubit + numQubits - 1, n);
+        exit(1);
+    }
+    long long N = 1LL << numQubits;
+
+    // 2|s><s| - I = -H X (I - 2|1...1><1...1|) X H sul registro
+    if (gateTraceActive) {
+        if (gateTraceDepth == 0) {
+            int qubits[MAX_TRACE_QUBITS] = {0};
+            for (int k = 0; k < numQubits; k++) qubits[k] = firstQubit + k;
+            for (int k = 0; k < numQubits; k++) traceGate(state, GATE_H, qubits[k], -1, 0.0);
+            traceFlipZeros(state, qubits, numQubits, 0);
+            traceMultiControlledPhase(state, qubits, numQubits, M_PI);
+            traceFlipZeros(state, qubits, numQubits, 0);
+            for (int k = 0; k < numQubits; k++) traceGate(state, GATE_H, qubits[k], -1, 0.0);
+        }
+        if (gateTraceDryRun) return;
+    }
+
+    if (numQubits == n) {
+        double sumRe = 0.0, sumIm = 0.0;
+
+        #pragma omp parallel for reduction(+:sumRe, sumIm) schedule(static)
+        for (long long i = 0; i < dim; i++) {
+            sumRe += creal(state->amplitudes[i]);
+            sumIm += cimag(state->amplitudes[i]);
+        }
+
+        double complex twiceMean = 2.0 * (sumRe + I * sumIm) / (double)dim;
+
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < dim; i++) {
+            state->amplitudes[i] = twiceMean - state->amplitudes[i];
+        }
+        return;
+    }
+
+    long long lowCount = 1LL << firstQubit;
+    long long numFibers = 1LL << (n - numQubits);
+
+    #pragma omp parallel for schedule(static)
+    for (long long f = 0; f < numFibers; f++) {
+        long long low = f & (lowCount - 1);
+        long long high = f >> firstQubit;
+        double complex *base = state->amplitudes + (high << (firstQubit + numQubits)) + low;
+
+        double complex sum = 0.0;
+        for (long long x = 0; x < N; x++) {
+            sum += base[x * lowCount];
+        }
+        double complex twiceMean = 2.0 * sum / (double)N;
+        for (long long x = 0; x < N; x++) {
+            base[x * lowCount] = twiceMean - base[x * lowCount];
+        }
+    }
+}
+
+/* Calcola la tabella di verità di f (valori troncati a numOutputs bit). */
+ClassicalOracle* createClassicalOracle(int numInputs, int numOutputs, ClassicalFunction f, void *context) {
+    if (numInputs < 0 || numInputs >= 62) {
+        fprintf(stderr, "Errore: numero di input dell'oracolo non valido (%d)\n", numInputs);
+        exit(1);
+    }
+    if (numOutputs < 1 || numOutputs > 64) {
+        fprintf(stderr, "Errore: numero di output dell'oracolo non valido (%d)\n", numOutputs);
+        exit(1);
+    }
+    ClassicalOracle *oracle = malloc(sizeof(ClassicalOracle));
+    if (!oracle) {
+        perror("Errore allocazione ClassicalOracle");
+        exit(1);
+    }
+    long long size = 1LL << numInputs;
+    unsigned long long outMask = (numOutputs == 64) ? ~0ULL : ((1ULL << numOutputs) - 1);
+    oracle->numInputs = numInputs;
+    oracle->numOutputs = numOutputs;
+    oracle->table = budgetMalloc(checkedBytes(size, sizeof(unsigned long long), "tabella dell'oracolo"),
+                                 "tabella dell'oracolo");
+
+    #pragma omp parallel for schedule(static)
+    for (long long x = 0; x < size; x++) {
+        oracle->table[x] = f((unsigned long long)x, context) & outMask;
+    }
+    return oracle;
+}
+
+void freeClassicalOracle(ClassicalOracle *oracle) {
+    if (oracle) {
+        budgetFree(oracle->table, (1LL << oracle->numInputs) * sizeof(unsigned long long));
+        free(oracle);
+    }
+}
+
+/*
+ * Per ogni stato base i si ricava x dai bit di input e la maschera m(x) = f(x) distribuita
+ * sui qubit di output; U_f scambia le ampiezze di i e i ^ m(x). Poiché x non cambia,
+ * le coppie sono disgiunte: ciascuna viene scambiata solo dall'indice minore e il ciclo
+ * può essere diviso tra i thread senza conflitti.
+ */
+void applyClassicalOracleTable(QubitState *state, const ClassicalOracle *oracle,
+                               const int *inputQubits, const int *outputQubits) {
+    long long dim = 1LL << state->numQubits;
+    int numInputs = oracle->numInputs;
+    int numOutputs = oracle->numOutputs;
+
+    // Qubit di input e di output tutti distinti e interni allo stato: altrimenti U_f
+    // non sarebbe una permutazione e gli scambi a coppie non basterebbero
+    unsigned long long used = 0;
+    for (int k = 0; k < numInputs + numOutputs; k++) {
+        int q = (k < numInputs) ? inputQubits[k] : outputQubits[k - numInputs];
+        if (q < 0 || q >= state->numQubits || ((used >> q) & 1)) {
+            fprintf(stderr, "Errore: qubit %d dell'oracolo non valido o ripetuto (stato di %d qubit)\n",
+                    q, state->numQubits);
+            exit(1);
+        }
+        used |= 1ULL << q;
+    }
+
+    // Per ogni x con f(x) != 0: X multi-controllate dai qubit di input (H Z H sul bersaglio)
+    if (gateTraceActive) {
+        if (gateTraceDepth == 0) {
+            // createClassicalOracle limita gli input a 61: resta posto per il bersaglio
+            int qubits[MAX_TRACE_QUBITS] = {0};
+            for (int k = 0; k < numInputs; k++) qubits[k] = inputQubits[k];
+            for (long long x = 0; x < (1LL << numInputs); x++) {
+                unsigned long long fx = oracle->table[x];
+                if (fx == 0) continue;
+                traceFlipZeros(state, qubits, numInputs, (unsigned long long)x);
+                for (int k = 0; k < numOutputs; k++) {
+                    if (!((fx >> k) & 1)) continue;
+                    qubits[numInputs] = outputQubits[k];
+                    traceGate(state, GATE_H, outputQubits[k], -1, 0.0);
+                    traceMultiControlledPhase(state, qubits, numInputs + 1, M_PI);
+                    traceGate(state, GATE_H, outputQubits[k], -1, 0.0);
+                }
+                traceFlipZeros(state, qubits, numInputs, (unsigned long long)x);
+            }
+        }
+        if (gateTraceDryRun) return;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        unsigned long long x = 0;
+        for (int k = 0; k < numInputs; k++) {
+            x |= (unsigned long long)((i >> inputQubits[k]) & 1) << k;
+        }
+        unsigned long long fx = oracle->table[x];
+        if (fx == 0) continue;
+
+        long long flip = 0;
+        for (int k = 0; k < numOutputs; k++) {
+            if ((fx >> k) & 1) {
+                flip |= 1LL << outputQubits[k];
+            }
+        }
+        long long j = i ^ flip;
+        if (i < j) {
+            double complex tmp = state->amplitudes[i];
+            state->amplitudes[i] = state->amplitudes[j];
+            state->amplitudes[j] = tmp;
+        }
+    }
+}
+
+void applyClassicalOracle(QubitState *state, const int *inputQubits, int numInputs,
+                          const int *outputQubits, int numOutputs,
+                          ClassicalFunction f, void *context) {
+    ClassicalOracle *oracle = createClassicalOracle(numInputs, numOutputs, f, context);
+    applyClassicalOracleTable(state, oracle, inputQubits, outputQubits);
+    freeClassicalOracle(oracle);
+}
@@ -0,0 +1,60 @@
+#ifndef QUANTUM_ALGORITHMS_H
+#define QUANTUM_ALGORITHMS_H
+
+#include <complex.h>
+#include "quantum_sim.h"  // Per QubitState
+
+// Operatori nativi per gli algoritmi noti (vedi la directory algoritmi_noti):
+// ciascuno agisce sull'intero vettore di stato con pochi passaggi, invece di
+// essere costruito da sequenze di gate elementari.
+// Durante la registrazione (quantum_trace.h) vengono scritti come la sequenza di gate
+// equivalente; il predicato di applyPhaseOraclePredicate deve quindi essere deterministico.
+
+// Trasformata di Fourier quantistica sui qubit firstQubit ... firstQubit + numQubits - 1,
+// dove firstQubit è il bit meno significativo del registro x:
+//   QFT |x> = 1/sqrt(N) sum_k e^{+2 pi i x k / N} |k>,   N = 2^numQubits.
+// Con inverse != 0 applica la trasformata inversa (esponente negativo).
+// Il risultato coincide con il circuito di Hadamard e fasi controllate seguito dagli swap finali.
+void applyQFT(QubitState *state, int firstQubit, int numQubits, int inverse);
+
+// Predicato sugli stati base: restituisce un valore diverso da zero se l'indice è marcato
+typedef int (*BasisPredicate)(long long index, void *context);
+
+// Oracolo di fase di Grover: |x> -> -|x> per ciascuno degli indici marcati.
+// Costo proporzionale a numMarked, senza percorrere l'intero vettore.
+void applyPhaseOracle(QubitState *state, const long long *markedIndices, int numMarked);
+
+// Oracolo di fase definito da un predicato: un solo passaggio parallelo sul vettore
+void applyPhaseOraclePredicate(QubitState *state, BasisPredicate predicate, void *context);
+
+// Diffusore di Grover 2|s><s| - I sui qubit firstQubit ... firstQubit + numQubits - 1
+// (|s> sovrapposizione uniforme del registro): ogni ampiezza a_x diventa 2 <a> - a_x,
+// dove <a> è la media sul registro a parità degli altri qubit.
+// Una riduzione parallela per le medie e un passaggio di aggiornamento.
+void applyDiffusion(QubitState *state, int firstQubit, int numQubits);
+
+// Funzione classica f: {0,1}^numInputs -> {0,1}^numOutputs usata dagli oracoli U_f
+typedef unsigned long long (*ClassicalFunction)(unsigned long long x, void *context);
+
+// Tabella di verità di f, calcolata una volta e riutilizzabile tra più chiamate
+typedef struct {
+    int numInputs;
+    int numOutputs;
+    unsigned long long *table;   // table[x] = f(x), 2^numInputs elementi
+} ClassicalOracle;
+
+ClassicalOracle* createClassicalOracle(int numInputs, int numOutputs, ClassicalFunction f, void *context);
+void freeClassicalOracle(ClassicalOracle *oracle);
+
+// Oracolo U_f: |x>|y> -> |x>|y xor f(x)>, con x letto dai qubit inputQubits[0..numInputs-1]
+// (inputQubits[0] bit meno significativo) e y dai qubit outputQubits. È una permutazione
+// delle ampiezze applicata in place con un solo passaggio parallelo.
+void applyClassicalOracle(QubitState *state, const int *inputQubits, int numInputs,
+                          const int *outputQubits, int numOutputs,
+                          ClassicalFunction f, void *context);
+
+// Come applyClassicalOracle, ma con la tabella di f già calcolata
+void applyClassicalOracleTable(QubitState *state, const ClassicalOracle *oracle,
+                               const int *inputQubits, const int *outputQubits);
+
+#endif // QUANTUM_ALGORITHMS_H
@@ -0,0 +1,243 @@
+// quantum_batch.c
+
+#include "quantum_batch.h"
+#include "quantum_sim.h"
+#include "quantum_memory.h"
+#include "quantum_trace.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <complex.h>
+#include <math.h>
+
+/* Alloca un batch di stati, ciascuno inizializzato a |0...0>. */
+BatchedQubitState* initializeBatchedState(int numQubits, int batchSize) {
+    BatchedQubitState *batch = malloc(sizeof(BatchedQubitState));
+    if (!batch) {
+        perror("Errore allocazione BatchedQubitState");
+        exit(1);
+    }
+    batch->numQubits = numQubits;
+    batch->batchSize = batchSize;
+    batch->amplitudes = budgetCalloc(stateVectorBytes(numQubits), batchSize, "ampiezze del batch");
+    // Lo stato base 0 occupa la prima riga: un'ampiezza 1 per ogni elemento
+    for (int b = 0; b < batchSize; b++) {
+        batch->amplitudes[b] = 1.0 + 0.0 * I;
+    }
+    return batch;
+}
+
+/* Libera la memoria associata al batch. */
+void freeBatchedState(BatchedQubitState *batch) {
+    if (batch) {
+        budgetFree(batch->amplitudes, stateVectorBytes(batch->numQubits) * batch->batchSize);
+        free(batch);
+    }
+}
+
+/* Copia uno stato nell'elemento b del batch. */
+void setBatchElement(BatchedQubitState *batch, int b, QubitState *state) {
+    TRACE_REQUIRE_AMPLITUDES(state, 0);
+    long long dim = 1LL << batch->numQubits;
+    int B = batch->batchSize;
+    for (long long i = 0; i < dim; i++) {
+        batch->amplitudes[i * B + b] = state->amplitudes[i];
+    }
+}
+
+/* Estrae una copia dell'elemento b del batch come QubitState indipendente. */
+QubitState* getBatchElement(BatchedQubitState *batch, int b) {
+    QubitState *state = initializeState(batch->numQubits);
+    TRACE_REQUIRE_AMPLITUDES(state, 1);
+    long long dim = 1LL << batch->numQubits;
+    int B = batch->batchSize;
+    for (long long i = 0; i < dim; i++) {
+        state->amplitudes[i] = batch->amplitudes[i * B + b];
+    }
+    return state;
+}
+
+/*
+ * Applica lo stesso gate 2x2 a tutti gli elementi del batch, in place.
+ * Il ciclo esterno (parallelo) percorre le coppie (i, i | 2^target); quello interno scorre
+ * le B ampiezze contigue delle due righe.
+ */
+void applySingleQubitGateBatched(BatchedQubitState *batch, int target, double complex gate[2][2]) {
+    long long half = 1LL << (batch->numQubits - 1);
+    long long step = 1LL << target;
+    int B = batch->batchSize;
+    double complex g00 = gate[0][0], g01 = gate[0][1];
+    double complex g10 = gate[1][0], g11 = gate[1][1];
+
+    #pragma omp parallel for schedule(static)
+    for (long long k = 0; k < half; k++) {
+        long long i = ((k >> target) << (target + 1)) | (k & (step - 1));
+        double complex *row0 = batch->amplitudes + i * B;
+        double complex *row1 = row0 + step * B;
+        for (int b = 0; b < B; b++) {
+            double complex a0 = row0[b];
+            double complex a1 = row1[b];
+            row0[b] = g00 * a0 + g01 * a1;
+            row1[b] = g10 * a0 + g11 * a1;
+        }
+    }
+}
+
+/* Applica all'elemento b il gate gates[b], tutti sullo stesso qubit target. */
+void applySingleQubitGatePerBatch(BatchedQubitState *batch, int target, double complex (*gates)[2][2]) {
+    long long half = 1LL << (batch->numQubits - 1);
+    long long step = 1LL << target;
+    int B = batch->batchSize;
+
+    #pragma omp parallel for schedule(static)
+    for (long long k = 0; k < half; k++) {
+        long long i = ((k >> target) << (target + 1)) | (k & (step - 1));
+        double complex *row0 = batch->amplitudes + i * B;
+        double complex *row1 = row0 + step * B;
+        for (int b = 0; b < B; b++) {
+            double complex a0 = row0[b];
+            double complex a1 = row1[b];
+            row0[b] = gates[b][0][0] * a0 + gates[b][0][1] * a1;
+            row1[b] = gates[b][1][0] * a0 + gates[b][1][1] * a1;
+        }
+    }
+}
+
+void applyHadamardBatched(BatchedQubitState *batch, int target) {
+    double complex H[2][2] = {
+        {1.0 / sqrt(2.0), 1.0 / sqrt(2.0)},
+        {1.0 / sqrt(2.0), -1.0 / sqrt(2.0)}
+    };
+    applySingleQubitGateBatched(batch, target, H);
+}
+
+/* X scambia le righe delle coppie: nessuna moltiplicazione necessaria. */
+void applyXBatched(BatchedQubitState *batch, int target) {
+    long long half = 1LL << (batch->numQubits - 1);
+    long long step = 1LL << target;
+    int B = batch->batchSize;
+
+    #pragma omp parallel for schedule(static)
+    for (long long k = 0; k < half; k++) {
+        long long i = ((k >> target) << (target + 1)) | (k & (step - 1));
+        double complex *row0 = batch->amplitudes + i * B;
+        double complex *row1 = row0 + step * B;
+        for (int b = 0; b < B; b++) {
+            double complex tmp = row0[b];
+            row0[b] = row1[b];
+            row1[b] = tmp;
+        }
+    }
+}
+
+void applyZBatched(BatchedQubitState *batch, int target) {
+    long long dim = 1LL << batch->numQubits;
+    int B = batch->batchSize;
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        if (((i >> target) & 1) == 1) {
+            double complex *row = batch->amplitudes + i * B;
+            for (int b = 0; b < B; b++) {
+                row[b] = -row[b];
+            }
+        }
+    }
+}
+
+void applyCNOTBatched(BatchedQubitState *batch, int control, int target) {
+    long long dim = 1LL << batch->numQubits;
+    long long tmask = 1LL << target;
+    int B = batch->batchSize;
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        // Ogni coppia viene scambiata una sola volta, a partire dall'indice con target = 0
+        if (((i >> control) & 1) == 1 && (i & tmask) == 0) {
+            double complex *row0 = batch->amplitudes + i * B;
+            double complex *row1 = batch->amplitudes + (i | tmask) * B;
+            for (int b = 0; b < B; b++) {
+                double complex tmp = row0[b];
+                row0[b] = row1[b];
+                row1[b] = tmp;
+            }
+        }
+    }
+}
+
+void applyCZBatched(BatchedQubitState *batch, int control, int target) {
+    long long dim = 1LL << batch->numQubits;
+    int B = batch->batchSize;
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        if (((i >> control) & 1) == 1 && ((i >> target) & 1) == 1) {
+            double complex *row = batch->amplitudes + i * B;
+            for (int b = 0; b < B; b++) {
+                row[b] = -row[b];
+            }
+        }
+    }
+}
+
+/* Come applyPhase, ma con un angolo diverso per ogni elemento del batch. */
+void applyPhaseBatched(BatchedQubitState *batch, int qubit, const double *phases) {
+    long long dim = 1LL << batch->numQubits;
+    int B = batch->batchSize;
+
+    // I fattori di fase vengono calcolati una sola volta per elemento
+    double complex *factors = malloc(B * sizeof(double complex));
+    if (!factors) {
+        perror("Errore allocazione in applyPhaseBatched");
+        exit(1);
+    }
+    for (int b = 0; b < B; b++) {
+        factors[b] = cexp(I * phases[b]);
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        if (((i >> qubit) & 1) == 1) {
+            double complex *row = batch->amplitudes + i * B;
+            for (int b = 0; b < B; b++) {
+                row[b] *= factors[b];
+            }
+        }
+    }
+
+    free(factors);
+}
+
+/* Come applyCPhaseShift, ma con una fase complessa diversa per ogni elemento del batch. */
+void applyCPhaseShiftBatched(BatchedQubitState *batch, int control, int target, const double complex *phases) {
+    long long dim = 1LL << batch->numQubits;
+    int B = batch->batchSize;
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        if (((i >> control) & 1) == 1 && ((i >> target) & 1) == 1) {
+            double complex *row = batch->amplitudes + i * B;
+            for (int b = 0; b < B; b++) {
+                row[b] *= phases[b];
+            }
+        }
+    }
+}
+
+/* Probabilità di misurare 1 sul qubit, per ogni elemento del batch. */
+void probabilityOneBatched(BatchedQubitState *batch, int qubit, double *prob1) {
+    long long dim = 1LL << batch->numQubits;
+    int B = batch->batchSize;
+
+    for (int b = 0; b < B; b++) {
+        prob1[b] = 0.0;
+    }
+    #pragma omp parallel for reduction(+:prob1[:B]) schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        if (((i >> qubit) & 1) == 1) {
+            double complex *row = batch->amplitudes + i * B;
+            for (int b = 0; b < B; b++) {
+                prob1[b] += creal(row[b]) * creal(row[b]) + cimag(row[b]) * cimag(row[b]);
+            }
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef QUANTUM_BATCH_H
+#define QUANTUM_BATCH_H
+
+#include <complex.h>
+#include "quantum_sim.h"  // Per QubitState
+
+// Struttura per rappresentare B stati quantistici indipendenti con lo stesso numero di qubit.
+// Le ampiezze sono interlacciate per indice di batch: l'ampiezza dello stato base i
+// dell'elemento b si trova in amplitudes[i * batchSize + b]. In questo modo ogni gate
+// aggiorna tutti i B stati con un ciclo interno contiguo (vettorizzabile), mentre il ciclo
+// esterno sulle coppie di righe è diviso tra i thread come nei kernel di quantum_sim.c.
+typedef struct {
+    int numQubits;
+    int batchSize;
+    double complex *amplitudes;
+} BatchedQubitState;
+
+// Alloca un batch di 'batchSize' stati a 'numQubits' qubit, tutti inizializzati a |0...0>
+BatchedQubitState* initializeBatchedState(int numQubits, int batchSize);
+
+// Libera la memoria associata al batch
+void freeBatchedState(BatchedQubitState *batch);
+
+// Copia lo stato 'state' nell'elemento 'b' del batch (stesso numero di qubit)
+void setBatchElement(BatchedQubitState *batch, int b, QubitState *state);
+
+// Restituisce una copia (da liberare con freeState) dell'elemento 'b' del batch
+QubitState* getBatchElement(BatchedQubitState *batch, int b);
+
+// Gate a 1 qubit identico per tutti gli elementi del batch
+void applySingleQubitGateBatched(BatchedQubitState *batch, int target, double complex gate[2][2]);
+
+// Gate a 1 qubit diverso per ogni elemento: gates[b] viene applicato all'elemento b
+void applySingleQubitGatePerBatch(BatchedQubitState *batch, int target, double complex (*gates)[2][2]);
+
+void applyHadamardBatched(BatchedQubitState *batch, int target);
+void applyXBatched(BatchedQubitState *batch, int target);
+void applyZBatched(BatchedQubitState *batch, int target);
+void applyCNOTBatched(BatchedQubitState *batch, int control, int target);
+void applyCZBatched(BatchedQubitState *batch, int control, int target);
+
+// Versioni parametriche: phases[b] è l'angolo (o la fase complessa) usato per l'elemento b,
+// con la stessa semantica di applyPhase e applyCPhaseShift.
+void applyPhaseBatched(BatchedQubitState *batch, int qubit, const double *phases);
+void applyCPhaseShiftBatched(BatchedQubitState *batch, int control, int target, const double complex *phases);
+
+// Calcola per ogni elemento b la probabilità di misurare 1 sul qubit indicato (senza collasso).
+// 'prob1' deve avere spazio per batchSize valori.
+void probabilityOneBatched(BatchedQubitState *batch, int qubit, double *prob1);
+
+#endif // QUANTUM_BATCH_H
@@ -0,0 +1,405 @@
+// quantum_binary.c
+
+// mmap e madvise non fanno parte di C99
+#define _DEFAULT_SOURCE
+
+#include "quantum_binary.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define QBIN_CONDITIONAL 0x80
+
+struct BinaryWriter {
+    const char *filename;
+    FILE *code;              // Il codice viene accumulato qui e copiato dopo le costanti
+    uint64_t codeBytes;
+    uint64_t numOps;
+
+    double *constants;
+    uint64_t numConstants;
+    uint64_t constantCapacity;
+    // Tabella hash delle sequenze di costanti già inserite: indice iniziale + 1 (0 = vuoto)
+    uint64_t *slots;
+    unsigned char *slotLengths;
+    uint64_t numSlots;       // Potenza di 2
+    uint64_t usedSlots;
+};
+
+/* Numero di angoli di un tipo di gate nella tabella delle costanti. */
+static int angleCount(GateType type) {
+    switch (type) {
+        case GATE_RX:
+        case GATE_RY:
+        case GATE_RZ:
+        case GATE_PHASE:
+        case GATE_CPHASE: return 1;
+        case GATE_U:      return 3;
+        case GATE_CU:     return 4;
+        default:          return 0;
+    }
+}
+
+/* Numero di qubit scritti per un'operazione (la misura ha anche il bit classico). */
+static int operandQubits(GateType type) {
+    return type == GATE_BARRIER ? 0 : gateArity(type);
+}
+
+static uint64_t hashConstants(const double *values, int count) {
+    uint64_t h = 14695981039346656037ULL;
+    const unsigned char *bytes = (const unsigned char*)values;
+    for (size_t k = 0; k < count * sizeof(double); k++) {
+        h = (h ^ bytes[k]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static void* checkedRealloc(void *ptr, size_t bytes) {
+    void *p = realloc(ptr, bytes);
+    if (!p) {
+        perror("Errore allocazione nel formato binario");
+        exit(1);
+    }
+    return p;
+}
+
+static void growSlots(BinaryWriter *w) {
+    uint64_t oldSlots = w->numSlots;
+    uint64_t *old = w->slots;
+    unsigned char *oldLengths = w->slotLengths;
+    w->numSlots = oldSlots ? 2 * oldSlots : 1024;
+    w->slots = calloc(w->numSlots, sizeof(uint64_t));
+    w->slotLengths = calloc(w->numSlots, 1);
+    if (!w->slots || !w->slotLengths) {
+        perror("Errore allocazione nel formato binario");
+        exit(1);
+    }
+    for (uint64_t k = 0; k < oldSlots; k++) {
+        if (!old[k]) continue;
+        uint64_t h = hashConstants(&w->constants[old[k] - 1], oldLengths[k]) & (w->numSlots - 1);
+        while (w->slots[h]) h = (h + 1) & (w->numSlots - 1);
+        w->slots[h] = old[k];
+        w->slotLengths[h] = oldLengths[k];
+    }
+    free(old);
+    free(oldLengths);
+}
+
+/* Restituisce l'indice della sequenza di costanti, aggiungendola se non è già presente. */
+static uint64_t internConstants(BinaryWriter *w, const double *values, int count) {
+    if (2 * (w->usedSlots + 1) > w->numSlots) {
+        growSlots(w);
+    }
+    uint64_t h = hashConstants(values, count) & (w->numSlots - 1);
+    while (w->slots[h]) {
+        if (w->slotLengths[h] == count &&
+            memcmp(&w->constants[w->slots[h] - 1], values, count * sizeof(double)) == 0) {
+            return w->slots[h] - 1;
+        }
+        h = (h + 1) & (w->numSlots - 1);
+    }
+
+    if (w->numConstants + count > w->constantCapacity) {
+        w->constantCapacity = w->constantCapacity ? 2 * w->constantCapacity : 256;
+        w->constants = checkedRealloc(w->constants, w->constantCapacity * sizeof(double));
+    }
+    uint64_t index = w->numConstants;
+    memcpy(&w->constants[index], values, count * sizeof(double));
+    w->numConstants += count;
+    w->slots[h] = index + 1;
+    w->slotLengths[h] = (unsigned char)count;
+    w->usedSlots++;
+    return index;
+}
+
+static void writeVarint(BinaryWriter *w, uint64_t value) {
+    while (value >= 0x80) {
+        putc((int)(value & 0x7f) | 0x80, w->code);
+        value >>= 7;
+        w->codeBytes++;
+    }
+    putc((int)value, w->code);
+    w->codeBytes++;
+}
+
+BinaryWriter* createBinaryWriter(const char *filename) {
+    BinaryWriter *w = calloc(1, sizeof(BinaryWriter));
+    if (!w) {
+        perror("Errore allocazione BinaryWriter");
+        exit(1);
+    }
+    w->filename = filename;
+    w->code = tmpfile();
+    if (!w->code) {
+        perror("Errore nella creazione del file temporaneo");
+        exit(1);
+    }
+    return w;
+}
+
+void binaryWriterAddOps(BinaryWriter *w, const GateOp *ops, int numOps) {
+    for (int k = 0; k < numOps; k++) {
+        const GateOp *op = &ops[k];
+        if (op->paramIndex >= 0) {
+            fprintf(stderr, "Errore: il formato binario non supporta angoli simbolici (operazione %llu)\n",
+                    (unsigned long long)w->numOps);
+            exit(1);
+        }
+        // Come in decodeOp: il valore del registro deve stare in un long long
+        if (op->condSize > 63) {
+            fprintf(stderr, "Errore: condizione su %d bit classici, al massimo 63 (operazione %llu)\n",
+                    op->condSize, (unsigned long long)w->numOps);
+            exit(1);
+        }
+        putc(op->type | (op->condSize > 0 ? QBIN_CONDITIONAL : 0), w->code);
+        w->codeBytes++;
+
+        for (int j = 0; j < operandQubits(op->type); j++) {
+            writeVarint(w, (uint64_t)op->qubits[j]);
+        }
+        if (op->type == GATE_MEASURE) {
+            writeVarint(w, (uint64_t)op->cbit);
+        }
+        int count = angleCount(op->type);
+        if (count > 0) {
+            double angles[4] = {op->angle, op->phi, op->lambda, op->gamma};
+            writeVarint(w, internConstants(w, angles, count));
+        }
+        if (op->condSize > 0) {
+            writeVarint(w, (uint64_t)op->condOffset);
+            writeVarint(w, (uint64_t)op->condSize);
+            writeVarint(w, (uint64_t)op->condValue);
+        }
+        w->numOps++;
+    }
+}
+
+void closeBinaryWriter(BinaryWriter *w, int numQubits, int numClbits) {
+    FILE *out = fopen(w->filename, "wb");
+    if (!out) {
+        perror("Errore nella creazione del file binario");
+        exit(1);
+    }
+    QbinHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, QBIN_MAGIC, sizeof(header.magic));
+    header.version = QBIN_VERSION;
+    header.numQubits = (uint32_t)numQubits;
+    header.numClbits = (uint32_t)numClbits;
+    header.numOps = w->numOps;
+    header.numConstants = w->numConstants;
+    header.codeBytes = w->codeBytes;
+
+    int ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    if (w->numConstants > 0) {
+        ok = ok && fwrite(w->constants, sizeof(double), w->numConstants, out) == w->numConstants;
+    }
+    rewind(w->code);
+    char buffer[1 << 16];
+    size_t n;
+    while (ok && (n = fread(buffer, 1, sizeof(buffer), w->code)) > 0) {
+        ok = fwrite(buffer, 1, n, out) == n;
+    }
+    if (!ok || ferror(w->code) || fclose(out) != 0) {
+        perror("Errore nella scrittura del file binario");
+        exit(1);
+    }
+
+    fclose(w->code);
+    free(w->constants);
+    free(w->slots);
+    free(w->slotLengths);
+    free(w);
+}
+
+void writeBinaryCircuit(const char *filename, const QuantumCircuit *circuit) {
+    BinaryWriter *w = createBinaryWriter(filename);
+    binaryWriterAddOps(w, circuit->ops, circuit->numOps);
+    closeBinaryWriter(w, circuit->numQubits, circuit->numClbits);
+}
+
+int isBinaryCircuitFile(const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return 0;
+    char magic[8];
+    int isBinary = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+                   memcmp(magic, QBIN_MAGIC, sizeof(magic)) == 0;
+    fclose(f);
+    return isBinary;
+}
+
+static int readVarint(const unsigned char **pos, const unsigned char *end, uint64_t *value) {
+    const unsigned char *p = *pos;
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p >= end) return 0;
+        unsigned char b = *p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *value = v;
+            *pos = p;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Decodifica l'operazione in *pos e avanza il puntatore. Restituisce 0 se i byte non
+ * descrivono un'operazione valida per il circuito (tipo, qubit, bit classici o costanti
+ * fuori intervallo, qubit ripetuti, codice troncato).
+ */
+static int decodeOp(const BinaryCircuit *bc, const unsigned char **pos, const unsigned char *end, GateOp *op) {
+    const QbinHeader *h = bc->header;
+    if (*pos >= end) return 0;
+    unsigned char opcode = *(*pos)++;
+    int type = opcode & ~QBIN_CONDITIONAL;
+    if (type >= GATE_NUM_TYPES) return 0;
+    *op = makeGateOp((GateType)type);
+
+    uint64_t v;
+    for (int j = 0; j < operandQubits(op->type); j++) {
+        if (!readVarint(pos, end, &v) || v >= h->numQubits) return 0;
+        op->qubits[j] = (int)v;
+        for (int i = 0; i < j; i++) {
+            if (op->qubits[i] == op->qubits[j]) return 0;
+        }
+    }
+    if (op->type == GATE_MEASURE) {
+        if (!readVarint(pos, end, &v) || v >= h->numClbits) return 0;
+        op->cbit = (int)v;
+    }
+    int count = angleCount(op->type);
+    if (count > 0) {
+        if (!readVarint(pos, end, &v) || v > h->numConstants || h->numConstants - v < (uint64_t)count) return 0;
+        const double *c = &bc->constants[v];
+        op->angle = c[0];
+        if (count >= 3) {
+            op->phi = c[1];
+            op->lambda = c[2];
+        }
+        if (count == 4) {
+            op->gamma = c[3];
+        }
+    }
+    if (opcode & QBIN_CONDITIONAL) {
+        uint64_t offset, size;
+        if (!readVarint(pos, end, &offset) || !readVarint(pos, end, &size) || !readVarint(pos, end, &v)) return 0;
+        if (size == 0 || size > 63 || offset > h->numClbits || h->numClbits - offset < size) return 0;
+        op->condOffset = (int)offset;
+        op->condSize = (int)size;
+        op->condValue = (long long)v;
+    }
+    return 1;
+}
+
+static void invalidBinary(const char *filename, const char *reason) {
+    fprintf(stderr, "%s: errore: file binario non valido (%s)\n", filename, reason);
+    exit(1);
+}
+
+BinaryCircuit* openBinaryCircuit(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Errore nell'apertura del file binario");
+        exit(1);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        perror("Errore nella lettura del file binario");
+        exit(1);
+    }
+    size_t size = (size_t)info.st_size;
+    if (size < sizeof(QbinHeader)) {
+        invalidBinary(filename, "intestazione troncata");
+    }
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("Errore nella mappatura del file binario");
+        exit(1);
+    }
+    close(fd);
+
+    BinaryCircuit *bc = malloc(sizeof(BinaryCircuit));
+    if (!bc) {
+        perror("Errore allocazione BinaryCircuit");
+        exit(1);
+    }
+    bc->map = map;
+    bc->size = size;
+    bc->header = map;
+    const QbinHeader *h = bc->header;
+    if (memcmp(h->magic, QBIN_MAGIC, sizeof(h->magic)) != 0) {
+        invalidBinary(filename, "intestazione sconosciuta");
+    }
+    if (h->version != QBIN_VERSION) {
+        invalidBinary(filename, "versione non supportata");
+    }
+    if (h->numQubits > INT_MAX || h->numClbits > INT_MAX) {
+        invalidBinary(filename, "troppi qubit o bit classici");
+    }
+    uint64_t available = size - sizeof(QbinHeader);
+    if (h->numConstants > available / sizeof(double) ||
+        h->codeBytes != available - h->numConstants * sizeof(double)) {
+        invalidBinary(filename, "dimensioni incoerenti");
+    }
+    bc->constants = (const double*)((const char*)map + sizeof(QbinHeader));
+    bc->code = (const unsigned char*)(bc->constants + h->numConstants);
+
+    // Un solo passaggio di verifica: l'esecuzione legge il codice una volta per esecuzione
+    const unsigned char *pos = bc->code, *end = bc->code + h->codeBytes;
+    uint64_t numOps = 0;
+    GateOp op;
+    while (pos < end) {
+        if (!decodeOp(bc, &pos, end, &op)) {
+            invalidBinary(filename, "operazione non valida");
+        }
+        numOps++;
+    }
+    if (numOps != h->numOps) {
+        invalidBinary(filename, "numero di operazioni errato");
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+    return bc;
+}
+
+void closeBinaryCircuit(BinaryCircuit *bc) {
+    if (bc) {
+        munmap(bc->map, bc->size);
+        free(bc);
+    }
+}
+
+void executeBinaryCircuit(const BinaryCircuit *bc, QubitState *state, int *clbits) {
+    for (uint32_t k = 0; k < bc->header->numClbits; k++) {
+        clbits[k] = 0;
+    }
+    const unsigned char *pos = bc->code, *end = bc->code + bc->header->codeBytes;
+    GateOp op;
+    while (pos < end) {
+        decodeOp(bc, &pos, end, &op);
+        executeOps(&op, 1, state, NULL, clbits);
+    }
+}
+
+QuantumCircuit* binaryCircuitToCircuit(const BinaryCircuit *bc) {
+    if (bc->header->numOps > INT_MAX) {
+        fprintf(stderr, "Errore: troppe operazioni per un QuantumCircuit (%llu)\n",
+                (unsigned long long)bc->header->numOps);
+        exit(1);
+    }
+    QuantumCircuit *circuit = createCircuit((int)bc->header->numQubits);
+    circuit->numClbits = (int)bc->header->numClbits;
+    const unsigned char *pos = bc->code, *end = bc->code + bc->header->codeBytes;
+    GateOp op;
+    while (pos < end) {
+        decodeOp(bc, &pos, end, &op);
+        circuitAddOp(circuit, &op);
+    }
+    return circuit;
+}
@@ -0,0 +1,74 @@
+#ifndef QUANTUM_BINARY_H
+#define QUANTUM_BINARY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "quantum_circuit.h"  // Per QuantumCircuit e GateOp
+
+// Formato binario compatto dei circuiti (file .qbin), da caricare senza analisi del testo.
+//
+// Struttura del file (interi e double nell'ordine dei byte della macchina):
+//   - intestazione QbinHeader (48 byte)
+//   - tabella delle costanti: numConstants double (angoli dei gate)
+//   - codice: numOps operazioni consecutive, codeBytes byte in tutto
+// Ogni operazione è un byte con il GateType (bit 7 = operazione condizionata) seguito dagli
+// operandi, interi senza segno codificati a lunghezza variabile (7 bit per byte, il bit alto
+// indica che segue un altro byte):
+//   - i qubit (gateArity); GATE_MEASURE: qubit e bit classico; GATE_BARRIER: nessuno
+//   - RX, RY, RZ, PHASE, CPHASE: indice dell'angolo nella tabella delle costanti
+//   - U: indice di theta, phi, lambda consecutivi; CU: theta, phi, lambda, gamma
+//   - se condizionata: condOffset, condSize (1 .. 63), condValue
+// Le costanti uguali vengono memorizzate una volta sola.
+
+#define QBIN_MAGIC "QSIMBIN1"
+#define QBIN_VERSION 1
+
+typedef struct {
+    char magic[8];           // QBIN_MAGIC, senza terminatore
+    uint32_t version;
+    uint32_t numQubits;
+    uint32_t numClbits;
+    uint32_t reserved;       // 0
+    uint64_t numOps;
+    uint64_t numConstants;
+    uint64_t codeBytes;
+} QbinHeader;
+
+// Circuito binario mappato in memoria: le operazioni vengono decodificate ed eseguite
+// direttamente dal file, senza costruire un QuantumCircuit.
+typedef struct {
+    void *map;
+    size_t size;
+    const QbinHeader *header;
+    const double *constants;
+    const unsigned char *code;
+} BinaryCircuit;
+
+// Scrittura incrementale: le operazioni si possono aggiungere un blocco alla volta
+// (per esempio dai blocchi di streamQASMFile); il file viene completato da closeBinaryWriter.
+typedef struct BinaryWriter BinaryWriter;
+
+BinaryWriter* createBinaryWriter(const char *filename);
+// Termina con un errore per le operazioni con angoli simbolici (paramIndex >= 0)
+void binaryWriterAddOps(BinaryWriter *writer, const GateOp *ops, int numOps);
+void closeBinaryWriter(BinaryWriter *writer, int numQubits, int numClbits);
+
+// Scrive l'intero circuito
+void writeBinaryCircuit(const char *filename, const QuantumCircuit *circuit);
+
+// Restituisce 1 se il file inizia con QBIN_MAGIC
+int isBinaryCircuitFile(const char *filename);
+
+// Mappa il file e ne verifica l'intera struttura (operandi, indici e dimensioni): le
+// esecuzioni successive non devono ripetere i controlli. In caso di errore termina.
+BinaryCircuit* openBinaryCircuit(const char *filename);
+void closeBinaryCircuit(BinaryCircuit *circuit);
+
+// Esegue il circuito sullo stato come executeCircuit; clbits deve avere spazio per
+// header->numClbits valori, che vengono azzerati all'inizio
+void executeBinaryCircuit(const BinaryCircuit *circuit, QubitState *state, int *clbits);
+
+// Decodifica tutte le operazioni in un QuantumCircuit
+QuantumCircuit* binaryCircuitToCircuit(const BinaryCircuit *circuit);
+
+#endif // QUANTUM_BINARY_H
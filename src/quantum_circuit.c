@@ -0,0 +1,516 @@
+// quantum_circuit.c
+
+#include "quantum_circuit.h"
+#include "quantum_sim.h"
+#include "quantum_trace.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <complex.h>
+#include <math.h>
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+/* Crea un circuito vuoto su numQubits qubit. */
+QuantumCircuit* createCircuit(int numQubits) {
+    QuantumCircuit *circuit = malloc(sizeof(QuantumCircuit));
+    if (!circuit) {
+        perror("Errore allocazione QuantumCircuit");
+        exit(1);
+    }
+    circuit->numQubits = numQubits;
+    circuit->numClbits = 0;
+    circuit->numParams = 0;
+    circuit->numOps = 0;
+    circuit->capacity = 16;
+    circuit->ops = malloc(circuit->capacity * sizeof(GateOp));
+    if (!circuit->ops) {
+        perror("Errore allocazione operazioni del circuito");
+        free(circuit);
+        exit(1);
+    }
+    return circuit;
+}
+
+/* Libera la memoria associata al circuito. */
+void freeCircuit(QuantumCircuit *circuit) {
+    if (circuit) {
+        free(circuit->ops);
+        free(circuit);
+    }
+}
+
+/* Funzione di supporto: riserva una nuova operazione in coda al circuito. */
+static GateOp* appendOp(QuantumCircuit *circuit, GateType type) {
+    if (circuit->numOps == circuit->capacity) {
+        circuit->capacity *= 2;
+        GateOp *ops = realloc(circuit->ops, circuit->capacity * sizeof(GateOp));
+        if (!ops) {
+            perror("Errore riallocazione operazioni del circuito");
+            exit(1);
+        }
+        circuit->ops = ops;
+    }
+    GateOp *op = &circuit->ops[circuit->numOps++];
+    *op = makeGateOp(type);
+    return op;
+}
+
+GateOp makeGateOp(GateType type) {
+    GateOp op;
+    op.type = type;
+    op.qubits[0] = op.qubits[1] = op.qubits[2] = -1;
+    op.paramIndex = -1;
+    op.angle = op.phi = op.lambda = op.gamma = 0.0;
+    op.cbit = -1;
+    op.condOffset = op.condSize = 0;
+    op.condValue = 0;
+    return op;
+}
+
+void circuitAddOp(QuantumCircuit *circuit, const GateOp *op) {
+    GateOp *dst = appendOp(circuit, op->type);
+    *dst = *op;
+    if (op->paramIndex + 1 > circuit->numParams) {
+        circuit->numParams = op->paramIndex + 1;
+    }
+}
+
+void circuitAddGate1(QuantumCircuit *circuit, GateType type, int target) {
+    GateOp *op = appendOp(circuit, type);
+    op->qubits[0] = target;
+}
+
+void circuitAddGate2(QuantumCircuit *circuit, GateType type, int control, int target) {
+    GateOp *op = appendOp(circuit, type);
+    op->qubits[0] = control;
+    op->qubits[1] = target;
+}
+
+void circuitAddGate3(QuantumCircuit *circuit, GateType type, int control1, int control2, int target) {
+    GateOp *op = appendOp(circuit, type);
+    op->qubits[0] = control1;
+    op->qubits[1] = control2;
+    op->qubits[2] = target;
+}
+
+void circuitAddRotation(QuantumCircuit *circuit, GateType type, int target, int paramIndex) {
+    GateOp *op = appendOp(circuit, type);
+    op->qubits[0] = target;
+    op->paramIndex = paramIndex;
+    if (paramIndex + 1 > circuit->numParams) {
+        circuit->numParams = paramIndex + 1;
+    }
+}
+
+void circuitAddControlledRotation(QuantumCircuit *circuit, GateType type, int control, int target, int paramIndex) {
+    GateOp *op = appendOp(circuit, type);
+    op->qubits[0] = control;
+    op->qubits[1] = target;
+    op->paramIndex = paramIndex;
+    if (paramIndex + 1 > circuit->numParams) {
+        circuit->numParams = paramIndex + 1;
+    }
+}
+
+void circuitAddFixedRotation(QuantumCircuit *circuit, GateType type, int target, double angle) {
+    GateOp *op = appendOp(circuit, type);
+    op->qubits[0] = target;
+    op->angle = angle;
+}
+
+void circuitAddU(QuantumCircuit *circuit, int target, double theta, double phi, double lambda) {
+    GateOp *op = appendOp(circuit, GATE_U);
+    op->qubits[0] = target;
+    op->angle = theta;
+    op->phi = phi;
+    op->lambda = lambda;
+}
+
+void circuitAddControlledU(QuantumCircuit *circuit, int control, int target,
+                           double theta, double phi, double lambda, double gamma) {
+    GateOp *op = appendOp(circuit, GATE_CU);
+    op->qubits[0] = control;
+    op->qubits[1] = target;
+    op->angle = theta;
+    op->phi = phi;
+    op->lambda = lambda;
+    op->gamma = gamma;
+}
+
+void circuitAddMeasure(QuantumCircuit *circuit, int qubit, int cbit) {
+    GateOp *op = appendOp(circuit, GATE_MEASURE);
+    op->qubits[0] = qubit;
+    op->cbit = cbit;
+    if (cbit >= circuit->numClbits) {
+        circuit->numClbits = cbit + 1;
+    }
+}
+
+void uGateMatrix(double theta, double phi, double lambda, double complex G[2][2]) {
+    double c = cos(theta / 2.0), s = sin(theta / 2.0);
+    G[0][0] = c;
+    G[0][1] = -cexp(I * lambda) * s;
+    G[1][0] = cexp(I * phi) * s;
+    G[1][1] = cexp(I * (phi + lambda)) * c;
+}
+
+/* Matrice 4x4 di U controllato, con indice locale a = bit(controllo) + 2 * bit(target). */
+static void controlledUMatrix(const GateOp *op, double theta, double complex G[4][4]) {
+    double complex U[2][2];
+    uGateMatrix(theta, op->phi, op->lambda, U);
+    double complex global = cexp(I * op->gamma);
+    for (int a = 0; a < 4; a++)
+        for (int b = 0; b < 4; b++)
+            G[a][b] = (a == b && !(a & 1)) ? 1.0 : 0.0;
+    for (int t = 0; t < 2; t++)
+        for (int u = 0; u < 2; u++)
+            G[1 + 2 * t][1 + 2 * u] = global * U[t][u];
+}
+
+/* Funzione di supporto: angolo effettivo di un'operazione. */
+static double opAngle(const GateOp *op, const double *params) {
+    return (op->paramIndex >= 0) ? params[op->paramIndex] : op->angle;
+}
+
+/* Applica un'operazione con un angolo esplicito (usato anche per l'inversa con -theta). */
+static void applyGateOpAngle(QubitState *state, const GateOp *op, double theta) {
+    const int *q = op->qubits;
+    switch (op->type) {
+        case GATE_H:       applyHadamard(state, q[0]); break;
+        case GATE_X:       applyX(state, q[0]); break;
+        case GATE_Y:       applyY(state, q[0]); break;
+        case GATE_Z:       applyZ(state, q[0]); break;
+        case GATE_S:       applyS(state, q[0]); break;
+        case GATE_T:       applyT(state, q[0]); break;
+        case GATE_TDG:     applyTdag(state, q[0]); break;
+        case GATE_RX:      applyRX(state, q[0], theta); break;
+        case GATE_RY:      applyRY(state, q[0], theta); break;
+        case GATE_RZ:      applyRZ(state, q[0], theta); break;
+        case GATE_PHASE:   applyPhase(state, q[0], theta); break;
+        case GATE_CNOT:    applyCNOT(state, q[0], q[1]); break;
+        case GATE_CZ:      applyCZ(state, q[0], q[1]); break;
+        case GATE_CPHASE:  applyCPhaseShift(state, q[0], q[1], cexp(I * theta)); break;
+        case GATE_TOFFOLI: applyToffoli(state, q[0], q[1], q[2]); break;
+        case GATE_CCZ:     applyCCZ(state, q[0], q[1], q[2]); break;
+        case GATE_U: {
+            double complex G[2][2];
+            uGateMatrix(theta, op->phi, op->lambda, G);
+            applySingleQubitGate(state, q[0], G);
+            break;
+        }
+        case GATE_SWAP:    applySwap(state, q[0], q[1]); break;
+        case GATE_CU: {
+            double complex G[4][4];
+            controlledUMatrix(op, theta, G);
+            applyTwoQubitGate(state, q[0], q[1], G);
+            break;
+        }
+        case GATE_CSWAP:   applyFredkin(state, q[0], q[1], q[2]); break;
+        case GATE_MEASURE: measure(state, q[0]); break;
+        case GATE_RESET:
+            if (measure(state, q[0]).result) applyX(state, q[0]);
+            break;
+        default:           break;
+    }
+}
+
+void applyGateOp(QubitState *state, const GateOp *op, const double *params) {
+    applyGateOpAngle(state, op, opAngle(op, params));
+}
+
+/* Applica U^dagger: i gate autoinversi restano invariati, le rotazioni cambiano segno. */
+void applyGateOpAdjoint(QubitState *state, const GateOp *op, const double *params) {
+    switch (op->type) {
+        case GATE_S:   applyPhase(state, op->qubits[0], -M_PI / 2.0); break;
+        case GATE_T:   applyTdag(state, op->qubits[0]); break;
+        case GATE_TDG: applyT(state, op->qubits[0]); break;
+        case GATE_U:
+        case GATE_CU: {
+            // U(theta, phi, lambda)^dagger = U(-theta, -lambda, -phi)
+            GateOp inverse = *op;
+            inverse.phi = -op->lambda;
+            inverse.lambda = -op->phi;
+            inverse.gamma = -op->gamma;
+            applyGateOpAngle(state, &inverse, -opAngle(op, params));
+            break;
+        }
+        default:       applyGateOpAngle(state, op, -opAngle(op, params)); break;
+    }
+}
+
+int gateArity(GateType type) {
+    switch (type) {
+        case GATE_CNOT:
+        case GATE_CZ:
+        case GATE_CPHASE:
+        case GATE_SWAP:
+        case GATE_CU:
+            return 2;
+        case GATE_TOFFOLI:
+        case GATE_CCZ:
+        case GATE_CSWAP:
+            return 3;
+        case GATE_BARRIER:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+int gateOpSingleQubitMatrix(const GateOp *op, const double *params, double complex G[2][2]) {
+    double theta = opAngle(op, params);
+    double h = 1.0 / sqrt(2.0);
+    double c = cos(theta / 2.0), s = sin(theta / 2.0);
+    G[0][1] = G[1][0] = 0.0;
+    switch (op->type) {
+        case GATE_H:     G[0][0] = h; G[0][1] = h; G[1][0] = h; G[1][1] = -h; break;
+        case GATE_X:     G[0][0] = 0; G[0][1] = 1; G[1][0] = 1; G[1][1] = 0; break;
+        case GATE_Y:     G[0][0] = 0; G[0][1] = -I; G[1][0] = I; G[1][1] = 0; break;
+        case GATE_Z:     G[0][0] = 1; G[1][1] = -1; break;
+        case GATE_S:     G[0][0] = 1; G[1][1] = I; break;
+        case GATE_T:     G[0][0] = 1; G[1][1] = cexp(I * M_PI / 4.0); break;
+        case GATE_TDG:   G[0][0] = 1; G[1][1] = cexp(-I * M_PI / 4.0); break;
+        case GATE_RX:    G[0][0] = c; G[0][1] = -I * s; G[1][0] = -I * s; G[1][1] = c; break;
+        case GATE_RY:    G[0][0] = c; G[0][1] = -s; G[1][0] = s; G[1][1] = c; break;
+        case GATE_RZ:    G[0][0] = cexp(-I * theta / 2.0); G[1][1] = cexp(I * theta / 2.0); break;
+        case GATE_PHASE: G[0][0] = 1; G[1][1] = cexp(I * theta); break;
+        case GATE_U:     uGateMatrix(theta, op->phi, op->lambda, G); break;
+        default:         return 0;
+    }
+    return 1;
+}
+
+int gateOpTwoQubitMatrix(const GateOp *op, const double *params, double complex G[4][4]) {
+    for (int a = 0; a < 4; a++)
+        for (int b = 0; b < 4; b++)
+            G[a][b] = (a == b) ? 1.0 : 0.0;
+    switch (op->type) {
+        case GATE_CNOT:
+            // Controllo = bit 0 locale: scambia |01> (a = 1) e |11> (a = 3)
+            G[1][1] = G[3][3] = 0.0;
+            G[1][3] = G[3][1] = 1.0;
+            break;
+        case GATE_CZ:
+            G[3][3] = -1.0;
+            break;
+        case GATE_CPHASE:
+            G[3][3] = cexp(I * opAngle(op, params));
+            break;
+        case GATE_SWAP:
+            // Scambia |01> (a = 1) e |10> (a = 2)
+            G[1][1] = G[2][2] = 0.0;
+            G[1][2] = G[2][1] = 1.0;
+            break;
+        case GATE_CU:
+            controlledUMatrix(op, opAngle(op, params), G);
+            break;
+        default:
+            return 0;
+    }
+    return 1;
+}
+
+long long classicalRegisterValue(const int *clbits, int offset, int size) {
+    long long value = 0;
+    for (int k = 0; k < size; k++) {
+        value |= (long long)(clbits[offset + k] & 1) << k;
+    }
+    return value;
+}
+
+/* Esegue tutte le operazioni del circuito in ordine. */
+void runCircuit(QuantumCircuit *circuit, QubitState *state, const double *params) {
+    if (circuit->numClbits == 0) {
+        for (int k = 0; k < circuit->numOps; k++) {
+            applyGateOp(state, &circuit->ops[k], params);
+        }
+        return;
+    }
+    int *clbits = malloc(circuit->numClbits * sizeof(int));
+    if (!clbits) {
+        perror("Errore allocazione bit classici");
+        exit(1);
+    }
+    executeCircuit(circuit, state, params, clbits);
+    free(clbits);
+}
+
+void executeCircuit(QuantumCircuit *circuit, QubitState *state, const double *params, int *clbits) {
+    for (int k = 0; k < circuit->numClbits; k++) {
+        clbits[k] = 0;
+    }
+    executeOps(circuit->ops, circuit->numOps, state, params, clbits);
+}
+
+void executeOps(const GateOp *ops, int numOps, QubitState *state, const double *params, int *clbits) {
+    for (int k = 0; k < numOps; k++) {
+        const GateOp *op = &ops[k];
+        if (op->condSize > 0 &&
+            classicalRegisterValue(clbits, op->condOffset, op->condSize) != op->condValue) {
+            continue;
+        }
+        if (op->type == GATE_MEASURE) {
+            clbits[op->cbit] = measure(state, op->qubits[0]).result;
+        } else {
+            applyGateOp(state, op, params);
+        }
+    }
+}
+
+/* Funzione di supporto: out += coeff * P |in> per una singola stringa di Pauli.
+   P|i> = i^{nY} (-1)^{|i & (Y|Z)|} |i ^ (X|Y)>. */
+static void accumulatePauliTerm(QubitState *in, QubitState *out, const PauliTerm *term) {
+    int n = in->numQubits;
+    long long dim = 1LL << n;
+    long long flipMask = 0, signMask = 0;
+    int numY = 0;
+    for (int k = 0; k < n; k++) {
+        char p = term->paulis[k];
+        if (p == 'X' || p == 'Y') flipMask |= 1LL << k;
+        if (p == 'Y' || p == 'Z') signMask |= 1LL << k;
+        if (p == 'Y') numY++;
+    }
+    static const double complex iPowers[4] = {1.0, I, -1.0, -I};
+    double complex factor = term->coeff * iPowers[numY % 4];
+
+    for (long long i = 0; i < dim; i++) {
+        long long bits = i & signMask;
+        int parity = 0;
+        while (bits) {
+            parity ^= 1;
+            bits &= bits - 1;
+        }
+        double complex a = factor * in->amplitudes[i];
+        out->amplitudes[i ^ flipMask] += parity ? -a : a;
+    }
+}
+
+/* Calcola out = H |in>. */
+void applyPauliSum(QubitState *in, QubitState *out, const PauliTerm *terms, int numTerms) {
+    TRACE_REQUIRE_AMPLITUDES(in, 0);
+    TRACE_REQUIRE_AMPLITUDES(out, 1);
+    long long dim = 1LL << in->numQubits;
+    for (long long i = 0; i < dim; i++) {
+        out->amplitudes[i] = 0.0 + 0.0 * I;
+    }
+    for (int t = 0; t < numTerms; t++) {
+        accumulatePauliTerm(in, out, &terms[t]);
+    }
+}
+
+/* Funzione di supporto: parte reale di <a|b>. */
+static double realInnerProduct(QubitState *a, QubitState *b) {
+    long long dim = 1LL << a->numQubits;
+    double sum = 0.0;
+    for (long long i = 0; i < dim; i++) {
+        sum += creal(conj(a->amplitudes[i]) * b->amplitudes[i]);
+    }
+    return sum;
+}
+
+double expectationPauliSum(QubitState *state, const PauliTerm *terms, int numTerms) {
+    QubitState *tmp = initializeState(state->numQubits);
+    applyPauliSum(state, tmp, terms, numTerms);
+    double value = realInnerProduct(state, tmp);
+    freeState(tmp);
+    return value;
+}
+
+/* Funzione di supporto: sostituisce mu con dU/dtheta |psi>, dove mu contiene già U(theta)|psi>.
+   Per R_P(theta) la derivata è (-i/2) P U; per PHASE e CPHASE è i Pi_1 U,
+   con Pi_1 il proiettore sui qubit coinvolti a 1. */
+static void applyGenerator(QubitState *mu, const GateOp *op) {
+    long long dim = 1LL << mu->numQubits;
+    switch (op->type) {
+        case GATE_RX: applyX(mu, op->qubits[0]); break;
+        case GATE_RY: applyY(mu, op->qubits[0]); break;
+        case GATE_RZ: applyZ(mu, op->qubits[0]); break;
+        default: break;
+    }
+
+    if (op->type == GATE_RX || op->type == GATE_RY || op->type == GATE_RZ) {
+        for (long long i = 0; i < dim; i++) {
+            mu->amplitudes[i] *= -0.5 * I;
+        }
+    } else {
+        long long mask = 1LL << op->qubits[0];
+        if (op->type == GATE_CPHASE) {
+            mask |= 1LL << op->qubits[1];
+        }
+        for (long long i = 0; i < dim; i++) {
+            mu->amplitudes[i] = ((i & mask) == mask) ? I * mu->amplitudes[i] : 0.0;
+        }
+    }
+}
+
+/* Il metodo aggiunto richiede un circuito unitario con parametri solo su RX, RY, RZ, PHASE
+   e CPHASE (gli unici generatori di applyGenerator): altrimenti termina con un errore. */
+static void checkDifferentiableCircuit(const QuantumCircuit *circuit) {
+    for (int k = 0; k < circuit->numOps; k++) {
+        const GateOp *op = &circuit->ops[k];
+        if (op->type == GATE_MEASURE || op->type == GATE_RESET) {
+            fprintf(stderr, "Errore: adjointGradient richiede un circuito unitario "
+                            "(operazione %d: misura o reset)\n", k);
+            exit(1);
+        }
+        if (op->paramIndex < 0) continue;
+        switch (op->type) {
+            case GATE_RX:
+            case GATE_RY:
+            case GATE_RZ:
+            case GATE_PHASE:
+            case GATE_CPHASE:
+                break;
+            default:
+                fprintf(stderr, "Errore: adjointGradient non supporta il parametro dell'operazione %d "
+                                "(tipo %d): solo RX, RY, RZ, PHASE e CPHASE\n", k, (int)op->type);
+                exit(1);
+        }
+    }
+}
+
+/*
+ * Metodo aggiunto: con |psi> = U_N ... U_1 |0> e |lambda> = H |psi>, percorrendo il circuito
+ * all'indietro si ha dE/dtheta_k = 2 Re <lambda_k| dU_k |psi_{k-1}>, dove psi e lambda
+ * vengono riportati indietro applicando U_k^dagger in place.
+ */
+double adjointGradient(QuantumCircuit *circuit, const double *params,
+                       const PauliTerm *terms, int numTerms, double *grad) {
+    checkDifferentiableCircuit(circuit);
+    int n = circuit->numQubits;
+    long long dim = 1LL << n;
+
+    QubitState *psi = initializeState(n);
+    QubitState *lambda = initializeState(n);
+    QubitState *mu = initializeState(n);
+
+    runCircuit(circuit, psi, params);
+    applyPauliSum(psi, lambda, terms, numTerms);
+    double energy = realInnerProduct(psi, lambda);
+
+    for (int p = 0; p < circuit->numParams; p++) {
+        grad[p] = 0.0;
+    }
+
+    for (int k = circuit->numOps - 1; k >= 0; k--) {
+        const GateOp *op = &circuit->ops[k];
+        applyGateOpAdjoint(psi, op, params);
+
+        if (op->paramIndex >= 0) {
+            memcpy(mu->amplitudes, psi->amplitudes, dim * sizeof(double complex));
+            applyGateOp(mu, op, params);
+            applyGenerator(mu, op);
+            grad[op->paramIndex] += 2.0 * realInnerProduct(lambda, mu);
+        }
+
+        applyGateOpAdjoint(lambda, op, params);
+    }
+
+    freeState(psi);
+    freeState(lambda);
+    freeState(mu);
+    return energy;
+}
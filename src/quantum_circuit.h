@@ -0,0 +1,143 @@
+#ifndef QUANTUM_CIRCUIT_H
+#define QUANTUM_CIRCUIT_H
+
+#include <complex.h>
+#include "quantum_sim.h"  // Per QubitState e i gate
+
+// Tipi di gate registrabili in un circuito.
+typedef enum {
+    GATE_H,
+    GATE_X,
+    GATE_Y,
+    GATE_Z,
+    GATE_S,
+    GATE_T,
+    GATE_TDG,
+    GATE_RX,        // exp(-i theta X / 2)
+    GATE_RY,        // exp(-i theta Y / 2)
+    GATE_RZ,        // exp(-i theta Z / 2)
+    GATE_PHASE,     // diag(1, e^{i theta}), come applyPhase
+    GATE_CNOT,      // qubits[0] = controllo, qubits[1] = target
+    GATE_CZ,
+    GATE_CPHASE,    // fase e^{i theta} su |11>, come applyCPhaseShift
+    GATE_TOFFOLI,   // qubits[0], qubits[1] = controlli, qubits[2] = target
+    GATE_CCZ,
+    GATE_U,         // U(theta, phi, lambda) di OpenQASM: theta = angle
+    GATE_SWAP,
+    GATE_CU,        // e^{i gamma} U(theta, phi, lambda) controllato: qubits[0] = controllo
+    GATE_CSWAP,     // qubits[0] = controllo, qubits[1], qubits[2] scambiati
+    GATE_MEASURE,   // misura qubits[0] nel bit classico cbit
+    GATE_RESET,     // riporta qubits[0] a |0>
+    GATE_BARRIER,   // nessun effetto sullo stato: separa i gate (per esempio per la fusione)
+    GATE_NUM_TYPES  // Numero di tipi di gate (non è un gate)
+} GateType;
+
+// Singola operazione del circuito.
+typedef struct {
+    GateType type;
+    int qubits[3];
+    int paramIndex;   // Indice nel vettore dei parametri, oppure -1 se l'angolo è fisso
+    double angle;     // Angolo fisso, usato quando paramIndex < 0
+    double phi, lambda, gamma;   // Angoli aggiuntivi di GATE_U e GATE_CU
+    int cbit;         // Bit classico di GATE_MEASURE
+    // Condizione "if (creg == condValue)" di OpenQASM sui bit classici
+    // condOffset ... condOffset + condSize - 1 (condSize = 0: operazione incondizionata)
+    int condOffset;
+    int condSize;
+    long long condValue;
+} GateOp;
+
+// Circuito come sequenza di operazioni su 'numQubits' qubit e 'numClbits' bit classici,
+// dipendente da 'numParams' parametri reali.
+typedef struct {
+    int numQubits;
+    int numClbits;
+    int numParams;
+    int numOps;
+    int capacity;
+    GateOp *ops;
+} QuantumCircuit;
+
+// Termine di un'osservabile somma di stringhe di Pauli: coeff * P_0 ⊗ P_1 ⊗ ...
+// 'paulis' ha un carattere per qubit ('I', 'X', 'Y', 'Z'); il carattere k agisce sul qubit k.
+typedef struct {
+    double coeff;
+    const char *paulis;
+} PauliTerm;
+
+QuantumCircuit* createCircuit(int numQubits);
+void freeCircuit(QuantumCircuit *circuit);
+
+// Aggiunge gate senza parametri (qubit non usati vengono ignorati)
+void circuitAddGate1(QuantumCircuit *circuit, GateType type, int target);
+void circuitAddGate2(QuantumCircuit *circuit, GateType type, int control, int target);
+void circuitAddGate3(QuantumCircuit *circuit, GateType type, int control1, int control2, int target);
+
+// Aggiunge un gate parametrico (RX, RY, RZ, PHASE) il cui angolo è params[paramIndex]
+void circuitAddRotation(QuantumCircuit *circuit, GateType type, int target, int paramIndex);
+// Aggiunge un CPHASE il cui angolo è params[paramIndex]
+void circuitAddControlledRotation(QuantumCircuit *circuit, GateType type, int control, int target, int paramIndex);
+// Aggiunge un gate parametrico con angolo fisso
+void circuitAddFixedRotation(QuantumCircuit *circuit, GateType type, int target, double angle);
+
+// Operazione con i campi ai valori predefiniti (nessun qubit, angoli nulli, incondizionata)
+GateOp makeGateOp(GateType type);
+// Aggiunge in coda una copia dell'operazione
+void circuitAddOp(QuantumCircuit *circuit, const GateOp *op);
+
+// Gate generici di OpenQASM con angoli fissi
+void circuitAddU(QuantumCircuit *circuit, int target, double theta, double phi, double lambda);
+void circuitAddControlledU(QuantumCircuit *circuit, int control, int target,
+                           double theta, double phi, double lambda, double gamma);
+// Misura del qubit nel bit classico 'cbit' (numClbits viene esteso fino a comprenderlo)
+void circuitAddMeasure(QuantumCircuit *circuit, int qubit, int cbit);
+
+// Matrice U(theta, phi, lambda) = [[cos(theta/2), -e^{i lambda} sin(theta/2)],
+//                                  [e^{i phi} sin(theta/2), e^{i (phi + lambda)} cos(theta/2)]]
+void uGateMatrix(double theta, double phi, double lambda, double complex G[2][2]);
+
+// Applica una singola operazione (o la sua inversa) allo stato.
+// GATE_MEASURE collassa lo stato scartando il risultato; le condizioni non vengono valutate.
+void applyGateOp(QubitState *state, const GateOp *op, const double *params);
+void applyGateOpAdjoint(QubitState *state, const GateOp *op, const double *params);
+
+// Numero di qubit su cui agisce un tipo di gate (1, 2 o 3)
+int gateArity(GateType type);
+
+// Matrice 2x2 di un gate a 1 qubit; restituisce 0 se l'operazione non è a 1 qubit
+int gateOpSingleQubitMatrix(const GateOp *op, const double *params, double complex G[2][2]);
+
+// Matrice 4x4 di un gate a 2 qubit con indice locale a = bit(qubits[0]) + 2 * bit(qubits[1]);
+// restituisce 0 se l'operazione non è a 2 qubit
+int gateOpTwoQubitMatrix(const GateOp *op, const double *params, double complex G[4][4]);
+
+// Esegue l'intero circuito sullo stato con i parametri indicati
+void runCircuit(QuantumCircuit *circuit, QubitState *state, const double *params);
+
+// Come runCircuit, registrando le misure in clbits (circuit->numClbits valori, azzerati
+// all'inizio) e rispettando le condizioni sui bit classici
+void executeCircuit(QuantumCircuit *circuit, QubitState *state, const double *params, int *clbits);
+
+// Come executeCircuit su una sequenza di operazioni, senza azzerare clbits
+// (per eseguire un circuito un blocco alla volta)
+void executeOps(const GateOp *ops, int numOps, QubitState *state, const double *params, int *clbits);
+
+// Valore del registro classico clbits[offset ... offset + size - 1] (bit meno significativo per primo)
+long long classicalRegisterValue(const int *clbits, int offset, int size);
+
+// Calcola out = H |in>, con H somma di 'numTerms' stringhe di Pauli
+void applyPauliSum(QubitState *in, QubitState *out, const PauliTerm *terms, int numTerms);
+
+// Valore di aspettazione <psi| H |psi>
+double expectationPauliSum(QubitState *state, const PauliTerm *terms, int numTerms);
+
+// Differenziazione aggiunta: calcola il gradiente di <H> rispetto a tutti i parametri
+// del circuito (partendo da |0...0>) con una simulazione in avanti e una all'indietro,
+// usando tre vettori di stato indipendentemente dal numero di parametri.
+// 'grad' deve avere spazio per circuit->numParams valori. Restituisce <H>.
+// Il circuito deve essere unitario (niente misure né reset) e i parametri possono comparire
+// solo in RX, RY, RZ, PHASE e CPHASE; altrimenti la funzione termina con un errore.
+double adjointGradient(QuantumCircuit *circuit, const double *params,
+                       const PauliTerm *terms, int numTerms, double *grad);
+
+#endif // QUANTUM_CIRCUIT_H
@@ -1,36 +1,170 @@
 // quantum_density.c
 
 #include "quantum_density.h"
+#include "quantum_memory.h"
+#include "quantum_trace.h"
 #include "quantum_sim.h"  // Per QubitState, etc.
 #include <stdlib.h>
 #include <stdio.h>
 #include <complex.h>
 #include <math.h>
 
-/* 
- * Funzione di supporto: moltiplicazione di due matrici complesse quadrate (dimensione dim x dim).
- * Le matrici A, B e C sono memorizzate in ordine row-major.
+/* Lato dei blocchi usati dal prodotto matriciale: un blocco di B impacchettato
+   (64 x 64 complessi = 64 KiB) resta in cache L2 durante l'aggiornamento di C. */
+#define GEMM_TILE 64
+
+/*
+ * Prodotto di matrici complesse quadrate (dimensione dim x dim, row-major).
+ * Calcola C = A op(B) (oppure C += A op(B) se accumulate != 0), dove op(B) = B oppure,
+ * con conjTransB != 0, op(B) = B^\dagger: il coniugato trasposto non viene mai materializzato
+ * ma costruito blocco per blocco durante l'impacchettamento.
+ * C è diviso in blocchi GEMM_TILE x GEMM_TILE distribuiti tra i thread (quelli sul bordo
+ * sono più piccoli se dim non è un multiplo di GEMM_TILE); per ogni blocco di k
+ * il corrispondente blocco di op(B) viene copiato in un buffer contiguo e il ciclo più interno
+ * (su j, con aritmetica reale esplicita) è vettorizzabile dal compilatore.
  */
-static void multiplyMatrices(const double complex *A, const double complex *B, double complex *C, int dim) {
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            double complex sum = 0;
-            for (int k = 0; k < dim; k++) {
-                sum += A[i * dim + k] * B[k * dim + j];
+void multiplyMatricesTiled(const double complex *A, const double complex *B, double complex *C,
+                           long long dim, int conjTransB, int accumulate) {
+    long long T = (dim < GEMM_TILE) ? dim : GEMM_TILE;
+    long long numTiles = (dim + T - 1) / T;
+
+    #pragma omp parallel
+    {
+        double *packedB = malloc(2 * T * T * sizeof(double));
+        if (!packedB) {
+            perror("Errore allocazione buffer in multiplyMatricesTiled");
+            exit(1);
+        }
+
+        #pragma omp for collapse(2) schedule(static)
+        for (long long it = 0; it < numTiles; it++) {
+            for (long long jt = 0; jt < numTiles; jt++) {
+                long long i0 = it * T, j0 = jt * T;
+                long long iEnd = (i0 + T < dim) ? i0 + T : dim;
+                long long tj = (j0 + T < dim) ? T : dim - j0;
+
+                if (!accumulate) {
+                    for (long long i = i0; i < iEnd; i++)
+                        for (long long j = j0; j < j0 + tj; j++)
+                            C[i * dim + j] = 0;
+                }
+
+                for (long long k0 = 0; k0 < dim; k0 += T) {
+                    long long tk = (k0 + T < dim) ? T : dim - k0;
+
+                    // Impacchetta op(B)[k0 .. k0+tk][j0 .. j0+tj] come coppie (re, im)
+                    for (long long kk = 0; kk < tk; kk++) {
+                        for (long long jj = 0; jj < tj; jj++) {
+                            double complex b = conjTransB ? conj(B[(j0 + jj) * dim + k0 + kk])
+                                                          : B[(k0 + kk) * dim + j0 + jj];
+                            packedB[2 * (kk * T + jj)] = creal(b);
+                            packedB[2 * (kk * T + jj) + 1] = cimag(b);
+                        }
+                    }
+
+                    for (long long i = i0; i < iEnd; i++) {
+                        double *c = (double *)(C + i * dim + j0);
+                        for (long long kk = 0; kk < tk; kk++) {
+                            double complex a = A[i * dim + k0 + kk];
+                            double ar = creal(a), ai = cimag(a);
+                            const double *bRow = packedB + 2 * kk * T;
+                            for (long long jj = 0; jj < tj; jj++) {
+                                double br = bRow[2 * jj], bi = bRow[2 * jj + 1];
+                                c[2 * jj] += ar * br - ai * bi;
+                                c[2 * jj + 1] += ar * bi + ai * br;
+                            }
+                        }
+                    }
+                }
             }
-            C[i * dim + j] = sum;
         }
+
+        free(packedB);
     }
 }
 
-/* 
- * Funzione di supporto: calcola il coniugato trasposto (dagger) di una matrice U di dimensione dim x dim.
- * Il risultato viene scritto in U_dag (già allocato con dim*dim elementi).
+/* Funzioni di supporto per il formato compatto: l'elemento (i, j) con i <= j si trova
+   all'indice i * dim - i * (i - 1) / 2 + (j - i); quelli sotto la diagonale si ricavano
+   come coniugati dei simmetrici. */
+static inline long long packedIndex(long long i, long long j, long long dim) {
+    return i * dim - i * (i - 1) / 2 + (j - i);
+}
+
+static inline double complex packedGet(const double complex *m, long long i, long long j, long long dim) {
+    return (i <= j) ? m[packedIndex(i, j, dim)] : conj(m[packedIndex(j, i, dim)]);
+}
+
+static inline void packedSet(double complex *m, long long i, long long j, long long dim, double complex v) {
+    if (i == j) {
+        m[packedIndex(i, i, dim)] = creal(v);
+    } else if (i < j) {
+        m[packedIndex(i, j, dim)] = v;
+    } else {
+        m[packedIndex(j, i, dim)] = conj(v);
+    }
+}
+
+/* Funzione di supporto: B <- G B G^\dagger per un blocco k x k (k <= 4) in row-major. */
+static void conjugateBlock(double complex *B, const double complex *G, int k) {
+    double complex T[16];
+    for (int a = 0; a < k; a++) {
+        for (int b = 0; b < k; b++) {
+            double complex sum = 0;
+            for (int c = 0; c < k; c++) sum += G[a * k + c] * B[c * k + b];
+            T[a * k + b] = sum;
+        }
+    }
+    for (int a = 0; a < k; a++) {
+        for (int b = 0; b < k; b++) {
+            double complex sum = 0;
+            for (int c = 0; c < k; c++) sum += T[a * k + c] * conj(G[b * k + c]);
+            B[a * k + b] = sum;
+        }
+    }
+}
+
+/* Funzione di supporto: v <- S v per il vettore row-major di un blocco k x k. */
+static void superoperatorBlock(double complex *v, const double complex *S, int k) {
+    int k2 = k * k;
+    double complex w[16];
+    for (int x = 0; x < k2; x++) {
+        double complex sum = 0;
+        for (int y = 0; y < k2; y++) sum += S[x * k2 + y] * v[y];
+        w[x] = sum;
+    }
+    for (int x = 0; x < k2; x++) v[x] = w[x];
+}
+
+/*
+ * Kernel locale per il formato compatto. I blocchi k x k sono individuati dagli indici base
+ * (r, c) con i bit locali a zero; si elaborano solo le coppie con r <= c, perché il blocco
+ * (c, r) è il coniugato trasposto di (r, c). Ogni elemento memorizzato appartiene a un solo
+ * blocco elaborato, quindi le righe base possono essere divise tra i thread.
+ * Con isSuperop == 0 'op' è un gate k x k (B -> G B G^\dagger), altrimenti un superoperatore k^2 x k^2.
  */
-static void conjugateTranspose(const double complex *U, double complex *U_dag, int dim) {
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            U_dag[j * dim + i] = conj(U[i * dim + j]);
+static void applyLocalMapPacked(DensityMatrix *dm, const long long *offsets, int k,
+                                int isSuperop, const double complex *op) {
+    long long dim = 1LL << dm->numQubits;
+    long long localMask = offsets[k - 1];
+    double complex *m = dm->matrix;
+
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (long long r = 0; r < dim; r++) {
+        if (r & localMask) continue;
+        for (long long c = r; c < dim; c++) {
+            if (c & localMask) continue;
+            double complex B[16];
+            for (int a = 0; a < k; a++)
+                for (int b = 0; b < k; b++)
+                    B[a * k + b] = packedGet(m, r + offsets[a], c + offsets[b], dim);
+            if (isSuperop) {
+                superoperatorBlock(B, op, k);
+            } else {
+                conjugateBlock(B, op, k);
+            }
+            for (int a = 0; a < k; a++)
+                for (int b = 0; b < k; b++)
+                    packedSet(m, r + offsets[a], c + offsets[b], dim, B[a * k + b]);
         }
     }
 }
@@ -43,20 +177,80 @@ DensityMatrix* initializeDensityMatrix(int numQubits) {
         exit(1);
     }
     dm->numQubits = numQubits;
-    int dim = 1 << numQubits;
-    dm->matrix = calloc(dim * dim, sizeof(double complex));
-    if (!dm->matrix) {
-        perror("Errore allocazione matrice densità");
-        free(dm);
+    dm->packed = 0;
+    dm->matrix = budgetCalloc(densityMatrixBytes(numQubits, 0), 1, "matrice densità");
+    return dm;
+}
+
+/* Inizializza una matrice densità compatta: solo il triangolo superiore, dim * (dim + 1) / 2 elementi. */
+DensityMatrix* initializePackedDensityMatrix(int numQubits) {
+    DensityMatrix *dm = malloc(sizeof(DensityMatrix));
+    if (!dm) {
+        perror("Errore allocazione DensityMatrix");
         exit(1);
     }
+    dm->numQubits = numQubits;
+    dm->packed = 1;
+    dm->matrix = budgetCalloc(densityMatrixBytes(numQubits, 1), 1, "matrice densità compatta");
     return dm;
 }
 
+/* Restituisce \rho[i][j] per entrambi i formati. */
+double complex getDensityElement(DensityMatrix *dm, long long i, long long j) {
+    long long dim = 1LL << dm->numQubits;
+    return dm->packed ? packedGet(dm->matrix, i, j, dim) : dm->matrix[i * dim + j];
+}
+
+/* Copia una matrice completa (hermitiana) in una compatta della stessa dimensione. */
+static void copyFullToPacked(DensityMatrix *full, DensityMatrix *packed) {
+    long long dim = 1LL << full->numQubits;
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        for (long long j = i; j < dim; j++) {
+            packedSet(packed->matrix, i, j, dim, full->matrix[i * dim + j]);
+        }
+    }
+}
+
+DensityMatrix* packDensityMatrix(DensityMatrix *dm) {
+    DensityMatrix *packed = initializePackedDensityMatrix(dm->numQubits);
+    if (dm->packed) {
+        long long dim = 1LL << dm->numQubits;
+        for (long long k = 0; k < dim * (dim + 1) / 2; k++) {
+            packed->matrix[k] = dm->matrix[k];
+        }
+    } else {
+        copyFullToPacked(dm, packed);
+    }
+    return packed;
+}
+
+DensityMatrix* unpackDensityMatrix(DensityMatrix *dm) {
+    DensityMatrix *full = initializeDensityMatrix(dm->numQubits);
+    long long dim = 1LL << dm->numQubits;
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        for (long long j = 0; j < dim; j++) {
+            full->matrix[i * dim + j] = getDensityElement(dm, i, j);
+        }
+    }
+    return full;
+}
+
+/* Traccia di \rho: somma degli elementi diagonali. */
+double traceDensityMatrix(DensityMatrix *dm) {
+    long long dim = 1LL << dm->numQubits;
+    double trace = 0.0;
+    for (long long i = 0; i < dim; i++) {
+        trace += creal(getDensityElement(dm, i, i));
+    }
+    return trace;
+}
+
 /* Libera la memoria associata a una DensityMatrix. */
 void freeDensityMatrix(DensityMatrix *dm) {
     if (dm) {
-        free(dm->matrix);
+        budgetFree(dm->matrix, densityMatrixBytes(dm->numQubits, dm->packed));
         free(dm);
     }
 }
@@ -64,10 +258,10 @@ void freeDensityMatrix(DensityMatrix *dm) {
 /* Stampa la matrice densità in formato testo. */
 void printDensityMatrix(DensityMatrix *dm) {
     if (!dm || !dm->matrix) return;
-    int dim = 1 << dm->numQubits;
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            double complex val = dm->matrix[i * dim + j];
+    long long dim = 1LL << dm->numQubits;
+    for (long long i = 0; i < dim; i++) {
+        for (long long j = 0; j < dim; j++) {
+            double complex val = getDensityElement(dm, i, j);
             printf("(%g %+gi) ", creal(val), cimag(val));
         }
         printf("\n");
@@ -78,79 +272,242 @@ void printDensityMatrix(DensityMatrix *dm) {
    \rho = |psi><psi|. */
 DensityMatrix* pureStateToDensityMatrix(QubitState *state) {
     if (!state) return NULL;
+    TRACE_REQUIRE_AMPLITUDES(state, 0);
     DensityMatrix *dm = initializeDensityMatrix(state->numQubits);
-    int dim = 1 << state->numQubits;
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
+    long long dim = 1LL << state->numQubits;
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        for (long long j = 0; j < dim; j++) {
             dm->matrix[i * dim + j] = state->amplitudes[i] * conj(state->amplitudes[j]);
         }
     }
     return dm;
 }
 
+/* Come pureStateToDensityMatrix, calcolando solo il triangolo superiore. */
+DensityMatrix* pureStateToPackedDensityMatrix(QubitState *state) {
+    if (!state) return NULL;
+    TRACE_REQUIRE_AMPLITUDES(state, 0);
+    DensityMatrix *dm = initializePackedDensityMatrix(state->numQubits);
+    long long dim = 1LL << state->numQubits;
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        for (long long j = i; j < dim; j++) {
+            packedSet(dm->matrix, i, j, dim, state->amplitudes[i] * conj(state->amplitudes[j]));
+        }
+    }
+    return dm;
+}
+
 /* Applica una trasformazione unitaria completa U (di dimensione 2^(numQubits) x 2^(numQubits)) alla matrice densità:
    \rho -> U \rho U^\dagger. */
 void applyUnitaryDensity(DensityMatrix *dm, double complex *U) {
-    int dim = 1 << dm->numQubits;
-    double complex *temp = calloc(dim * dim, sizeof(double complex));
-    double complex *U_dag = calloc(dim * dim, sizeof(double complex));
-    if (!temp || !U_dag) {
-        perror("Errore allocazione in applyUnitaryDensity");
-        exit(1);
+    if (dm->packed) {
+        DensityMatrix *full = unpackDensityMatrix(dm);
+        applyUnitaryDensity(full, U);
+        copyFullToPacked(full, dm);
+        freeDensityMatrix(full);
+        return;
     }
+    long long dim = 1LL << dm->numQubits;
+    size_t bytes = densityMatrixBytes(dm->numQubits, 0);
+    double complex *temp = budgetMalloc(bytes, "matrice temporanea in applyUnitaryDensity");
     // Calcola U * rho
-    multiplyMatrices(U, dm->matrix, temp, dim);
-    // Calcola U^\dagger
-    conjugateTranspose(U, U_dag, dim);
-    // Calcola (U * rho) * U^\dagger
-    double complex *newMatrix = calloc(dim * dim, sizeof(double complex));
-    if (!newMatrix) {
-        perror("Errore allocazione newMatrix in applyUnitaryDensity");
-        exit(1);
+    multiplyMatricesTiled(U, dm->matrix, temp, dim, 0, 0);
+    // Calcola (U * rho) * U^\dagger direttamente in dm->matrix
+    multiplyMatricesTiled(temp, U, dm->matrix, dim, 1, 0);
+    budgetFree(temp, bytes);
+}
+
+/* Applica un gate a 1 qubit (matrice 2x2) al qubit 'target' della matrice densità,
+   \rho -> U \rho U^\dagger, senza costruire l'operatore completo.
+   Gli indici di riga e di colonna che differiscono solo per il bit 'target' formano
+   blocchi 2x2 indipendenti B, ciascuno trasformato in place come B -> G B G^\dagger:
+   il costo è O(4^n) e non servono matrici temporanee. */
+void applySingleQubitGateDensity(DensityMatrix *dm, int target, double complex gate[2][2]) {
+    long long dim = 1LL << dm->numQubits;
+    long long mask = 1LL << target;
+    if (dm->packed) {
+        long long offsets[2] = { 0, mask };
+        applyLocalMapPacked(dm, offsets, 2, 0, &gate[0][0]);
+        return;
     }
-    multiplyMatrices(temp, U_dag, newMatrix, dim);
-    // Copia il risultato in dm->matrix
-    for (int i = 0; i < dim * dim; i++) {
-        dm->matrix[i] = newMatrix[i];
+    double complex *rho = dm->matrix;
+    double complex g00 = gate[0][0], g01 = gate[0][1];
+    double complex g10 = gate[1][0], g11 = gate[1][1];
+
+    #pragma omp parallel for schedule(static)
+    for (long long r0 = 0; r0 < dim; r0++) {
+        if (r0 & mask) continue;
+        double complex *row0 = rho + r0 * dim;
+        double complex *row1 = rho + (r0 | mask) * dim;
+        for (long long c0 = 0; c0 < dim; c0++) {
+            if (c0 & mask) continue;
+            long long c1 = c0 | mask;
+            double complex b00 = row0[c0], b01 = row0[c1];
+            double complex b10 = row1[c0], b11 = row1[c1];
+            // T = G B
+            double complex t00 = g00 * b00 + g01 * b10;
+            double complex t01 = g00 * b01 + g01 * b11;
+            double complex t10 = g10 * b00 + g11 * b10;
+            double complex t11 = g10 * b01 + g11 * b11;
+            // B' = T G^\dagger
+            row0[c0] = t00 * conj(g00) + t01 * conj(g01);
+            row0[c1] = t00 * conj(g10) + t01 * conj(g11);
+            row1[c0] = t10 * conj(g00) + t11 * conj(g01);
+            row1[c1] = t10 * conj(g10) + t11 * conj(g11);
+        }
     }
-    free(temp);
-    free(U_dag);
-    free(newMatrix);
 }
 
-/* Applica un gate a 1 qubit (matrice 2x2) al qubit 'target' della matrice densità.
-   Espande il gate alla dimensione completa del sistema e lo applica tramite
-   \rho -> U \rho U^\dagger. */
-void applySingleQubitGateDensity(DensityMatrix *dm, int target, double complex gate[2][2]) {
-    int n = dm->numQubits;
-    int dim = 1 << n;
-    double complex *U = calloc(dim * dim, sizeof(double complex));
-    if (!U) {
-        perror("Errore allocazione U in applySingleQubitGateDensity");
-        exit(1);
+/*
+ * Funzione di supporto per i gate di permutazione controllati:
+ * pi(i) = i ^ flipMask se tutti i bit di controlMask sono a 1 (e, se swapMask != 0, i due bit
+ * di swapMask sono diversi), altrimenti pi(i) = i. Poiché pi è un'involuzione,
+ * \rho'[i][j] = \rho[pi(i)][pi(j)] si ottiene scambiando coppie di elementi: ogni coppia
+ * viene scambiata solo dall'elemento con indice lineare minore, quindi le righe possono
+ * essere elaborate in parallelo senza conflitti.
+ */
+static long long permutedIndex(long long i, long long controlMask, long long flipMask, long long swapMask) {
+    if ((i & controlMask) != controlMask) return i;
+    if (swapMask) {
+        long long bits = i & swapMask;
+        if (bits == 0 || bits == swapMask) return i;
     }
-    // Costruzione dell'operatore completo U.
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            int valid = 1;
-            int bit_i = (i >> target) & 1;
-            int bit_j = (j >> target) & 1;
-            for (int k = 0; k < n; k++) {
-                if (k == target) continue;
-                int bi = (i >> k) & 1;
-                int bj = (j >> k) & 1;
-                if (bi != bj) {
-                    valid = 0;
-                    break;
-                }
+    return i ^ flipMask;
+}
+
+/* Nel formato compatto l'elemento sorgente (pi(i), pi(j)) può cadere sotto la diagonale:
+   in quel caso si scambia con il simmetrico memorizzato, coniugando entrambi i valori. */
+static void applyPermutationPacked(DensityMatrix *dm, long long controlMask, long long flipMask, long long swapMask) {
+    long long dim = 1LL << dm->numQubits;
+    double complex *m = dm->matrix;
+
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (long long i = 0; i < dim; i++) {
+        long long pi = permutedIndex(i, controlMask, flipMask, swapMask);
+        for (long long j = i; j < dim; j++) {
+            long long pj = permutedIndex(j, controlMask, flipMask, swapMask);
+            int conjugate = pi > pj;
+            long long src = conjugate ? packedIndex(pj, pi, dim) : packedIndex(pi, pj, dim);
+            long long dst = packedIndex(i, j, dim);
+            if (dst < src) {
+                double complex tmp = m[dst];
+                m[dst] = conjugate ? conj(m[src]) : m[src];
+                m[src] = conjugate ? conj(tmp) : tmp;
+            } else if (dst == src && conjugate) {
+                m[dst] = conj(m[dst]);
             }
-            if (valid) {
-                U[i * dim + j] = gate[bit_i][bit_j];
+        }
+    }
+}
+
+static void applyPermutationDensity(DensityMatrix *dm, long long controlMask, long long flipMask, long long swapMask) {
+    long long dim = 1LL << dm->numQubits;
+    double complex *rho = dm->matrix;
+    if (dm->packed) {
+        applyPermutationPacked(dm, controlMask, flipMask, swapMask);
+        return;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        long long pi = permutedIndex(i, controlMask, flipMask, swapMask);
+        for (long long j = 0; j < dim; j++) {
+            long long pj = permutedIndex(j, controlMask, flipMask, swapMask);
+            long long src = pi * dim + pj;
+            long long dst = i * dim + j;
+            if (dst < src) {
+                double complex tmp = rho[dst];
+                rho[dst] = rho[src];
+                rho[src] = tmp;
             }
         }
     }
-    applyUnitaryDensity(dm, U);
-    free(U);
+}
+
+/* Funzione di supporto per le fasi controllate: U = diag(d), con d(i) = phase se tutti i bit
+   di mask sono a 1 e 1 altrimenti; \rho[i][j] -> d(i) conj(d(j)) \rho[i][j]. */
+static void applyControlledPhaseDensity(DensityMatrix *dm, long long mask, double complex phase) {
+    long long dim = 1LL << dm->numQubits;
+    double complex *rho = dm->matrix;
+    double complex phaseConj = conj(phase);
+    int packed = dm->packed;
+
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (long long i = 0; i < dim; i++) {
+        int rowSet = (i & mask) == mask;
+        for (long long j = packed ? i : 0; j < dim; j++) {
+            int colSet = (j & mask) == mask;
+            long long idx = packed ? packedIndex(i, j, dim) : i * dim + j;
+            if (rowSet && !colSet) {
+                rho[idx] *= phase;
+            } else if (!rowSet && colSet) {
+                rho[idx] *= phaseConj;
+            }
+        }
+    }
+}
+
+void applyCNOTDensity(DensityMatrix *dm, int control, int target) {
+    applyPermutationDensity(dm, 1LL << control, 1LL << target, 0);
+}
+
+void applyCZDensity(DensityMatrix *dm, int control, int target) {
+    applyControlledPhaseDensity(dm, (1LL << control) | (1LL << target), -1.0);
+}
+
+void applyCPhaseShiftDensity(DensityMatrix *dm, int control, int target, double complex phase) {
+    applyControlledPhaseDensity(dm, (1LL << control) | (1LL << target), phase);
+}
+
+void applyToffoliDensity(DensityMatrix *dm, int control1, int control2, int target) {
+    applyPermutationDensity(dm, (1LL << control1) | (1LL << control2), 1LL << target, 0);
+}
+
+void applyCCZDensity(DensityMatrix *dm, int control1, int control2, int target) {
+    applyControlledPhaseDensity(dm, (1LL << control1) | (1LL << control2) | (1LL << target), -1.0);
+}
+
+void applyFredkinDensity(DensityMatrix *dm, int control, int target1, int target2) {
+    long long swapMask = (1LL << target1) | (1LL << target2);
+    applyPermutationDensity(dm, 1LL << control, swapMask, swapMask);
+}
+
+/* Gate 4x4 generico: ogni blocco 4x4 B individuato da qubit0 e qubit1 diventa G B G^\dagger. */
+void applyTwoQubitGateDensity(DensityMatrix *dm, int qubit0, int qubit1, double complex gate[4][4]) {
+    long long dim = 1LL << dm->numQubits;
+    long long m0 = 1LL << qubit0;
+    long long m1 = 1LL << qubit1;
+    long long offsets[4] = { 0, m0, m1, m0 | m1 };
+    if (dm->packed) {
+        applyLocalMapPacked(dm, offsets, 4, 0, &gate[0][0]);
+        return;
+    }
+    double complex *rho = dm->matrix;
+
+    #pragma omp parallel for schedule(static)
+    for (long long r = 0; r < dim; r++) {
+        if (r & (m0 | m1)) continue;
+        for (long long c = 0; c < dim; c++) {
+            if (c & (m0 | m1)) continue;
+            double complex B[4][4], T[4][4];
+            for (int a = 0; a < 4; a++)
+                for (int b = 0; b < 4; b++)
+                    B[a][b] = rho[(r + offsets[a]) * dim + c + offsets[b]];
+            // T = G B
+            for (int a = 0; a < 4; a++)
+                for (int b = 0; b < 4; b++)
+                    T[a][b] = gate[a][0] * B[0][b] + gate[a][1] * B[1][b]
+                            + gate[a][2] * B[2][b] + gate[a][3] * B[3][b];
+            // B' = T G^\dagger
+            for (int a = 0; a < 4; a++)
+                for (int b = 0; b < 4; b++)
+                    rho[(r + offsets[a]) * dim + c + offsets[b]] =
+                        T[a][0] * conj(gate[b][0]) + T[a][1] * conj(gate[b][1])
+                      + T[a][2] * conj(gate[b][2]) + T[a][3] * conj(gate[b][3]);
+        }
+    }
 }
 
 /* Applica un canale quantistico (definito da numOperators operatori di Kraus)
@@ -158,38 +515,575 @@ void applySingleQubitGateDensity(DensityMatrix *dm, int target, double complex g
    \rho -> \sum_i K_i \rho K_i^\dagger.
    "krausOperators" è un array di puntatori a matrici, ognuna di dimensione 2^(numQubits) x 2^(numQubits). */
 void applyKrausChannelDensity(DensityMatrix *dm, int numOperators, double complex **krausOperators) {
-    int dim = 1 << dm->numQubits;
-    double complex *newRho = calloc(dim * dim, sizeof(double complex));
-    if (!newRho) {
-        perror("Errore allocazione newRho in applyKrausChannelDensity");
-        exit(1);
-    }
-    double complex *temp = calloc(dim * dim, sizeof(double complex));
-    double complex *temp2 = calloc(dim * dim, sizeof(double complex));
-    double complex *K_dag = calloc(dim * dim, sizeof(double complex));
-    if (!temp || !temp2 || !K_dag) {
-        perror("Errore allocazione in applyKrausChannelDensity");
-        exit(1);
+    if (dm->packed) {
+        DensityMatrix *full = unpackDensityMatrix(dm);
+        applyKrausChannelDensity(full, numOperators, krausOperators);
+        copyFullToPacked(full, dm);
+        freeDensityMatrix(full);
+        return;
     }
+    long long dim = 1LL << dm->numQubits;
+    size_t bytes = densityMatrixBytes(dm->numQubits, 0);
+    double complex *newRho = budgetCalloc(bytes, 1, "matrice densità in applyKrausChannelDensity");
+    double complex *temp = budgetMalloc(bytes, "matrice temporanea in applyKrausChannelDensity");
     for (int op = 0; op < numOperators; op++) {
         double complex *K = krausOperators[op];
         // Calcola temp = K * rho
-        multiplyMatrices(K, dm->matrix, temp, dim);
-        // Calcola K_dag (coniugato trasposto di K)
-        conjugateTranspose(K, K_dag, dim);
-        // Calcola temp2 = (K * rho) * K_dag
-        multiplyMatrices(temp, K_dag, temp2, dim);
-        // Aggiunge temp2 a newRho
-        for (int i = 0; i < dim * dim; i++) {
-            newRho[i] += temp2[i];
-        }
+        multiplyMatricesTiled(K, dm->matrix, temp, dim, 0, 0);
+        // Accumula newRho += (K * rho) * K^\dagger
+        multiplyMatricesTiled(temp, K, newRho, dim, 1, 1);
     }
     // Aggiorna la matrice densità
-    for (int i = 0; i < dim * dim; i++) {
-        dm->matrix[i] = newRho[i];
+    budgetFree(dm->matrix, bytes);
+    dm->matrix = newRho;
+    budgetFree(temp, bytes);
+}
+
+/* Applica S a ogni blocco 2x2 individuato dal bit 'target' di riga e colonna. */
+void applySingleQubitSuperoperatorDensity(DensityMatrix *dm, int target, double complex S[4][4]) {
+    long long dim = 1LL << dm->numQubits;
+    long long mask = 1LL << target;
+    if (dm->packed) {
+        long long offsets[2] = { 0, mask };
+        applyLocalMapPacked(dm, offsets, 2, 1, &S[0][0]);
+        return;
+    }
+    double complex *rho = dm->matrix;
+
+    #pragma omp parallel for schedule(static)
+    for (long long r0 = 0; r0 < dim; r0++) {
+        if (r0 & mask) continue;
+        double complex *row0 = rho + r0 * dim;
+        double complex *row1 = rho + (r0 | mask) * dim;
+        for (long long c0 = 0; c0 < dim; c0++) {
+            if (c0 & mask) continue;
+            long long c1 = c0 | mask;
+            double complex v[4] = { row0[c0], row0[c1], row1[c0], row1[c1] };
+            double complex w[4];
+            for (int a = 0; a < 4; a++) {
+                w[a] = S[a][0] * v[0] + S[a][1] * v[1] + S[a][2] * v[2] + S[a][3] * v[3];
+            }
+            row0[c0] = w[0];
+            row0[c1] = w[1];
+            row1[c0] = w[2];
+            row1[c1] = w[3];
+        }
+    }
+}
+
+/* Applica S a ogni blocco 4x4 individuato dai bit qubit0 e qubit1 di riga e colonna. */
+void applyTwoQubitSuperoperatorDensity(DensityMatrix *dm, int qubit0, int qubit1, double complex S[16][16]) {
+    long long dim = 1LL << dm->numQubits;
+    long long m0 = 1LL << qubit0;
+    long long m1 = 1LL << qubit1;
+    long long offsets[4] = { 0, m0, m1, m0 | m1 };
+    if (dm->packed) {
+        applyLocalMapPacked(dm, offsets, 4, 1, &S[0][0]);
+        return;
+    }
+    double complex *rho = dm->matrix;
+
+    #pragma omp parallel for schedule(static)
+    for (long long r = 0; r < dim; r++) {
+        if (r & (m0 | m1)) continue;
+        for (long long c = 0; c < dim; c++) {
+            if (c & (m0 | m1)) continue;
+            double complex v[16], w[16];
+            for (int a = 0; a < 4; a++) {
+                for (int b = 0; b < 4; b++) {
+                    v[a * 4 + b] = rho[(r + offsets[a]) * dim + c + offsets[b]];
+                }
+            }
+            for (int x = 0; x < 16; x++) {
+                double complex sum = 0;
+                for (int y = 0; y < 16; y++) {
+                    sum += S[x][y] * v[y];
+                }
+                w[x] = sum;
+            }
+            for (int a = 0; a < 4; a++) {
+                for (int b = 0; b < 4; b++) {
+                    rho[(r + offsets[a]) * dim + c + offsets[b]] = w[a * 4 + b];
+                }
+            }
+        }
+    }
+}
+
+/* Superoperatore del canale: S[(a,b)][(c,d)] = \sum_k K_k[a][c] conj(K_k[b][d]). */
+void singleQubitKrausToSuperoperator(int numOperators, double complex (*kraus)[2][2], double complex S[4][4]) {
+    for (int x = 0; x < 4; x++)
+        for (int y = 0; y < 4; y++)
+            S[x][y] = 0;
+    for (int k = 0; k < numOperators; k++) {
+        for (int a = 0; a < 2; a++)
+            for (int b = 0; b < 2; b++)
+                for (int c = 0; c < 2; c++)
+                    for (int d = 0; d < 2; d++)
+                        S[a * 2 + b][c * 2 + d] += kraus[k][a][c] * conj(kraus[k][b][d]);
+    }
+}
+
+void applySingleQubitKrausDensity(DensityMatrix *dm, int target, int numOperators, double complex (*kraus)[2][2]) {
+    double complex S[4][4];
+    singleQubitKrausToSuperoperator(numOperators, kraus, S);
+    applySingleQubitSuperoperatorDensity(dm, target, S);
+}
+
+void applyTwoQubitKrausDensity(DensityMatrix *dm, int qubit0, int qubit1, int numOperators, double complex (*kraus)[4][4]) {
+    double complex S[16][16] = {{0}};
+    for (int k = 0; k < numOperators; k++) {
+        for (int a = 0; a < 4; a++)
+            for (int b = 0; b < 4; b++)
+                for (int c = 0; c < 4; c++)
+                    for (int d = 0; d < 4; d++)
+                        S[a * 4 + b][c * 4 + d] += kraus[k][a][c] * conj(kraus[k][b][d]);
+    }
+    applyTwoQubitSuperoperatorDensity(dm, qubit0, qubit1, S);
+}
+
+/*
+ * Canali di Pauli: con P = X^x Z^z vale (P \rho P^\dagger)[i][j] = (-1)^{z.(i^j)} \rho[i^x][j^x],
+ * quindi \rho'[i][j] = \sum_x coef[x][i^j] \rho[i^x][j^x] con
+ * coef[x][d] = \sum_z p(x,z) (-1)^{popcount(z & d)}.
+ * 'probs' è indicizzato dalla stringa di Pauli in base 4 (cifra k per il qubit locale k,
+ * 0 = I, 1 = X, 2 = Y, 3 = Z); coef ha K x K elementi con K = 2^numLocal.
+ */
+static void pauliChannelCoefficients(int numLocal, const double *probs, double *coef) {
+    static const int pauliX[4] = { 0, 1, 1, 0 };
+    static const int pauliZ[4] = { 0, 0, 1, 1 };
+    int K = 1 << numLocal;
+    int numPaulis = K * K;
+    for (int e = 0; e < K * K; e++) coef[e] = 0.0;
+    for (int p = 0; p < numPaulis; p++) {
+        int x = 0, z = 0;
+        for (int k = 0, digits = p; k < numLocal; k++, digits >>= 2) {
+            x |= pauliX[digits & 3] << k;
+            z |= pauliZ[digits & 3] << k;
+        }
+        for (int d = 0; d < K; d++) {
+            int sign = __builtin_popcount(z & d) & 1;
+            coef[x * K + d] += sign ? -probs[p] : probs[p];
+        }
+    }
+}
+
+/* Superoperatore equivalente (per il formato compatto): S[(a,b)][(a^x,b^x)] = coef[x][a^b]. */
+static void pauliChannelSuperoperator(int K, const double *coef, double complex *S) {
+    for (int e = 0; e < K * K * K * K; e++) S[e] = 0.0;
+    for (int a = 0; a < K; a++)
+        for (int b = 0; b < K; b++)
+            for (int x = 0; x < K; x++)
+                S[(a * K + b) * K * K + (a ^ x) * K + (b ^ x)] = coef[x * K + (a ^ b)];
+}
+
+/* Sul blocco [[b00, b01], [b10, b11]]: la diagonale si mescola con peso coef[1][0],
+   i due elementi fuori diagonale con peso coef[1][1]. Solo coefficienti reali. */
+void applyPauliChannelDensity(DensityMatrix *dm, int target, double px, double py, double pz) {
+    double probs[4] = { 1.0 - px - py - pz, px, py, pz };
+    double coef[4];
+    pauliChannelCoefficients(1, probs, coef);
+    long long dim = 1LL << dm->numQubits;
+    long long mask = 1LL << target;
+    if (dm->packed) {
+        double complex S[4][4];
+        long long offsets[2] = { 0, mask };
+        pauliChannelSuperoperator(2, coef, &S[0][0]);
+        applyLocalMapPacked(dm, offsets, 2, 1, &S[0][0]);
+        return;
+    }
+    double complex *rho = dm->matrix;
+    double same0 = coef[0], diff0 = coef[1];   // x = 0: d = 0, d = 1
+    double same1 = coef[2], diff1 = coef[3];   // x = 1: d = 0, d = 1
+
+    #pragma omp parallel for schedule(static)
+    for (long long r0 = 0; r0 < dim; r0++) {
+        if (r0 & mask) continue;
+        double complex *row0 = rho + r0 * dim;
+        double complex *row1 = rho + (r0 | mask) * dim;
+        for (long long c0 = 0; c0 < dim; c0++) {
+            if (c0 & mask) continue;
+            long long c1 = c0 | mask;
+            double complex b00 = row0[c0], b01 = row0[c1];
+            double complex b10 = row1[c0], b11 = row1[c1];
+            row0[c0] = same0 * b00 + same1 * b11;
+            row1[c1] = same0 * b11 + same1 * b00;
+            row0[c1] = diff0 * b01 + diff1 * b10;
+            row1[c0] = diff0 * b10 + diff1 * b01;
+        }
+    }
+}
+
+/* Come sopra su blocchi 4x4: ogni elemento (a, b) si combina con i tre (a^x, b^x). */
+void applyTwoQubitPauliChannelDensity(DensityMatrix *dm, int qubit0, int qubit1, const double probs[16]) {
+    double coef[16];
+    pauliChannelCoefficients(2, probs, coef);
+    long long dim = 1LL << dm->numQubits;
+    long long m0 = 1LL << qubit0;
+    long long m1 = 1LL << qubit1;
+    long long offsets[4] = { 0, m0, m1, m0 | m1 };
+    if (dm->packed) {
+        double complex S[16][16];
+        pauliChannelSuperoperator(4, coef, &S[0][0]);
+        applyLocalMapPacked(dm, offsets, 4, 1, &S[0][0]);
+        return;
+    }
+    double complex *rho = dm->matrix;
+
+    #pragma omp parallel for schedule(static)
+    for (long long r = 0; r < dim; r++) {
+        if (r & (m0 | m1)) continue;
+        for (long long c = 0; c < dim; c++) {
+            if (c & (m0 | m1)) continue;
+            double complex v[4][4];
+            for (int a = 0; a < 4; a++)
+                for (int b = 0; b < 4; b++)
+                    v[a][b] = rho[(r + offsets[a]) * dim + c + offsets[b]];
+            for (int a = 0; a < 4; a++)
+                for (int b = 0; b < 4; b++) {
+                    int d = a ^ b;
+                    rho[(r + offsets[a]) * dim + c + offsets[b]] =
+                        coef[d] * v[a][b] + coef[4 + d] * v[a ^ 1][b ^ 1]
+                      + coef[8 + d] * v[a ^ 2][b ^ 2] + coef[12 + d] * v[a ^ 3][b ^ 3];
+                }
+        }
+    }
+}
+
+/* Distribuisce i bit di v (dal meno significativo) sulle posizioni a 1 di 'mask' (come pdep). */
+static inline long long depositBits(long long v, long long mask) {
+    long long idx = 0;
+    for (long long m = mask; m; m &= m - 1, v >>= 1) {
+        if (v & 1) idx |= m & -m;
+    }
+    return idx;
+}
+
+/* Sottoinsieme successivo di 'mask' in ordine crescente (0 dopo l'ultimo). */
+static inline long long nextSubmask(long long t, long long mask) {
+    return (t - mask) & mask;
+}
+
+/* Sotto questa dimensione della matrice ridotta (2 qubit tenuti) gli elementi sono troppo
+   pochi per dividerli tra i thread: si divide invece la somma sui qubit tracciati. */
+#define SMALL_REDUCED_ELEMENTS 16
+
+/*
+ * \rho_A[a][b] = \sum_e \rho[a|e][b|e], senza copie di \rho né tabelle di indici: gli indici
+ * tenuti si ottengono con depositBits e quelli tracciati scorrendo i sottoinsiemi di traceMask.
+ * Con una matrice ridotta grande ogni thread calcola interi elementi; con una piccola i
+ * thread si dividono la somma su e e i risultati vengono ridotti.
+ */
+DensityMatrix* partialTrace(DensityMatrix *dm, long long keepMask) {
+    int n = dm->numQubits;
+    long long fullMask = (1LL << n) - 1;
+    keepMask &= fullMask;
+    long long traceMask = fullMask & ~keepMask;
+    int numKeep = __builtin_popcountll(keepMask);
+    long long dimR = 1LL << numKeep;
+    long long numTraced = 1LL << (n - numKeep);
+    long long dim = 1LL << n;
+
+    DensityMatrix *reduced = initializeDensityMatrix(numKeep);
+    double complex *m = dm->matrix;
+    int packed = dm->packed;
+
+    if (dimR * dimR <= SMALL_REDUCED_ELEMENTS) {
+        int numElements = (int)(dimR * dimR);
+        long long rows[SMALL_REDUCED_ELEMENTS], cols[SMALL_REDUCED_ELEMENTS];
+        double sums[2 * SMALL_REDUCED_ELEMENTS] = {0.0};
+        for (int ab = 0; ab < numElements; ab++) {
+            rows[ab] = depositBits(ab / dimR, keepMask);
+            cols[ab] = depositBits(ab % dimR, keepMask);
+        }
+        #pragma omp parallel for reduction(+:sums[:2 * SMALL_REDUCED_ELEMENTS]) schedule(static)
+        for (long long e = 0; e < numTraced; e++) {
+            long long t = depositBits(e, traceMask);
+            for (int ab = 0; ab < numElements; ab++) {
+                long long i = rows[ab] | t, j = cols[ab] | t;
+                double complex v = packed ? packedGet(m, i, j, dim) : m[i * dim + j];
+                sums[2 * ab] += creal(v);
+                sums[2 * ab + 1] += cimag(v);
+            }
+        }
+        for (int ab = 0; ab < numElements; ab++) {
+            reduced->matrix[ab] = sums[2 * ab] + I * sums[2 * ab + 1];
+        }
+        return reduced;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long long ab = 0; ab < dimR * dimR; ab++) {
+        long long row = depositBits(ab / dimR, keepMask);
+        long long col = depositBits(ab % dimR, keepMask);
+        double sumRe = 0.0, sumIm = 0.0;
+        long long t = 0;
+        for (long long e = 0; e < numTraced; e++, t = nextSubmask(t, traceMask)) {
+            long long i = row | t, j = col | t;
+            double complex v = packed ? packedGet(m, i, j, dim) : m[i * dim + j];
+            sumRe += creal(v);
+            sumIm += cimag(v);
+        }
+        reduced->matrix[ab] = sumRe + I * sumIm;
+    }
+    return reduced;
+}
+
+/* \rho_A[a][b] = \sum_e psi[a|e] conj(psi[b|e]), direttamente dalle ampiezze (stessa
+   suddivisione del lavoro di partialTrace). */
+DensityMatrix* reducedDensityFromState(QubitState *state, long long keepMask) {
+    TRACE_REQUIRE_AMPLITUDES(state, 0);
+    int n = state->numQubits;
+    long long fullMask = (1LL << n) - 1;
+    keepMask &= fullMask;
+    long long traceMask = fullMask & ~keepMask;
+    int numKeep = __builtin_popcountll(keepMask);
+    long long dimR = 1LL << numKeep;
+    long long numTraced = 1LL << (n - numKeep);
+
+    DensityMatrix *reduced = initializeDensityMatrix(numKeep);
+    const double complex *psi = state->amplitudes;
+
+    if (dimR * dimR <= SMALL_REDUCED_ELEMENTS) {
+        int numElements = (int)(dimR * dimR);
+        long long keep[4];
+        double sums[2 * SMALL_REDUCED_ELEMENTS] = {0.0};
+        for (long long a = 0; a < dimR; a++) {
+            keep[a] = depositBits(a, keepMask);
+        }
+        #pragma omp parallel for reduction(+:sums[:2 * SMALL_REDUCED_ELEMENTS]) schedule(static)
+        for (long long e = 0; e < numTraced; e++) {
+            long long t = depositBits(e, traceMask);
+            for (long long a = 0; a < dimR; a++) {
+                for (long long b = a; b < dimR; b++) {
+                    double complex v = psi[keep[a] | t] * conj(psi[keep[b] | t]);
+                    sums[2 * (a * dimR + b)] += creal(v);
+                    sums[2 * (a * dimR + b) + 1] += cimag(v);
+                }
+            }
+        }
+        for (int ab = 0; ab < numElements; ab++) {
+            long long a = ab / dimR, b = ab % dimR;
+            if (b < a) continue;
+            double complex sum = sums[2 * ab] + I * sums[2 * ab + 1];
+            reduced->matrix[a * dimR + b] = sum;
+            reduced->matrix[b * dimR + a] = conj(sum);
+        }
+        return reduced;
+    }
+
+    // Solo il triangolo superiore; l'inferiore si ottiene per hermitianità
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long long a = 0; a < dimR; a++) {
+        long long rowA = depositBits(a, keepMask);
+        for (long long b = a; b < dimR; b++) {
+            long long rowB = depositBits(b, keepMask);
+            double complex sum = 0.0;
+            long long t = 0;
+            for (long long e = 0; e < numTraced; e++, t = nextSubmask(t, traceMask)) {
+                sum += psi[rowA | t] * conj(psi[rowB | t]);
+            }
+            reduced->matrix[a * dimR + b] = sum;
+            reduced->matrix[b * dimR + a] = conj(sum);
+        }
+    }
+    return reduced;
+}
+
+/* Probabilità di 1 sul qubit dalla diagonale; il collasso azzera i blocchi con bit diversi
+   da 'result' e riscala gli altri, elemento per elemento e in place.
+   Un esito di probabilità nulla (o negativa per arrotondamento) non viene mai scelto. */
+MeasurementResult measureDensity(DensityMatrix *dm, int qubit) {
+    long long dim = 1LL << dm->numQubits;
+    long long mask = 1LL << qubit;
+    double complex *m = dm->matrix;
+    int packed = dm->packed;
+    double prob0 = 0.0, prob1 = 0.0;
+
+    #pragma omp parallel for reduction(+:prob0, prob1) schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        double p = creal(packed ? m[packedIndex(i, i, dim)] : m[i * dim + i]);
+        if (i & mask) prob1 += p; else prob0 += p;
+    }
+    if (prob0 < 0.0) prob0 = 0.0;
+    if (prob1 < 0.0) prob1 = 0.0;
+    double total = prob0 + prob1;
+    if (!(total > 0.0)) {
+        fprintf(stderr, "Errore: measureDensity su una matrice densità a traccia nulla\n");
+        exit(1);
+    }
+    prob0 /= total;
+    prob1 /= total;
+
+    double rand_val = (double)rand() / RAND_MAX;
+    int result = (prob1 == 0.0 || (prob0 > 0.0 && rand_val < prob0)) ? 0 : 1;
+    long long keep = result ? mask : 0;
+    double scale = 1.0 / (result ? prob1 * total : prob0 * total);
+
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (long long i = 0; i < dim; i++) {
+        int rowKept = (i & mask) == keep;
+        long long j0 = packed ? i : 0;
+        for (long long j = j0; j < dim; j++) {
+            long long idx = packed ? packedIndex(i, j, dim) : i * dim + j;
+            if (rowKept && (j & mask) == keep) {
+                m[idx] *= scale;
+            } else {
+                m[idx] = 0.0;
+            }
+        }
+    }
+
+    MeasurementResult m_result;
+    m_result.prob0 = prob0;
+    m_result.prob1 = prob1;
+    m_result.result = result;
+    return m_result;
+}
+
+/* La distribuzione cumulativa della diagonale viene costruita una volta;
+   ogni colpo costa poi una ricerca binaria O(n). */
+long long* sampleShotsDensity(DensityMatrix *dm, long long numShots) {
+    long long dim = 1LL << dm->numQubits;
+    double *cumulative = budgetMalloc(checkedBytes(dim, sizeof(double), "probabilità cumulative"),
+                                      "probabilità cumulative");
+    long long *counts = budgetCalloc(dim, sizeof(long long), "conteggi in sampleShotsDensity");
+    double sum = 0.0;
+    for (long long i = 0; i < dim; i++) {
+        double p = creal(dm->packed ? dm->matrix[packedIndex(i, i, dim)] : dm->matrix[i * dim + i]);
+        sum += (p > 0.0) ? p : 0.0;
+        cumulative[i] = sum;
+    }
+    if (!(sum > 0.0)) {
+        fprintf(stderr, "Errore: sampleShotsDensity su una matrice densità a traccia nulla\n");
+        exit(1);
+    }
+
+    for (long long s = 0; s < numShots; s++) {
+        double u = sum * ((double)rand() / ((double)RAND_MAX + 1.0));
+        long long lo = 0, hi = dim - 1;
+        while (lo < hi) {
+            long long mid = (lo + hi) / 2;
+            if (cumulative[mid] > u) hi = mid; else lo = mid + 1;
+        }
+        counts[lo]++;
+    }
+
+    budgetFree(cumulative, dim * sizeof(double));
+    return counts;
+}
+
+void freeShotsDensity(long long *counts, int numQubits) {
+    budgetFree(counts, (1LL << numQubits) * sizeof(long long));
+}
+
+/* Numero massimo di qubit raccolti in un blocco da applySingleQubitSuperoperatorsDensity:
+   blocchi 32 x 32 (16 KB) che restano in cache durante i passaggi locali. */
+#define LOCAL_GROUP_QUBITS 5
+
+/* Elementi non nulli di un superoperatore 4x4: i canali tipici (damping, dephasing,
+   rilassamento termico) ne hanno 4-6 su 16, e solo questi vengono applicati. */
+typedef struct {
+    int count;
+    int row[16], col[16];
+    double complex value[16];
+} SparseSuperoperator;
+
+static void sparsifySuperoperator(const double complex *S, SparseSuperoperator *sp) {
+    sp->count = 0;
+    for (int x = 0; x < 16; x++) {
+        if (S[x] != 0.0) {
+            sp->row[sp->count] = x / 4;
+            sp->col[sp->count] = x % 4;
+            sp->value[sp->count] = S[x];
+            sp->count++;
+        }
+    }
+}
+
+/* Applica a un blocco K x K (in cache) il superoperatore sul bit locale 'bit'. */
+static void superoperatorOnLocalBit(double complex *B, int K, int bit, const SparseSuperoperator *sp) {
+    int lm = 1 << bit;
+    for (int a = 0; a < K; a++) {
+        if (a & lm) continue;
+        for (int b = 0; b < K; b++) {
+            if (b & lm) continue;
+            double complex *p[4] = { &B[a * K + b], &B[a * K + (b | lm)], &B[(a | lm) * K + b], &B[(a | lm) * K + (b | lm)] };
+            double complex v[4] = { *p[0], *p[1], *p[2], *p[3] };
+            double complex w[4] = { 0.0, 0.0, 0.0, 0.0 };
+            for (int e = 0; e < sp->count; e++) {
+                w[sp->row[e]] += sp->value[e] * v[sp->col[e]];
+            }
+            *p[0] = w[0];
+            *p[1] = w[1];
+            *p[2] = w[2];
+            *p[3] = w[3];
+        }
+    }
+}
+
+/*
+ * I qubit vengono divisi in gruppi di al più LOCAL_GROUP_QUBITS: per ogni gruppo si percorre
+ * \rho una sola volta, raccogliendo il blocco 2^g x 2^g dei qubit del gruppo e applicandogli
+ * in cache i g superoperatori. Nel formato compatto si elaborano solo i blocchi con r <= c,
+ * come in applyLocalMapPacked.
+ */
+void applySingleQubitSuperoperatorsDensity(DensityMatrix *dm, int numTargets, const int *targets,
+                                           double complex (*S)[4][4]) {
+    long long dim = 1LL << dm->numQubits;
+    double complex *m = dm->matrix;
+    int packed = dm->packed;
+
+    for (int first = 0; first < numTargets; first += LOCAL_GROUP_QUBITS) {
+        int g = numTargets - first;
+        if (g > LOCAL_GROUP_QUBITS) g = LOCAL_GROUP_QUBITS;
+        int K = 1 << g;
+        long long groupMask = 0;
+        long long offsets[1 << LOCAL_GROUP_QUBITS];
+        SparseSuperoperator sparse[LOCAL_GROUP_QUBITS];
+        for (int k = 0; k < g; k++) {
+            groupMask |= 1LL << targets[first + k];
+            sparsifySuperoperator(&S[first + k][0][0], &sparse[k]);
+        }
+        for (int a = 0; a < K; a++) {
+            offsets[a] = 0;
+            for (int k = 0; k < g; k++) {
+                if ((a >> k) & 1) offsets[a] |= 1LL << targets[first + k];
+            }
+        }
+
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (long long r = 0; r < dim; r++) {
+            if (r & groupMask) continue;
+            double complex B[1 << (2 * LOCAL_GROUP_QUBITS)];
+            double complex *rows[1 << LOCAL_GROUP_QUBITS];
+            for (int a = 0; a < K; a++) {
+                rows[a] = m + (r + offsets[a]) * dim;
+            }
+            for (long long c = packed ? r : 0; c < dim; c++) {
+                if (c & groupMask) continue;
+                if (packed) {
+                    for (int a = 0; a < K; a++)
+                        for (int b = 0; b < K; b++)
+                            B[a * K + b] = packedGet(m, r + offsets[a], c + offsets[b], dim);
+                } else {
+                    for (int a = 0; a < K; a++)
+                        for (int b = 0; b < K; b++)
+                            B[a * K + b] = rows[a][c + offsets[b]];
+                }
+                for (int k = 0; k < g; k++) {
+                    superoperatorOnLocalBit(B, K, k, &sparse[k]);
+                }
+                if (packed) {
+                    for (int a = 0; a < K; a++)
+                        for (int b = 0; b < K; b++)
+                            packedSet(m, r + offsets[a], c + offsets[b], dim, B[a * K + b]);
+                } else {
+                    for (int a = 0; a < K; a++)
+                        for (int b = 0; b < K; b++)
+                            rows[a][c + offsets[b]] = B[a * K + b];
+                }
+            }
+        }
     }
-    free(newRho);
-    free(temp);
-    free(temp2);
-    free(K_dag);
 }
@@ -8,15 +8,31 @@
 #include "quantum_sim.h"  // Include le definizioni per QubitState, etc.
 
 // Struttura per rappresentare la matrice densità.
-// La matrice è memorizzata in ordine "row-major" ed ha dimensione 2^(numQubits) x 2^(numQubits)
+// La matrice è memorizzata in ordine "row-major" ed ha dimensione 2^(numQubits) x 2^(numQubits).
+// Con packed != 0 si sfrutta l'hermitianità di \rho: viene memorizzato solo il triangolo
+// superiore (diagonale reale inclusa), riga per riga, in dim * (dim + 1) / 2 elementi.
 typedef struct {
     int numQubits;
+    int packed;
     double complex *matrix;
 } DensityMatrix;
 
 // Inizializza una matrice densità per 'numQubits' (allocazione e inizializzazione a zero)
 DensityMatrix* initializeDensityMatrix(int numQubits);
 
+// Come initializeDensityMatrix, ma in formato hermitiano compatto (circa metà della memoria)
+DensityMatrix* initializePackedDensityMatrix(int numQubits);
+
+// Conversioni tra formato completo e compatto (restituiscono una nuova matrice)
+DensityMatrix* packDensityMatrix(DensityMatrix *dm);
+DensityMatrix* unpackDensityMatrix(DensityMatrix *dm);
+
+// Restituisce l'elemento \rho[i][j] indipendentemente dal formato di memorizzazione
+double complex getDensityElement(DensityMatrix *dm, long long i, long long j);
+
+// Traccia di \rho (parte reale della somma degli elementi diagonali)
+double traceDensityMatrix(DensityMatrix *dm);
+
 // Libera la memoria associata a una matrice densità
 void freeDensityMatrix(DensityMatrix *dm);
 
@@ -27,17 +43,95 @@ void printDensityMatrix(DensityMatrix *dm);
 // (cioè, \rho = |psi><psi|)
 DensityMatrix* pureStateToDensityMatrix(QubitState *state);
 
+// Come sopra, producendo direttamente una matrice in formato compatto
+DensityMatrix* pureStateToPackedDensityMatrix(QubitState *state);
+
 // Applica una trasformazione unitaria U (matrice di dimensione 2^(numQubits) x 2^(numQubits))
-// alla matrice densità: \rho -> U \rho U^\dagger
+// alla matrice densità: \rho -> U \rho U^\dagger.
+// Per le matrici compatte (come per applyKrausChannelDensity) \rho viene espansa temporaneamente.
 void applyUnitaryDensity(DensityMatrix *dm, double complex *U);
 
 // Applica un gate a 1-qubit (matrice 2x2) al qubit 'target' della matrice densità.
-// Questa funzione dovrà espandere il gate alla dimensione del sistema (tramite prodotto tensoriale).
+// Il gate agisce localmente sui blocchi 2x2 individuati dal bit 'target' di riga e colonna,
+// in place e con costo O(4^n), senza espandere l'operatore alla dimensione del sistema.
 void applySingleQubitGateDensity(DensityMatrix *dm, int target, double complex gate[2][2]);
 
+// Gate a 2 e 3 qubit, controparti di quelli di quantum_sim.h, applicati in place con kernel locali:
+// i gate di permutazione scambiano elementi di \rho, quelli di fase controllata li scalano.
+void applyCNOTDensity(DensityMatrix *dm, int control, int target);
+void applyCZDensity(DensityMatrix *dm, int control, int target);
+void applyCPhaseShiftDensity(DensityMatrix *dm, int control, int target, double complex phase);
+void applyToffoliDensity(DensityMatrix *dm, int control1, int control2, int target);
+void applyCCZDensity(DensityMatrix *dm, int control1, int control2, int target);
+void applyFredkinDensity(DensityMatrix *dm, int control, int target1, int target2);
+
+// Gate arbitrario a 2 qubit (matrice 4x4) con indice locale a = bit(qubit0) + 2 * bit(qubit1)
+void applyTwoQubitGateDensity(DensityMatrix *dm, int qubit0, int qubit1, double complex gate[4][4]);
+
 // Applica un canale quantistico (modello tramite operatori di Kraus)
 // alla matrice densità: \rho -> \sum_i K_i \rho K_i^\dagger.
 // 'numOperators' è il numero di operatori, e 'krausOperators' è un array di matrici (ognuna di dimensione 2^(numQubits) x 2^(numQubits)).
 void applyKrausChannelDensity(DensityMatrix *dm, int numOperators, double complex **krausOperators);
 
+// Applica un superoperatore locale S (4x4) al qubit 'target': ogni blocco 2x2 B di \rho,
+// letto come vettore (B00, B01, B10, B11), diventa S vec(B). Un solo passaggio in place.
+void applySingleQubitSuperoperatorDensity(DensityMatrix *dm, int target, double complex S[4][4]);
+
+// Come sopra per due qubit: blocchi 4x4 con indice locale a = bit(qubit0) + 2 * bit(qubit1)
+// e superoperatore 16x16 sul vettore row-major del blocco.
+void applyTwoQubitSuperoperatorDensity(DensityMatrix *dm, int qubit0, int qubit1, double complex S[16][16]);
+
+// Applica superoperatori indipendenti S[k] ai qubit targets[k] (tutti distinti) con un solo
+// passaggio su \rho ogni 5 qubit, invece di un passaggio per qubit.
+void applySingleQubitSuperoperatorsDensity(DensityMatrix *dm, int numTargets, const int *targets,
+                                           double complex (*S)[4][4]);
+
+// Costruisce il superoperatore 4x4 di un canale a 1 qubit: S[(a,b)][(c,d)] = \sum_k K_k[a][c] conj(K_k[b][d])
+void singleQubitKrausToSuperoperator(int numOperators, double complex (*kraus)[2][2], double complex S[4][4]);
+
+// Canale di Kraus locale su un qubit: \rho -> \sum_k K_k \rho K_k^\dagger con K_k matrici 2x2.
+// Gli operatori vengono combinati in un unico superoperatore e applicati in un solo passaggio,
+// senza estenderli alla dimensione del sistema.
+void applySingleQubitKrausDensity(DensityMatrix *dm, int target, int numOperators, double complex (*kraus)[2][2]);
+
+// Canale di Kraus locale su due qubit, con operatori 4x4 (indice locale come sopra)
+void applyTwoQubitKrausDensity(DensityMatrix *dm, int qubit0, int qubit1, int numOperators, double complex (*kraus)[4][4]);
+
+// Canale di Pauli su un qubit: \rho -> p0 \rho + px X\rho X + py Y\rho Y + pz Z\rho Z, p0 = 1 - px - py - pz.
+// Non servono prodotti di matrici: i blocchi diagonali si mescolano tra loro e quelli
+// fuori diagonale vengono scalati e mescolati con coefficienti reali, in un solo passaggio.
+void applyPauliChannelDensity(DensityMatrix *dm, int target, double px, double py, double pz);
+
+// Canale di Pauli su due qubit: probs[a + 4 * b] è la probabilità di P_a su qubit0 e P_b su qubit1
+// (0 = I, 1 = X, 2 = Y, 3 = Z); le 16 probabilità devono sommare a 1.
+void applyTwoQubitPauliChannelDensity(DensityMatrix *dm, int qubit0, int qubit1, const double probs[16]);
+
+// Traccia parziale: restituisce la matrice densità (non compatta) dei qubit con bit a 1 in
+// keepMask, nell'ordine crescente di indice (il qubit tenuto di indice minore diventa il qubit 0).
+// Un solo passaggio parallelo che legge solo gli elementi necessari, in entrambi i formati,
+// senza memoria aggiuntiva oltre al risultato; con 1 o 2 qubit tenuti i thread si dividono
+// la somma sui qubit tracciati invece degli elementi.
+DensityMatrix* partialTrace(DensityMatrix *dm, long long keepMask);
+
+// Matrice densità ridotta di uno stato puro, calcolata direttamente dalle ampiezze
+// senza costruire |psi><psi| con pureStateToDensityMatrix.
+DensityMatrix* reducedDensityFromState(QubitState *state, long long keepMask);
+
+// Misura proiettiva del qubit nella base computazionale (come measure di quantum_sim.h):
+// \rho -> P_r \rho P_r / p_r, calcolato in place senza copie della matrice.
+// Un esito con p_r = 0 non viene mai scelto; una \rho a traccia nulla è un errore.
+MeasurementResult measureDensity(DensityMatrix *dm, int qubit);
+
+// Prodotto a blocchi C = A op(B) (C += A op(B) se accumulate != 0) di matrici dense dim x dim,
+// con op(B) = B oppure B^\dagger se conjTransB != 0; dim qualsiasi (i blocchi sul bordo
+// sono ridotti)
+void multiplyMatricesTiled(const double complex *A, const double complex *B, double complex *C,
+                           long long dim, int conjTransB, int accumulate);
+
+// Campiona numShots misure di tutti i qubit dalla diagonale di \rho, senza modificarla.
+// Restituisce un istogramma di 2^numQubits conteggi, allocato nel budget di memoria
+// (quantum_memory.h): va liberato con freeShotsDensity.
+long long* sampleShotsDensity(DensityMatrix *dm, long long numShots);
+void freeShotsDensity(long long *counts, int numQubits);
+
 #endif // QUANTUM_DENSITY_H
@@ -0,0 +1,174 @@
+// quantum_memory.c
+
+#include "quantum_memory.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <complex.h>
+#include <stdint.h>
+#include <unistd.h>
+
+static size_t memoryBudget = 0;
+static int budgetInitialized = 0;
+static size_t memoryInUse = 0;
+static size_t memoryPeak = 0;
+
+/* Legge QUANTUMSIM_MEMORY_BUDGET alla prima richiesta, se non è già stato impostato un budget. */
+static void initializeBudget(void) {
+    if (budgetInitialized) return;
+    budgetInitialized = 1;
+    const char *env = getenv("QUANTUMSIM_MEMORY_BUDGET");
+    if (!env || !*env) return;
+
+    char *end;
+    double value = strtod(env, &end);
+    switch (*end) {
+        case 'k': case 'K': value *= 1024.0; break;
+        case 'm': case 'M': value *= 1024.0 * 1024.0; break;
+        case 'g': case 'G': value *= 1024.0 * 1024.0 * 1024.0; break;
+        default: break;
+    }
+    if (value > 0) {
+        memoryBudget = (size_t)value;
+    }
+}
+
+void setMemoryBudget(size_t bytes) {
+    budgetInitialized = 1;
+    memoryBudget = bytes;
+}
+
+size_t getMemoryBudget(void) {
+    initializeBudget();
+    return memoryBudget;
+}
+
+size_t currentMemoryUsage(void) {
+    return memoryInUse;
+}
+
+size_t peakMemoryUsage(void) {
+    return memoryPeak;
+}
+
+void resetPeakMemoryUsage(void) {
+    #pragma omp critical(quantum_memory)
+    memoryPeak = memoryInUse;
+}
+
+void printMemoryReport(void) {
+    size_t budget = getMemoryBudget();
+    fprintf(stderr, "Memoria: in uso %.1f MiB, picco %.1f MiB", memoryInUse / 1048576.0, memoryPeak / 1048576.0);
+    if (budget) {
+        fprintf(stderr, ", budget %.1f MiB\n", budget / 1048576.0);
+    } else {
+        fprintf(stderr, ", budget illimitato\n");
+    }
+}
+
+int memoryBudgetAllows(size_t bytes) {
+    size_t budget = getMemoryBudget();
+    return budget == 0 || (bytes <= budget && memoryInUse <= budget - bytes);
+}
+
+size_t checkedBytes(size_t count, size_t size, const char *what) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        fprintf(stderr, "Errore: dimensione non rappresentabile per %s (%zu x %zu byte)\n", what, count, size);
+        exit(1);
+    }
+    return count * size;
+}
+
+/* Riserva 'bytes' nel budget (in modo atomico rispetto agli altri thread) o termina. */
+static void reserveBytes(size_t bytes, const char *what) {
+    size_t budget = getMemoryBudget();
+    int ok = 1;
+    #pragma omp critical(quantum_memory)
+    {
+        if (budget && (bytes > budget || memoryInUse > budget - bytes)) {
+            ok = 0;
+        } else {
+            memoryInUse += bytes;
+            if (memoryInUse > memoryPeak) memoryPeak = memoryInUse;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Errore: budget di memoria superato per %s: richiesti %.1f MiB, "
+                        "in uso %.1f MiB, budget %.1f MiB\n",
+                what, bytes / 1048576.0, memoryInUse / 1048576.0, budget / 1048576.0);
+        exit(1);
+    }
+}
+
+static void releaseBytes(size_t bytes) {
+    #pragma omp critical(quantum_memory)
+    memoryInUse -= (bytes <= memoryInUse) ? bytes : memoryInUse;
+}
+
+void* budgetMalloc(size_t bytes, const char *what) {
+    reserveBytes(bytes, what);
+    void *ptr = malloc(bytes ? bytes : 1);
+    if (!ptr) {
+        releaseBytes(bytes);
+        fprintf(stderr, "Errore allocazione %s (%.1f MiB)\n", what, bytes / 1048576.0);
+        exit(1);
+    }
+    return ptr;
+}
+
+void* budgetCalloc(size_t count, size_t size, const char *what) {
+    size_t bytes = checkedBytes(count, size, what);
+    reserveBytes(bytes, what);
+    void *ptr = calloc(count ? count : 1, size ? size : 1);
+    if (!ptr) {
+        releaseBytes(bytes);
+        fprintf(stderr, "Errore allocazione %s (%.1f MiB)\n", what, bytes / 1048576.0);
+        exit(1);
+    }
+    return ptr;
+}
+
+void budgetFree(void *ptr, size_t bytes) {
+    if (!ptr) return;
+    free(ptr);
+    releaseBytes(bytes);
+}
+
+size_t stateVectorBytes(int numQubits) {
+    if (numQubits < 0 || numQubits >= 62) return SIZE_MAX;
+    return checkedBytes((size_t)1 << numQubits, sizeof(double complex), "vettore di stato");
+}
+
+size_t densityMatrixBytes(int numQubits, int packed) {
+    if (numQubits < 0 || numQubits >= 31) return SIZE_MAX;
+    size_t dim = (size_t)1 << numQubits;
+    size_t elements = packed ? dim * (dim + 1) / 2 : dim * dim;
+    return checkedBytes(elements, sizeof(double complex), "matrice densità");
+}
+
+/* Memoria fisica del nodo in byte (0 se non è nota). */
+static size_t physicalMemoryBytes(void) {
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pages <= 0 || pageSize <= 0) return 0;
+    if ((size_t)pages > SIZE_MAX / (size_t)pageSize) return SIZE_MAX;
+    return (size_t)pages * (size_t)pageSize;
+}
+
+int backendMemoryAllows(size_t bytes) {
+    if (getMemoryBudget() != 0) return memoryBudgetAllows(bytes);
+    size_t limit = physicalMemoryBytes();
+    if (limit == 0) limit = DEFAULT_BACKEND_MEMORY_LIMIT;
+    return bytes <= limit && memoryInUse <= limit - bytes;
+}
+
+SimulationBackend chooseNoisyBackend(int numQubits, int numThreads) {
+    if (backendMemoryAllows(densityMatrixBytes(numQubits, 0))) return BACKEND_DENSITY;
+    if (backendMemoryAllows(densityMatrixBytes(numQubits, 1))) return BACKEND_PACKED_DENSITY;
+    size_t state = stateVectorBytes(numQubits);
+    if (numThreads < 1) numThreads = 1;
+    if (state != SIZE_MAX && state <= SIZE_MAX / numThreads
+        && backendMemoryAllows(state * numThreads)) return BACKEND_TRAJECTORIES;
+    if (backendMemoryAllows(state)) return BACKEND_TRAJECTORIES;
+    return BACKEND_NONE;
+}
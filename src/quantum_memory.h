@@ -0,0 +1,61 @@
+#ifndef QUANTUM_MEMORY_H
+#define QUANTUM_MEMORY_H
+
+#include <stddef.h>
+
+// Contabilità della memoria per i vettori di stato e le matrici densità.
+// Tutte le allocazioni grandi passano da budgetMalloc/budgetCalloc, che verificano un budget
+// configurabile prima di allocare: un job troppo grande termina subito con un messaggio chiaro
+// invece di esaurire la memoria del nodo. Il budget si imposta con setMemoryBudget oppure con
+// la variabile d'ambiente QUANTUMSIM_MEMORY_BUDGET (byte, con suffisso opzionale K, M o G).
+
+// Budget in byte (0 = illimitato)
+void setMemoryBudget(size_t bytes);
+size_t getMemoryBudget(void);
+
+// Byte attualmente allocati tramite il budget e picco dall'avvio (o dall'ultimo reset)
+size_t currentMemoryUsage(void);
+size_t peakMemoryUsage(void);
+void resetPeakMemoryUsage(void);
+
+// Stampa uso corrente, picco e budget su stderr
+void printMemoryReport(void);
+
+// Restituisce 1 se altri 'bytes' entrano nel budget
+int memoryBudgetAllows(size_t bytes);
+
+// Allocazioni contabilizzate: se il budget verrebbe superato o l'allocazione fallisce
+// stampano 'what' con le dimensioni richieste e terminano il programma.
+void* budgetMalloc(size_t bytes, const char *what);
+void* budgetCalloc(size_t count, size_t size, const char *what);
+// Libera un blocco ottenuto da budgetMalloc/budgetCalloc di dimensione 'bytes'
+void budgetFree(void *ptr, size_t bytes);
+
+// Prodotto count * size con controllo dell'overflow (termina se non rappresentabile)
+size_t checkedBytes(size_t count, size_t size, const char *what);
+
+// Memoria richiesta dalle rappresentazioni di n qubit
+size_t stateVectorBytes(int numQubits);
+size_t densityMatrixBytes(int numQubits, int packed);
+
+// Limite usato nella scelta della rappresentazione quando il budget è illimitato e la
+// memoria fisica del nodo non è nota
+#define DEFAULT_BACKEND_MEMORY_LIMIT ((size_t)4 << 30)
+
+// Come memoryBudgetAllows, ma con il budget illimitato il limite è la memoria fisica del nodo
+// (o DEFAULT_BACKEND_MEMORY_LIMIT): serve a scegliere tra rappresentazioni alternative, non
+// solo a rifiutare un'allocazione
+int backendMemoryAllows(size_t bytes);
+
+// Rappresentazione più accurata che entra nel budget (o nella memoria fisica, se il budget è
+// illimitato) per una simulazione rumorosa (usata da runNoisyCircuitShots di noise_model.h)
+typedef enum {
+    BACKEND_DENSITY,          // Matrice densità completa
+    BACKEND_PACKED_DENSITY,   // Matrice densità hermitiana compatta (circa metà memoria)
+    BACKEND_TRAJECTORIES,     // Traiettorie: un vettore di stato per thread
+    BACKEND_NONE              // Nemmeno un vettore di stato entra nel budget
+} SimulationBackend;
+
+SimulationBackend chooseNoisyBackend(int numQubits, int numThreads);
+
+#endif // QUANTUM_MEMORY_H
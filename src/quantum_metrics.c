@@ -0,0 +1,444 @@
+// quantum_metrics.c
+
+#include "quantum_metrics.h"
+#include "quantum_memory.h"
+#include "quantum_trace.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <complex.h>
+#include <math.h>
+#include <float.h>
+
+/* Numero massimo di iterazioni QL per autovalore. */
+#define QL_MAX_ITERATIONS 60
+/* Colonne elaborate insieme quando si applicano i riflettori agli autovettori. */
+#define REFLECTOR_BLOCK 64
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Riduzione di Householder di una matrice hermitiana d x d (modificata in place) a una matrice
+ * tridiagonale hermitiana: diag[i] riceve la diagonale (reale), sub[k] l'elemento (k+1, k).
+ * Il riflettore k, I - tau[k] v v^\dagger, agisce sulle righe k+1 .. d-1; v viene lasciato
+ * nella colonna k di A sotto la diagonale (tau[k] = 0: nessun riflettore).
+ * Ogni passo è un aggiornamento di rango 2 della sottomatrice restante, parallelo sulle righe.
+ */
+static void householderTridiagonalize(double complex *A, long long d, double *diag,
+                                      double complex *sub, double *tau) {
+    double complex *v = budgetMalloc(checkedBytes(2 * d, sizeof(double complex), "riflettore di Householder"),
+                                     "riflettore di Householder");
+    double complex *p = v + d;
+    for (long long k = 0; k + 2 < d; k++) {
+        long long m = d - k - 1;
+        double norm = 0.0;
+        for (long long i = 0; i < m; i++) {
+            v[i] = A[(k + 1 + i) * d + k];
+            norm += creal(v[i]) * creal(v[i]) + cimag(v[i]) * cimag(v[i]);
+        }
+        norm = sqrt(norm);
+        double x0 = cabs(v[0]);
+        if (norm - x0 <= 1e-300 * (norm + 1.0)) {
+            // Colonna già ridotta
+            sub[k] = v[0];
+            tau[k] = 0.0;
+            continue;
+        }
+        double complex phase = (x0 > 0.0) ? v[0] / x0 : 1.0;
+        sub[k] = -phase * norm;
+        v[0] += phase * norm;
+        double t = 1.0 / (norm * (norm + x0));   // 2 / (v^\dagger v)
+        tau[k] = t;
+
+        // p = tau S v, con S la sottomatrice (k+1 .., k+1 ..)
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < m; i++) {
+            const double complex *row = A + (k + 1 + i) * d + k + 1;
+            double complex sum = 0.0;
+            for (long long j = 0; j < m; j++) sum += row[j] * v[j];
+            p[i] = t * sum;
+        }
+        // w = p - (tau / 2)(v^\dagger p) v, e S <- S - v w^\dagger - w v^\dagger
+        double complex vp = 0.0;
+        for (long long i = 0; i < m; i++) vp += conj(v[i]) * p[i];
+        double K = 0.5 * t * creal(vp);
+        for (long long i = 0; i < m; i++) p[i] -= K * v[i];
+
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < m; i++) {
+            double complex *row = A + (k + 1 + i) * d + k + 1;
+            double complex vi = v[i], wi = p[i];
+            for (long long j = 0; j < m; j++) row[j] -= vi * conj(p[j]) + wi * conj(v[j]);
+        }
+
+        for (long long i = 0; i < m; i++) A[(k + 1 + i) * d + k] = v[i];
+    }
+    budgetFree(v, 2 * d * sizeof(double complex));
+    for (long long i = 0; i < d; i++) diag[i] = creal(A[i * d + i]);
+    if (d >= 2) sub[d - 2] = A[(d - 1) * d + d - 2];
+}
+
+/*
+ * Metodo QL implicito con shift di Wilkinson per la matrice tridiagonale reale simmetrica
+ * (diagonale diag, sottodiagonale e[0 .. d-2], e[d-1] = 0): al termine diag contiene gli
+ * autovalori. Se Z non è NULL (d x d, inizialmente l'identità) ne accumula gli autovettori
+ * per colonne: le rotazioni di ogni passo vengono prima calcolate e poi applicate a tutte
+ * le righe di Z in parallelo.
+ */
+static void tridiagonalQL(double *diag, double *e, long long d, double *Z) {
+    double *rotations = Z ? budgetMalloc(checkedBytes(2 * d, sizeof(double), "rotazioni QL"), "rotazioni QL") : NULL;
+
+    // Soglia assoluta rispetto alla norma (come tql2 di EISPACK): con molti autovalori nulli
+    // un test relativo ai soli elementi diagonali non verrebbe mai soddisfatto
+    double norm = 0.0;
+    for (long long l = 0; l < d; l++) {
+        int iterations = 0;
+        long long m;
+        norm = fmax(norm, fabs(diag[l]) + fabs(e[l]));
+        do {
+            for (m = l; m + 1 < d; m++) {
+                if (fabs(e[m]) <= DBL_EPSILON * norm) break;
+            }
+            if (m == l) break;
+            if (iterations++ == QL_MAX_ITERATIONS) {
+                fprintf(stderr, "Errore: il metodo QL non converge\n");
+                exit(1);
+            }
+            double g = (diag[l + 1] - diag[l]) / (2.0 * e[l]);
+            double r = hypot(g, 1.0);
+            g = diag[m] - diag[l] + e[l] / (g + copysign(r, g));
+            double s = 1.0, c = 1.0, p = 0.0;
+            long long i, numRotations = 0;
+            for (i = m - 1; i >= l; i--) {
+                double f = s * e[i], b = c * e[i];
+                e[i + 1] = (r = hypot(f, g));
+                if (r == 0.0) {
+                    diag[i + 1] -= p;
+                    e[m] = 0.0;
+                    break;
+                }
+                s = f / r;
+                c = g / r;
+                g = diag[i + 1] - p;
+                r = (diag[i] - g) * s + 2.0 * c * b;
+                diag[i + 1] = g + (p = s * r);
+                g = c * r - b;
+                if (rotations) {
+                    rotations[2 * numRotations] = c;
+                    rotations[2 * numRotations + 1] = s;
+                    numRotations++;
+                }
+            }
+            if (Z && numRotations > 0) {
+                // Le rotazioni agiscono sulle colonne (m-1-q, m-q) di ogni riga
+                #pragma omp parallel for schedule(static)
+                for (long long row = 0; row < d; row++) {
+                    double *z = Z + row * d;
+                    for (long long q = 0; q < numRotations; q++) {
+                        long long col = m - 1 - q;
+                        double cr = rotations[2 * q], sr = rotations[2 * q + 1];
+                        double f = z[col + 1];
+                        z[col + 1] = sr * z[col] + cr * f;
+                        z[col] = cr * z[col] - sr * f;
+                    }
+                }
+            }
+            if (r == 0.0 && i >= l) continue;
+            diag[l] -= p;
+            e[l] = g;
+            e[m] = 0.0;
+        } while (m != l);
+    }
+    if (rotations) budgetFree(rotations, 2 * d * sizeof(double));
+}
+
+/*
+ * Decomposizione spettrale di una matrice hermitiana d x d (distrutta): autovalori in eig e,
+ * se W non è NULL, autovettori nelle colonne di W (A = W diag(eig) W^\dagger).
+ * La tridiagonale hermitiana T viene resa reale con la trasformazione di fase
+ * D = diag(delta), delta[k+1] = delta[k] sub[k] / |sub[k]|; poi W = Q D Z, con Q il prodotto
+ * dei riflettori applicati a blocchi di colonne.
+ */
+static void hermitianEigen(double complex *A, long long d, double *eig, double complex *W) {
+    double *e = budgetMalloc(checkedBytes(2 * d, sizeof(double), "tridiagonale"), "tridiagonale");
+    double *tau = e + d;
+    double complex *sub = budgetMalloc(checkedBytes(2 * d, sizeof(double complex), "sottodiagonale"), "sottodiagonale");
+    double complex *delta = sub + d;
+
+    householderTridiagonalize(A, d, eig, sub, tau);
+    delta[0] = 1.0;
+    for (long long k = 0; k + 1 < d; k++) {
+        double a = cabs(sub[k]);
+        e[k] = a;
+        delta[k + 1] = (a > 0.0) ? delta[k] * sub[k] / a : delta[k];
+    }
+    e[d - 1] = 0.0;
+
+    if (!W) {
+        tridiagonalQL(eig, e, d, NULL);
+    } else {
+        double *Z = budgetCalloc(d * d, sizeof(double), "autovettori tridiagonali");
+        for (long long i = 0; i < d; i++) Z[i * d + i] = 1.0;
+        tridiagonalQL(eig, e, d, Z);
+
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < d; i++)
+            for (long long j = 0; j < d; j++)
+                W[i * d + j] = delta[i] * Z[i * d + j];
+        budgetFree(Z, d * d * sizeof(double));
+
+        // W <- H_k W per k decrescente: ogni riflettore tocca le righe k+1 .. d-1
+        for (long long k = d - 3; k >= 0; k--) {
+            if (tau[k] == 0.0) continue;
+            long long m = d - k - 1;
+            const double complex *Ak = A + k;
+            double t = tau[k];
+            #pragma omp parallel for schedule(static)
+            for (long long j0 = 0; j0 < d; j0 += REFLECTOR_BLOCK) {
+                long long width = (d - j0 < REFLECTOR_BLOCK) ? d - j0 : REFLECTOR_BLOCK;
+                double complex dot[REFLECTOR_BLOCK];
+                for (long long jj = 0; jj < width; jj++) dot[jj] = 0.0;
+                for (long long i = 0; i < m; i++) {
+                    double complex vi = conj(Ak[(k + 1 + i) * d]);
+                    const double complex *w = W + (k + 1 + i) * d + j0;
+                    for (long long jj = 0; jj < width; jj++) dot[jj] += vi * w[jj];
+                }
+                for (long long i = 0; i < m; i++) {
+                    double complex vi = t * Ak[(k + 1 + i) * d];
+                    double complex *w = W + (k + 1 + i) * d + j0;
+                    for (long long jj = 0; jj < width; jj++) w[jj] -= vi * dot[jj];
+                }
+            }
+        }
+    }
+
+    budgetFree(sub, 2 * d * sizeof(double complex));
+    budgetFree(e, 2 * d * sizeof(double));
+}
+
+void hermitianEigenvalues(const double complex *H, long long d, double *eigenvalues) {
+    size_t bytes = checkedBytes(d * d, sizeof(double complex), "copia in hermitianEigenvalues");
+    double complex *A = budgetMalloc(bytes, "copia in hermitianEigenvalues");
+    memcpy(A, H, bytes);
+    hermitianEigen(A, d, eigenvalues, NULL);
+    qsort(eigenvalues, d, sizeof(double), compareDoubles);
+    budgetFree(A, bytes);
+}
+
+/* Radice quadrata di una matrice hermitiana semidefinita positiva (distrutta):
+   sqrt(H) = (W L^{1/4}) (W L^{1/4})^\dagger, con il prodotto a blocchi di quantum_density.c. */
+static void hermitianSqrt(double complex *H, long long d, double complex *out) {
+    size_t bytes = checkedBytes(d * d, sizeof(double complex), "autovettori in hermitianSqrt");
+    double complex *W = budgetMalloc(bytes, "autovettori in hermitianSqrt");
+    double *eig = budgetMalloc(checkedBytes(d, sizeof(double), "autovalori in hermitianSqrt"),
+                               "autovalori in hermitianSqrt");
+    hermitianEigen(H, d, eig, W);
+    for (long long k = 0; k < d; k++) eig[k] = (eig[k] > 0.0) ? sqrt(sqrt(eig[k])) : 0.0;
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < d; i++)
+        for (long long k = 0; k < d; k++)
+            W[i * d + k] *= eig[k];
+    multiplyMatricesTiled(W, W, out, d, 1, 0);
+    budgetFree(eig, d * sizeof(double));
+    budgetFree(W, bytes);
+}
+
+/* Copia densa (row-major) di rho, per i calcoli spettrali. */
+static double complex* denseCopy(DensityMatrix *rho) {
+    long long dim = 1LL << rho->numQubits;
+    double complex *M = budgetMalloc(densityMatrixBytes(rho->numQubits, 0), "copia densa di rho");
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++)
+        for (long long j = 0; j < dim; j++)
+            M[i * dim + j] = getDensityElement(rho, i, j);
+    return M;
+}
+
+/* -sum lambda log2 lambda sugli autovalori positivi. */
+static double entropyOfEigenvalues(const double *eigenvalues, long long d) {
+    double S = 0.0;
+    for (long long i = 0; i < d; i++) {
+        if (eigenvalues[i] > 1e-15) S -= eigenvalues[i] * log2(eigenvalues[i]);
+    }
+    return S;
+}
+
+double fidelityStates(QubitState *a, QubitState *b) {
+    TRACE_REQUIRE_AMPLITUDES(a, 0);
+    TRACE_REQUIRE_AMPLITUDES(b, 0);
+    long long dim = 1LL << a->numQubits;
+    double re = 0.0, im = 0.0;
+
+    #pragma omp parallel for reduction(+:re, im) schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        double complex v = conj(a->amplitudes[i]) * b->amplitudes[i];
+        re += creal(v);
+        im += cimag(v);
+    }
+    return re * re + im * im;
+}
+
+/* <psi| rho |psi> = sum_ij conj(psi_i) rho_ij psi_j, riga per riga. */
+double fidelityStateDensity(QubitState *psi, DensityMatrix *rho) {
+    TRACE_REQUIRE_AMPLITUDES(psi, 0);
+    long long dim = 1LL << rho->numQubits;
+    const double complex *a = psi->amplitudes;
+    double sum = 0.0;
+
+    #pragma omp parallel for reduction(+:sum) schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        double complex row = 0.0;
+        if (rho->packed) {
+            for (long long j = 0; j < dim; j++) row += getDensityElement(rho, i, j) * a[j];
+        } else {
+            const double complex *r = rho->matrix + i * dim;
+            for (long long j = 0; j < dim; j++) row += r[j] * a[j];
+        }
+        sum += creal(conj(a[i]) * row);
+    }
+    return sum;
+}
+
+/* Tr(A B) = sum_ij A_ij conj(B_ij) per matrici hermitiane, in un passaggio parallelo. */
+static double traceProductDensity(DensityMatrix *a, DensityMatrix *b) {
+    long long dim = 1LL << a->numQubits;
+    double sum = 0.0;
+
+    #pragma omp parallel for reduction(+:sum) schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        for (long long j = 0; j < dim; j++) {
+            sum += creal(getDensityElement(a, i, j) * conj(getDensityElement(b, i, j)));
+        }
+    }
+    return sum;
+}
+
+/* Uno stato è puro se Tr(rho^2) = 1: le metriche si riducono allora a Tr(A B). */
+static int isPureDensity(DensityMatrix *rho) {
+    return purityDensity(rho) > 1.0 - 1e-12;
+}
+
+double fidelityDensity(DensityMatrix *a, DensityMatrix *b) {
+    // Con A = |psi><psi| la fedeltà è <psi| B |psi> = Tr(A B)
+    if (isPureDensity(a) || isPureDensity(b)) {
+        return traceProductDensity(a, b);
+    }
+
+    long long dim = 1LL << a->numQubits;
+    double complex *A = denseCopy(a);
+    double complex *B = denseCopy(b);
+    size_t bytes = densityMatrixBytes(a->numQubits, 0);
+    double complex *sqrtA = budgetMalloc(bytes, "sqrt(A) in fidelityDensity");
+    double complex *T = budgetMalloc(bytes, "matrice temporanea in fidelityDensity");
+    double *eig = budgetMalloc(checkedBytes(dim, sizeof(double), "autovalori in fidelityDensity"),
+                               "autovalori in fidelityDensity");
+    hermitianSqrt(A, dim, sqrtA);
+
+    // A <- sqrt(A) B sqrt(A), passando per T = sqrt(A) B
+    multiplyMatricesTiled(sqrtA, B, T, dim, 0, 0);
+    multiplyMatricesTiled(T, sqrtA, A, dim, 0, 0);
+
+    hermitianEigenvalues(A, dim, eig);
+    double rootSum = 0.0;
+    for (long long i = 0; i < dim; i++) {
+        if (eig[i] > 0.0) rootSum += sqrt(eig[i]);
+    }
+
+    budgetFree(A, bytes);
+    budgetFree(B, bytes);
+    budgetFree(sqrtA, bytes);
+    budgetFree(T, bytes);
+    budgetFree(eig, dim * sizeof(double));
+    return rootSum * rootSum;
+}
+
+/* Tr(rho^2) = sum_ij |rho_ij|^2; nel formato compatto i termini fuori diagonale contano due volte. */
+double purityDensity(DensityMatrix *rho) {
+    long long dim = 1LL << rho->numQubits;
+    long long size = rho->packed ? dim * (dim + 1) / 2 : dim * dim;
+    const double complex *m = rho->matrix;
+    double sum = 0.0;
+
+    #pragma omp parallel for reduction(+:sum) schedule(static)
+    for (long long k = 0; k < size; k++) {
+        sum += creal(m[k]) * creal(m[k]) + cimag(m[k]) * cimag(m[k]);
+    }
+    if (rho->packed) {
+        double diag = 0.0;
+        for (long long i = 0; i < dim; i++) {
+            double v = creal(getDensityElement(rho, i, i));
+            diag += v * v;
+        }
+        sum = 2.0 * sum - diag;
+    }
+    return sum;
+}
+
+double traceDistanceStates(QubitState *a, QubitState *b) {
+    double F = fidelityStates(a, b);
+    return (F < 1.0) ? sqrt(1.0 - F) : 0.0;
+}
+
+double traceDistanceDensity(DensityMatrix *a, DensityMatrix *b) {
+    // Due stati puri: sqrt(1 - |<a|b>|^2), con |<a|b>|^2 = Tr(A B)
+    if (isPureDensity(a) && isPureDensity(b)) {
+        double F = traceProductDensity(a, b);
+        return (F < 1.0) ? sqrt(1.0 - F) : 0.0;
+    }
+
+    long long dim = 1LL << a->numQubits;
+    size_t bytes = densityMatrixBytes(a->numQubits, 0);
+    double complex *D = budgetMalloc(bytes, "differenza in traceDistanceDensity");
+    double *eig = budgetMalloc(checkedBytes(dim, sizeof(double), "autovalori in traceDistanceDensity"),
+                               "autovalori in traceDistanceDensity");
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++)
+        for (long long j = 0; j < dim; j++)
+            D[i * dim + j] = getDensityElement(a, i, j) - getDensityElement(b, i, j);
+
+    hermitianEigen(D, dim, eig, NULL);
+    double sum = 0.0;
+    for (long long i = 0; i < dim; i++) sum += fabs(eig[i]);
+
+    budgetFree(D, bytes);
+    budgetFree(eig, dim * sizeof(double));
+    return 0.5 * sum;
+}
+
+double vonNeumannEntropy(DensityMatrix *rho) {
+    if (isPureDensity(rho)) return 0.0;
+
+    long long dim = 1LL << rho->numQubits;
+    double complex *M = denseCopy(rho);
+    double *eig = budgetMalloc(checkedBytes(dim, sizeof(double), "autovalori in vonNeumannEntropy"),
+                               "autovalori in vonNeumannEntropy");
+    hermitianEigen(M, dim, eig, NULL);
+    double S = entropyOfEigenvalues(eig, dim);
+    budgetFree(eig, dim * sizeof(double));
+    budgetFree(M, densityMatrixBytes(rho->numQubits, 0));
+    return S;
+}
+
+/* La matrice ridotta più piccola delle due ha lo stesso spettro non nullo:
+   si diagonalizza quella del lato con meno qubit. */
+double entanglementEntropy(QubitState *state, long long keepMask) {
+    long long fullMask = (1LL << state->numQubits) - 1;
+    keepMask &= fullMask;
+    if (__builtin_popcountll(keepMask) > state->numQubits / 2) {
+        keepMask = fullMask & ~keepMask;
+    }
+    DensityMatrix *reduced = reducedDensityFromState(state, keepMask);
+    double S = vonNeumannEntropy(reduced);
+    freeDensityMatrix(reduced);
+    return S;
+}
+
+double reducedEntropyDensity(DensityMatrix *rho, long long keepMask) {
+    DensityMatrix *reduced = partialTrace(rho, keepMask);
+    double S = vonNeumannEntropy(reduced);
+    freeDensityMatrix(reduced);
+    return S;
+}
@@ -0,0 +1,47 @@
+#ifndef QUANTUM_METRICS_H
+#define QUANTUM_METRICS_H
+
+#include <complex.h>
+#include "quantum_sim.h"
+#include "quantum_density.h"
+
+// Metriche di qualità dello stato per confrontare simulazioni rumorose e ideali.
+// Fedeltà e purezza si calcolano con riduzioni parallele sugli elementi, senza copie.
+// Le decomposizioni spettrali servono solo per le metriche che le richiedono e vengono
+// evitate quando uno stato è puro (Tr(rho^2) = 1): la fedeltà con uno stato puro, la distanza
+// di traccia tra stati puri e la loro entropia costano O(d^2). Negli altri casi distanza di
+// traccia, fedeltà ed entropia di matrici complete restano O(d^3) in tempo e O(d^2) in
+// memoria (d = 2^numQubits), da usare quindi fuori dai cicli di simulazione; l'entropia di
+// entanglement diagonalizza soltanto la matrice ridotta del lato più piccolo.
+
+// Autovalori (in ordine crescente) di una matrice hermitiana d x d in formato row-major:
+// riduzione di Householder a tridiagonale e metodo QL implicito, O(d^3) con aggiornamenti paralleli
+void hermitianEigenvalues(const double complex *H, long long d, double *eigenvalues);
+
+// Fedeltà tra stati puri |<a|b>|^2
+double fidelityStates(QubitState *a, QubitState *b);
+
+// Fedeltà tra uno stato puro e una matrice densità: <psi| rho |psi>
+double fidelityStateDensity(QubitState *psi, DensityMatrix *rho);
+
+// Fedeltà di Uhlmann tra due matrici densità: (Tr sqrt(sqrt(A) B sqrt(A)))^2
+double fidelityDensity(DensityMatrix *a, DensityMatrix *b);
+
+// Purezza Tr(rho^2)
+double purityDensity(DensityMatrix *rho);
+
+// Distanza di traccia 1/2 ||A - B||_1; per due stati puri vale sqrt(1 - |<a|b>|^2)
+double traceDistanceStates(QubitState *a, QubitState *b);
+double traceDistanceDensity(DensityMatrix *a, DensityMatrix *b);
+
+// Entropia di von Neumann -Tr(rho log2 rho), in bit
+double vonNeumannEntropy(DensityMatrix *rho);
+
+// Entropia di entanglement della bipartizione (qubit in keepMask | resto):
+// entropia della matrice ridotta, calcolata senza costruire la matrice densità completa
+double entanglementEntropy(QubitState *state, long long keepMask);
+
+// Come sopra per uno stato misto: entropia della traccia parziale
+double reducedEntropyDensity(DensityMatrix *rho, long long keepMask);
+
+#endif // QUANTUM_METRICS_H
@@ -0,0 +1,277 @@
+// quantum_runner.c
+
+#include "quantum_runner.h"
+#include "quantum_sim.h"
+#include "quantum_memory.h"
+#include "qasm_to_c/qasm_stream.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <complex.h>
+
+int circuitHasTerminalMeasurements(const QuantumCircuit *circuit) {
+    int measured = 0;
+    for (int k = 0; k < circuit->numOps; k++) {
+        const GateOp *op = &circuit->ops[k];
+        if (op->condSize > 0 || op->type == GATE_RESET) return 0;
+        if (op->type == GATE_MEASURE) {
+            measured = 1;
+        } else if (measured && op->type != GATE_BARRIER) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Campiona numShots stati base dalle probabilità dello stato (somma cumulativa e ricerca
+ * binaria) e converte ciascuno nel valore del registro classico: il bit c vale il bit del
+ * qubit measuredQubit[c] (0 se measuredQubit[c] < 0, cioè se c non viene mai misurato).
+ */
+static void sampleTerminalShots(QubitState *state, const int *measuredQubit, int numClbits,
+                                long long numShots, long long *values) {
+    long long dim = 1LL << state->numQubits;
+    double *cumulative = budgetMalloc(dim * sizeof(double), "probabilità cumulative");
+    double total = 0.0;
+    for (long long i = 0; i < dim; i++) {
+        double complex a = state->amplitudes[i];
+        total += creal(a) * creal(a) + cimag(a) * cimag(a);
+        cumulative[i] = total;
+    }
+
+    for (long long s = 0; s < numShots; s++) {
+        double u = total * ((double)rand() / ((double)RAND_MAX + 1.0));
+        long long lo = 0, hi = dim - 1;
+        while (lo < hi) {
+            long long mid = lo + (hi - lo) / 2;
+            if (cumulative[mid] > u) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        long long value = 0;
+        for (int c = 0; c < numClbits; c++) {
+            if (measuredQubit[c] >= 0 && ((lo >> measuredQubit[c]) & 1)) value |= 1LL << c;
+        }
+        values[s] = value;
+    }
+
+    budgetFree(cumulative, dim * sizeof(double));
+}
+
+static int compareValues(const void *a, const void *b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+ShotHistogram* runCircuitShots(QuantumCircuit *circuit, long long numShots) {
+    if (circuit->numClbits > 63) {
+        fprintf(stderr, "Errore: al massimo 63 bit classici (il circuito ne ha %d)\n", circuit->numClbits);
+        exit(1);
+    }
+    long long *values = malloc((numShots > 0 ? numShots : 1) * sizeof(long long));
+    int *clbits = malloc((circuit->numClbits > 0 ? circuit->numClbits : 1) * sizeof(int));
+    if (!values || !clbits) {
+        perror("Errore allocazione risultati delle esecuzioni");
+        exit(1);
+    }
+
+    QubitState *state = initializeState(circuit->numQubits);
+    if (circuitHasTerminalMeasurements(circuit)) {
+        for (int k = 0; k < circuit->numOps && circuit->ops[k].type != GATE_MEASURE; k++) {
+            applyGateOp(state, &circuit->ops[k], NULL);
+        }
+        // Le misure successive sullo stesso bit classico sovrascrivono le precedenti;
+        // clbits non serve nel campionamento e ospita la corrispondenza bit -> qubit
+        int *measuredQubit = clbits;
+        for (int c = 0; c < circuit->numClbits; c++) measuredQubit[c] = -1;
+        for (int k = 0; k < circuit->numOps; k++) {
+            const GateOp *op = &circuit->ops[k];
+            if (op->type == GATE_MEASURE) measuredQubit[op->cbit] = op->qubits[0];
+        }
+        sampleTerminalShots(state, measuredQubit, circuit->numClbits, numShots, values);
+    } else {
+        for (long long s = 0; s < numShots; s++) {
+            initializeStateTo(state, 0);
+            executeCircuit(circuit, state, NULL, clbits);
+            values[s] = classicalRegisterValue(clbits, 0, circuit->numClbits);
+        }
+    }
+    freeState(state);
+    free(clbits);
+
+    ShotHistogram *histogram = buildShotHistogram(values, numShots, circuit->numClbits);
+    free(values);
+    return histogram;
+}
+
+/* Raggruppa i valori ordinati in sequenze uguali. */
+ShotHistogram* buildShotHistogram(long long *values, long long numShots, int numClbits) {
+    qsort(values, numShots, sizeof(long long), compareValues);
+    ShotHistogram *histogram = malloc(sizeof(ShotHistogram));
+    if (!histogram) {
+        perror("Errore allocazione ShotHistogram");
+        exit(1);
+    }
+    histogram->numClbits = numClbits;
+    histogram->numShots = numShots;
+    histogram->numOutcomes = 0;
+    histogram->outcomes = malloc((numShots > 0 ? numShots : 1) * sizeof(ShotCount));
+    if (!histogram->outcomes) {
+        perror("Errore allocazione ShotHistogram");
+        exit(1);
+    }
+    for (long long s = 0; s < numShots; s++) {
+        if (s == 0 || values[s] != values[s - 1]) {
+            histogram->outcomes[histogram->numOutcomes].value = values[s];
+            histogram->outcomes[histogram->numOutcomes].count = 0;
+            histogram->numOutcomes++;
+        }
+        histogram->outcomes[histogram->numOutcomes - 1].count++;
+    }
+    return histogram;
+}
+
+void freeShotHistogram(ShotHistogram *histogram) {
+    if (histogram) {
+        free(histogram->outcomes);
+        free(histogram);
+    }
+}
+
+void printShotHistogram(const ShotHistogram *histogram) {
+    for (int k = 0; k < histogram->numOutcomes; k++) {
+        for (int b = histogram->numClbits - 1; b >= 0; b--) {
+            printf("%d", (int)((histogram->outcomes[k].value >> b) & 1));
+        }
+        printf(" %lld\n", histogram->outcomes[k].count);
+    }
+}
+
+/*
+ * Stato di un'esecuzione in streaming. Con deferMeasurements le misure finali non vengono
+ * eseguite: measuredQubit[c] ricorda l'ultimo qubit misurato nel bit classico c, e lo stato
+ * resta quello prima delle misure. Se dopo una misura arriva un gate (o compaiono reset o
+ * condizioni) le misure rinviate vengono eseguite in quel punto, equivalente perché fra loro
+ * e il gate ci sono solo altre misure e barriere, e il resto del file viene eseguito normalmente.
+ */
+typedef struct {
+    QubitState *state;
+    int numQubits;
+    int *clbits;
+    int numClbits;
+    int deferMeasurements;
+    int measured;
+    int *measuredQubit;
+} StreamExecution;
+
+/* Esegue le misure rinviate e torna all'esecuzione normale. */
+static void flushDeferredMeasurements(StreamExecution *ex) {
+    for (int c = 0; c < ex->numClbits; c++) {
+        if (ex->measuredQubit[c] >= 0) ex->clbits[c] = measure(ex->state, ex->measuredQubit[c]).result;
+    }
+    ex->deferMeasurements = 0;
+}
+
+/* Esegue un blocco letto in streaming; lo stato viene allocato al primo gate. */
+static void executeChunk(const QuantumCircuit *chunk, void *context) {
+    StreamExecution *ex = context;
+    ex->numQubits = chunk->numQubits;
+    if (chunk->numClbits > ex->numClbits) {
+        ex->clbits = realloc(ex->clbits, chunk->numClbits * sizeof(int));
+        ex->measuredQubit = realloc(ex->measuredQubit, chunk->numClbits * sizeof(int));
+        if (!ex->clbits || !ex->measuredQubit) {
+            perror("Errore allocazione bit classici");
+            exit(1);
+        }
+        for (int k = ex->numClbits; k < chunk->numClbits; k++) {
+            ex->clbits[k] = 0;
+            ex->measuredQubit[k] = -1;
+        }
+        ex->numClbits = chunk->numClbits;
+    }
+    if (chunk->numOps == 0) return;
+    if (!ex->state) {
+        ex->state = initializeState(chunk->numQubits);
+    } else if (ex->state->numQubits != chunk->numQubits) {
+        fprintf(stderr, "Errore: in streaming tutti i qreg devono precedere il primo gate\n");
+        exit(1);
+    }
+    int k = 0;
+    while (ex->deferMeasurements && k < chunk->numOps) {
+        const GateOp *op = &chunk->ops[k];
+        if (op->condSize > 0 || op->type == GATE_RESET ||
+            (ex->measured && op->type != GATE_MEASURE && op->type != GATE_BARRIER)) {
+            flushDeferredMeasurements(ex);
+            break;
+        }
+        if (op->type == GATE_MEASURE) {
+            ex->measuredQubit[op->cbit] = op->qubits[0];
+            ex->measured = 1;
+        } else {
+            applyGateOp(ex->state, op, NULL);
+        }
+        k++;
+    }
+    if (k < chunk->numOps) {
+        executeOps(chunk->ops + k, chunk->numOps - k, ex->state, NULL, ex->clbits);
+    }
+}
+
+QubitState* runQasmFileStreaming(const char *filename, int **clbits, int *numClbits) {
+    StreamExecution ex = {NULL, 0, NULL, 0, 0, 0, NULL};
+    streamQASMFile(filename, executeChunk, &ex);
+    if (!ex.state) {
+        ex.state = initializeState(ex.numQubits);
+    }
+    free(ex.measuredQubit);
+    *clbits = ex.clbits;
+    *numClbits = ex.numClbits;
+    return ex.state;
+}
+
+ShotHistogram* runQasmFileStreamingShots(const char *filename, long long numShots, QubitState **finalState) {
+    StreamExecution ex = {NULL, 0, NULL, 0, 1, 0, NULL};
+    streamQASMFile(filename, executeChunk, &ex);
+    if (!ex.state) {
+        ex.state = initializeState(ex.numQubits);
+    }
+    if (ex.numClbits == 0) {
+        free(ex.clbits);
+        free(ex.measuredQubit);
+        *finalState = ex.state;
+        return NULL;
+    }
+    if (ex.numClbits > 63) {
+        fprintf(stderr, "Errore: al massimo 63 bit classici (il circuito ne ha %d)\n", ex.numClbits);
+        exit(1);
+    }
+    long long *values = malloc(numShots * sizeof(long long));
+    if (!values) {
+        perror("Errore allocazione risultati delle esecuzioni");
+        exit(1);
+    }
+
+    if (ex.deferMeasurements) {
+        // Misure solo finali: un'unica lettura del file, poi campionamento dello stato
+        sampleTerminalShots(ex.state, ex.measuredQubit, ex.numClbits, numShots, values);
+    } else {
+        // La prima lettura vale come prima esecuzione; le altre rileggono il file
+        values[0] = classicalRegisterValue(ex.clbits, 0, ex.numClbits);
+        for (long long s = 1; s < numShots; s++) {
+            int *clbits, numClbits;
+            QubitState *state = runQasmFileStreaming(filename, &clbits, &numClbits);
+            values[s] = classicalRegisterValue(clbits, 0, numClbits);
+            free(clbits);
+            freeState(state);
+        }
+    }
+    freeState(ex.state);
+    free(ex.clbits);
+    free(ex.measuredQubit);
+
+    ShotHistogram *histogram = buildShotHistogram(values, numShots, ex.numClbits);
+    free(values);
+    *finalState = NULL;
+    return histogram;
+}
@@ -0,0 +1,52 @@
+#ifndef QUANTUM_RUNNER_H
+#define QUANTUM_RUNNER_H
+
+#include "quantum_circuit.h"  // Per QuantumCircuit
+
+// Esecuzione ripetuta di un circuito con statistica dei bit classici (modalità "run").
+
+// Numero di occorrenze di un valore del registro classico (bit c[0] meno significativo)
+typedef struct {
+    long long value;
+    long long count;
+} ShotCount;
+
+typedef struct {
+    int numClbits;
+    long long numShots;
+    int numOutcomes;
+    ShotCount *outcomes;   // In ordine crescente di valore
+} ShotHistogram;
+
+// Restituisce 1 se le misure stanno tutte in fondo al circuito (seguite solo da altre misure
+// o barriere) e non ci sono reset né condizioni: in tal caso il risultato di ogni esecuzione
+// si ottiene campionando lo stato finale, senza ripetere la simulazione.
+int circuitHasTerminalMeasurements(const QuantumCircuit *circuit);
+
+// Esegue numShots volte il circuito partendo da |0...0> (circuit->numClbits <= 63).
+// Con misure solo finali la parte unitaria viene simulata una volta e i risultati campionati
+// dalle probabilità finali; altrimenti ogni esecuzione ripete la simulazione con executeCircuit.
+ShotHistogram* runCircuitShots(QuantumCircuit *circuit, long long numShots);
+void freeShotHistogram(ShotHistogram *histogram);
+
+// Istogramma dei valori del registro classico di numShots esecuzioni (values viene ordinato)
+ShotHistogram* buildShotHistogram(long long *values, long long numShots, int numClbits);
+
+// Esegue una volta il file QASM partendo da |0...0>, leggendolo in streaming (vedi
+// qasm_stream.h): il circuito non viene mai tenuto tutto in memoria e l'analisi del blocco
+// successivo procede mentre quello corrente viene simulato. Tutti i qreg devono precedere
+// il primo gate. Restituisce lo stato finale; in *clbits viene allocato (da liberare con free)
+// il vettore dei *numClbits bit classici.
+QubitState* runQasmFileStreaming(const char *filename, int **clbits, int *numClbits);
+
+// Come runCircuitShots per un file QASM letto in streaming. Con misure solo finali il file
+// viene letto e simulato una volta sola e i numShots risultati vengono campionati dallo stato
+// finale; altrimenti la prima lettura vale come prima esecuzione e ciascuna delle successive
+// rilegge il file. Se il circuito non ha bit classici restituisce NULL e lo stato finale
+// in *finalState (da liberare con freeState).
+ShotHistogram* runQasmFileStreamingShots(const char *filename, long long numShots, QubitState **finalState);
+
+// Stampa una riga "c[n-1]...c[0] conteggio" per ogni risultato osservato
+void printShotHistogram(const ShotHistogram *histogram);
+
+#endif // QUANTUM_RUNNER_H
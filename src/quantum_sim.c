@@ -17,6 +17,8 @@
  */
 
 #include "quantum_sim.h"
+#include "quantum_memory.h"
+#include "quantum_trace.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
@@ -30,7 +32,11 @@
 /**
  * Inizializza lo stato quantistico a uno stato di base specifico.
  */
-void initializeStateTo(QubitState *state, int index) {
+void initializeStateTo(QubitState *state, long long index) {
+    if (gateTraceActive) {
+        traceBasisState(state, index);
+        if (gateTraceDryRun) return;
+    }
     long long dim = 1LL << state->numQubits;
     for (long long i = 0; i < dim; i++) {
         state->amplitudes[i] = 0.0 + 0.0 * I;
@@ -42,6 +48,7 @@ void initializeStateTo(QubitState *state, int index) {
  * Stampa lo stato quantistico completo del sistema.
  */
 void printState(QubitState *state) {
+    if (gateTraceDryRun) return;   // In dry-run non ci sono ampiezze
     long long dim = 1LL << state->numQubits;
     for (long long i = 0; i < dim; i++) {
         printf("Stato %lld: %f + %fi | ", i, creal(state->amplitudes[i]), cimag(state->amplitudes[i]));
@@ -58,9 +65,19 @@ void printState(QubitState *state) {
  */
 QubitState* initializeState(int numQubits) {
     QubitState *state = (QubitState *)malloc(sizeof(QubitState));
+    if (!state) {
+        perror("Errore allocazione QubitState");
+        exit(1);
+    }
     state->numQubits = numQubits;
-    long long dim = 1LL << numQubits;
-    state->amplitudes = (double complex *)calloc(dim, sizeof(double complex));
+    if (gateTraceActive) {
+        traceStateCreated(state);
+        if (gateTraceDryRun) {
+            state->amplitudes = NULL;   // Le ampiezze non vengono mai toccate
+            return state;
+        }
+    }
+    state->amplitudes = (double complex *)budgetCalloc(stateVectorBytes(numQubits), 1, "vettore di stato");
 
     // Imposta lo stato |0>^N
     state->amplitudes[0] = 1.0 + 0.0 * I;
@@ -72,6 +89,7 @@ QubitState* initializeState(int numQubits) {
  * Inizializza il qubit target nello stato |1> mantenendo lo stato degli altri qubit.
  */
 void initializeSingleQubitToOne(QubitState* state, int target) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_X, target, -1, -1, 0.0));
     long long dim = 1LL << state->numQubits;
 
     for (long long i = 0; i < dim; i++) {
@@ -81,132 +99,244 @@ void initializeSingleQubitToOne(QubitState* state, int target) {
             state->amplitudes[i] = 0.0 + 0.0 * I;
         }
     }
+    TRACE_GATE_END();
 }
 
 /**
  * Libera la memoria allocata per lo stato quantistico.
  */
 void freeState(QubitState *state) {
-    free(state->amplitudes);
+    if (gateTraceActive) {
+        traceStateFreed(state);
+    }
+    if (state->amplitudes) {
+        budgetFree(state->amplitudes, stateVectorBytes(state->numQubits));
+    }
     free(state);
 }
 
 /**
  * Applica un gate a un singolo qubit nello stato quantistico.
+ * Le ampiezze vengono aggiornate in place, una coppia (i, i | 2^target) alla volta:
+ * l'indice k = 0 ... dim/2 - 1 enumera le coppie inserendo un bit 0 in posizione target,
+ * così le iterazioni sono indipendenti e vengono divise tra i thread.
  */
 void applySingleQubitGate(QubitState *state, int target, double complex gate[2][2]) {
-    long long dim = 1LL << state->numQubits;
-    double complex *new_amplitudes = (double complex *)malloc(dim * sizeof(double complex));
-
-    for (long long i = 0; i < dim; i++) {
-        int bitValue = (i >> target) & 1;
-        long long j = i ^ (1LL << target);
-
-        if (bitValue == 0) {
-            new_amplitudes[i] = gate[0][0] * state->amplitudes[i] + gate[0][1] * state->amplitudes[j];
-        } else {
-            new_amplitudes[i] = gate[1][0] * state->amplitudes[j] + gate[1][1] * state->amplitudes[i];
-        }
+    TRACE_GATE_BEGIN(state, traceSingleQubitMatrix(target, gate));
+    long long half = 1LL << (state->numQubits - 1);
+    long long step = 1LL << target;
+    double complex g00 = gate[0][0], g01 = gate[0][1];
+    double complex g10 = gate[1][0], g11 = gate[1][1];
+
+    #pragma omp parallel for schedule(static)
+    for (long long k = 0; k < half; k++) {
+        long long i = ((k >> target) << (target + 1)) | (k & (step - 1));
+        long long j = i | step;
+        double complex a0 = state->amplitudes[i];
+        double complex a1 = state->amplitudes[j];
+        state->amplitudes[i] = g00 * a0 + g01 * a1;
+        state->amplitudes[j] = g10 * a0 + g11 * a1;
     }
+    TRACE_GATE_END();
+}
 
-    for (long long i = 0; i < dim; i++) {
-        state->amplitudes[i] = new_amplitudes[i];
+/**
+ * Applica un gate arbitrario a 2 qubit (matrice 4x4) con indice locale
+ * a = bit(qubit0) + 2 * bit(qubit1), in place sui quartetti di ampiezze.
+ */
+void applyTwoQubitGate(QubitState *state, int qubit0, int qubit1, double complex gate[4][4]) {
+    TRACE_GATE_BEGIN(state, traceTwoQubitMatrix(qubit0, qubit1, gate));
+    long long quarter = 1LL << (state->numQubits - 2);
+    int lo = (qubit0 < qubit1) ? qubit0 : qubit1;
+    int hi = (qubit0 < qubit1) ? qubit1 : qubit0;
+    long long m0 = 1LL << qubit0;
+    long long m1 = 1LL << qubit1;
+
+    #pragma omp parallel for schedule(static)
+    for (long long k = 0; k < quarter; k++) {
+        // Inserisce due bit 0 nelle posizioni lo e hi
+        long long i = ((k >> lo) << (lo + 1)) | (k & ((1LL << lo) - 1));
+        i = ((i >> hi) << (hi + 1)) | (i & ((1LL << hi) - 1));
+        long long idx[4] = { i, i | m0, i | m1, i | m0 | m1 };
+        double complex a[4];
+        for (int r = 0; r < 4; r++) {
+            a[r] = state->amplitudes[idx[r]];
+        }
+        for (int r = 0; r < 4; r++) {
+            state->amplitudes[idx[r]] = gate[r][0] * a[0] + gate[r][1] * a[1]
+                                      + gate[r][2] * a[2] + gate[r][3] * a[3];
+        }
     }
-
-    free(new_amplitudes);
+    TRACE_GATE_END();
 }
 
 void applyHadamard(QubitState *state, int target) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_H, target, -1, -1, 0.0));
     double complex H[2][2] = {
         {1.0 / sqrt(2.0), 1.0 / sqrt(2.0)},
         {1.0 / sqrt(2.0), -1.0 / sqrt(2.0)}
     };
     applySingleQubitGate(state, target, H);
+    TRACE_GATE_END();
 }
 
 void applyX(QubitState *state, int target) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_X, target, -1, -1, 0.0));
     double complex X[2][2] = {
         {0, 1},
         {1, 0}
     };
     applySingleQubitGate(state, target, X);
+    TRACE_GATE_END();
 }
 
 void applyY(QubitState *state, int target) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_Y, target, -1, -1, 0.0));
     double complex Y_GATE[2][2] = {
         {0, -I},
         {I, 0}
     };
     applySingleQubitGate(state, target, Y_GATE);
+    TRACE_GATE_END();
 }
 
 void applyZ(QubitState *state, int target) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_Z, target, -1, -1, 0.0));
     double complex Z[2][2] = {
         {1, 0},
         {0, -1}
     };
     applySingleQubitGate(state, target, Z);
+    TRACE_GATE_END();
 }
 
 void applyT(QubitState *state, int target) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_T, target, -1, -1, 0.0));
     double complex T[2][2] = {
         {1, 0},
         {0, cexp(I * M_PI / 4.0)}
     };
     applySingleQubitGate(state, target, T);
+    TRACE_GATE_END();
 }
 
 void applyTdag(QubitState *state, int target) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_TDG, target, -1, -1, 0.0));
     double complex Tdag[2][2] = {
         {1, 0},
         {0, cexp(-I * M_PI / 4.0)}
     };
     applySingleQubitGate(state, target, Tdag);
+    TRACE_GATE_END();
 }
 
 void applyS(QubitState *state, int target) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_S, target, -1, -1, 0.0));
     double complex S[2][2] = {
         {1, 0},
         {0, I}
     };
     applySingleQubitGate(state, target, S);
+    TRACE_GATE_END();
+}
+
+/**
+ * Rotazione di un angolo theta attorno all'asse X: RX(theta) = exp(-i theta X / 2).
+ */
+void applyRX(QubitState *state, int target, double theta) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_RX, target, -1, -1, theta));
+    double c = cos(theta / 2.0);
+    double s = sin(theta / 2.0);
+    double complex RX[2][2] = {
+        {c, -I * s},
+        {-I * s, c}
+    };
+    applySingleQubitGate(state, target, RX);
+    TRACE_GATE_END();
+}
+
+/**
+ * Rotazione di un angolo theta attorno all'asse Y: RY(theta) = exp(-i theta Y / 2).
+ */
+void applyRY(QubitState *state, int target, double theta) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_RY, target, -1, -1, theta));
+    double c = cos(theta / 2.0);
+    double s = sin(theta / 2.0);
+    double complex RY[2][2] = {
+        {c, -s},
+        {s, c}
+    };
+    applySingleQubitGate(state, target, RY);
+    TRACE_GATE_END();
+}
+
+/**
+ * Rotazione di un angolo theta attorno all'asse Z: RZ(theta) = exp(-i theta Z / 2).
+ */
+void applyRZ(QubitState *state, int target, double theta) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_RZ, target, -1, -1, theta));
+    double complex RZ[2][2] = {
+        {cexp(-I * theta / 2.0), 0},
+        {0, cexp(I * theta / 2.0)}
+    };
+    applySingleQubitGate(state, target, RZ);
+    TRACE_GATE_END();
 }
 
 /**
  * Applica un gate CNOT al sistema quantistico.
+ * Le coppie di ampiezze con controllo a 1 vengono scambiate in place.
  */
 void applyCNOT(QubitState *state, int control, int target) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_CNOT, control, target, -1, 0.0));
     long long dim = 1LL << state->numQubits;
-    double complex *new_amplitudes = (double complex *)malloc(dim * sizeof(double complex));
-
-    for (long long i = 0; i < dim; i++) {
-        new_amplitudes[i] = state->amplitudes[i];
-    }
+    long long tmask = 1LL << target;
 
+    #pragma omp parallel for schedule(static)
     for (long long i = 0; i < dim; i++) {
         int control_bit = (i >> control) & 1;
-        int target_bit = (i >> target) & 1;
 
-        if (control_bit == 1) {
-            long long j = i ^ (1LL << target);
-            new_amplitudes[i] = state->amplitudes[j];
-            new_amplitudes[j] = state->amplitudes[i];
+        // Ogni coppia viene scambiata una sola volta, partendo dall'indice con target a 0
+        if (control_bit == 1 && (i & tmask) == 0) {
+            long long j = i | tmask;
+            double complex tmp = state->amplitudes[i];
+            state->amplitudes[i] = state->amplitudes[j];
+            state->amplitudes[j] = tmp;
         }
     }
+    TRACE_GATE_END();
+}
+
+/**
+ * Scambia due qubit: le ampiezze con i due bit diversi vengono scambiate a coppie,
+ * ciascuna una sola volta (dall'indice con qubit1 = 1 e qubit2 = 0).
+ */
+void applySwap(QubitState *state, int qubit1, int qubit2) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_SWAP, qubit1, qubit2, -1, 0.0));
+    long long dim = 1LL << state->numQubits;
+    long long m1 = 1LL << qubit1;
+    long long m2 = 1LL << qubit2;
 
+    #pragma omp parallel for schedule(static)
     for (long long i = 0; i < dim; i++) {
-        state->amplitudes[i] = new_amplitudes[i];
+        if ((i & m1) && !(i & m2)) {
+            long long j = i ^ m1 ^ m2;
+            double complex tmp = state->amplitudes[i];
+            state->amplitudes[i] = state->amplitudes[j];
+            state->amplitudes[j] = tmp;
+        }
     }
-
-    free(new_amplitudes);
+    TRACE_GATE_END();
 }
 
 /**
  * Applica un gate Controlled-Z (CZ) al sistema quantistico.
  */
 void applyCZ(QubitState *state, int control, int target) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_CZ, control, target, -1, 0.0));
     long long dim = 1LL << state->numQubits; // Dimensione dello spazio di Hilbert
 
+    #pragma omp parallel for schedule(static)
     for (long long i = 0; i < dim; i++) {
         int control_bit = (i >> control) & 1; // Estrae il valore del qubit di controllo
         int target_bit = (i >> target) & 1;   // Estrae il valore del qubit target
@@ -216,12 +346,15 @@ void applyCZ(QubitState *state, int control, int target) {
             state->amplitudes[i] *= -1; // Inversione del segno dell'ampiezza
         }
     }
+    TRACE_GATE_END();
 }
 
 
 void applyCPhaseShift(QubitState *state, int control, int target, double complex phase) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_CPHASE, control, target, -1, carg(phase)));
     long long dim = 1LL << state->numQubits;
 
+    #pragma omp parallel for schedule(static)
     for (long long i = 0; i < dim; i++) {
         int control_bit = (i >> control) & 1;
         int target_bit = (i >> target) & 1;
@@ -230,12 +363,23 @@ void applyCPhaseShift(QubitState *state, int control, int target, double complex
             state->amplitudes[i] *= phase;
         }
     }
+    TRACE_GATE_END();
 }
 
 /**
  * Misura il valore di un qubit specificato nello stato quantistico e collassa il sistema.
  */
 MeasurementResult measure(QubitState *state, int qubit) {
+    if (gateTraceActive) {
+        if (gateTraceDepth == 0) {
+            GateOp traceOp = traceGateOp(GATE_MEASURE, qubit, -1, -1, 0.0);
+            traceRecordOp(state, &traceOp);
+        }
+        if (gateTraceDryRun) {
+            MeasurementResult zero = {1.0, 0.0, 0};
+            return zero;
+        }
+    }
     long long dim = 1LL << state->numQubits;
     double prob0 = 0.0;
 
@@ -282,6 +426,22 @@ MeasurementResult measure(QubitState *state, int qubit) {
  * Esegue una misura su tutti i qubit del sistema e collassa lo stato.
  */
 int* measure_all(QubitState *state) {
+    if (gateTraceActive) {
+        if (gateTraceDepth == 0) {
+            for (int q = 0; q < state->numQubits; q++) {
+                GateOp traceOp = traceGateOp(GATE_MEASURE, q, -1, -1, 0.0);
+                traceRecordOp(state, &traceOp);
+            }
+        }
+        if (gateTraceDryRun) {
+            int *zeros = (int*)calloc(state->numQubits > 0 ? state->numQubits : 1, sizeof(int));
+            if (!zeros) {
+                perror("Errore allocazione in measure_all");
+                exit(1);
+            }
+            return zeros;
+        }
+    }
     long long dim = 1LL << state->numQubits;
     double cumulativeProb = 0.0;
     double randNum = (double)rand() / RAND_MAX;
@@ -296,6 +456,10 @@ int* measure_all(QubitState *state) {
     }
 
     int* results = (int*)malloc(state->numQubits * sizeof(int));
+    if (!results) {
+        perror("Errore allocazione in measure_all");
+        exit(1);
+    }
     for (int i = 0; i < state->numQubits; i++) {
         results[i] = (collapse_index >> i) & 1;
     }
@@ -317,6 +481,7 @@ QubitAmplitudes getQubitAmplitudes(QubitState* state, int target) {
     QubitAmplitudes result;
     result.amplitude0 = 0.0 + 0.0 * I;
     result.amplitude1 = 0.0 + 0.0 * I;
+    if (gateTraceDryRun) return result;
 
     for (long long i = 0; i < dim; i++) {
         if (((i >> target) & 1) == 0) {
@@ -337,6 +502,7 @@ void printQubitAmplitudes(QubitAmplitudes amplitudes) {
 //------------------ 3 qubit gates ---------------------------//
 
 void applyToffoli(QubitState* state, int control1, int control2, int target) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_TOFFOLI, control1, control2, target, 0.0));
     applyHadamard(state, target);
     applyCNOT(state, control2, target);
     applyTdag(state, target);
@@ -353,17 +519,18 @@ void applyToffoli(QubitState* state, int control1, int control2, int target) {
     applyT(state, control1);
     applyTdag(state, control2);
     applyCNOT(state, control1, control2);
+    TRACE_GATE_END();
 }
 
 
 
 void applyFredkin(QubitState* state, int control, int target1, int target2) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_CSWAP, control, target1, target2, 0.0));
+    // SWAP controllato = CNOT(t2, t1) CCX(c, t1, t2) CNOT(t2, t1)
+    applyCNOT(state, target2, target1);
     applyToffoli(state, control, target1, target2);
-    applyCNOT(state, target1, target2);
-    applyToffoli(state, control, target1, target2);
-    applyCNOT(state, target1, target2);
-    applyToffoli(state, control, target1, target2);
-    applyCNOT(state, target1, target2);
+    applyCNOT(state, target2, target1);
+    TRACE_GATE_END();
 }
 
 /**
@@ -371,6 +538,7 @@ void applyFredkin(QubitState* state, int control, int target1, int target2) {
  * Questo gate inverte il segno dello stato target solo se entrambi i qubit di controllo sono nello stato |1⟩.
  */
 void applyCCZ(QubitState* state, int control1, int control2, int target) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_CCZ, control1, control2, target, 0.0));
     // Passo 1: Applica Hadamard al qubit target
     applyHadamard(state, target);
 
@@ -379,6 +547,7 @@ void applyCCZ(QubitState* state, int control1, int control2, int target) {
 
     // Passo 3: Applica Hadamard al qubit target (ripristino)
     applyHadamard(state, target);
+    TRACE_GATE_END();
 }
 
 
@@ -404,11 +573,15 @@ void applyCCPhase(QubitState* state, int control1, int control2, int target, dou
 }
 
 void applyPhase(QubitState* state, int qubit, double phase) {
+    TRACE_GATE_BEGIN(state, traceGateOp(GATE_PHASE, qubit, -1, -1, phase));
     long long dim = 1LL << state->numQubits;
+    double complex factor = cexp(I * phase);
 
+    #pragma omp parallel for schedule(static)
     for (long long i = 0; i < dim; i++) {
         if (((i >> qubit) & 1) == 1) {
-            state->amplitudes[i] *= cexp(I * phase);
+            state->amplitudes[i] *= factor;
         }
     }
+    TRACE_GATE_END();
 }
@@ -40,7 +40,7 @@ typedef struct {
 } QubitAmplitudes;
 
 QubitState* initializeState(int numQubits);
-void initializeStateTo(QubitState *state, int index);
+void initializeStateTo(QubitState *state, long long index);
 void initializeSingleQubitToOne(QubitState *state, int targetQubit);
 void freeState(QubitState *state);
 void printState(QubitState *state);
@@ -54,9 +54,16 @@ void applyTdag(QubitState *state, int target);
 void applyS(QubitState *state, int target);
 void applyCNOT(QubitState *state, int control, int target);
 void applyCZ(QubitState *state, int control, int target);
+void applySwap(QubitState *state, int qubit1, int qubit2);
 void applyCPhaseShift(QubitState *state, int control, int target, double complex phase);
 void applyPhase(QubitState* state, int qubit, double phase);
 void applySingleQubitGate(QubitState *state, int target, double complex gate[2][2]);
+void applyTwoQubitGate(QubitState *state, int qubit0, int qubit1, double complex gate[4][4]);
+
+// Gate di rotazione parametrici: R_P(theta) = exp(-i theta P / 2)
+void applyRX(QubitState *state, int target, double theta);
+void applyRY(QubitState *state, int target, double theta);
+void applyRZ(QubitState *state, int target, double theta);
 
 // Nuove funzioni a 3-qubit
 void applyFredkin(QubitState* state, int control, int target1, int target2);
@@ -0,0 +1,279 @@
+// quantum_trace.c
+
+#include "quantum_trace.h"
+#include "quantum_binary.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+int gateTraceActive = 0;
+int gateTraceDryRun = 0;
+int gateTraceDepth = 0;
+
+static const char *traceFilename = NULL;
+static BinaryWriter *traceWriter = NULL;   // Uscita binaria
+static FILE *traceQasmBody = NULL;         // Uscita QASM: operazioni, copiate dopo i registri
+
+static GateOp traceBuffer[TRACE_BUFFER_OPS];
+static int traceBuffered = 0;
+static long long traceNumOps = 0;
+static int traceNumQubits = 0;
+static int traceNumClbits = 0;
+static const QubitState *tracedState = NULL;   // NULL: nessuno stato vivo seguito
+static int traceStateFresh = 0;               // 1: nessuna operazione sullo stato seguito
+static int traceWarned = 0;
+
+/* Scrive un'operazione in OpenQASM 2.0 (le operazioni registrate non hanno condizioni). */
+static void writeQasmOp(FILE *out, const GateOp *op) {
+    const int *q = op->qubits;
+    switch (op->type) {
+        case GATE_H:       fprintf(out, "h q[%d];\n", q[0]); break;
+        case GATE_X:       fprintf(out, "x q[%d];\n", q[0]); break;
+        case GATE_Y:       fprintf(out, "y q[%d];\n", q[0]); break;
+        case GATE_Z:       fprintf(out, "z q[%d];\n", q[0]); break;
+        case GATE_S:       fprintf(out, "s q[%d];\n", q[0]); break;
+        case GATE_T:       fprintf(out, "t q[%d];\n", q[0]); break;
+        case GATE_TDG:     fprintf(out, "tdg q[%d];\n", q[0]); break;
+        case GATE_RX:      fprintf(out, "rx(%.17g) q[%d];\n", op->angle, q[0]); break;
+        case GATE_RY:      fprintf(out, "ry(%.17g) q[%d];\n", op->angle, q[0]); break;
+        case GATE_RZ:      fprintf(out, "rz(%.17g) q[%d];\n", op->angle, q[0]); break;
+        case GATE_PHASE:   fprintf(out, "u1(%.17g) q[%d];\n", op->angle, q[0]); break;
+        case GATE_CNOT:    fprintf(out, "cx q[%d],q[%d];\n", q[0], q[1]); break;
+        case GATE_CZ:      fprintf(out, "cz q[%d],q[%d];\n", q[0], q[1]); break;
+        case GATE_CPHASE:  fprintf(out, "cu1(%.17g) q[%d],q[%d];\n", op->angle, q[0], q[1]); break;
+        case GATE_SWAP:    fprintf(out, "swap q[%d],q[%d];\n", q[0], q[1]); break;
+        case GATE_TOFFOLI: fprintf(out, "ccx q[%d],q[%d],q[%d];\n", q[0], q[1], q[2]); break;
+        // qelib1.inc non ha ccz: si usa H ccx H, come applyCCZ
+        case GATE_CCZ:     fprintf(out, "h q[%d];\nccx q[%d],q[%d],q[%d];\nh q[%d];\n",
+                                   q[2], q[0], q[1], q[2], q[2]); break;
+        case GATE_CSWAP:   fprintf(out, "cswap q[%d],q[%d],q[%d];\n", q[0], q[1], q[2]); break;
+        case GATE_U:       fprintf(out, "U(%.17g,%.17g,%.17g) q[%d];\n",
+                                   op->angle, op->phi, op->lambda, q[0]); break;
+        case GATE_CU:      fprintf(out, "cu(%.17g,%.17g,%.17g,%.17g) q[%d],q[%d];\n",
+                                   op->angle, op->phi, op->lambda, op->gamma, q[0], q[1]); break;
+        case GATE_MEASURE: fprintf(out, "measure q[%d] -> c[%d];\n", q[0], op->cbit); break;
+        case GATE_RESET:   fprintf(out, "reset q[%d];\n", q[0]); break;
+        case GATE_BARRIER: fprintf(out, "barrier q;\n"); break;
+        default: break;
+    }
+}
+
+static void flushTraceBuffer(void) {
+    if (traceWriter) {
+        binaryWriterAddOps(traceWriter, traceBuffer, traceBuffered);
+    } else {
+        for (int k = 0; k < traceBuffered; k++) {
+            writeQasmOp(traceQasmBody, &traceBuffer[k]);
+        }
+    }
+    traceBuffered = 0;
+}
+
+static void appendTraceOp(const GateOp *op) {
+    traceBuffer[traceBuffered++] = *op;
+    traceStateFresh = 0;
+    traceNumOps++;
+    if (traceBuffered == TRACE_BUFFER_OPS) {
+        flushTraceBuffer();
+    }
+}
+
+void startGateTrace(const char *filename, int dryRun) {
+    size_t length = strlen(filename);
+    traceFilename = filename;
+    if (length >= 5 && strcmp(filename + length - 5, ".qbin") == 0) {
+        traceWriter = createBinaryWriter(filename);
+    } else {
+        traceQasmBody = tmpfile();
+        if (!traceQasmBody) {
+            perror("Errore nella creazione del file temporaneo");
+            exit(1);
+        }
+    }
+    traceBuffered = 0;
+    traceNumOps = 0;
+    traceNumQubits = 0;
+    traceNumClbits = 0;
+    tracedState = NULL;
+    traceWarned = 0;
+    gateTraceDepth = 0;
+    gateTraceDryRun = dryRun;
+    gateTraceActive = 1;
+}
+
+long long stopGateTrace(void) {
+    flushTraceBuffer();
+    gateTraceActive = 0;
+    gateTraceDryRun = 0;
+
+    if (traceWriter) {
+        closeBinaryWriter(traceWriter, traceNumQubits, traceNumClbits);
+        traceWriter = NULL;
+    } else {
+        FILE *out = fopen(traceFilename, "w");
+        if (!out) {
+            perror("Errore nella creazione del file QASM");
+            exit(1);
+        }
+        fprintf(out, "OPENQASM 2.0;\ninclude \"qelib1.inc\";\n");
+        if (traceNumQubits > 0) fprintf(out, "qreg q[%d];\n", traceNumQubits);
+        if (traceNumClbits > 0) fprintf(out, "creg c[%d];\n", traceNumClbits);
+        rewind(traceQasmBody);
+        char buffer[1 << 16];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), traceQasmBody)) > 0) {
+            if (fwrite(buffer, 1, n, out) != n) break;
+        }
+        if (ferror(traceQasmBody) || ferror(out) || fclose(out) != 0) {
+            perror("Errore nella scrittura del file QASM");
+            exit(1);
+        }
+        fclose(traceQasmBody);
+        traceQasmBody = NULL;
+    }
+    tracedState = NULL;
+    return traceNumOps;
+}
+
+void traceStateCreated(const QubitState *state) {
+    if (tracedState) return;   // Un altro stato è già seguito
+    tracedState = state;
+    // Lo stato riprende da |0...0> dopo le operazioni dello stato precedente
+    if (traceNumOps > 0) {
+        for (int q = 0; q < state->numQubits; q++) {
+            GateOp reset = traceGateOp(GATE_RESET, q, -1, -1, 0.0);
+            appendTraceOp(&reset);
+        }
+    }
+    if (state->numQubits > traceNumQubits) {
+        traceNumQubits = state->numQubits;
+    }
+    traceStateFresh = 1;
+}
+
+void traceBasisState(const QubitState *state, long long index) {
+    if (!tracedState) {
+        traceStateCreated(state);
+    }
+    if (state != tracedState) return;
+    // Uno stato appena creato è già in |0...0>
+    if (!traceStateFresh) {
+        for (int q = 0; q < state->numQubits; q++) {
+            GateOp reset = traceGateOp(GATE_RESET, q, -1, -1, 0.0);
+            appendTraceOp(&reset);
+        }
+    }
+    for (int q = 0; q < state->numQubits; q++) {
+        if ((index >> q) & 1) {
+            GateOp x = traceGateOp(GATE_X, q, -1, -1, 0.0);
+            appendTraceOp(&x);
+        }
+    }
+}
+
+void traceStateFreed(const QubitState *state) {
+    if (state == tracedState) {
+        tracedState = NULL;
+    }
+}
+
+void traceRecordOp(const QubitState *state, const GateOp *op) {
+    if (op->type == GATE_NUM_TYPES) return;   // Operazione non rappresentabile
+    if (!tracedState) {
+        traceStateCreated(state);
+    }
+    if (state != tracedState) return;
+
+    if (op->type == GATE_MEASURE) {
+        GateOp m = *op;
+        m.cbit = traceNumClbits++;
+        appendTraceOp(&m);
+    } else {
+        appendTraceOp(op);
+    }
+}
+
+GateOp traceGateOp(GateType type, int qubit0, int qubit1, int qubit2, double angle) {
+    GateOp op = makeGateOp(type);
+    op.qubits[0] = qubit0;
+    op.qubits[1] = qubit1;
+    op.qubits[2] = qubit2;
+    op.angle = angle;
+    return op;
+}
+
+/* Scompone G = e^{i alpha} U(theta, phi, lambda) negli angoli di op e restituisce alpha. */
+static double decomposeU(double complex G[2][2], GateOp *op) {
+    const double eps = 1e-12;
+    double c = cabs(G[0][0]), s = cabs(G[1][0]);
+    double alpha = (c > eps) ? carg(G[0][0]) : carg(-G[0][1]);
+    op->angle = 2.0 * atan2(s, c);
+    op->phi = (s > eps) ? carg(G[1][0]) - alpha : 0.0;
+    op->lambda = (cabs(G[0][1]) > eps) ? carg(-G[0][1]) - alpha : carg(G[1][1]) - alpha - op->phi;
+    return alpha;
+}
+
+GateOp traceSingleQubitMatrix(int target, double complex G[2][2]) {
+    GateOp op = makeGateOp(GATE_U);
+    op.qubits[0] = target;
+    decomposeU(G, &op);
+    return op;
+}
+
+/* 1 se G è l'identità sugli indici locali con il bit 'mask' a 0. */
+static int isControlledBy(double complex G[4][4], int mask) {
+    for (int a = 0; a < 4; a++) {
+        for (int b = 0; b < 4; b++) {
+            if ((a & mask) && (b & mask)) continue;
+            if (cabs(G[a][b] - (a == b ? 1.0 : 0.0)) > 1e-12) return 0;
+        }
+    }
+    return 1;
+}
+
+GateOp traceTwoQubitMatrix(int qubit0, int qubit1, double complex G[4][4]) {
+    double complex U[2][2];
+    GateOp op = makeGateOp(GATE_CU);
+    if (isControlledBy(G, 1)) {
+        // Controllo su qubit0: il gate agisce sugli indici 1 e 3
+        for (int t = 0; t < 2; t++) {
+            for (int u = 0; u < 2; u++) {
+                U[t][u] = G[1 + 2 * t][1 + 2 * u];
+            }
+        }
+        op.qubits[0] = qubit0;
+        op.qubits[1] = qubit1;
+    } else if (isControlledBy(G, 2)) {
+        // Controllo su qubit1: il gate agisce sugli indici 2 e 3
+        for (int t = 0; t < 2; t++) {
+            for (int u = 0; u < 2; u++) {
+                U[t][u] = G[2 + t][2 + u];
+            }
+        }
+        op.qubits[0] = qubit1;
+        op.qubits[1] = qubit0;
+    } else {
+        if (!traceWarned) {
+            fprintf(stderr, "Attenzione: applyTwoQubitGate con una matrice non controllata non è "
+                            "rappresentabile, la traccia non è esatta\n");
+            traceWarned = 1;
+        }
+        return makeGateOp(GATE_NUM_TYPES);
+    }
+    op.gamma = decomposeU(U, &op);
+    return op;
+}
+
+void traceAmplitudeAccess(const QubitState *state, const char *function, int modifies) {
+    if (!state->amplitudes) {
+        fprintf(stderr, "Errore: %s usa le ampiezze dello stato, che in dry-run non vengono allocate\n",
+                function);
+        exit(1);
+    }
+    if (modifies && state == tracedState && gateTraceDepth == 0 && !traceWarned) {
+        fprintf(stderr, "Attenzione: %s non è rappresentabile come gate, la traccia non è esatta\n",
+                function);
+        traceWarned = 1;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef QUANTUM_TRACE_H
+#define QUANTUM_TRACE_H
+
+#include "quantum_sim.h"      // Per QubitState
+#include "quantum_circuit.h"  // Per GateOp
+
+// Registrazione dei gate eseguiti dal simulatore (modalità "trace").
+//
+// Durante la registrazione ogni chiamata alle funzioni di quantum_sim.h (apply*, measure,
+// measure_all, initializeStateTo, ...) viene aggiunta come GateOp a un buffer di dimensione
+// fissa, svuotato sul file di uscita quando è pieno: un circuito scritto in C con cicli,
+// variabili e funzioni viene catturato esattamente come è stato eseguito.
+// - Solo la chiamata più esterna viene registrata: applyToffoli non registra anche i CNOT e
+//   i T con cui è implementato. applyCCY e applyCCPhase, che non hanno un'operazione
+//   corrispondente, vengono registrati attraverso i gate che chiamano.
+// - Viene seguito un solo stato alla volta: il primo creato (o usato) durante la registrazione;
+//   dopo freeState il successivo initializeState riprende sugli stessi qubit, preceduto da
+//   un reset di tutti i qubit. Le operazioni su altri stati vivi vengono ignorate.
+// - Ogni misura scrive un nuovo bit classico (c[k] = k-esima misura).
+// - applySingleQubitGate viene registrato come U(theta, phi, lambda) a meno della fase
+//   globale; applyTwoQubitGate solo se la matrice è un gate controllato (su uno dei due
+//   qubit), altrimenti viene segnalato che la traccia non è esatta.
+// - Gli operatori di quantum_algorithms.h vengono registrati come la sequenza di gate
+//   equivalente, a meno della fase globale: la QFT con H, fasi controllate e swap; diffusore
+//   e oracoli con X e H attorno a fasi multi-controllate, scomposte in CNOT e CPHASE
+//   (2^k gate per k qubit: un oracolo su n qubit costa O(2^n) gate per indice marcato).
+// - In dry-run le ampiezze non vengono né allocate né aggiornate: le misure restituiscono
+//   sempre 0 e printState non stampa nulla. È utile per circuiti troppo grandi da simulare,
+//   purché il programma usi solo le funzioni di quantum_sim.h e quantum_algorithms.h e non
+//   dipenda dalle misure. Le altre funzioni che usano le ampiezze (canali delle traiettorie,
+//   matrici densità, metriche, valori attesi) terminano con un errore esplicito.
+// La registrazione non è prevista da più thread contemporaneamente.
+
+#define TRACE_BUFFER_OPS 4096
+
+// Inizia la registrazione verso 'filename': formato binario (quantum_binary.h) se il nome
+// termina con ".qbin", altrimenti OpenQASM 2.0
+void startGateTrace(const char *filename, int dryRun);
+// Termina la registrazione e completa il file; restituisce il numero di operazioni registrate
+long long stopGateTrace(void);
+
+// Stato usato dalle funzioni di quantum_sim.c
+extern int gateTraceActive;
+extern int gateTraceDryRun;
+extern int gateTraceDepth;
+
+void traceRecordOp(const QubitState *state, const GateOp *op);
+void traceStateCreated(const QubitState *state);
+void traceStateFreed(const QubitState *state);
+void traceBasisState(const QubitState *state, long long index);
+GateOp traceGateOp(GateType type, int qubit0, int qubit1, int qubit2, double angle);
+GateOp traceSingleQubitMatrix(int target, double complex G[2][2]);
+GateOp traceTwoQubitMatrix(int qubit0, int qubit1, double complex G[4][4]);
+void traceAmplitudeAccess(const QubitState *state, const char *function, int modifies);
+
+// All'inizio delle funzioni che usano direttamente le ampiezze senza un'operazione
+// registrabile: in dry-run termina con un errore; se 'modifies' e la funzione agisce sullo
+// stato seguito, segnala che la traccia non è esatta.
+#define TRACE_REQUIRE_AMPLITUDES(state, modifies)                       \
+    if (gateTraceActive) {                                              \
+        traceAmplitudeAccess((state), __func__, (modifies));            \
+    }
+
+// All'inizio di un gate: registra l'operazione 'makeOp' se la chiamata non è annidata in un
+// altro gate registrato; in dry-run la funzione termina subito. TRACE_GATE_END va messo
+// alla fine della funzione.
+#define TRACE_GATE_BEGIN(state, makeOp)                 \
+    if (gateTraceActive) {                              \
+        if (gateTraceDepth++ == 0) {                    \
+            GateOp traceOp = (makeOp);                  \
+            traceRecordOp((state), &traceOp);           \
+        }                                               \
+        if (gateTraceDryRun) {                          \
+            gateTraceDepth--;                           \
+            return;                                     \
+        }                                               \
+    }
+
+#define TRACE_GATE_END()                                \
+    if (gateTraceActive) {                              \
+        gateTraceDepth--;                               \
+    }
+
+#endif // QUANTUM_TRACE_H
@@ -0,0 +1,415 @@
+// quantum_trajectory.c
+
+#include "quantum_trajectory.h"
+#include "quantum_sim.h"
+#include "quantum_memory.h"
+#include "quantum_trace.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <complex.h>
+#include <math.h>
+
+/* Funzione di supporto: passo di splitmix64, usato solo per espandere il seme. */
+static unsigned long long splitmix64(unsigned long long *x) {
+    unsigned long long z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline unsigned long long rotl(unsigned long long x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+void seedTrajectoryRng(TrajectoryRng *rng, unsigned long long seed, unsigned long long stream) {
+    unsigned long long x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+    for (int k = 0; k < 4; k++) {
+        rng->s[k] = splitmix64(&x);
+    }
+}
+
+double trajectoryRandom(TrajectoryRng *rng) {
+    unsigned long long *s = rng->s;
+    unsigned long long result = rotl(s[1] * 5, 7) * 9;
+    unsigned long long t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    // 53 bit più significativi -> double in [0, 1)
+    return (double)(result >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Funzione di supporto: probabilità che il qubit valga 1. */
+static double probabilityOne(QubitState *state, int qubit) {
+    long long dim = 1LL << state->numQubits;
+    double prob1 = 0.0;
+
+    #pragma omp parallel for reduction(+:prob1) schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        if ((i >> qubit) & 1) {
+            double complex a = state->amplitudes[i];
+            prob1 += creal(a) * creal(a) + cimag(a) * cimag(a);
+        }
+    }
+    return prob1;
+}
+
+/* Dephasing: K0 = sqrt(1-p) I, K1 = sqrt(p) Z sono unitari a meno di un fattore,
+   quindi Z viene applicato con probabilità p indipendentemente dallo stato. */
+void applyDephasingTrajectory(QubitState *state, int targetQubit, double p, TrajectoryRng *rng) {
+    TRACE_REQUIRE_AMPLITUDES(state, 1);
+    if (trajectoryRandom(rng) < p) {
+        applyZ(state, targetQubit);
+    }
+}
+
+/* Depolarizzante: X, Y o Z ciascuno con probabilità p/4. */
+void applyDepolarizingTrajectory(QubitState *state, int targetQubit, double p, TrajectoryRng *rng) {
+    TRACE_REQUIRE_AMPLITUDES(state, 1);
+    double r = trajectoryRandom(rng);
+    if (r < p / 4) {
+        applyX(state, targetQubit);
+    } else if (r < p / 2) {
+        applyY(state, targetQubit);
+    } else if (r < 3 * p / 4) {
+        applyZ(state, targetQubit);
+    }
+}
+
+/* Ampiezza damping: il salto K1 = sqrt(gamma) |0><1| avviene con probabilità gamma * P(1);
+   altrimenti si applica K0 = diag(1, sqrt(1-gamma)). In entrambi i casi lo stato viene
+   rinormalizzato nello stesso passaggio. */
+void applyAmplitudeDampingTrajectory(QubitState *state, int targetQubit, double gamma, TrajectoryRng *rng) {
+    TRACE_REQUIRE_AMPLITUDES(state, 1);
+    long long dim = 1LL << state->numQubits;
+    long long mask = 1LL << targetQubit;
+    double prob1 = probabilityOne(state, targetQubit);
+    double pJump = gamma * prob1;
+
+    if (trajectoryRandom(rng) < pJump) {
+        double scale = 1.0 / sqrt(prob1);
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < dim; i++) {
+            if ((i & mask) == 0) {
+                state->amplitudes[i] = scale * state->amplitudes[i | mask];
+                state->amplitudes[i | mask] = 0.0;
+            }
+        }
+    } else {
+        double scale0 = 1.0 / sqrt(1.0 - pJump);
+        double scale1 = sqrt(1.0 - gamma) * scale0;
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < dim; i++) {
+            state->amplitudes[i] *= (i & mask) ? scale1 : scale0;
+        }
+    }
+}
+
+MeasurementResult measureTrajectory(QubitState *state, int qubit, TrajectoryRng *rng) {
+    TRACE_REQUIRE_AMPLITUDES(state, 1);
+    long long dim = 1LL << state->numQubits;
+    long long mask = 1LL << qubit;
+    double prob1 = probabilityOne(state, qubit);
+    int result = (trajectoryRandom(rng) < prob1) ? 1 : 0;
+    double scale = 1.0 / sqrt(result ? prob1 : 1.0 - prob1);
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        int bit = (i & mask) ? 1 : 0;
+        state->amplitudes[i] = (bit == result) ? scale * state->amplitudes[i] : 0.0;
+    }
+
+    MeasurementResult m_result;
+    m_result.prob0 = 1.0 - prob1;
+    m_result.prob1 = prob1;
+    m_result.result = result;
+    return m_result;
+}
+
+long long sampleBasisState(QubitState *state, TrajectoryRng *rng) {
+    TRACE_REQUIRE_AMPLITUDES(state, 0);
+    long long dim = 1LL << state->numQubits;
+    double r = trajectoryRandom(rng);
+    double cumulative = 0.0;
+    for (long long i = 0; i < dim; i++) {
+        double complex a = state->amplitudes[i];
+        cumulative += creal(a) * creal(a) + cimag(a) * cimag(a);
+        if (r < cumulative) {
+            return i;
+        }
+    }
+    // Errori di arrotondamento: ultimo indice con probabilità non nulla
+    for (long long i = dim - 1; i > 0; i--) {
+        if (state->amplitudes[i] != 0.0) return i;
+    }
+    return 0;
+}
+
+TrajectoryResult* runTrajectories(int numQubits, int numTrajectories, unsigned long long seed,
+                                  TrajectoryCircuit circuit, void *context,
+                                  TrajectoryObservable *observables, int numObservables,
+                                  int shotsPerTrajectory) {
+    TrajectoryResult *result = malloc(sizeof(TrajectoryResult));
+    double *values = malloc((size_t)numTrajectories * (numObservables > 0 ? numObservables : 1) * sizeof(double));
+    if (!result || !values) {
+        perror("Errore allocazione in runTrajectories");
+        exit(1);
+    }
+    result->numTrajectories = numTrajectories;
+    result->numObservables = numObservables;
+    result->shotsPerTrajectory = shotsPerTrajectory;
+    result->mean = calloc(numObservables > 0 ? numObservables : 1, sizeof(double));
+    result->stdError = calloc(numObservables > 0 ? numObservables : 1, sizeof(double));
+    result->shots = NULL;
+    if (shotsPerTrajectory > 0) {
+        result->shots = malloc((size_t)numTrajectories * shotsPerTrajectory * sizeof(long long));
+    }
+    if (!result->mean || !result->stdError || (shotsPerTrajectory > 0 && !result->shots)) {
+        perror("Errore allocazione risultati in runTrajectories");
+        exit(1);
+    }
+
+    #pragma omp parallel
+    {
+        // Un solo vettore di stato per thread, riutilizzato da tutte le sue traiettorie
+        QubitState *state = initializeState(numQubits);
+        TrajectoryRng rng;
+
+        #pragma omp for schedule(dynamic)
+        for (int t = 0; t < numTrajectories; t++) {
+            initializeStateTo(state, 0);
+            seedTrajectoryRng(&rng, seed, (unsigned long long)t);
+            circuit(state, &rng, context);
+
+            for (int k = 0; k < numObservables; k++) {
+                values[(size_t)t * numObservables + k] = observables[k](state, context);
+            }
+            for (int s = 0; s < shotsPerTrajectory; s++) {
+                result->shots[(size_t)t * shotsPerTrajectory + s] = sampleBasisState(state, &rng);
+            }
+        }
+
+        freeState(state);
+    }
+
+    // Riduzione in ordine fisso: il risultato non dipende dalla suddivisione tra i thread
+    for (int k = 0; k < numObservables; k++) {
+        double sum = 0.0, sumSq = 0.0;
+        for (int t = 0; t < numTrajectories; t++) {
+            double v = values[(size_t)t * numObservables + k];
+            sum += v;
+            sumSq += v * v;
+        }
+        double mean = sum / numTrajectories;
+        double variance = (numTrajectories > 1)
+            ? (sumSq - numTrajectories * mean * mean) / (numTrajectories - 1) : 0.0;
+        result->mean[k] = mean;
+        result->stdError[k] = (variance > 0.0) ? sqrt(variance / numTrajectories) : 0.0;
+    }
+
+    free(values);
+    return result;
+}
+
+void freeTrajectoryResult(TrajectoryResult *result) {
+    if (result) {
+        free(result->mean);
+        free(result->stdError);
+        free(result->shots);
+        free(result);
+    }
+}
+
+/* Ordina una copia degli esiti e la comprime in sequenze uguali (vedi buildShotHistogram). */
+ShotHistogram* trajectoryShotHistogram(const TrajectoryResult *result, int numQubits) {
+    long long total = (long long)result->numTrajectories * result->shotsPerTrajectory;
+    size_t bytes = checkedBytes((size_t)(total > 0 ? total : 1), sizeof(long long), "esiti delle traiettorie");
+    long long *values = budgetMalloc(bytes, "esiti delle traiettorie");
+    for (long long s = 0; s < total; s++) {
+        values[s] = result->shots[s];
+    }
+    ShotHistogram *histogram = buildShotHistogram(values, total, numQubits);
+    budgetFree(values, bytes);
+    return histogram;
+}
+
+/*
+ * Operatori di Kraus del rilassamento termico come unico canale:
+ *   K0 = diag(1, c),  K1 = diag(0, l1),  K2 = sqrt(gamma) |0><1|
+ * con gamma = 1 - e^{-t/T1}, c = e^{-t/T2} e l1 = sqrt(1 - gamma - c^2) (T2 <= 2 T1 garantisce
+ * c^2 <= 1 - gamma): la media riproduce thermalRelaxationSuperoperator. K1 e K2 agiscono
+ * solo sulla componente con il qubit a 1 e hanno probabilità l1^2 P(1) e gamma P(1).
+ */
+static void thermalRelaxationKraus(double T1, double T2, double duration,
+                                   double *gamma, double *coherence, double *lambda1) {
+    if (T2 > 2.0 * T1) T2 = 2.0 * T1;
+    *gamma = 1.0 - exp(-duration / T1);
+    *coherence = exp(-duration / T2);
+    double rest = 1.0 - *gamma - *coherence * *coherence;
+    *lambda1 = (rest > 0.0) ? sqrt(rest) : 0.0;
+}
+
+void applyThermalRelaxationTrajectory(QubitState *state, int targetQubit, double T1, double T2,
+                                      double duration, TrajectoryRng *rng) {
+    TRACE_REQUIRE_AMPLITUDES(state, 1);
+    long long dim = 1LL << state->numQubits;
+    long long mask = 1LL << targetQubit;
+    double gamma, coherence, lambda1;
+    thermalRelaxationKraus(T1, T2, duration, &gamma, &coherence, &lambda1);
+    double prob1 = probabilityOne(state, targetQubit);
+    double pJump = gamma * prob1;
+    double pDecay = lambda1 * lambda1 * prob1;
+    double r = trajectoryRandom(rng);
+
+    if (r < pJump) {
+        // K2: |1> -> |0>
+        double scale = 1.0 / sqrt(prob1);
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < dim; i++) {
+            if ((i & mask) == 0) {
+                state->amplitudes[i] = scale * state->amplitudes[i | mask];
+                state->amplitudes[i | mask] = 0.0;
+            }
+        }
+    } else if (r < pJump + pDecay) {
+        // K1: proiezione su |1>
+        double scale = 1.0 / sqrt(prob1);
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < dim; i++) {
+            state->amplitudes[i] = (i & mask) ? scale * state->amplitudes[i] : 0.0;
+        }
+    } else {
+        // K0: la componente |1> viene smorzata di c
+        double scale0 = 1.0 / sqrt(1.0 - pJump - pDecay);
+        double scale1 = coherence * scale0;
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < dim; i++) {
+            state->amplitudes[i] *= (i & mask) ? scale1 : scale0;
+        }
+    }
+}
+
+/* Numero massimo di qubit inattivi trattati con un solo istogramma (2^12 valori). */
+#define IDLE_GROUP_QUBITS 12
+
+/*
+ * Un passaggio calcola l'istogramma delle probabilità dei 2^k valori dei bit inattivi;
+ * su di esso si estrae in sequenza l'operatore di Kraus di ciascun qubit (K0, K1 o K2 di
+ * thermalRelaxationKraus), aggiornandolo esattamente come farebbe lo stato. Gli operatori
+ * scelti agiscono solo sui bit inattivi, quindi si applicano tutti insieme con un secondo
+ * passaggio: l'ampiezza i (con i bit saltati a 0) riceve quella di i | jumpMask moltiplicata
+ * per factor[pattern(i)].
+ */
+static void idleRelaxationGroup(QubitState *state, const int *qubits, int k,
+                                const double *T1, const double *T2, double duration, TrajectoryRng *rng) {
+    long long dim = 1LL << state->numQubits;
+    int numPatterns = 1 << k;
+    double *hist = calloc(numPatterns, sizeof(double));
+    double *factor = malloc(numPatterns * sizeof(double));
+    if (!hist || !factor) {
+        perror("Errore allocazione in applyIdleThermalRelaxationTrajectory");
+        exit(1);
+    }
+
+    #pragma omp parallel for reduction(+:hist[:numPatterns]) schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        int pattern = 0;
+        for (int l = 0; l < k; l++) {
+            pattern |= (int)((i >> qubits[l]) & 1) << l;
+        }
+        double complex a = state->amplitudes[i];
+        hist[pattern] += creal(a) * creal(a) + cimag(a) * cimag(a);
+    }
+
+    int jumped = 0, decayed = 0;
+    double coherence[IDLE_GROUP_QUBITS], lambda1[IDLE_GROUP_QUBITS], jumpAmp[IDLE_GROUP_QUBITS];
+    for (int l = 0; l < k; l++) {
+        double gamma;
+        thermalRelaxationKraus(T1[qubits[l]], T2[qubits[l]], duration, &gamma, &coherence[l], &lambda1[l]);
+        jumpAmp[l] = sqrt(gamma);
+
+        double total = 0.0, prob1 = 0.0;
+        for (int p = 0; p < numPatterns; p++) {
+            total += hist[p];
+            if ((p >> l) & 1) prob1 += hist[p];
+        }
+        int bit = 1 << l;
+        double r = trajectoryRandom(rng) * total;
+        if (r < gamma * prob1) {
+            jumped |= bit;
+            for (int p = 0; p < numPatterns; p++) {
+                if (!(p & bit)) {
+                    hist[p] = gamma * hist[p | bit];
+                    hist[p | bit] = 0.0;
+                }
+            }
+        } else if (r < (gamma + lambda1[l] * lambda1[l]) * prob1) {
+            decayed |= bit;
+            for (int p = 0; p < numPatterns; p++) {
+                hist[p] = (p & bit) ? lambda1[l] * lambda1[l] * hist[p] : 0.0;
+            }
+        } else {
+            for (int p = 0; p < numPatterns; p++) {
+                if (p & bit) hist[p] *= coherence[l] * coherence[l];
+            }
+        }
+    }
+
+    double norm = 0.0;
+    for (int p = 0; p < numPatterns; p++) norm += hist[p];
+    norm = 1.0 / sqrt(norm);
+    long long jumpMask = 0;
+    for (int l = 0; l < k; l++) {
+        if ((jumped >> l) & 1) jumpMask |= 1LL << qubits[l];
+    }
+    for (int p = 0; p < numPatterns; p++) {
+        double f = norm;
+        for (int l = 0; l < k; l++) {
+            if ((jumped >> l) & 1) {
+                f *= jumpAmp[l];
+            } else if ((decayed >> l) & 1) {
+                f *= ((p >> l) & 1) ? lambda1[l] : 0.0;
+            } else if ((p >> l) & 1) {
+                f *= coherence[l];
+            }
+        }
+        factor[p] = f;
+    }
+
+    // Ogni indice con bit saltati non nulli appartiene a un solo i con (i & jumpMask) == 0
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        if (i & jumpMask) continue;
+        int pattern = 0;
+        for (int l = 0; l < k; l++) {
+            pattern |= (int)((i >> qubits[l]) & 1) << l;
+        }
+        double complex a = state->amplitudes[i | jumpMask];
+        for (long long s = jumpMask; s; s = (s - 1) & jumpMask) {
+            state->amplitudes[i | s] = 0.0;
+        }
+        state->amplitudes[i] = factor[pattern] * a;
+    }
+
+    free(hist);
+    free(factor);
+}
+
+void applyIdleThermalRelaxationTrajectory(QubitState *state, long long idleMask,
+                                          const double *T1, const double *T2, double duration,
+                                          TrajectoryRng *rng) {
+    TRACE_REQUIRE_AMPLITUDES(state, 1);
+    int qubits[64];
+    int count = 0;
+    for (int q = 0; q < state->numQubits; q++) {
+        if ((idleMask >> q) & 1) qubits[count++] = q;
+    }
+    for (int first = 0; first < count; first += IDLE_GROUP_QUBITS) {
+        int k = count - first;
+        if (k > IDLE_GROUP_QUBITS) k = IDLE_GROUP_QUBITS;
+        idleRelaxationGroup(state, qubits + first, k, T1, T2, duration, rng);
+    }
+}
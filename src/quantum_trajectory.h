@@ -0,0 +1,76 @@
+#ifndef QUANTUM_TRAJECTORY_H
+#define QUANTUM_TRAJECTORY_H
+
+#include <complex.h>
+#include "quantum_sim.h"     // Per QubitState e MeasurementResult
+#include "quantum_runner.h"  // Per ShotHistogram
+
+// Simulazione del rumore con traiettorie quantistiche (Monte Carlo): invece di evolvere la
+// matrice densità (4^n elementi) si evolve un vettore di stato (2^n elementi) applicando a
+// caso uno degli operatori di Kraus di ogni canale, con la probabilità prevista dalla regola
+// di Born. La media sulle traiettorie riproduce i risultati della matrice densità.
+
+// Generatore pseudo-casuale indipendente per traiettoria (xoshiro256**):
+// rand() non è rientrante e non può essere condiviso tra i thread.
+typedef struct {
+    unsigned long long s[4];
+} TrajectoryRng;
+
+// Inizializza il flusso 'stream' a partire dal seme globale 'seed'
+void seedTrajectoryRng(TrajectoryRng *rng, unsigned long long seed, unsigned long long stream);
+
+// Numero uniforme in [0, 1)
+double trajectoryRandom(TrajectoryRng *rng);
+
+// Canali di rumore applicati stocasticamente (stessi parametri di noise_channels.h)
+void applyDephasingTrajectory(QubitState *state, int targetQubit, double p, TrajectoryRng *rng);
+void applyAmplitudeDampingTrajectory(QubitState *state, int targetQubit, double gamma, TrajectoryRng *rng);
+void applyDepolarizingTrajectory(QubitState *state, int targetQubit, double p, TrajectoryRng *rng);
+
+// Rilassamento termico (T1, T2, durata) come un unico canale a tre operatori di Kraus, con un
+// passaggio per la probabilità e uno per l'operatore estratto; la media è applyThermalRelaxation
+void applyThermalRelaxationTrajectory(QubitState *state, int targetQubit, double T1, double T2,
+                                      double duration, TrajectoryRng *rng);
+
+// Rilassamento termico di tutti i qubit inattivi (bit a 1 in idleMask) con due passaggi sul
+// vettore di stato, indipendentemente dal loro numero (fino a 12 qubit per gruppo)
+void applyIdleThermalRelaxationTrajectory(QubitState *state, long long idleMask,
+                                          const double *T1, const double *T2, double duration,
+                                          TrajectoryRng *rng);
+
+// Misura di un qubit con collasso, usando il generatore della traiettoria
+MeasurementResult measureTrajectory(QubitState *state, int qubit, TrajectoryRng *rng);
+
+// Estrae un indice di stato base con probabilità |a_i|^2, senza modificare lo stato
+long long sampleBasisState(QubitState *state, TrajectoryRng *rng);
+
+// Circuito rumoroso eseguito su ogni traiettoria (lo stato parte da |0...0>)
+typedef void (*TrajectoryCircuit)(QubitState *state, TrajectoryRng *rng, void *context);
+
+// Osservabile valutata sullo stato finale di ogni traiettoria
+typedef double (*TrajectoryObservable)(QubitState *state, void *context);
+
+typedef struct {
+    int numTrajectories;
+    int numObservables;
+    int shotsPerTrajectory;
+    double *mean;         // Media di ogni osservabile sulle traiettorie
+    double *stdError;     // Errore standard della media
+    long long *shots;     // numTrajectories * shotsPerTrajectory esiti (indici di stato base), o NULL
+} TrajectoryResult;
+
+// Esegue 'numTrajectories' traiettorie distribuite tra i thread: ogni thread alloca un solo
+// vettore di stato e ogni traiettoria usa il flusso casuale (seed, indice traiettoria),
+// quindi i risultati non dipendono dal numero di thread.
+TrajectoryResult* runTrajectories(int numQubits, int numTrajectories, unsigned long long seed,
+                                  TrajectoryCircuit circuit, void *context,
+                                  TrajectoryObservable *observables, int numObservables,
+                                  int shotsPerTrajectory);
+
+void freeTrajectoryResult(TrajectoryResult *result);
+
+// Istogramma degli esiti osservati (indici di stato base su numQubits bit), in ordine crescente:
+// la memoria dipende dal numero di esiti e non da 2^numQubits. Da liberare con freeShotHistogram.
+ShotHistogram* trajectoryShotHistogram(const TrajectoryResult *result, int numQubits);
+
+#endif // QUANTUM_TRAJECTORY_H
@@ -0,0 +1,166 @@
+// vectorized_density.c
+
+#include "vectorized_density.h"
+#include "quantum_sim.h"
+#include "quantum_density.h"
+#include "quantum_trace.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <complex.h>
+#include <math.h>
+
+VectorizedDensityMatrix* initializeVectorizedDensity(int numQubits) {
+    VectorizedDensityMatrix *vdm = malloc(sizeof(VectorizedDensityMatrix));
+    if (!vdm) {
+        perror("Errore allocazione VectorizedDensityMatrix");
+        exit(1);
+    }
+    vdm->numQubits = numQubits;
+    // initializeState pone a 1 l'ampiezza 0, cioè \rho[0][0]
+    vdm->state = initializeState(2 * numQubits);
+    return vdm;
+}
+
+void freeVectorizedDensity(VectorizedDensityMatrix *vdm) {
+    if (vdm) {
+        freeState(vdm->state);
+        free(vdm);
+    }
+}
+
+/* \rho = |psi><psi|: l'ampiezza i | (j << n) vale psi_i conj(psi_j). */
+VectorizedDensityMatrix* pureStateToVectorizedDensity(QubitState *state) {
+    TRACE_REQUIRE_AMPLITUDES(state, 0);
+    int n = state->numQubits;
+    long long dim = 1LL << n;
+    VectorizedDensityMatrix *vdm = initializeVectorizedDensity(n);
+    double complex *v = vdm->state->amplitudes;
+
+    #pragma omp parallel for schedule(static)
+    for (long long j = 0; j < dim; j++) {
+        double complex cj = conj(state->amplitudes[j]);
+        for (long long i = 0; i < dim; i++) {
+            v[i | (j << n)] = state->amplitudes[i] * cj;
+        }
+    }
+    return vdm;
+}
+
+VectorizedDensityMatrix* vectorizeDensityMatrix(DensityMatrix *dm) {
+    int n = dm->numQubits;
+    long long dim = 1LL << n;
+    VectorizedDensityMatrix *vdm = initializeVectorizedDensity(n);
+    double complex *v = vdm->state->amplitudes;
+
+    #pragma omp parallel for schedule(static)
+    for (long long j = 0; j < dim; j++) {
+        for (long long i = 0; i < dim; i++) {
+            v[i | (j << n)] = getDensityElement(dm, i, j);
+        }
+    }
+    return vdm;
+}
+
+DensityMatrix* vectorizedToDensityMatrix(VectorizedDensityMatrix *vdm) {
+    int n = vdm->numQubits;
+    long long dim = 1LL << n;
+    DensityMatrix *dm = initializeDensityMatrix(n);
+    double complex *v = vdm->state->amplitudes;
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < dim; i++) {
+        for (long long j = 0; j < dim; j++) {
+            dm->matrix[i * dim + j] = v[i | (j << n)];
+        }
+    }
+    return dm;
+}
+
+double traceVectorizedDensity(VectorizedDensityMatrix *vdm) {
+    int n = vdm->numQubits;
+    long long dim = 1LL << n;
+    double trace = 0.0;
+    for (long long i = 0; i < dim; i++) {
+        trace += creal(vdm->state->amplitudes[i | (i << n)]);
+    }
+    return trace;
+}
+
+void applySingleQubitGateVectorized(VectorizedDensityMatrix *vdm, int target, double complex gate[2][2]) {
+    double complex gateConj[2][2] = {
+        {conj(gate[0][0]), conj(gate[0][1])},
+        {conj(gate[1][0]), conj(gate[1][1])}
+    };
+    applySingleQubitGate(vdm->state, target, gate);
+    applySingleQubitGate(vdm->state, target + vdm->numQubits, gateConj);
+}
+
+/* I gate reali coincidono con il proprio coniugato: basta ripeterli sui qubit di colonna. */
+void applyHadamardVectorized(VectorizedDensityMatrix *vdm, int target) {
+    applyHadamard(vdm->state, target);
+    applyHadamard(vdm->state, target + vdm->numQubits);
+}
+
+void applyXVectorized(VectorizedDensityMatrix *vdm, int target) {
+    applyX(vdm->state, target);
+    applyX(vdm->state, target + vdm->numQubits);
+}
+
+void applyZVectorized(VectorizedDensityMatrix *vdm, int target) {
+    applyZ(vdm->state, target);
+    applyZ(vdm->state, target + vdm->numQubits);
+}
+
+void applyCNOTVectorized(VectorizedDensityMatrix *vdm, int control, int target) {
+    int n = vdm->numQubits;
+    applyCNOT(vdm->state, control, target);
+    applyCNOT(vdm->state, control + n, target + n);
+}
+
+void applyCZVectorized(VectorizedDensityMatrix *vdm, int control, int target) {
+    int n = vdm->numQubits;
+    applyCZ(vdm->state, control, target);
+    applyCZ(vdm->state, control + n, target + n);
+}
+
+void applyCPhaseShiftVectorized(VectorizedDensityMatrix *vdm, int control, int target, double complex phase) {
+    int n = vdm->numQubits;
+    applyCPhaseShift(vdm->state, control, target, phase);
+    applyCPhaseShift(vdm->state, control + n, target + n, conj(phase));
+}
+
+void applyToffoliVectorized(VectorizedDensityMatrix *vdm, int control1, int control2, int target) {
+    int n = vdm->numQubits;
+    applyToffoli(vdm->state, control1, control2, target);
+    applyToffoli(vdm->state, control1 + n, control2 + n, target + n);
+}
+
+void applyTwoQubitGateVectorized(VectorizedDensityMatrix *vdm, int qubit0, int qubit1, double complex gate[4][4]) {
+    int n = vdm->numQubits;
+    double complex gateConj[4][4];
+    for (int a = 0; a < 4; a++) {
+        for (int b = 0; b < 4; b++) {
+            gateConj[a][b] = conj(gate[a][b]);
+        }
+    }
+    applyTwoQubitGate(vdm->state, qubit0, qubit1, gate);
+    applyTwoQubitGate(vdm->state, qubit0 + n, qubit1 + n, gateConj);
+}
+
+/* Sulla coppia (t, t + n) l'indice locale del gate è a + 2b, con a bit di riga e b bit di
+   colonna; S usa invece l'indice a * 2 + b del blocco row-major, quindi va riordinato. */
+void applySingleQubitSuperoperatorVectorized(VectorizedDensityMatrix *vdm, int target, double complex S[4][4]) {
+    double complex gate[4][4];
+    for (int a = 0; a < 2; a++)
+        for (int b = 0; b < 2; b++)
+            for (int c = 0; c < 2; c++)
+                for (int d = 0; d < 2; d++)
+                    gate[a + 2 * b][c + 2 * d] = S[a * 2 + b][c * 2 + d];
+    applyTwoQubitGate(vdm->state, target, target + vdm->numQubits, gate);
+}
+
+void applySingleQubitKrausVectorized(VectorizedDensityMatrix *vdm, int target, int numOperators, double complex (*kraus)[2][2]) {
+    double complex S[4][4];
+    singleQubitKrausToSuperoperator(numOperators, kraus, S);
+    applySingleQubitSuperoperatorVectorized(vdm, target, S);
+}
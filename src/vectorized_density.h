@@ -0,0 +1,47 @@
+#ifndef VECTORIZED_DENSITY_H
+#define VECTORIZED_DENSITY_H
+
+#include <complex.h>
+#include "quantum_sim.h"      // Per QubitState e i kernel sul vettore di stato
+#include "quantum_density.h"  // Per le conversioni da/verso DensityMatrix
+
+// Matrice densità di n qubit vettorizzata come vettore di stato a 2n qubit:
+// l'ampiezza di indice i | (j << n) è \rho[i][j]. I qubit 0 ... n-1 indicizzano le righe,
+// i qubit n ... 2n-1 le colonne. Un gate U sul qubit t diventa U sul qubit t e conj(U)
+// sul qubit t + n, quindi si riusano direttamente i kernel di quantum_sim.c.
+typedef struct {
+    int numQubits;      // Qubit fisici n
+    QubitState *state;  // Vettore a 2n qubit
+} VectorizedDensityMatrix;
+
+// Inizializza \rho = |0...0><0...0|
+VectorizedDensityMatrix* initializeVectorizedDensity(int numQubits);
+void freeVectorizedDensity(VectorizedDensityMatrix *vdm);
+
+// Conversioni (restituiscono nuove strutture)
+VectorizedDensityMatrix* pureStateToVectorizedDensity(QubitState *state);
+VectorizedDensityMatrix* vectorizeDensityMatrix(DensityMatrix *dm);
+DensityMatrix* vectorizedToDensityMatrix(VectorizedDensityMatrix *vdm);
+
+// Traccia di \rho
+double traceVectorizedDensity(VectorizedDensityMatrix *vdm);
+
+// Gate: U sul qubit t (righe) e conj(U) sul qubit t + n (colonne)
+void applySingleQubitGateVectorized(VectorizedDensityMatrix *vdm, int target, double complex gate[2][2]);
+void applyHadamardVectorized(VectorizedDensityMatrix *vdm, int target);
+void applyXVectorized(VectorizedDensityMatrix *vdm, int target);
+void applyZVectorized(VectorizedDensityMatrix *vdm, int target);
+void applyCNOTVectorized(VectorizedDensityMatrix *vdm, int control, int target);
+void applyCZVectorized(VectorizedDensityMatrix *vdm, int control, int target);
+void applyCPhaseShiftVectorized(VectorizedDensityMatrix *vdm, int control, int target, double complex phase);
+void applyToffoliVectorized(VectorizedDensityMatrix *vdm, int control1, int control2, int target);
+void applyTwoQubitGateVectorized(VectorizedDensityMatrix *vdm, int qubit0, int qubit1, double complex gate[4][4]);
+
+// Superoperatore locale S (stessa convenzione di applySingleQubitSuperoperatorDensity),
+// applicato come gate 4x4 non unitario sulla coppia di qubit (t, t + n)
+void applySingleQubitSuperoperatorVectorized(VectorizedDensityMatrix *vdm, int target, double complex S[4][4]);
+
+// Canale di Kraus locale su un qubit, \rho -> \sum_k K_k \rho K_k^\dagger
+void applySingleQubitKrausVectorized(VectorizedDensityMatrix *vdm, int target, int numOperators, double complex (*kraus)[2][2]);
+
+#endif // VECTORIZED_DENSITY_H
@@ -0,0 +1,50 @@
+# Confronta due stati stampati da printState ("Stato i: re + imi | bit"): il primo file è
+# quello atteso, il secondo l'uscita del programma. Gli stati devono coincidere a meno della
+# fase globale (ricavata dall'ampiezza attesa più grande), con la precisione della stampa.
+# Termina con 1 se differiscono.
+
+function imag(field) {
+    sub(/i$/, "", field)
+    return field + 0
+}
+
+FNR == NR {
+    if ($1 == "Stato") {
+        expectedRe[$2] = $3 + 0
+        expectedIm[$2] = imag($5)
+        numExpected++
+    }
+    next
+}
+
+$1 == "Stato" {
+    actualRe[$2] = $3 + 0
+    actualIm[$2] = imag($5)
+    numActual++
+}
+
+END {
+    if (numExpected == 0 || numExpected != numActual) exit 1
+    largest = -1
+    for (k in expectedRe) {
+        m = expectedRe[k] * expectedRe[k] + expectedIm[k] * expectedIm[k]
+        if (m > largest) {
+            largest = m
+            reference = k
+        }
+    }
+    if (!(reference in actualRe)) exit 1
+    # Fase globale: a / e normalizzato sull'ampiezza di riferimento
+    phaseRe = actualRe[reference] * expectedRe[reference] + actualIm[reference] * expectedIm[reference]
+    phaseIm = actualIm[reference] * expectedRe[reference] - actualRe[reference] * expectedIm[reference]
+    norm = sqrt(phaseRe * phaseRe + phaseIm * phaseIm)
+    if (norm == 0) exit 1
+    phaseRe /= norm
+    phaseIm /= norm
+    for (k in expectedRe) {
+        if (!(k in actualRe)) exit 1
+        dRe = actualRe[k] - (phaseRe * expectedRe[k] - phaseIm * expectedIm[k])
+        dIm = actualIm[k] - (phaseRe * expectedIm[k] + phaseIm * expectedRe[k])
+        if (dRe * dRe + dIm * dIm > 1e-10) exit 1
+    }
+}
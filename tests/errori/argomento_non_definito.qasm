@@ -0,0 +1,4 @@
+// atteso: 4: errore: argomento 'b' non definito in 'g'
+OPENQASM 2.0;
+include "qelib1.inc";
+gate g a { h b; }
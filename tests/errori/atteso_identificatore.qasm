@@ -0,0 +1,4 @@
+// atteso: 4: errore: atteso un identificatore, trovato '['
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg [2];
@@ -0,0 +1,4 @@
+// atteso: 4: errore: atteso un intero non negativo, trovato '1.5'
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[1.5];
@@ -0,0 +1,6 @@
+// atteso: 6: errore: condizione sul registro 'c' di 64 bit: al massimo 63
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[1];
+creg c[64];
+if (c == 1) x q[0];
@@ -0,0 +1,6 @@
+// atteso: 6: errore: registro classico 'd' non dichiarato
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[1];
+creg c[1];
+if (d == 1) x q[0];
@@ -0,0 +1,4 @@
+// atteso: 4: errore: dimensione del registro non valida: 0
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[0];
@@ -0,0 +1,6 @@
+// atteso: 6: errore: registri di dimensioni diverse negli argomenti
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[2];
+qreg r[3];
+cx q, r;
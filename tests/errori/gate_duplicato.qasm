@@ -0,0 +1,4 @@
+// atteso: 4: errore: gate 'h' già definito
+OPENQASM 2.0;
+include "qelib1.inc";
+gate h a { x a; }
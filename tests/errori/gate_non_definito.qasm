@@ -0,0 +1,5 @@
+// atteso: 5: errore: gate 'foo' non definito
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[1];
+foo q[0];
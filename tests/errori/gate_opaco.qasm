@@ -0,0 +1,6 @@
+// atteso: 6: errore: il gate opaco 'magia' non può essere simulato
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[1];
+opaque magia a;
+magia q[0];
@@ -0,0 +1,3 @@
+// atteso: 3: errore: errore nella lettura di 'tests/errori/.'
+OPENQASM 2.0;
+include ".";
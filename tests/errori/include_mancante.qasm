@@ -0,0 +1,3 @@
+// atteso: 3: errore: impossibile aprire il file incluso 'tests/errori/non_esiste.inc'
+OPENQASM 2.0;
+include "non_esiste.inc";
@@ -0,0 +1,3 @@
+// atteso: 3: errore: atteso il nome del file da includere
+OPENQASM 2.0;
+include qelib1;
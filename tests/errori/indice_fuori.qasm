@@ -0,0 +1,5 @@
+// atteso: 5: errore: indice 2 fuori dal registro 'q' di dimensione 2
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[2];
+h q[2];
@@ -0,0 +1,5 @@
+// atteso: 5: errore: istruzione non valida: '3'
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[1];
+3 q[0];
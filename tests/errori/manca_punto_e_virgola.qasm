@@ -0,0 +1,5 @@
+// atteso: 5: errore: fine del file inattesa: manca ';'
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[1];
+h q[0]
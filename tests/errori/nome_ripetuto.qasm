@@ -0,0 +1,4 @@
+// atteso: 4: errore: nome 'a' ripetuto
+OPENQASM 2.0;
+include "qelib1.inc";
+gate g a, a { h a; }
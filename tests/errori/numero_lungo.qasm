@@ -0,0 +1,5 @@
+// atteso: 5: errore: numero troppo lungo
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[1];
+rx(0.1234567890123456789012345678901234567890123456789012345678901234567890) q[0];
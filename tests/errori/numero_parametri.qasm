@@ -0,0 +1,5 @@
+// atteso: 5: errore: il gate 'rx' richiede 1 parametri (0 forniti)
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[1];
+rx q[0];
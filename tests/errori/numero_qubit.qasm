@@ -0,0 +1,5 @@
+// atteso: 5: errore: il gate 'cx' richiede 2 qubit (1 forniti)
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[2];
+cx q[0];
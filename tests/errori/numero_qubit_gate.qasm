@@ -0,0 +1,4 @@
+// atteso: 4: errore: il gate 'cx' richiede 2 qubit (1 forniti)
+OPENQASM 2.0;
+include "qelib1.inc";
+gate g a, b { cx a; }
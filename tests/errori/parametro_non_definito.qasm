@@ -0,0 +1,5 @@
+// atteso: 5: errore: parametro 'theta' non definito
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[1];
+rx(theta) q[0];
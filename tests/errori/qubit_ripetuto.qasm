@@ -0,0 +1,5 @@
+// atteso: 5: errore: lo stesso qubit compare più volte negli argomenti
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[2];
+cx q[0], q[0];
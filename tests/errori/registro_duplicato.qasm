@@ -0,0 +1,5 @@
+// atteso: 5: errore: registro 'q' già dichiarato
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[2];
+creg q[2];
@@ -0,0 +1,5 @@
+// atteso: 5: errore: registro quantistico 'r' non dichiarato
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[1];
+h r[0];
@@ -0,0 +1,4 @@
+// atteso: 4: errore: il gate 'g' non può chiamare se stesso
+OPENQASM 2.0;
+include "qelib1.inc";
+gate g a { h a; g a; }
@@ -0,0 +1,4 @@
+// atteso: 3: errore: stringa non terminata
+OPENQASM 2.0;
+include "qelib1.inc;
+qreg q[1];
@@ -0,0 +1,5 @@
+// atteso: 5: errore: troppi argomenti (massimo 16)
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[17];
+cx q[0], q[1], q[2], q[3], q[4], q[5], q[6], q[7], q[8], q[9], q[10], q[11], q[12], q[13], q[14], q[15], q[16];
@@ -0,0 +1,4 @@
+// atteso: 4: errore: troppi argomenti (massimo 16)
+OPENQASM 2.0;
+include "qelib1.inc";
+gate g a { barrier a; u3(0, 0, 0) a, a, a, a, a, a, a, a, a, a, a, a, a, a, a, a, a; }
@@ -0,0 +1,4 @@
+// atteso: 4: errore: troppi nomi nella definizione (massimo 16)
+OPENQASM 2.0;
+include "qelib1.inc";
+gate g(a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16) q { h q; }
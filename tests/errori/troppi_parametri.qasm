@@ -0,0 +1,5 @@
+// atteso: 5: errore: troppi parametri (massimo 16)
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[1];
+u3(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17) q[0];
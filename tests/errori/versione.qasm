@@ -0,0 +1,3 @@
+// atteso: 2: errore: è supportato solo OpenQASM 2.x
+OPENQASM 3.0;
+qubit q;
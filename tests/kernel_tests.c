@@ -0,0 +1,1568 @@
+// kernel_tests.c
+//
+// Test dei kernel che non sono raggiungibili dai file QASM: stati in batch, gradiente
+// aggiunto, QFT nativa, oracoli classici, prodotto a blocchi, matrici densità (complete,
+// compatte e vettorizzate), canali e modelli di rumore, misure, tracce parziali, metriche,
+// traiettorie, rumore dei qubit inattivi, budget di memoria, runNoisyCircuitShots con le tre
+// rappresentazioni scelte dal budget, rumore dei qubit inattivi per strati ed esecuzioni
+// ripetute in streaming.
+// Ogni verifica confronta il risultato con un valore noto analiticamente o con un'altra
+// rappresentazione dello stesso stato; i controlli statistici usano un margine di 5 errori
+// standard.
+// Il programma termina con 1 se almeno una verifica fallisce.
+
+#include "quantum_sim.h"
+#include "quantum_circuit.h"
+#include "quantum_density.h"
+#include "vectorized_density.h"
+#include "noise_channels.h"
+#include "noise_model.h"
+#include "quantum_metrics.h"
+#include "quantum_trajectory.h"
+#include "quantum_memory.h"
+#include "quantum_batch.h"
+#include "quantum_algorithms.h"
+#include "quantum_runner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include <math.h>
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+static int numChecks = 0;
+static int numFailures = 0;
+
+static void checkClose(const char *description, double actual, double expected, double tolerance) {
+    numChecks++;
+    if (!(fabs(actual - expected) <= tolerance)) {
+        printf("❌ %s: %.12g invece di %.12g (tolleranza %g)\n", description, actual, expected, tolerance);
+        numFailures++;
+    }
+}
+
+static void checkTrue(const char *description, int condition) {
+    numChecks++;
+    if (!condition) {
+        printf("❌ %s\n", description);
+        numFailures++;
+    }
+}
+
+/* Differenza massima tra \rho e |psi><psi|. */
+static double densityDistanceFromState(DensityMatrix *dm, QubitState *psi) {
+    long long dim = 1LL << psi->numQubits;
+    double worst = 0.0;
+    for (long long i = 0; i < dim; i++) {
+        for (long long j = 0; j < dim; j++) {
+            double complex expected = psi->amplitudes[i] * conj(psi->amplitudes[j]);
+            double d = cabs(getDensityElement(dm, i, j) - expected);
+            if (d > worst) worst = d;
+        }
+    }
+    return worst;
+}
+
+/* Differenza massima tra due matrici densità, in qualunque formato. */
+static double densityDistance(DensityMatrix *a, DensityMatrix *b) {
+    long long dim = 1LL << a->numQubits;
+    double worst = 0.0;
+    for (long long i = 0; i < dim; i++) {
+        for (long long j = 0; j < dim; j++) {
+            double d = cabs(getDensityElement(a, i, j) - getDensityElement(b, i, j));
+            if (d > worst) worst = d;
+        }
+    }
+    return worst;
+}
+
+/* Stato |+> su un qubit. */
+static QubitState* plusState(void) {
+    QubitState *psi = initializeState(1);
+    applyHadamard(psi, 0);
+    return psi;
+}
+
+/* ---------------------------------------------------------------------------
+ * Prodotto a blocchi contro il prodotto elemento per elemento, con dimensioni che
+ * non sono multipli del blocco (un solo blocco ridotto, blocchi completi più il bordo)
+ * ------------------------------------------------------------------------- */
+
+static void testTiledProduct(void) {
+    const long long sizes[3] = {48, 70, 130};
+    for (int t = 0; t < 3; t++) {
+        long long d = sizes[t];
+        double complex *A = malloc(d * d * sizeof(double complex));
+        double complex *B = malloc(d * d * sizeof(double complex));
+        double complex *C = malloc(d * d * sizeof(double complex));
+        double complex *C0 = malloc(d * d * sizeof(double complex));
+        for (long long i = 0; i < d * d; i++) {
+            A[i] = (double)rand() / RAND_MAX - 0.5 + I * ((double)rand() / RAND_MAX - 0.5);
+            B[i] = (double)rand() / RAND_MAX - 0.5 + I * ((double)rand() / RAND_MAX - 0.5);
+            C0[i] = (double)rand() / RAND_MAX - 0.5;
+        }
+        for (int conjTransB = 0; conjTransB < 2; conjTransB++) {
+            for (int accumulate = 0; accumulate < 2; accumulate++) {
+                memcpy(C, C0, d * d * sizeof(double complex));
+                multiplyMatricesTiled(A, B, C, d, conjTransB, accumulate);
+                double maxDiff = 0.0;
+                for (long long i = 0; i < d; i++) {
+                    for (long long j = 0; j < d; j++) {
+                        double complex expected = accumulate ? C0[i * d + j] : 0.0;
+                        for (long long k = 0; k < d; k++) {
+                            expected += A[i * d + k] * (conjTransB ? conj(B[j * d + k]) : B[k * d + j]);
+                        }
+                        double diff = cabs(C[i * d + j] - expected);
+                        if (diff > maxDiff) maxDiff = diff;
+                    }
+                }
+                char text[128];
+                snprintf(text, sizeof(text), "prodotto a blocchi %lldx%lld%s%s", d, d,
+                         conjTransB ? ", B^dagger" : "", accumulate ? ", accumulato" : "");
+                checkClose(text, maxDiff, 0.0, 1e-12);
+            }
+        }
+        free(C0);
+        free(C);
+        free(B);
+        free(A);
+    }
+}
+
+
+/* ---------------------------------------------------------------------------
+ * Gate sulle matrici densità: ogni kernel applicato a \rho (formato completo e compatto)
+ * deve dare |psi><psi| della stessa sequenza di gate sul vettore
+ * ------------------------------------------------------------------------- */
+
+static void testDensityGates(void) {
+    // Matrice unitaria generica U(theta, phi, lambda)
+    double uTheta = 0.9, uPhi = -0.4, uLambda = 1.1;
+    double complex u[2][2] = {
+        { cos(uTheta / 2), -cexp(I * uLambda) * sin(uTheta / 2) },
+        { cexp(I * uPhi) * sin(uTheta / 2), cexp(I * (uPhi + uLambda)) * cos(uTheta / 2) }
+    };
+    double complex h[2][2] = {
+        { 1 / sqrt(2), 1 / sqrt(2) },
+        { 1 / sqrt(2), -1 / sqrt(2) }
+    };
+    double complex y[2][2] = { { 0, -I }, { I, 0 } };
+
+    for (int packed = 0; packed <= 1; packed++) {
+        const char *format = packed ? "compatta" : "completa";
+        char text[128];
+
+        QubitState *psi = initializeState(3);
+        applyHadamard(psi, 0);
+        applyRY(psi, 1, 0.7);
+        applyRX(psi, 2, 1.3);
+        applyCNOT(psi, 0, 2);
+        DensityMatrix *dm = packed ? pureStateToPackedDensityMatrix(psi) : pureStateToDensityMatrix(psi);
+
+        // Gate a 1 qubit su ogni posizione
+        for (int q = 0; q < 3; q++) {
+            applySingleQubitGate(psi, q, u);
+            applySingleQubitGateDensity(dm, q, u);
+        }
+        applySingleQubitGate(psi, 1, h);
+        applySingleQubitGateDensity(dm, 1, h);
+        applySingleQubitGate(psi, 2, y);
+        applySingleQubitGateDensity(dm, 2, y);
+        snprintf(text, sizeof(text), "gate a 1 qubit sulla matrice densità %s", format);
+        checkClose(text, densityDistanceFromState(dm, psi), 0.0, 1e-12);
+
+        // Gate a 2 e 3 qubit, con controlli e bersagli in ordine sia crescente che decrescente
+        applyCNOT(psi, 2, 0);
+        applyCNOTDensity(dm, 2, 0);
+        applyCZ(psi, 0, 1);
+        applyCZDensity(dm, 0, 1);
+        applyCPhaseShift(psi, 1, 2, cexp(I * 0.8));
+        applyCPhaseShiftDensity(dm, 1, 2, cexp(I * 0.8));
+        applyToffoli(psi, 2, 0, 1);
+        applyToffoliDensity(dm, 2, 0, 1);
+        applyCCZ(psi, 1, 2, 0);
+        applyCCZDensity(dm, 1, 2, 0);
+        applyFredkin(psi, 1, 2, 0);
+        applyFredkinDensity(dm, 1, 2, 0);
+
+        // Gate generico a 2 qubit: U sul qubit0 (bit basso dell'indice locale) e H sul qubit1
+        double complex uh[4][4];
+        for (int a = 0; a < 4; a++) {
+            for (int b = 0; b < 4; b++) {
+                uh[a][b] = u[a & 1][b & 1] * h[a >> 1][b >> 1];
+            }
+        }
+        applySingleQubitGate(psi, 2, u);
+        applySingleQubitGate(psi, 0, h);
+        applyTwoQubitGateDensity(dm, 2, 0, uh);
+        snprintf(text, sizeof(text), "gate a 2 e 3 qubit sulla matrice densità %s", format);
+        checkClose(text, densityDistanceFromState(dm, psi), 0.0, 1e-12);
+
+        freeDensityMatrix(dm);
+        freeState(psi);
+    }
+
+    // Conversioni tra i due formati
+    QubitState *psi = initializeState(3);
+    applyHadamard(psi, 1);
+    applySingleQubitGate(psi, 0, u);
+    applyCNOT(psi, 1, 2);
+    DensityMatrix *fromState = pureStateToDensityMatrix(psi);
+    DensityMatrix *packedFromState = pureStateToPackedDensityMatrix(psi);
+    checkClose("pureStateToDensityMatrix", densityDistanceFromState(fromState, psi), 0.0, 1e-14);
+    checkClose("pureStateToPackedDensityMatrix", densityDistanceFromState(packedFromState, psi), 0.0, 1e-14);
+    DensityMatrix *unpacked = unpackDensityMatrix(packedFromState);
+    DensityMatrix *repacked = packDensityMatrix(fromState);
+    checkClose("unpackDensityMatrix", densityDistance(unpacked, fromState), 0.0, 1e-14);
+    checkClose("packDensityMatrix", densityDistance(repacked, fromState), 0.0, 1e-14);
+    checkClose("traccia della matrice compatta", traceDensityMatrix(repacked), 1.0, 1e-12);
+
+    // Gate della rappresentazione vettorizzata a partire da |0000>
+    QubitState *phi = initializeState(4);
+    VectorizedDensityMatrix *vdm = pureStateToVectorizedDensity(phi);
+    applyHadamard(phi, 0);
+    applyHadamardVectorized(vdm, 0);
+    applyX(phi, 2);
+    applyXVectorized(vdm, 2);
+    applyCNOT(phi, 0, 1);
+    applyCNOTVectorized(vdm, 0, 1);
+    applyToffoli(phi, 0, 1, 3);
+    applyToffoliVectorized(vdm, 0, 1, 3);
+    applyCPhaseShift(phi, 3, 2, cexp(I * 0.9));
+    applyCPhaseShiftVectorized(vdm, 3, 2, cexp(I * 0.9));
+    applyCZ(phi, 0, 2);
+    applyCZVectorized(vdm, 0, 2);
+    applyZ(phi, 1);
+    applyZVectorized(vdm, 1);
+    applySingleQubitGate(phi, 3, u);
+    applySingleQubitGateVectorized(vdm, 3, u);
+    DensityMatrix *fromVectorized = vectorizedToDensityMatrix(vdm);
+    checkClose("gate sulla matrice densità vettorizzata", densityDistanceFromState(fromVectorized, phi), 0.0, 1e-12);
+    checkClose("traccia della matrice vettorizzata", traceVectorizedDensity(vdm), 1.0, 1e-12);
+
+    freeDensityMatrix(fromVectorized);
+    freeVectorizedDensity(vdm);
+    freeState(phi);
+    freeDensityMatrix(repacked);
+    freeDensityMatrix(unpacked);
+    freeDensityMatrix(packedFromState);
+    freeDensityMatrix(fromState);
+    freeState(psi);
+}
+
+/* ---------------------------------------------------------------------------
+ * Canali di rumore: elementi di \rho noti in forma chiusa, in entrambi i formati
+ * ------------------------------------------------------------------------- */
+
+static void checkOneQubitDensity(const char *description, DensityMatrix *dm, double rho11, double complex rho01) {
+    char text[160];
+    snprintf(text, sizeof(text), "%s: rho11", description);
+    checkClose(text, creal(getDensityElement(dm, 1, 1)), rho11, 1e-12);
+    snprintf(text, sizeof(text), "%s: rho01", description);
+    checkClose(text, cabs(getDensityElement(dm, 0, 1) - rho01), 0.0, 1e-12);
+    snprintf(text, sizeof(text), "%s: traccia", description);
+    checkClose(text, traceDensityMatrix(dm), 1.0, 1e-12);
+}
+
+static void testChannels(void) {
+    QubitState *plus = plusState();
+    QubitState *one = initializeState(1);
+    applyX(one, 0);
+    QubitState *zero = initializeState(1);
+
+    for (int packed = 0; packed <= 1; packed++) {
+        const char *format = packed ? "compatta" : "completa";
+        char text[128];
+
+        // Dephasing p: Z con probabilità p, le coerenze si riducono di (1 - 2p)
+        DensityMatrix *dm = packed ? pureStateToPackedDensityMatrix(plus) : pureStateToDensityMatrix(plus);
+        applyDephasing(dm, 0, 0.1);
+        snprintf(text, sizeof(text), "dephasing (%s)", format);
+        checkOneQubitDensity(text, dm, 0.5, 0.4);
+        freeDensityMatrix(dm);
+
+        // Ampiezza damping gamma: rho11 -> (1 - gamma) rho11, coerenze * sqrt(1 - gamma)
+        dm = packed ? pureStateToPackedDensityMatrix(plus) : pureStateToDensityMatrix(plus);
+        applyAmplitudeDamping(dm, 0, 0.3);
+        snprintf(text, sizeof(text), "amplitude damping (%s)", format);
+        checkOneQubitDensity(text, dm, 0.35, 0.5 * sqrt(0.7));
+        freeDensityMatrix(dm);
+
+        // Depolarizzante p: il vettore di Bloch si riduce di (1 - p)
+        dm = packed ? pureStateToPackedDensityMatrix(zero) : pureStateToDensityMatrix(zero);
+        applyDepolarizing(dm, 0, 0.2);
+        snprintf(text, sizeof(text), "depolarizzante (%s)", format);
+        checkOneQubitDensity(text, dm, 0.1, 0.0);
+        freeDensityMatrix(dm);
+
+        // Rilassamento termico: rho11 * e^{-t/T1}, coerenze * e^{-t/T2}
+        dm = packed ? pureStateToPackedDensityMatrix(plus) : pureStateToDensityMatrix(plus);
+        applyThermalRelaxation(dm, 0, 50.0, 30.0, 10.0);
+        snprintf(text, sizeof(text), "rilassamento termico (%s)", format);
+        checkOneQubitDensity(text, dm, 0.5 * exp(-10.0 / 50.0), 0.5 * exp(-10.0 / 30.0));
+        freeDensityMatrix(dm);
+
+        // Canale a due qubit con un solo operatore unitario (CNOT, controllo qubit0 = bit basso
+        // dell'indice locale): deve coincidere con il gate sul vettore, anche su qubit non adiacenti
+        QubitState *psi = initializeState(3);
+        applyHadamard(psi, 0);
+        applyRY(psi, 1, 0.4);
+        applyRX(psi, 2, 1.1);
+        dm = packed ? pureStateToPackedDensityMatrix(psi) : pureStateToDensityMatrix(psi);
+        double complex cnot[1][4][4] = { {
+            { 1, 0, 0, 0 },
+            { 0, 0, 0, 1 },
+            { 0, 0, 1, 0 },
+            { 0, 1, 0, 0 }
+        } };
+        applyTwoQubitKrausDensity(dm, 0, 2, 1, cnot);
+        applyCNOT(psi, 0, 2);
+        snprintf(text, sizeof(text), "canale di Kraus a due qubit (%s)", format);
+        checkClose(text, densityDistanceFromState(dm, psi), 0.0, 1e-12);
+
+        // Canali di Pauli in forma chiusa contro gli stessi canali scritti come operatori di Kraus,
+        // su uno stato senza simmetrie tra i qubit
+        freeDensityMatrix(dm);
+        applyRY(psi, 0, 0.3);
+        applyRX(psi, 1, 0.9);
+        applyCNOT(psi, 1, 2);
+        dm = packed ? pureStateToPackedDensityMatrix(psi) : pureStateToDensityMatrix(psi);
+        DensityMatrix *viaKraus = packed ? pureStateToPackedDensityMatrix(psi) : pureStateToDensityMatrix(psi);
+        double complex pauli[4][2][2] = {
+            { { 1, 0 }, { 0, 1 } },
+            { { 0, 1 }, { 1, 0 } },
+            { { 0, -I }, { I, 0 } },
+            { { 1, 0 }, { 0, -1 } }
+        };
+        double p1[4] = {0.7, 0.05, 0.1, 0.15};
+        double complex kraus1[4][2][2];
+        for (int k = 0; k < 4; k++)
+            for (int r = 0; r < 2; r++)
+                for (int col = 0; col < 2; col++)
+                    kraus1[k][r][col] = sqrt(p1[k]) * pauli[k][r][col];
+        applyPauliChannelDensity(dm, 1, p1[1], p1[2], p1[3]);
+        applySingleQubitKrausDensity(viaKraus, 1, 4, kraus1);
+        snprintf(text, sizeof(text), "canale di Pauli a un qubit (%s)", format);
+        checkClose(text, densityDistance(dm, viaKraus), 0.0, 1e-12);
+
+        double probs[16];
+        double complex kraus2[16][4][4];
+        probs[0] = 1.0;
+        for (int k = 1; k < 16; k++) {
+            probs[k] = 0.01 * ((7 * k) % 11);   // Non simmetriche tra i due qubit
+            probs[0] -= probs[k];
+        }
+        for (int k = 0; k < 16; k++)
+            for (int r = 0; r < 4; r++)
+                for (int col = 0; col < 4; col++)
+                    kraus2[k][r][col] = sqrt(probs[k]) * pauli[k & 3][r & 1][col & 1] * pauli[k >> 2][r >> 1][col >> 1];
+        applyTwoQubitPauliChannelDensity(dm, 2, 0, probs);
+        applyTwoQubitKrausDensity(viaKraus, 2, 0, 16, kraus2);
+        snprintf(text, sizeof(text), "canale di Pauli a due qubit (%s)", format);
+        checkClose(text, densityDistance(dm, viaKraus), 0.0, 1e-12);
+
+        freeDensityMatrix(viaKraus);
+        freeDensityMatrix(dm);
+        freeState(psi);
+    }
+
+    VectorizedDensityMatrix *vdm = pureStateToVectorizedDensity(plus);
+    applyDephasingVectorized(vdm, 0, 0.1);
+    DensityMatrix *dm = vectorizedToDensityMatrix(vdm);
+    checkOneQubitDensity("dephasing (vettorizzata)", dm, 0.5, 0.4);
+    freeDensityMatrix(dm);
+    freeVectorizedDensity(vdm);
+
+    vdm = pureStateToVectorizedDensity(one);
+    applyAmplitudeDampingVectorized(vdm, 0, 0.3);
+    dm = vectorizedToDensityMatrix(vdm);
+    checkOneQubitDensity("amplitude damping (vettorizzata)", dm, 0.7, 0.0);
+    freeDensityMatrix(dm);
+    freeVectorizedDensity(vdm);
+
+    vdm = pureStateToVectorizedDensity(zero);
+    applyDepolarizingVectorized(vdm, 0, 0.2);
+    dm = vectorizedToDensityMatrix(vdm);
+    checkOneQubitDensity("depolarizzante (vettorizzata)", dm, 0.1, 0.0);
+    freeDensityMatrix(dm);
+    freeVectorizedDensity(vdm);
+
+    freeState(zero);
+    freeState(one);
+    freeState(plus);
+}
+
+/* ---------------------------------------------------------------------------
+ * Modello di rumore: senza canali runNoisyCircuitDensity deve coincidere con il circuito
+ * sul vettore; con i canali, con gate e canali applicati uno alla volta
+ * ------------------------------------------------------------------------- */
+
+static void testNoiseModel(void) {
+    const double params[2] = {0.7, 0.8};
+    QuantumCircuit *c = createCircuit(4);
+    circuitAddGate1(c, GATE_H, 0);
+    circuitAddRotation(c, GATE_RY, 1, 0);
+    circuitAddFixedRotation(c, GATE_RX, 2, 1.3);
+    circuitAddGate2(c, GATE_CNOT, 0, 1);
+    circuitAddGate2(c, GATE_CZ, 1, 2);
+    circuitAddControlledRotation(c, GATE_CPHASE, 2, 3, 1);
+    circuitAddGate3(c, GATE_TOFFOLI, 0, 1, 3);
+    circuitAddGate3(c, GATE_CCZ, 3, 0, 2);
+    circuitAddFixedRotation(c, GATE_RZ, 2, -0.6);
+    circuitAddGate1(c, GATE_Y, 3);
+    circuitAddGate1(c, GATE_S, 0);
+    circuitAddGate1(c, GATE_T, 1);
+    circuitAddGate1(c, GATE_TDG, 2);
+    circuitAddFixedRotation(c, GATE_PHASE, 3, 0.45);
+    circuitAddU(c, 3, 0.9, -0.4, 1.1);
+    circuitAddGate2(c, GATE_SWAP, 0, 3);
+    circuitAddGate3(c, GATE_CSWAP, 1, 2, 0);
+    circuitAddControlledU(c, 3, 1, 1.2, 0.3, -0.7, 0.5);
+    circuitAddGate2(c, GATE_CNOT, 3, 0);
+
+    QubitState *psi = initializeState(4);
+    runCircuit(c, psi, params);
+
+    NoiseModel *noiseless = createNoiseModel(4);
+    for (int packed = 0; packed <= 1; packed++) {
+        DensityMatrix *dm = packed ? initializePackedDensityMatrix(4) : initializeDensityMatrix(4);
+        dm->matrix[0] = 1.0;
+        runNoisyCircuitDensity(c, noiseless, dm, params);
+        checkClose(packed ? "circuito senza rumore sulla matrice compatta" : "circuito senza rumore sulla matrice completa",
+                   densityDistanceFromState(dm, psi), 0.0, 1e-12);
+        freeDensityMatrix(dm);
+    }
+
+    // Canali del gate CNOT su entrambi i qubit, poi quelli del qubit 1 dopo ogni gate che lo usa
+    QuantumCircuit *noisy = createCircuit(2);
+    circuitAddGate1(noisy, GATE_H, 0);
+    circuitAddGate2(noisy, GATE_CNOT, 0, 1);
+    circuitAddFixedRotation(noisy, GATE_RY, 1, 0.7);
+    NoiseModel *model = createNoiseModel(2);
+    noiseModelAddGateChannel(model, GATE_CNOT, NOISE_DEPOLARIZING, 0.05);
+    noiseModelAddQubitChannel(model, 1, NOISE_DEPHASING, 0.1);
+    noiseModelAddQubitChannel(model, 1, NOISE_AMPLITUDE_DAMPING, 0.2);
+
+    QubitState *zero = initializeState(2);
+    DensityMatrix *expected = pureStateToDensityMatrix(zero);
+    double complex h[2][2] = {
+        { 1 / sqrt(2), 1 / sqrt(2) },
+        { 1 / sqrt(2), -1 / sqrt(2) }
+    };
+    double complex ry[2][2] = {
+        { cos(0.35), -sin(0.35) },
+        { sin(0.35), cos(0.35) }
+    };
+    applySingleQubitGateDensity(expected, 0, h);
+    applyCNOTDensity(expected, 0, 1);
+    applyDepolarizing(expected, 0, 0.05);
+    applyDepolarizing(expected, 1, 0.05);
+    applyDephasing(expected, 1, 0.1);
+    applyAmplitudeDamping(expected, 1, 0.2);
+    applySingleQubitGateDensity(expected, 1, ry);
+    applyDephasing(expected, 1, 0.1);
+    applyAmplitudeDamping(expected, 1, 0.2);
+
+    for (int packed = 0; packed <= 1; packed++) {
+        DensityMatrix *dm = packed ? pureStateToPackedDensityMatrix(zero) : pureStateToDensityMatrix(zero);
+        runNoisyCircuitDensity(noisy, model, dm, NULL);
+        checkClose(packed ? "rumore fuso nel gate (matrice compatta)" : "rumore fuso nel gate (matrice completa)",
+                   densityDistance(dm, expected), 0.0, 1e-12);
+        freeDensityMatrix(dm);
+    }
+
+    freeDensityMatrix(expected);
+    freeState(zero);
+    freeNoiseModel(model);
+    freeCircuit(noisy);
+    freeNoiseModel(noiseless);
+    freeState(psi);
+    freeCircuit(c);
+}
+
+/* ---------------------------------------------------------------------------
+ * Stati in batch: ogni colonna deve coincidere con lo stesso circuito su un QubitState
+ * ------------------------------------------------------------------------- */
+
+#define BATCH_QUBITS 4
+#define BATCH_SIZE 5
+
+static double stateDistance(QubitState *a, QubitState *b) {
+    double worst = 0.0;
+    for (long long i = 0; i < (1LL << a->numQubits); i++) {
+        double d = cabs(a->amplitudes[i] - b->amplitudes[i]);
+        if (d > worst) worst = d;
+    }
+    return worst;
+}
+
+static void testBatched(void) {
+    BatchedQubitState *batch = initializeBatchedState(BATCH_QUBITS, BATCH_SIZE);
+    QubitState *states[BATCH_SIZE];
+    double phases[BATCH_SIZE];
+    double complex cphases[BATCH_SIZE];
+    double complex gates[BATCH_SIZE][2][2];
+
+    // Stati iniziali diversi per elemento
+    for (int b = 0; b < BATCH_SIZE; b++) {
+        states[b] = initializeState(BATCH_QUBITS);
+        for (int q = 0; q < BATCH_QUBITS; q++) {
+            double t = 0.5 * (0.3 + 0.7 * b + 0.2 * q);
+            double complex ry[2][2] = {{cos(t), -sin(t)}, {sin(t), cos(t)}};
+            applySingleQubitGate(states[b], q, ry);
+            applyPhase(states[b], q, 0.1 * (b + 1) * (q + 1));
+        }
+        setBatchElement(batch, b, states[b]);
+        phases[b] = 0.4 * b - 0.9;
+        cphases[b] = cexp(I * (1.1 - 0.3 * b));
+        double c = cos(0.2 * b + 0.5), s = sin(0.2 * b + 0.5);
+        gates[b][0][0] = c;
+        gates[b][0][1] = -s * cexp(I * 0.3 * b);
+        gates[b][1][0] = s;
+        gates[b][1][1] = c * cexp(I * 0.3 * b);
+    }
+    double complex G[2][2] = {{0.6, 0.8 * I}, {0.8 * I, 0.6}};
+
+    applyHadamardBatched(batch, 1);
+    applyXBatched(batch, 3);
+    applyZBatched(batch, 0);
+    applyCNOTBatched(batch, 1, 2);
+    applyCZBatched(batch, 3, 0);
+    applyPhaseBatched(batch, 2, phases);
+    applyCPhaseShiftBatched(batch, 0, 1, cphases);
+    applySingleQubitGateBatched(batch, 2, G);
+    applySingleQubitGatePerBatch(batch, 0, gates);
+    double prob1[BATCH_SIZE];
+    probabilityOneBatched(batch, 2, prob1);
+
+    double worst = 0.0, worstProb = 0.0;
+    for (int b = 0; b < BATCH_SIZE; b++) {
+        QubitState *s = states[b];
+        applyHadamard(s, 1);
+        applyX(s, 3);
+        applyZ(s, 0);
+        applyCNOT(s, 1, 2);
+        applyCZ(s, 3, 0);
+        applyPhase(s, 2, phases[b]);
+        applyCPhaseShift(s, 0, 1, cphases[b]);
+        applySingleQubitGate(s, 2, G);
+        applySingleQubitGate(s, 0, gates[b]);
+
+        QubitState *column = getBatchElement(batch, b);
+        double d = stateDistance(column, s);
+        if (d > worst) worst = d;
+        double p = 0.0;
+        for (long long i = 0; i < (1LL << BATCH_QUBITS); i++) {
+            if ((i >> 2) & 1) p += creal(s->amplitudes[i] * conj(s->amplitudes[i]));
+        }
+        if (fabs(prob1[b] - p) > worstProb) worstProb = fabs(prob1[b] - p);
+        freeState(column);
+        freeState(s);
+    }
+    checkClose("batch: colonne uguali agli stati singoli", worst, 0.0, 1e-12);
+    checkClose("batch: probabilityOneBatched", worstProb, 0.0, 1e-12);
+    freeBatchedState(batch);
+}
+
+/* ---------------------------------------------------------------------------
+ * Gradiente aggiunto confrontato con le differenze finite centrali
+ * ------------------------------------------------------------------------- */
+
+#define GRADIENT_PARAMS 5
+
+static double circuitEnergy(QuantumCircuit *c, const double *params, const PauliTerm *terms, int numTerms) {
+    QubitState *state = initializeState(c->numQubits);
+    runCircuit(c, state, params);
+    double energy = expectationPauliSum(state, terms, numTerms);
+    freeState(state);
+    return energy;
+}
+
+static void testAdjointGradient(void) {
+    QuantumCircuit *c = createCircuit(3);
+    circuitAddGate1(c, GATE_H, 2);
+    circuitAddRotation(c, GATE_RX, 0, 0);
+    circuitAddRotation(c, GATE_RY, 1, 1);
+    circuitAddGate2(c, GATE_CNOT, 0, 1);
+    circuitAddControlledRotation(c, GATE_CPHASE, 1, 2, 2);
+    circuitAddRotation(c, GATE_RY, 2, 3);
+    circuitAddRotation(c, GATE_RX, 0, 1);   // Parametro condiviso da due gate
+    circuitAddRotation(c, GATE_PHASE, 0, 4);
+    circuitAddGate1(c, GATE_H, 0);
+    PauliTerm terms[3] = {{0.7, "ZZI"}, {0.4, "XIX"}, {-0.3, "IYZ"}};
+    double params[GRADIENT_PARAMS] = {0.3, -1.1, 0.8, 2.0, 0.5};
+    double grad[GRADIENT_PARAMS];
+
+    double energy = adjointGradient(c, params, terms, 3, grad);
+    checkClose("gradiente aggiunto: energia", energy, circuitEnergy(c, params, terms, 3), 1e-12);
+    double worst = 0.0;
+    const double h = 1e-5;
+    for (int p = 0; p < GRADIENT_PARAMS; p++) {
+        double shifted[GRADIENT_PARAMS];
+        memcpy(shifted, params, sizeof(shifted));
+        shifted[p] = params[p] + h;
+        double plus = circuitEnergy(c, shifted, terms, 3);
+        shifted[p] = params[p] - h;
+        double minus = circuitEnergy(c, shifted, terms, 3);
+        double d = fabs(grad[p] - (plus - minus) / (2.0 * h));
+        if (d > worst) worst = d;
+    }
+    checkClose("gradiente aggiunto contro differenze finite", worst, 0.0, 1e-8);
+    freeCircuit(c);
+}
+
+/* ---------------------------------------------------------------------------
+ * QFT nativa contro la matrice della definizione
+ * ------------------------------------------------------------------------- */
+
+#define QFT_QUBITS 5
+
+/* Stato di 5 qubit con ampiezze tutte diverse. */
+static QubitState* irregularState(void) {
+    QubitState *s = initializeState(QFT_QUBITS);
+    for (int q = 0; q < QFT_QUBITS; q++) {
+        applyRY(s, q, 0.3 + 0.45 * q);
+        applyRZ(s, q, 0.7 - 0.2 * q);
+    }
+    for (int q = 0; q + 1 < QFT_QUBITS; q++) {
+        applyCNOT(s, q, q + 1);
+    }
+    return s;
+}
+
+/* QFT |x> = 1/sqrt(N) sum_k e^{+-2 pi i x k / N} |k> sul registro, elemento per elemento. */
+static void referenceQFT(const QubitState *in, QubitState *out, int first, int m, int inverse) {
+    long long dim = 1LL << in->numQubits, N = 1LL << m;
+    long long regMask = (N - 1) << first;
+    double sign = inverse ? -1.0 : 1.0;
+    for (long long i = 0; i < dim; i++) out->amplitudes[i] = 0.0;
+    for (long long i = 0; i < dim; i++) {
+        long long x = (i >> first) & (N - 1), rest = i & ~regMask;
+        for (long long k = 0; k < N; k++) {
+            out->amplitudes[rest | (k << first)] +=
+                in->amplitudes[i] * cexp(sign * 2.0 * M_PI * I * (double)(x * k) / (double)N) / sqrt((double)N);
+        }
+    }
+}
+
+static void testQFT(void) {
+    // Con 4 thread: (0, 5) e (1, 4) hanno meno fibre che thread (farfalle divise tra i thread),
+    // (0, 3) e (2, 3) ne hanno 4 (una FFT per fibra, in place o nel buffer del thread)
+    int registers[5][3] = {{0, 5, 0}, {1, 4, 1}, {0, 3, 0}, {2, 3, 0}, {1, 3, 1}};
+#ifdef _OPENMP
+    int threads = omp_get_max_threads();
+    omp_set_num_threads(4);
+#endif
+    for (int r = 0; r < 5; r++) {
+        int first = registers[r][0], m = registers[r][1], inverse = registers[r][2];
+        QubitState *state = irregularState();
+        QubitState *input = irregularState();
+        QubitState *expected = initializeState(QFT_QUBITS);
+        referenceQFT(input, expected, first, m, inverse);
+        applyQFT(state, first, m, inverse);
+        char text[128];
+        snprintf(text, sizeof(text), "%s sui qubit %d ... %d", inverse ? "QFT inversa" : "QFT",
+                 first, first + m - 1);
+        checkClose(text, stateDistance(state, expected), 0.0, 1e-12);
+        freeState(expected);
+        freeState(input);
+        freeState(state);
+    }
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+}
+
+/* ---------------------------------------------------------------------------
+ * Oracolo classico: tabella di verità sugli stati base
+ * ------------------------------------------------------------------------- */
+
+/* f(x) = (3x + 1) mod 8 su 3 bit */
+static unsigned long long affineFunction(unsigned long long x, void *context) {
+    (void)context;
+    return (3 * x + 1) & 7;
+}
+
+static void testClassicalOracle(void) {
+    // Input e output non contigui e fuori ordine, con un qubit (3) che non partecipa
+    const int inputQubits[3] = {4, 0, 2};
+    const int outputQubits[3] = {6, 1, 5};
+    const int n = 7;
+    ClassicalOracle *oracle = createClassicalOracle(3, 3, affineFunction, NULL);
+    int tableOk = 1, directOk = 1;
+    for (long long i = 0; i < (1LL << n); i++) {
+        unsigned long long x = 0;
+        for (int k = 0; k < 3; k++) x |= (unsigned long long)((i >> inputQubits[k]) & 1) << k;
+        unsigned long long fx = affineFunction(x, NULL);
+        long long expected = i;
+        for (int k = 0; k < 3; k++) {
+            if ((fx >> k) & 1) expected ^= 1LL << outputQubits[k];
+        }
+
+        QubitState *s = initializeState(n);
+        s->amplitudes[0] = 0.0;
+        s->amplitudes[i] = 1.0;
+        applyClassicalOracleTable(s, oracle, inputQubits, outputQubits);
+        if (cabs(s->amplitudes[expected] - 1.0) > 1e-15) tableOk = 0;
+        applyClassicalOracle(s, inputQubits, 3, outputQubits, 3, affineFunction, NULL);
+        if (cabs(s->amplitudes[i] - 1.0) > 1e-15) directOk = 0;
+        freeState(s);
+    }
+    checkTrue("oracolo da tabella: |x>|y> -> |x>|y xor f(x)> su tutti gli stati base", tableOk);
+    checkTrue("oracolo applicato due volte: identità su tutti gli stati base", directOk);
+    freeClassicalOracle(oracle);
+}
+
+/* ---------------------------------------------------------------------------
+ * Misura e campionamento su uno stato misto noto:
+ * \rho = 0.6 |psi><psi| + 0.4 |11><11|,  |psi> = (|00> + |01>) / sqrt(2)
+ * ------------------------------------------------------------------------- */
+
+#define MEASURE_TRIALS 2000
+
+static DensityMatrix* knownMixedState(int packed) {
+    DensityMatrix *full = initializeDensityMatrix(2);
+    full->matrix[0 * 4 + 0] = 0.3;
+    full->matrix[0 * 4 + 1] = 0.3;
+    full->matrix[1 * 4 + 0] = 0.3;
+    full->matrix[1 * 4 + 1] = 0.3;
+    full->matrix[3 * 4 + 3] = 0.4;
+    if (!packed) return full;
+    DensityMatrix *dm = packDensityMatrix(full);
+    freeDensityMatrix(full);
+    return dm;
+}
+
+static void testMeasureDensity(void) {
+    // Stati dopo la misura del qubit 0: |00><00| per 0, (0.3 |01><01| + 0.4 |11><11|) / 0.7 per 1
+    const double after[2][4] = {{1.0, 0.0, 0.0, 0.0}, {0.0, 0.3 / 0.7, 0.0, 0.4 / 0.7}};
+    for (int packed = 0; packed < 2; packed++) {
+        const char *format = packed ? "compatta" : "completa";
+        long long ones = 0;
+        double probError = 0.0, stateError = 0.0;
+        for (int t = 0; t < MEASURE_TRIALS; t++) {
+            DensityMatrix *dm = knownMixedState(packed);
+            MeasurementResult r = measureDensity(dm, 0);
+            ones += r.result;
+            probError = fmax(probError, fabs(r.prob1 - 0.7));
+            for (long long i = 0; i < 4; i++) {
+                for (long long j = 0; j < 4; j++) {
+                    double expected = (i == j) ? after[r.result][i] : 0.0;
+                    stateError = fmax(stateError, cabs(getDensityElement(dm, i, j) - expected));
+                }
+            }
+            freeDensityMatrix(dm);
+        }
+        char text[128];
+        snprintf(text, sizeof(text), "measureDensity (%s): P(1) = 0.7", format);
+        checkClose(text, probError, 0.0, 1e-12);
+        snprintf(text, sizeof(text), "measureDensity (%s): stato dopo la misura", format);
+        checkClose(text, stateError, 0.0, 1e-12);
+        snprintf(text, sizeof(text), "measureDensity (%s): frequenza dell'esito 1", format);
+        checkClose(text, (double)ones / MEASURE_TRIALS, 0.7, 5.0 * sqrt(0.7 * 0.3 / MEASURE_TRIALS));
+
+        // Esiti di probabilità nulla: il qubit 1 di |00><00| dà sempre 0 e lo stato resta finito
+        int zeroOk = 1;
+        QubitState *zero = initializeState(2);
+        for (int t = 0; t < MEASURE_TRIALS && zeroOk; t++) {
+            DensityMatrix *pure = packed ? pureStateToPackedDensityMatrix(zero) : pureStateToDensityMatrix(zero);
+            MeasurementResult r = measureDensity(pure, 1);
+            if (r.result != 0 || r.prob1 != 0.0 || getDensityElement(pure, 0, 0) != 1.0) zeroOk = 0;
+            freeDensityMatrix(pure);
+        }
+        freeState(zero);
+        snprintf(text, sizeof(text), "measureDensity (%s): esito di probabilità nulla mai scelto", format);
+        checkTrue(text, zeroOk);
+
+        // Campionamento di tutti i qubit dalla diagonale (0.3, 0.3, 0, 0.4)
+        const double diagonal[4] = {0.3, 0.3, 0.0, 0.4};
+        const long long shots = 20000;
+        DensityMatrix *dm = knownMixedState(packed);
+        long long *counts = sampleShotsDensity(dm, shots);
+        int histogramOk = 1;
+        for (int k = 0; k < 4; k++) {
+            double sigma = sqrt(diagonal[k] * (1.0 - diagonal[k]) / shots);
+            if (fabs((double)counts[k] / shots - diagonal[k]) > 5.0 * sigma) histogramOk = 0;
+        }
+        snprintf(text, sizeof(text), "sampleShotsDensity (%s): istogramma della diagonale", format);
+        checkTrue(text, histogramOk);
+        freeShotsDensity(counts, 2);
+        freeDensityMatrix(dm);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Traccia parziale e stati ridotti
+ * ------------------------------------------------------------------------- */
+
+static void testPartialTrace(void) {
+    // Coppia di Bell sui qubit 0 e 1, qubit 2 in |1>
+    QubitState *psi = initializeState(3);
+    applyHadamard(psi, 0);
+    applyCNOT(psi, 0, 1);
+    applyX(psi, 2);
+    DensityMatrix *dm = pureStateToDensityMatrix(psi);
+    DensityMatrix *packed = pureStateToPackedDensityMatrix(psi);
+
+    DensityMatrix *reduced[3] = {
+        partialTrace(dm, 1), partialTrace(packed, 1), reducedDensityFromState(psi, 1)
+    };
+    const char *names[3] = {"completa", "compatta", "dal vettore di stato"};
+    for (int k = 0; k < 3; k++) {
+        char text[128];
+        snprintf(text, sizeof(text), "traccia parziale di una coppia di Bell (%s)", names[k]);
+        checkOneQubitDensity(text, reduced[k], 0.5, 0.0);
+        freeDensityMatrix(reduced[k]);
+    }
+
+    DensityMatrix *third = reducedDensityFromState(psi, 4);
+    checkOneQubitDensity("stato ridotto di un qubit separabile", third, 1.0, 0.0);
+    DensityMatrix *pair = partialTrace(dm, 3);
+    QubitState *bell = initializeState(2);
+    applyHadamard(bell, 0);
+    applyCNOT(bell, 0, 1);
+    checkClose("traccia parziale sul qubit separabile", densityDistanceFromState(pair, bell), 0.0, 1e-14);
+
+    freeState(bell);
+    freeDensityMatrix(pair);
+    freeDensityMatrix(third);
+    freeDensityMatrix(packed);
+    freeDensityMatrix(dm);
+    freeState(psi);
+
+    // Stato entangled di 5 qubit: maschere non contigue con 2 qubit tenuti (somma divisa tra
+    // i thread), 3 e 4 (elementi divisi tra i thread), contro la definizione elemento per elemento
+    QubitState *mixed = initializeState(5);
+    for (int q = 0; q < 5; q++) {
+        applyRY(mixed, q, 0.4 + 0.5 * q);
+        applyRZ(mixed, q, 0.3 * q - 0.2);
+    }
+    for (int q = 0; q < 4; q++) {
+        applyCNOT(mixed, q, q + 1);
+    }
+    applyRX(mixed, 2, 0.7);
+    dm = pureStateToDensityMatrix(mixed);
+    packed = pureStateToPackedDensityMatrix(mixed);
+    long long masks[3] = {0x05, 0x16, 0x1B};
+    for (int k = 0; k < 3; k++) {
+        long long keep = masks[k];
+        int numKeep = __builtin_popcountll(keep);
+        long long dimR = 1LL << numKeep;
+        DensityMatrix *expected = initializeDensityMatrix(numKeep);
+        for (long long i = 0; i < 32; i++) {
+            for (long long j = 0; j < 32; j++) {
+                if ((i ^ j) & ~keep & 31) continue;
+                long long a = 0, b = 0;
+                for (int q = 0, bit = 0; q < 5; q++) {
+                    if (!((keep >> q) & 1)) continue;
+                    a |= ((i >> q) & 1) << bit;
+                    b |= ((j >> q) & 1) << bit;
+                    bit++;
+                }
+                expected->matrix[a * dimR + b] += dm->matrix[i * 32 + j];
+            }
+        }
+        DensityMatrix *results[3] = {
+            partialTrace(dm, keep), partialTrace(packed, keep), reducedDensityFromState(mixed, keep)
+        };
+        for (int r = 0; r < 3; r++) {
+            char text[128];
+            snprintf(text, sizeof(text), "traccia parziale su 5 qubit, maschera 0x%llx (%s)", keep, names[r]);
+            checkClose(text, densityDistance(results[r], expected), 0.0, 1e-13);
+            freeDensityMatrix(results[r]);
+        }
+        freeDensityMatrix(expected);
+    }
+    freeDensityMatrix(packed);
+    freeDensityMatrix(dm);
+    freeState(mixed);
+}
+
+/* ---------------------------------------------------------------------------
+ * Metriche
+ * ------------------------------------------------------------------------- */
+
+/* Matrice densità di un qubit con gli elementi indicati. */
+static DensityMatrix* oneQubitDensity(double rho00, double complex rho01) {
+    DensityMatrix *dm = initializeDensityMatrix(1);
+    dm->matrix[0] = rho00;
+    dm->matrix[1] = rho01;
+    dm->matrix[2] = conj(rho01);
+    dm->matrix[3] = 1.0 - rho00;
+    return dm;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void testEigenvalues(void) {
+    // Y (x) I + 0.5 Z (x) Z: i due termini anticommutano, autovalori +-sqrt(1.25) doppi
+    double complex H[16] = {0};
+    for (long long r = 0; r < 4; r++) {
+        long long low = r & 1, high = r >> 1;
+        double zz = (low == high) ? 0.5 : -0.5;
+        H[r * 4 + r] += zz;
+        // Y sul qubit 1 (bit alto dell'indice): <0|Y|1> = -i, <1|Y|0> = i
+        long long flipped = r ^ 2;
+        H[flipped * 4 + r] += high ? -I : I;
+    }
+    double eig[4];
+    hermitianEigenvalues(H, 4, eig);
+    double expected[4] = {-sqrt(1.25), -sqrt(1.25), sqrt(1.25), sqrt(1.25)};
+    for (int k = 0; k < 4; k++) {
+        checkClose("autovalori di Y(x)I + 0.5 Z(x)Z", eig[k], expected[k], 1e-12);
+    }
+
+    // V D V con V = I - 2 v v^dagger / |v|^2 (hermitiana e unitaria): autovalori noti, con
+    // ripetizioni, di una matrice complessa di dimensione non potenza di 2
+    const long long d = 37;
+    double complex *v = malloc(d * sizeof(double complex));
+    double complex *A = malloc(d * d * sizeof(double complex));
+    double *diagonal = malloc(d * sizeof(double));
+    double *values = malloc(d * sizeof(double));
+    if (!v || !A || !diagonal || !values) {
+        perror("Errore allocazione in testEigenvalues");
+        exit(1);
+    }
+    double norm2 = 0.0;
+    for (long long k = 0; k < d; k++) {
+        v[k] = cos(0.7 * k + 0.1) + I * sin(1.3 * k * k + 0.2);
+        norm2 += creal(v[k] * conj(v[k]));
+        diagonal[k] = (double)(k % 11) - 4.5;
+    }
+    for (long long r = 0; r < d; r++) {
+        for (long long c = 0; c < d; c++) {
+            // (V D V)[r][c] = sum_k V[r][k] D[k] V[k][c]
+            double complex sum = 0.0;
+            for (long long k = 0; k < d; k++) {
+                double complex vrk = (r == k ? 1.0 : 0.0) - 2.0 * v[r] * conj(v[k]) / norm2;
+                double complex vkc = (k == c ? 1.0 : 0.0) - 2.0 * v[k] * conj(v[c]) / norm2;
+                sum += vrk * diagonal[k] * vkc;
+            }
+            A[r * d + c] = sum;
+        }
+    }
+    hermitianEigenvalues(A, d, values);
+    qsort(diagonal, d, sizeof(double), compareDoubles);
+    double worst = 0.0;
+    for (long long k = 0; k < d; k++) {
+        if (fabs(values[k] - diagonal[k]) > worst) worst = fabs(values[k] - diagonal[k]);
+    }
+    checkClose("autovalori di una matrice hermitiana 37x37", worst, 0.0, 1e-10);
+    free(values);
+    free(diagonal);
+    free(A);
+    free(v);
+}
+
+static void testMetrics(void) {
+    QubitState *zero = initializeState(1);
+    QubitState *plus = plusState();
+    checkClose("fedeltà tra |0> e |+>", fidelityStates(zero, plus), 0.5, 1e-14);
+    checkClose("distanza di traccia tra |0> e |+>", traceDistanceStates(zero, plus), sqrt(0.5), 1e-7);
+
+    // Stati misti di un qubit: F = Tr(ab) + 2 sqrt(det a det b), D = sqrt(d00^2 + |d01|^2)
+    DensityMatrix *a = oneQubitDensity(0.5, 0.4);
+    DensityMatrix *b = oneQubitDensity(0.65, 0.5 * sqrt(0.7));
+    double complex trab = 0.0;
+    for (int i = 0; i < 2; i++)
+        for (int j = 0; j < 2; j++)
+            trab += a->matrix[i * 2 + j] * b->matrix[j * 2 + i];
+    double detA = 0.25 - 0.16, detB = 0.65 * 0.35 - 0.25 * 0.7;
+    checkClose("fedeltà di Uhlmann tra stati misti", fidelityDensity(a, b),
+               creal(trab) + 2.0 * sqrt(detA * detB), 1e-10);
+    checkClose("distanza di traccia tra stati misti", traceDistanceDensity(a, b),
+               sqrt(0.15 * 0.15 + pow(0.4 - 0.5 * sqrt(0.7), 2)), 1e-10);
+    checkClose("fedeltà tra |+> e uno stato misto", fidelityStateDensity(plus, a), 0.9, 1e-14);
+    checkClose("purezza", purityDensity(a), 0.25 + 0.25 + 2 * 0.16, 1e-14);
+
+    DensityMatrix *pure = pureStateToDensityMatrix(plus);
+    checkClose("fedeltà con una matrice pura", fidelityDensity(pure, a), 0.9, 1e-10);
+    checkClose("distanza di traccia con una matrice pura", traceDistanceDensity(a, pure),
+               sqrt(0.1 * 0.1), 1e-10);
+    checkClose("entropia di uno stato puro", vonNeumannEntropy(pure), 0.0, 1e-10);
+
+    DensityMatrix *diagonal = oneQubitDensity(0.8, 0.0);
+    checkClose("entropia di von Neumann", vonNeumannEntropy(diagonal),
+               -0.8 * log2(0.8) - 0.2 * log2(0.2), 1e-10);
+
+    DensityMatrix *mixed = initializeDensityMatrix(2);
+    for (int k = 0; k < 4; k++) mixed->matrix[k * 4 + k] = 0.25;
+    checkClose("entropia dello stato massimamente misto", vonNeumannEntropy(mixed), 2.0, 1e-10);
+    checkClose("purezza dello stato massimamente misto", purityDensity(mixed), 0.25, 1e-14);
+
+    QubitState *bell = initializeState(3);
+    applyHadamard(bell, 0);
+    applyCNOT(bell, 0, 1);
+    applyHadamard(bell, 2);
+    checkClose("entropia di entanglement di una coppia di Bell", entanglementEntropy(bell, 1), 1.0, 1e-10);
+    checkClose("entropia di entanglement di un qubit separabile", entanglementEntropy(bell, 4), 0.0, 1e-10);
+    DensityMatrix *bellDensity = pureStateToDensityMatrix(bell);
+    checkClose("entropia ridotta di una coppia di Bell", reducedEntropyDensity(bellDensity, 2), 1.0, 1e-10);
+
+    freeDensityMatrix(bellDensity);
+    freeState(bell);
+    freeDensityMatrix(mixed);
+    freeDensityMatrix(diagonal);
+    freeDensityMatrix(pure);
+    freeDensityMatrix(b);
+    freeDensityMatrix(a);
+    freeState(plus);
+    freeState(zero);
+
+    testEigenvalues();
+}
+
+/* ---------------------------------------------------------------------------
+ * Traiettorie: le medie devono riprodurre i valori della matrice densità
+ * ------------------------------------------------------------------------- */
+
+typedef enum { CHANNEL_DEPHASING, CHANNEL_DAMPING, CHANNEL_DEPOLARIZING, CHANNEL_THERMAL } TestChannel;
+
+static void channelTrajectory(QubitState *state, TrajectoryRng *rng, void *context) {
+    TestChannel channel = *(const TestChannel *)context;
+    if (channel == CHANNEL_DEPOLARIZING) {
+        applyDepolarizingTrajectory(state, 0, 0.2, rng);   // Parte da |0>
+        return;
+    }
+    applyHadamard(state, 0);
+    switch (channel) {
+        case CHANNEL_DEPHASING: applyDephasingTrajectory(state, 0, 0.1, rng); break;
+        case CHANNEL_DAMPING:   applyAmplitudeDampingTrajectory(state, 0, 0.3, rng); break;
+        default:                applyThermalRelaxationTrajectory(state, 0, 50.0, 30.0, 10.0, rng); break;
+    }
+}
+
+static double observableZ(QubitState *state, void *context) {
+    (void)context;
+    return creal(state->amplitudes[0] * conj(state->amplitudes[0]) - state->amplitudes[1] * conj(state->amplitudes[1]));
+}
+
+static double observableX(QubitState *state, void *context) {
+    (void)context;
+    return 2.0 * creal(conj(state->amplitudes[0]) * state->amplitudes[1]);
+}
+
+static void testTrajectories(void) {
+    const int numTrajectories = 4000;
+    TrajectoryObservable observables[2] = {observableZ, observableX};
+    const char *names[4] = {"dephasing", "amplitude damping", "depolarizzante", "rilassamento termico"};
+    // <Z> e <X> attesi (stessi parametri di testChannels)
+    double expected[4][2] = {
+        {0.0, 0.8},
+        {0.3, sqrt(0.7)},
+        {0.8, 0.0},
+        {1.0 - exp(-10.0 / 50.0), exp(-10.0 / 30.0)}
+    };
+
+    for (int ch = 0; ch < 4; ch++) {
+        TestChannel channel = (TestChannel)ch;
+        TrajectoryResult *r = runTrajectories(1, numTrajectories, 1234, channelTrajectory, &channel,
+                                              observables, 2, 1);
+        for (int k = 0; k < 2; k++) {
+            char text[128];
+            snprintf(text, sizeof(text), "traiettorie %s: <%s>", names[ch], k ? "X" : "Z");
+            checkClose(text, r->mean[k], expected[ch][k], 5.0 * r->stdError[k] + 1e-12);
+        }
+        if (ch == CHANNEL_DAMPING) {
+            // Stesso seme: stessi risultati; gli esiti campionati sono uno per traiettoria
+            TrajectoryResult *again = runTrajectories(1, numTrajectories, 1234, channelTrajectory, &channel,
+                                                      observables, 2, 1);
+            checkTrue("traiettorie riproducibili con lo stesso seme",
+                      again->mean[0] == r->mean[0] && again->mean[1] == r->mean[1]);
+            ShotHistogram *h = trajectoryShotHistogram(r, 1);
+            long long total = 0, ones = 0;
+            for (int k = 0; k < h->numOutcomes; k++) {
+                total += h->outcomes[k].count;
+                if (h->outcomes[k].value == 1) ones = h->outcomes[k].count;
+            }
+            checkTrue("istogramma delle traiettorie completo", total == numTrajectories);
+            double p1 = 0.35;
+            checkClose("frequenza di |1> dopo amplitude damping", (double)ones / numTrajectories, p1,
+                       5.0 * sqrt(p1 * (1 - p1) / numTrajectories));
+            freeShotHistogram(h);
+            freeTrajectoryResult(again);
+        }
+        freeTrajectoryResult(r);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Rumore dei qubit inattivi: un solo passaggio per tutti i qubit deve coincidere con il
+ * rilassamento termico applicato un qubit alla volta
+ * ------------------------------------------------------------------------- */
+
+#define IDLE_QUBITS 6
+#define IDLE_TRAJECTORIES 4000
+
+static const double idleT1[IDLE_QUBITS] = {8.0, 9.0, 10.0, 11.0, 12.0, 13.0};
+static const double idleT2[IDLE_QUBITS] = {5.0, 7.0, 9.0, 11.0, 13.0, 15.0};
+
+/* H q0, X q1, CNOT q0,q2, X q3, H q5: q4 resta in |0> e non deve cambiare. */
+static void idleStateGates(QubitState *state, DensityMatrix *dm) {
+    double s = 1.0 / sqrt(2.0);
+    double complex H[2][2] = {{s, s}, {s, -s}};
+    double complex X[2][2] = {{0, 1}, {1, 0}};
+    if (state) {
+        applyHadamard(state, 0);
+        applyX(state, 1);
+        applyCNOT(state, 0, 2);
+        applyX(state, 3);
+        applyHadamard(state, 5);
+    }
+    if (dm) {
+        applySingleQubitGateDensity(dm, 0, H);
+        applySingleQubitGateDensity(dm, 1, X);
+        applyCNOTDensity(dm, 0, 2);
+        applySingleQubitGateDensity(dm, 3, X);
+        applySingleQubitGateDensity(dm, 5, H);
+    }
+}
+
+static void idleTrajectory(QubitState *state, TrajectoryRng *rng, void *context) {
+    (void)context;
+    idleStateGates(state, NULL);
+    applyIdleThermalRelaxationTrajectory(state, (1LL << IDLE_QUBITS) - 1, idleT1, idleT2, 2.0, rng);
+}
+
+static void testIdleRelaxation(void) {
+    // Riferimento: un qubit alla volta; i 6 qubit inattivi richiedono due gruppi da 5 e 1
+    DensityMatrix *expected = initializeDensityMatrix(IDLE_QUBITS);
+    expected->matrix[0] = 1.0;
+    idleStateGates(NULL, expected);
+    for (int q = 0; q < IDLE_QUBITS; q++) {
+        applyThermalRelaxation(expected, q, idleT1[q], idleT2[q], 2.0);
+    }
+
+    for (int packed = 0; packed <= 1; packed++) {
+        DensityMatrix *dm = packed ? initializePackedDensityMatrix(IDLE_QUBITS) : initializeDensityMatrix(IDLE_QUBITS);
+        dm->matrix[0] = 1.0;
+        idleStateGates(NULL, dm);
+        applyIdleThermalRelaxation(dm, (1LL << IDLE_QUBITS) - 1, idleT1, idleT2, 2.0);
+        checkClose(packed ? "rumore dei qubit inattivi (compatta)" : "rumore dei qubit inattivi (completa)",
+                   densityDistance(dm, expected), 0.0, 1e-12);
+        freeDensityMatrix(dm);
+    }
+
+    // Le traiettorie devono campionare la diagonale del riferimento
+    TrajectoryResult *r = runTrajectories(IDLE_QUBITS, IDLE_TRAJECTORIES, 99, idleTrajectory, NULL, NULL, 0, 1);
+    ShotHistogram *h = trajectoryShotHistogram(r, IDLE_QUBITS);
+    long long counts[1 << IDLE_QUBITS] = {0};
+    for (int k = 0; k < h->numOutcomes; k++) {
+        counts[h->outcomes[k].value] = h->outcomes[k].count;
+    }
+    int histogramOk = 1;
+    for (long long i = 0; i < (1LL << IDLE_QUBITS); i++) {
+        double p = creal(expected->matrix[i * (1LL << IDLE_QUBITS) + i]);
+        double sigma = sqrt(p * (1.0 - p) / IDLE_TRAJECTORIES);
+        if (fabs((double)counts[i] / IDLE_TRAJECTORIES - p) > 5.0 * sigma + 1e-12) histogramOk = 0;
+    }
+    checkTrue("rumore dei qubit inattivi (traiettorie)", histogramOk);
+
+    freeShotHistogram(h);
+    freeTrajectoryResult(r);
+    freeDensityMatrix(expected);
+}
+
+/* ---------------------------------------------------------------------------
+ * Budget di memoria: contabilità delle allocazioni e scelta della rappresentazione
+ * ------------------------------------------------------------------------- */
+
+#define BUDGET_QUBITS 6
+
+static void testMemoryBudget(void) {
+    size_t base = currentMemoryUsage();
+    DensityMatrix *full = initializeDensityMatrix(BUDGET_QUBITS);
+    checkTrue("memoria contabilizzata per la matrice densità",
+              currentMemoryUsage() - base == densityMatrixBytes(BUDGET_QUBITS, 0));
+    DensityMatrix *packed = initializePackedDensityMatrix(BUDGET_QUBITS);
+    checkTrue("memoria contabilizzata per la matrice compatta",
+              currentMemoryUsage() - base == densityMatrixBytes(BUDGET_QUBITS, 0) + densityMatrixBytes(BUDGET_QUBITS, 1));
+    QubitState *psi = initializeState(BUDGET_QUBITS);
+    checkTrue("memoria contabilizzata per il vettore di stato",
+              currentMemoryUsage() - base == densityMatrixBytes(BUDGET_QUBITS, 0) + densityMatrixBytes(BUDGET_QUBITS, 1)
+                                             + stateVectorBytes(BUDGET_QUBITS));
+    freeState(psi);
+    freeDensityMatrix(packed);
+    freeDensityMatrix(full);
+    checkTrue("memoria restituita dopo le liberazioni", currentMemoryUsage() == base);
+
+    // Ogni soglia ammette la rappresentazione indicata ma non quella più accurata
+    size_t savedBudget = getMemoryBudget();
+    const size_t budgets[4] = {
+        0,
+        base + densityMatrixBytes(BUDGET_QUBITS, 1),
+        base + 4 * stateVectorBytes(BUDGET_QUBITS),
+        base + stateVectorBytes(BUDGET_QUBITS) / 2
+    };
+    const SimulationBackend expected[4] = {
+        BACKEND_DENSITY, BACKEND_PACKED_DENSITY, BACKEND_TRAJECTORIES, BACKEND_NONE
+    };
+    const char *names[4] = {"senza budget", "matrice compatta", "traiettorie", "nessuna"};
+    for (int k = 0; k < 4; k++) {
+        setMemoryBudget(budgets[k]);
+        char text[128];
+        snprintf(text, sizeof(text), "chooseNoisyBackend (%s)", names[k]);
+        checkTrue(text, chooseNoisyBackend(BUDGET_QUBITS, 4) == expected[k]);
+    }
+    setMemoryBudget(savedBudget);
+}
+
+/* ---------------------------------------------------------------------------
+ * runNoisyCircuitShots con le tre rappresentazioni
+ * ------------------------------------------------------------------------- */
+
+#define SHOT_QUBITS 6
+#define NUM_SHOTS 2000
+
+static QuantumCircuit* noisyShotCircuit(void) {
+    QuantumCircuit *c = createCircuit(SHOT_QUBITS);
+    circuitAddGate1(c, GATE_H, 0);
+    circuitAddGate2(c, GATE_CNOT, 0, 1);
+    circuitAddGate2(c, GATE_CNOT, 1, 2);
+    circuitAddFixedRotation(c, GATE_RY, 3, 0.8);
+    circuitAddGate2(c, GATE_CNOT, 3, 4);
+    circuitAddGate1(c, GATE_X, 5);
+    circuitAddGate1(c, GATE_H, 5);
+    circuitAddFixedRotation(c, GATE_RX, 5, 0.5);
+    return c;
+}
+
+static NoiseModel* noisyShotModel(void) {
+    NoiseModel *model = createNoiseModel(SHOT_QUBITS);
+    noiseModelAddGateChannel(model, GATE_CNOT, NOISE_DEPOLARIZING, 0.05);
+    noiseModelAddGateChannel(model, GATE_H, NOISE_DEPHASING, 0.04);
+    noiseModelAddQubitChannel(model, 5, NOISE_AMPLITUDE_DAMPING, 0.2);
+    return model;
+}
+
+/* Verifica le frequenze dell'istogramma rispetto alla diagonale di \rho. */
+static void checkHistogram(const char *description, const ShotHistogram *h, const double *probabilities) {
+    char text[160];
+    long long total = 0;
+    int impossible = 0;
+    double worst = 0.0;
+    for (int k = 0; k < h->numOutcomes; k++) {
+        double p = probabilities[h->outcomes[k].value];
+        total += h->outcomes[k].count;
+        if (p < 1e-12) impossible++;
+    }
+    for (long long i = 0; i < (1LL << SHOT_QUBITS); i++) {
+        long long count = 0;
+        for (int k = 0; k < h->numOutcomes; k++) {
+            if (h->outcomes[k].value == i) count = h->outcomes[k].count;
+        }
+        double p = probabilities[i];
+        double deviation = fabs((double)count / NUM_SHOTS - p) / (sqrt(p * (1 - p) / NUM_SHOTS) + 1e-12);
+        if (deviation > worst) worst = deviation;
+    }
+    snprintf(text, sizeof(text), "%s: numero di esecuzioni", description);
+    checkTrue(text, total == NUM_SHOTS);
+    snprintf(text, sizeof(text), "%s: esiti impossibili", description);
+    checkTrue(text, impossible == 0);
+    snprintf(text, sizeof(text), "%s: scarto massimo in errori standard", description);
+    checkClose(text, worst, 0.0, 5.0);
+}
+
+static int sameHistogram(const ShotHistogram *a, const ShotHistogram *b) {
+    if (a->numOutcomes != b->numOutcomes) return 0;
+    for (int k = 0; k < a->numOutcomes; k++) {
+        if (a->outcomes[k].value != b->outcomes[k].value || a->outcomes[k].count != b->outcomes[k].count) return 0;
+    }
+    return 1;
+}
+
+static void testNoisyShots(void) {
+    QuantumCircuit *unitary = noisyShotCircuit();
+    NoiseModel *model = noisyShotModel();
+
+    // Probabilità di riferimento dalla diagonale della matrice densità
+    DensityMatrix *dm = initializeDensityMatrix(SHOT_QUBITS);
+    dm->matrix[0] = 1.0;
+    runNoisyCircuitDensity(unitary, model, dm, NULL);
+    double probabilities[1 << SHOT_QUBITS];
+    for (long long i = 0; i < (1LL << SHOT_QUBITS); i++) {
+        probabilities[i] = creal(getDensityElement(dm, i, i));
+    }
+    freeDensityMatrix(dm);
+
+    QuantumCircuit *measured = noisyShotCircuit();
+    for (int q = 0; q < SHOT_QUBITS; q++) {
+        circuitAddMeasure(measured, q, q);
+    }
+
+    // Budget: illimitato (matrice completa), tra la compatta e la completa, solo vettori di stato
+    size_t valueBytes = NUM_SHOTS * sizeof(long long);
+    size_t budgets[3] = {
+        0,
+        valueBytes + (densityMatrixBytes(SHOT_QUBITS, 0) + densityMatrixBytes(SHOT_QUBITS, 1)) / 2,
+        valueBytes + densityMatrixBytes(SHOT_QUBITS, 1) / 2
+    };
+    SimulationBackend backends[3] = {BACKEND_DENSITY, BACKEND_PACKED_DENSITY, BACKEND_TRAJECTORIES};
+    const char *names[3] = {"shot rumorosi (matrice completa)", "shot rumorosi (matrice compatta)",
+                            "shot rumorosi (traiettorie)"};
+    size_t savedBudget = getMemoryBudget();
+    for (int k = 0; k < 3; k++) {
+        setMemoryBudget(budgets[k]);
+        // Il chooser vede il budget restante dopo l'allocazione dei risultati
+        void *values = budgetMalloc(valueBytes, "risultati simulati");
+        checkTrue(names[k], chooseNoisyBackend(SHOT_QUBITS, 1) == backends[k]);
+        budgetFree(values, valueBytes);
+
+        ShotHistogram *h = runNoisyCircuitShots(measured, model, NUM_SHOTS, NULL, 42);
+        checkHistogram(names[k], h, probabilities);
+        if (backends[k] == BACKEND_TRAJECTORIES) {
+            ShotHistogram *again = runNoisyCircuitShots(measured, model, NUM_SHOTS, NULL, 42);
+            checkTrue("traiettorie riproducibili con lo stesso seme", sameHistogram(h, again));
+            freeShotHistogram(again);
+#ifdef _OPENMP
+            int threads = omp_get_max_threads();
+            omp_set_num_threads(1);
+            ShotHistogram *serial = runNoisyCircuitShots(measured, model, NUM_SHOTS, NULL, 42);
+            omp_set_num_threads(threads);
+            checkTrue("traiettorie indipendenti dal numero di thread", sameHistogram(h, serial));
+            freeShotHistogram(serial);
+#endif
+            // Misure intermedie: ogni misura è un passaggio sullo stato invece del campionamento finale
+            QuantumCircuit *midway = createCircuit(SHOT_QUBITS);
+            for (int k = 0; k < unitary->numOps; k++) {
+                if (k == 5) {
+                    for (int q = 0; q < 5; q++) circuitAddMeasure(midway, q, q);
+                }
+                circuitAddOp(midway, &unitary->ops[k]);
+            }
+            circuitAddMeasure(midway, 5, 5);
+            checkTrue("misure intermedie non finali", !circuitHasTerminalMeasurements(midway));
+            ShotHistogram *perMeasure = runNoisyCircuitShots(midway, model, NUM_SHOTS, NULL, 42);
+            checkHistogram("shot rumorosi (traiettorie, misure intermedie)", perMeasure, probabilities);
+            freeShotHistogram(perMeasure);
+            freeCircuit(midway);
+        }
+        freeShotHistogram(h);
+    }
+    setMemoryBudget(savedBudget);
+
+    freeCircuit(measured);
+    freeNoiseModel(model);
+    freeCircuit(unitary);
+}
+
+/*
+ * Rumore dei qubit inattivi nel modello di rumore: H e X durano 1, CNOT 3, ogni qubit ha i propri T1 e T2.
+ * Strato 0: H q0, X q1, X q3, H q5 (q2 e q4 inattivi per 1); strato 1: CNOT q0,q2 e
+ * CNOT q1,q4 (q3 e q5 inattivi per 3). Il riferimento applica gli stessi canali uno per uno.
+ */
+static QuantumCircuit* idleNoiseCircuit(void) {
+    QuantumCircuit *c = createCircuit(SHOT_QUBITS);
+    circuitAddGate1(c, GATE_H, 0);
+    circuitAddGate1(c, GATE_X, 1);
+    circuitAddGate2(c, GATE_CNOT, 0, 2);
+    circuitAddGate1(c, GATE_X, 3);
+    circuitAddGate2(c, GATE_CNOT, 1, 4);
+    circuitAddGate1(c, GATE_H, 5);
+    return c;
+}
+
+static void testIdleScheduling(void) {
+    double T1[SHOT_QUBITS], T2[SHOT_QUBITS];
+    NoiseModel *model = createNoiseModel(SHOT_QUBITS);
+    for (int q = 0; q < SHOT_QUBITS; q++) {
+        T1[q] = 8.0 + q;
+        T2[q] = 5.0 + 2.0 * q;
+        noiseModelSetRelaxationTimes(model, q, T1[q], T2[q]);
+    }
+    noiseModelAddGateChannel(model, GATE_H, NOISE_THERMAL_RELAXATION, 1.0);
+    noiseModelAddGateChannel(model, GATE_X, NOISE_THERMAL_RELAXATION, 1.0);
+    noiseModelAddGateChannel(model, GATE_CNOT, NOISE_THERMAL_RELAXATION, 3.0);
+
+    double s = 1.0 / sqrt(2.0);
+    double complex H[2][2] = {{s, s}, {s, -s}};
+    double complex X[2][2] = {{0, 1}, {1, 0}};
+    DensityMatrix *expected = initializeDensityMatrix(SHOT_QUBITS);
+    expected->matrix[0] = 1.0;
+    applySingleQubitGateDensity(expected, 0, H);
+    applySingleQubitGateDensity(expected, 1, X);
+    applySingleQubitGateDensity(expected, 3, X);
+    applySingleQubitGateDensity(expected, 5, H);
+    for (int q = 0; q < SHOT_QUBITS; q++) {
+        applyThermalRelaxation(expected, q, T1[q], T2[q], 1.0);
+    }
+    applyCNOTDensity(expected, 0, 2);
+    applyCNOTDensity(expected, 1, 4);
+    for (int q = 0; q < SHOT_QUBITS; q++) {
+        applyThermalRelaxation(expected, q, T1[q], T2[q], 3.0);
+    }
+
+    for (int packed = 0; packed <= 1; packed++) {
+        QuantumCircuit *c = idleNoiseCircuit();
+        DensityMatrix *dm = packed ? initializePackedDensityMatrix(SHOT_QUBITS) : initializeDensityMatrix(SHOT_QUBITS);
+        dm->matrix[0] = 1.0;
+        runNoisyCircuitDensity(c, model, dm, NULL);
+        checkClose(packed ? "qubit inattivi per strati (compatta)" : "qubit inattivi per strati (completa)",
+                   densityDistance(dm, expected), 0.0, 1e-12);
+        freeDensityMatrix(dm);
+        freeCircuit(c);
+    }
+
+    // Le traiettorie applicano lo stesso rumore con applyIdleThermalRelaxationTrajectory
+    double probabilities[1 << SHOT_QUBITS];
+    for (long long i = 0; i < (1LL << SHOT_QUBITS); i++) {
+        probabilities[i] = creal(getDensityElement(expected, i, i));
+    }
+    QuantumCircuit *measured = idleNoiseCircuit();
+    for (int q = 0; q < SHOT_QUBITS; q++) {
+        circuitAddMeasure(measured, q, q);
+    }
+    size_t savedBudget = getMemoryBudget();
+    setMemoryBudget(currentMemoryUsage() + NUM_SHOTS * sizeof(long long) + densityMatrixBytes(SHOT_QUBITS, 1) / 2);
+    ShotHistogram *h = runNoisyCircuitShots(measured, model, NUM_SHOTS, NULL, 99);
+    setMemoryBudget(savedBudget);
+    checkHistogram("qubit inattivi per strati (traiettorie)", h, probabilities);
+
+    freeShotHistogram(h);
+    freeCircuit(measured);
+    freeDensityMatrix(expected);
+    freeNoiseModel(model);
+}
+
+/*
+ * Budget illimitato (predefinito) con troppi qubit per la matrice densità: la scelta deve
+ * ricadere sulle traiettorie. X su tutti i qubit con defasamento (che non cambia le
+ * popolazioni) e H sul qubit 0: i bit 1..n-1 valgono sempre 1, il bit 0 è casuale.
+ */
+#define LARGE_SHOT_QUBITS 20
+#define LARGE_NUM_SHOTS 24
+
+static void testLargeNoisyShots(void) {
+    QuantumCircuit *c = createCircuit(LARGE_SHOT_QUBITS);
+    for (int q = 0; q < LARGE_SHOT_QUBITS; q++) {
+        circuitAddGate1(c, GATE_X, q);
+    }
+    circuitAddGate1(c, GATE_H, 0);
+    for (int q = 0; q < LARGE_SHOT_QUBITS; q++) {
+        circuitAddMeasure(c, q, q);
+    }
+    NoiseModel *model = createNoiseModel(LARGE_SHOT_QUBITS);
+    noiseModelAddGateChannel(model, GATE_X, NOISE_DEPHASING, 0.1);
+
+    size_t savedBudget = getMemoryBudget();
+    setMemoryBudget(0);
+    checkTrue("budget illimitato, 20 qubit: traiettorie",
+              chooseNoisyBackend(LARGE_SHOT_QUBITS, 1) == BACKEND_TRAJECTORIES);
+    ShotHistogram *h = runNoisyCircuitShots(c, model, LARGE_NUM_SHOTS, NULL, 7);
+    setMemoryBudget(savedBudget);
+
+    long long total = 0, ones = 0, wrong = 0;
+    long long high = ((1LL << LARGE_SHOT_QUBITS) - 1) & ~1LL;
+    for (int k = 0; k < h->numOutcomes; k++) {
+        total += h->outcomes[k].count;
+        if ((h->outcomes[k].value & ~1LL) != high) wrong += h->outcomes[k].count;
+        if (h->outcomes[k].value & 1) ones += h->outcomes[k].count;
+    }
+    checkTrue("20 qubit rumorosi: numero di esecuzioni", total == LARGE_NUM_SHOTS);
+    checkTrue("20 qubit rumorosi: bit 1..19 a 1", wrong == 0);
+    checkClose("20 qubit rumorosi: frequenza del bit 0", (double)ones / LARGE_NUM_SHOTS, 0.5,
+               5.0 * sqrt(0.25 / LARGE_NUM_SHOTS));
+
+    freeShotHistogram(h);
+    freeNoiseModel(model);
+    freeCircuit(c);
+}
+
+/* ---------------------------------------------------------------------------
+ * runQasmFileStreamingShots: misure finali campionate da una sola lettura, misure seguite
+ * da gate eseguite nel punto in cui il circuito smette di essere terminale
+ * ------------------------------------------------------------------------- */
+
+#define STREAM_FILE "kernel_tests_stream.qasm"
+
+static ShotHistogram* streamShots(const char *body, long long shots, QubitState **finalState) {
+    FILE *file = fopen(STREAM_FILE, "w");
+    if (!file) {
+        perror("Errore scrittura " STREAM_FILE);
+        exit(1);
+    }
+    fprintf(file, "OPENQASM 2.0;\ninclude \"qelib1.inc\";\nqreg q[2];\n%s", body);
+    fclose(file);
+    ShotHistogram *histogram = runQasmFileStreamingShots(STREAM_FILE, shots, finalState);
+    remove(STREAM_FILE);
+    return histogram;
+}
+
+/* Frequenze dei valori del registro a 2 bit confrontate con le probabilità attese
+   (5 errori standard). */
+static void checkTwoBitCounts(const char *description, const long long counts[4], long long shots,
+                              const double expected[4]) {
+    int ok = 1;
+    for (int v = 0; v < 4; v++) {
+        double sigma = sqrt(expected[v] * (1.0 - expected[v]) / shots);
+        if (fabs((double)counts[v] / shots - expected[v]) > 5.0 * sigma) ok = 0;
+    }
+    checkTrue(description, ok);
+}
+
+static void testStreamingShots(void) {
+    QubitState *state = NULL;
+    long long counts[4] = {0, 0, 0, 0};
+
+    // Coppia di Bell con misure finali: solo 00 e 11
+    ShotHistogram *histogram = streamShots("creg c[2];\nh q[0];\ncx q[0], q[1];\nbarrier q;\n"
+                                           "measure q[0] -> c[0];\nmeasure q[1] -> c[1];\n", 2000, &state);
+    for (int k = 0; k < histogram->numOutcomes; k++) {
+        counts[histogram->outcomes[k].value] += histogram->outcomes[k].count;
+    }
+    const double bell[4] = {0.5, 0.0, 0.0, 0.5};
+    checkTwoBitCounts("streaming con misure finali: istogramma della coppia di Bell", counts, 2000, bell);
+    freeShotHistogram(histogram);
+
+    // H dopo la misura: le misure rinviate vanno eseguite prima, e i due bit sono indipendenti.
+    // Un colpo per lettura, così ogni risultato viene dalla lettura con le misure rinviate.
+    for (int v = 0; v < 4; v++) counts[v] = 0;
+    for (int s = 0; s < 400; s++) {
+        histogram = streamShots("creg c[2];\nh q[0];\nmeasure q[0] -> c[0];\nh q[0];\n"
+                                "measure q[0] -> c[1];\n", 1, &state);
+        counts[histogram->outcomes[0].value]++;
+        freeShotHistogram(histogram);
+    }
+    const double independent[4] = {0.25, 0.25, 0.25, 0.25};
+    checkTwoBitCounts("streaming con gate dopo una misura: bit indipendenti", counts, 400, independent);
+
+    // Senza bit classici: nessun istogramma, lo stato finale |11>
+    histogram = streamShots("x q[0];\nx q[1];\n", 10, &state);
+    checkTrue("streaming senza bit classici: stato finale restituito",
+              histogram == NULL && state && cabs(state->amplitudes[3] - 1.0) < 1e-12);
+    freeState(state);
+}
+
+int main(void) {
+    srand(12345);
+    testBatched();
+    testAdjointGradient();
+    testQFT();
+    testClassicalOracle();
+    testTiledProduct();
+    testDensityGates();
+    testChannels();
+    testNoiseModel();
+    testMeasureDensity();
+    testPartialTrace();
+    testMetrics();
+    testTrajectories();
+    testIdleRelaxation();
+    testMemoryBudget();
+    testNoisyShots();
+    testIdleScheduling();
+    testLargeNoisyShots();
+    testStreamingShots();
+
+    printf("%d verifiche, %d fallite\n", numChecks, numFailures);
+    return numFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,19 @@
+// Misure intermedie, reset e istruzioni condizionate sui registri classici
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[3];
+creg c[2];
+creg d[1];
+x q[0];
+measure q[0] -> c[0];
+if (c == 1) x q[1];
+if (c == 2) x q[2];
+measure q[1] -> c[1];
+if (c == 3) x q[2];
+reset q[0];
+measure q[2] -> d[0];
+if (d == 1) reset q;
+if (d == 0) x q[1];
+if (d == 1) x q[0];
+measure q[0] -> c[0];
+measure q[1] -> c[1];
@@ -0,0 +1,35 @@
+// Algoritmo di Deutsch sulle quattro funzioni di un bit: costanti (0) e bilanciate (1)
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[2];
+creg c[4];
+x q[1];
+h q[0];
+h q[1];
+h q[0];
+measure q[0] -> c[0];
+reset q[0];
+reset q[1];
+x q[1];
+h q[0];
+h q[1];
+x q[1];
+h q[0];
+measure q[0] -> c[1];
+reset q[0];
+reset q[1];
+x q[1];
+h q[0];
+h q[1];
+cx q[0],q[1];
+h q[0];
+measure q[0] -> c[2];
+reset q[0];
+reset q[1];
+x q[1];
+h q[0];
+h q[1];
+x q[0];
+cx q[0],q[1];
+h q[0];
+measure q[0] -> c[3];
@@ -0,0 +1,14 @@
+// Estensione delle istruzioni ai registri interi (broadcast)
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg a[3];
+qreg b[3];
+h a;
+cx a, b;
+ry(0.4) b;
+cz a[0], b;
+crz(0.7) b, a[2];
+barrier a, b;
+u1(pi/3) a;
+swap a, b;
+rx(0.25) a[1];
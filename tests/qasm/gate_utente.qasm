@@ -0,0 +1,11 @@
+// Gate definiti dall'utente in un file incluso, con espressioni sui parametri
+OPENQASM 2.0;
+include "qelib1.inc";
+include "include/definizioni.inc";
+qreg q[3];
+tripla(0.5, -0.25) q[0], q[1], q[2];
+coppia(cos(pi/3)) q[2], q[0];
+tripla(1e-1, 2.5E-1) q[2], q[1], q[0];
+u1(-(pi)) q[1];
+rx(+0.2*-1) q[0];
+ry(2^-1^2) q[2];
@@ -0,0 +1,10 @@
+// Misure solo alla fine del circuito: i risultati vengono campionati dallo stato finale
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[3];
+creg c[3];
+x q[0];
+cx q[0], q[2];
+h q[1];
+h q[1];
+measure q -> c;
@@ -0,0 +1,26 @@
+// Gate a un qubit di OpenQASM e di qelib1.inc
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[3];
+h q[0];
+ry(0.3) q[1];
+rx(1.1) q[2];
+U(0.4, 0.5, 0.6) q[0];
+u3(0.7, -0.2, 0.9) q[1];
+u(1.3, 0.1, -0.4) q[2];
+u2(0.25, -1.5) q[0];
+u1(0.8) q[1];
+p(-0.6) q[2];
+id q[0];
+u0(1) q[1];
+x q[2];
+y q[0];
+z q[1];
+s q[2];
+sdg q[0];
+t q[1];
+tdg q[2];
+rz(0.35) q[0];
+sx q[1];
+sxdg q[2];
+h q[1];
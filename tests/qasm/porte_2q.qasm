@@ -0,0 +1,24 @@
+// Gate a due qubit di OpenQASM e di qelib1.inc, inclusi quelli definiti in QASM (rxx, rzz)
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[3];
+h q[0];
+ry(0.9) q[1];
+rx(-0.7) q[2];
+CX q[0], q[1];
+cx q[1], q[2];
+cy q[2], q[0];
+cz q[0], q[2];
+ch q[1], q[0];
+swap q[0], q[2];
+crx(0.6) q[0], q[1];
+cry(-1.2) q[1], q[2];
+crz(0.45) q[2], q[0];
+cu1(1.7) q[0], q[1];
+cp(-0.3) q[1], q[2];
+cu3(0.5, 0.2, -0.8) q[2], q[1];
+cu(0.9, -0.4, 0.3, 0.6) q[1], q[0];
+csx q[0], q[2];
+rxx(0.8) q[1], q[2];
+rzz(-1.1) q[0], q[1];
+h q[2];
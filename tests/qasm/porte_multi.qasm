@@ -0,0 +1,17 @@
+// Gate a tre o più qubit: Toffoli, Fredkin e i multi-controllati di qelib1.inc
+OPENQASM 2.0;
+include "qelib1.inc";
+qreg q[5];
+h q[0];
+h q[1];
+ry(1.9) q[2];
+rx(2.2) q[3];
+u3(1.4, 0.3, -0.5) q[4];
+ccx q[0], q[1], q[2];
+cswap q[2], q[3], q[4];
+rccx q[4], q[2], q[0];
+c3x q[0], q[1], q[2], q[3];
+c3sqrtx q[1], q[2], q[3], q[4];
+rc3x q[4], q[3], q[0], q[1];
+c4x q[0], q[1], q[2], q[3], q[4];
+h q[3];